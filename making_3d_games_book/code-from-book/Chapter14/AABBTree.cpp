@@ -0,0 +1,482 @@
+// ----------------------------------------------------------------
+// From Game Programming in C++ by Sanjay Madhav
+// Copyright (C) 2017 Sanjay Madhav. All rights reserved.
+// 
+// Released under the BSD License
+// See LICENSE in root directory for full details.
+// ----------------------------------------------------------------
+
+#include "AABBTree.h"
+#include "FrameAllocator.h"
+#include "Profiler.h"
+#include <algorithm>
+
+namespace
+{
+	AABB Union(const AABB& a, const AABB& b)
+	{
+		return AABB(Vector3(Math::Min(a.mMin.x, b.mMin.x),
+			Math::Min(a.mMin.y, b.mMin.y), Math::Min(a.mMin.z, b.mMin.z)),
+			Vector3(Math::Max(a.mMax.x, b.mMax.x),
+			Math::Max(a.mMax.y, b.mMax.y), Math::Max(a.mMax.z, b.mMax.z)));
+	}
+
+	float SurfaceArea(const AABB& box)
+	{
+		Vector3 d = box.mMax - box.mMin;
+		return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+	}
+
+	bool Contains(const AABB& outer, const AABB& inner)
+	{
+		return outer.mMin.x <= inner.mMin.x && outer.mMin.y <= inner.mMin.y &&
+			outer.mMin.z <= inner.mMin.z && inner.mMax.x <= outer.mMax.x &&
+			inner.mMax.y <= outer.mMax.y && inner.mMax.z <= outer.mMax.z;
+	}
+
+	// Slab test for where the segment enters the box
+	// (0 if it starts inside), false if it misses
+	bool SegmentEntry(const Vector3& start, const Vector3& delta,
+		const AABB& box, float maxT, float& outT)
+	{
+		float tMin = 0.0f;
+		float tMax = maxT;
+		const float* s = start.GetAsFloatPtr();
+		const float* d = delta.GetAsFloatPtr();
+		const float* bMin = box.mMin.GetAsFloatPtr();
+		const float* bMax = box.mMax.GetAsFloatPtr();
+		for (int i = 0; i < 3; i++)
+		{
+			if (Math::NearZero(d[i], 0.0f))
+			{
+				// Parallel to this slab, so it has to start inside it
+				if (s[i] < bMin[i] || s[i] > bMax[i])
+				{
+					return false;
+				}
+			}
+			else
+			{
+				float inv = 1.0f / d[i];
+				float t1 = (bMin[i] - s[i]) * inv;
+				float t2 = (bMax[i] - s[i]) * inv;
+				if (t1 > t2)
+				{
+					std::swap(t1, t2);
+				}
+				tMin = Math::Max(tMin, t1);
+				tMax = Math::Min(tMax, t2);
+				if (tMin > tMax)
+				{
+					return false;
+				}
+			}
+		}
+		outT = tMin;
+		return true;
+	}
+}
+
+AABBTree::AABBTree(float margin)
+	:mRoot(NullNode)
+	,mFreeList(NullNode)
+	,mMargin(margin)
+{
+}
+
+int AABBTree::AllocateNode()
+{
+	if (mFreeList == NullNode)
+	{
+		Node node{ AABB(Vector3::Zero, Vector3::Zero), nullptr,
+			NullNode, NullNode, NullNode, -1 };
+		node.mParent = mFreeList;
+		mNodes.emplace_back(node);
+		mFreeList = static_cast<int>(mNodes.size()) - 1;
+	}
+	int node = mFreeList;
+	mFreeList = mNodes[node].mParent;
+	mNodes[node].mParent = NullNode;
+	mNodes[node].mChild1 = NullNode;
+	mNodes[node].mChild2 = NullNode;
+	mNodes[node].mHeight = 0;
+	mNodes[node].mUserData = nullptr;
+	return node;
+}
+
+void AABBTree::FreeNode(int node)
+{
+	mNodes[node].mParent = mFreeList;
+	mNodes[node].mHeight = -1;
+	mFreeList = node;
+}
+
+int AABBTree::CreateProxy(const AABB& box, void* userData)
+{
+	int proxy = AllocateNode();
+	Vector3 margin(mMargin, mMargin, mMargin);
+	mNodes[proxy].mBox = AABB(box.mMin - margin, box.mMax + margin);
+	mNodes[proxy].mUserData = userData;
+	InsertLeaf(proxy);
+	return proxy;
+}
+
+void AABBTree::DestroyProxy(int proxy)
+{
+	RemoveLeaf(proxy);
+	FreeNode(proxy);
+}
+
+bool AABBTree::MoveProxy(int proxy, const AABB& box)
+{
+	// Still inside the fat box, so nothing to do
+	if (Contains(mNodes[proxy].mBox, box))
+	{
+		return false;
+	}
+	RemoveLeaf(proxy);
+	Vector3 margin(mMargin, mMargin, mMargin);
+	mNodes[proxy].mBox = AABB(box.mMin - margin, box.mMax + margin);
+	InsertLeaf(proxy);
+	return true;
+}
+
+void AABBTree::InsertLeaf(int leaf)
+{
+	if (mRoot == NullNode)
+	{
+		mRoot = leaf;
+		mNodes[leaf].mParent = NullNode;
+		return;
+	}
+
+	// Walk down to the best sibling, choosing whichever child
+	// grows the total surface area the least
+	AABB leafBox = mNodes[leaf].mBox;
+	int index = mRoot;
+	while (!mNodes[index].IsLeaf())
+	{
+		int child1 = mNodes[index].mChild1;
+		int child2 = mNodes[index].mChild2;
+
+		float area = SurfaceArea(mNodes[index].mBox);
+		float combinedArea = SurfaceArea(Union(mNodes[index].mBox, leafBox));
+		// Cost of making a new parent for this node and the leaf
+		float cost = 2.0f * combinedArea;
+		// Least cost of pushing the leaf further down
+		float inheritCost = 2.0f * (combinedArea - area);
+
+		float cost1 = SurfaceArea(Union(leafBox, mNodes[child1].mBox)) + inheritCost;
+		if (!mNodes[child1].IsLeaf())
+		{
+			cost1 -= SurfaceArea(mNodes[child1].mBox);
+		}
+		float cost2 = SurfaceArea(Union(leafBox, mNodes[child2].mBox)) + inheritCost;
+		if (!mNodes[child2].IsLeaf())
+		{
+			cost2 -= SurfaceArea(mNodes[child2].mBox);
+		}
+
+		if (cost < cost1 && cost < cost2)
+		{
+			break;
+		}
+		index = cost1 < cost2 ? child1 : child2;
+	}
+	int sibling = index;
+
+	// Make a new parent for the sibling and the leaf
+	int oldParent = mNodes[sibling].mParent;
+	int newParent = AllocateNode();
+	mNodes[newParent].mParent = oldParent;
+	mNodes[newParent].mBox = Union(leafBox, mNodes[sibling].mBox);
+	mNodes[newParent].mHeight = mNodes[sibling].mHeight + 1;
+	mNodes[newParent].mChild1 = sibling;
+	mNodes[newParent].mChild2 = leaf;
+	mNodes[sibling].mParent = newParent;
+	mNodes[leaf].mParent = newParent;
+	if (oldParent == NullNode)
+	{
+		mRoot = newParent;
+	}
+	else if (mNodes[oldParent].mChild1 == sibling)
+	{
+		mNodes[oldParent].mChild1 = newParent;
+	}
+	else
+	{
+		mNodes[oldParent].mChild2 = newParent;
+	}
+
+	Refit(mNodes[leaf].mParent);
+}
+
+void AABBTree::RemoveLeaf(int leaf)
+{
+	if (leaf == mRoot)
+	{
+		mRoot = NullNode;
+		return;
+	}
+
+	// The sibling takes the parent's place
+	int parent = mNodes[leaf].mParent;
+	int grandParent = mNodes[parent].mParent;
+	int sibling = mNodes[parent].mChild1 == leaf ?
+		mNodes[parent].mChild2 : mNodes[parent].mChild1;
+	if (grandParent == NullNode)
+	{
+		mRoot = sibling;
+		mNodes[sibling].mParent = NullNode;
+		FreeNode(parent);
+		return;
+	}
+	if (mNodes[grandParent].mChild1 == parent)
+	{
+		mNodes[grandParent].mChild1 = sibling;
+	}
+	else
+	{
+		mNodes[grandParent].mChild2 = sibling;
+	}
+	mNodes[sibling].mParent = grandParent;
+	FreeNode(parent);
+
+	Refit(grandParent);
+}
+
+void AABBTree::Refit(int node)
+{
+	while (node != NullNode)
+	{
+		node = Balance(node);
+		int child1 = mNodes[node].mChild1;
+		int child2 = mNodes[node].mChild2;
+		mNodes[node].mHeight = 1 + std::max(mNodes[child1].mHeight, mNodes[child2].mHeight);
+		mNodes[node].mBox = Union(mNodes[child1].mBox, mNodes[child2].mBox);
+		node = mNodes[node].mParent;
+	}
+}
+
+int AABBTree::Balance(int a)
+{
+	// a has children b and c, b has d and e, c has f and g.
+	// If one child is 2+ taller than the other, the taller child
+	// moves up into a's place (and a takes its shorter grandchild)
+	if (mNodes[a].IsLeaf() || mNodes[a].mHeight < 2)
+	{
+		return a;
+	}
+	int b = mNodes[a].mChild1;
+	int c = mNodes[a].mChild2;
+	int balance = mNodes[c].mHeight - mNodes[b].mHeight;
+	if (balance > 1)
+	{
+		// Rotate c up
+		int f = mNodes[c].mChild1;
+		int g = mNodes[c].mChild2;
+		mNodes[c].mChild1 = a;
+		mNodes[c].mParent = mNodes[a].mParent;
+		mNodes[a].mParent = c;
+		int cParent = mNodes[c].mParent;
+		if (cParent == NullNode)
+		{
+			mRoot = c;
+		}
+		else if (mNodes[cParent].mChild1 == a)
+		{
+			mNodes[cParent].mChild1 = c;
+		}
+		else
+		{
+			mNodes[cParent].mChild2 = c;
+		}
+
+		// Keep the taller of f and g under c
+		if (mNodes[f].mHeight < mNodes[g].mHeight)
+		{
+			std::swap(f, g);
+		}
+		mNodes[c].mChild2 = f;
+		mNodes[a].mChild2 = g;
+		mNodes[g].mParent = a;
+		mNodes[a].mBox = Union(mNodes[b].mBox, mNodes[g].mBox);
+		mNodes[c].mBox = Union(mNodes[a].mBox, mNodes[f].mBox);
+		mNodes[a].mHeight = 1 + std::max(mNodes[b].mHeight, mNodes[g].mHeight);
+		mNodes[c].mHeight = 1 + std::max(mNodes[a].mHeight, mNodes[f].mHeight);
+		return c;
+	}
+	if (balance < -1)
+	{
+		// Rotate b up
+		int d = mNodes[b].mChild1;
+		int e = mNodes[b].mChild2;
+		mNodes[b].mChild1 = a;
+		mNodes[b].mParent = mNodes[a].mParent;
+		mNodes[a].mParent = b;
+		int bParent = mNodes[b].mParent;
+		if (bParent == NullNode)
+		{
+			mRoot = b;
+		}
+		else if (mNodes[bParent].mChild1 == a)
+		{
+			mNodes[bParent].mChild1 = b;
+		}
+		else
+		{
+			mNodes[bParent].mChild2 = b;
+		}
+
+		if (mNodes[d].mHeight < mNodes[e].mHeight)
+		{
+			std::swap(d, e);
+		}
+		mNodes[b].mChild2 = d;
+		mNodes[a].mChild1 = e;
+		mNodes[e].mParent = a;
+		mNodes[a].mBox = Union(mNodes[c].mBox, mNodes[e].mBox);
+		mNodes[b].mBox = Union(mNodes[a].mBox, mNodes[d].mBox);
+		mNodes[a].mHeight = 1 + std::max(mNodes[c].mHeight, mNodes[e].mHeight);
+		mNodes[b].mHeight = 1 + std::max(mNodes[a].mHeight, mNodes[d].mHeight);
+		return b;
+	}
+	return a;
+}
+
+void AABBTree::Query(const AABB& box, const std::function<bool(int proxy)>& f) const
+{
+	if (mRoot == NullNode)
+	{
+		return;
+	}
+	// Scratch stack (can be on any thread, so it's per-thread memory)
+	FrameVector<int> stack;
+	stack.reserve(64);
+	stack.emplace_back(mRoot);
+	while (!stack.empty())
+	{
+		int node = stack.back();
+		stack.pop_back();
+		if (Intersect(mNodes[node].mBox, box))
+		{
+			if (mNodes[node].IsLeaf())
+			{
+				if (!f(node))
+				{
+					return;
+				}
+			}
+			else
+			{
+				stack.emplace_back(mNodes[node].mChild1);
+				stack.emplace_back(mNodes[node].mChild2);
+			}
+		}
+	}
+}
+
+void AABBTree::Query(const Sphere& sphere, const std::function<bool(int proxy)>& f) const
+{
+	if (mRoot == NullNode)
+	{
+		return;
+	}
+	FrameVector<int> stack;
+	stack.reserve(64);
+	stack.emplace_back(mRoot);
+	while (!stack.empty())
+	{
+		int node = stack.back();
+		stack.pop_back();
+		if (Intersect(sphere, mNodes[node].mBox))
+		{
+			if (mNodes[node].IsLeaf())
+			{
+				if (!f(node))
+				{
+					return;
+				}
+			}
+			else
+			{
+				stack.emplace_back(mNodes[node].mChild1);
+				stack.emplace_back(mNodes[node].mChild2);
+			}
+		}
+	}
+}
+
+void AABBTree::RayCast(const LineSegment& l, const std::function<float(int proxy, float maxT)>& f) const
+{
+	RayCastPacket(&l, 1, [&f](int /*segment*/, int proxy, float maxT) {
+		return f(proxy, maxT);
+	});
+}
+
+void AABBTree::RayCastPacket(const LineSegment* segments, int count,
+	const std::function<float(int segment, int proxy, float maxT)>& f) const
+{
+	PROFILE_SCOPE("AABBTree::RayCastPacket");
+	if (mRoot == NullNode)
+	{
+		return;
+	}
+	Vector3 deltas[MaxPacketSize];
+	float maxTs[MaxPacketSize];
+	// Bit per segment that's still going
+	int active = 0;
+	for (int i = 0; i < count; i++)
+	{
+		deltas[i] = segments[i].mEnd - segments[i].mStart;
+		maxTs[i] = 1.0f;
+		active |= 1 << i;
+	}
+	FrameVector<int> stack;
+	stack.reserve(64);
+	stack.emplace_back(mRoot);
+	while (!stack.empty() && active != 0)
+	{
+		int node = stack.back();
+		stack.pop_back();
+		// Which segments reach this node before their closest hit so far?
+		int reached = 0;
+		for (int i = 0; i < count; i++)
+		{
+			float t;
+			if ((active & (1 << i)) &&
+				SegmentEntry(segments[i].mStart, deltas[i], mNodes[node].mBox, maxTs[i], t))
+			{
+				reached |= 1 << i;
+			}
+		}
+		if (reached == 0)
+		{
+			continue;
+		}
+		if (mNodes[node].IsLeaf())
+		{
+			for (int i = 0; i < count; i++)
+			{
+				if (reached & (1 << i))
+				{
+					maxTs[i] = f(i, node, maxTs[i]);
+					if (maxTs[i] <= 0.0f)
+					{
+						active &= ~(1 << i);
+					}
+				}
+			}
+		}
+		else
+		{
+			stack.emplace_back(mNodes[node].mChild1);
+			stack.emplace_back(mNodes[node].mChild2);
+		}
+	}
+}
+
+int AABBTree::GetHeight() const
+{
+	return mRoot == NullNode ? 0 : mNodes[mRoot].mHeight;
+}
@@ -0,0 +1,79 @@
+// ----------------------------------------------------------------
+// From Game Programming in C++ by Sanjay Madhav
+// Copyright (C) 2017 Sanjay Madhav. All rights reserved.
+// 
+// Released under the BSD License
+// See LICENSE in root directory for full details.
+// ----------------------------------------------------------------
+
+#pragma once
+#include <vector>
+#include <functional>
+#include "Collision.h"
+
+// Dynamic bounding volume hierarchy. Each leaf holds a "fat" box
+// (the real box plus a margin), so a box that only moves a little
+// doesn't need to change the tree. Inserts pick the sibling that
+// grows the tree's surface area the least, and rotations keep the
+// tree balanced, so queries are logarithmic in the number of leaves.
+class AABBTree
+{
+public:
+	static const int NullNode = -1;
+
+	AABBTree(float margin = 10.0f);
+
+	// Add a leaf for this box (returns its proxy id)
+	int CreateProxy(const AABB& box, void* userData);
+	void DestroyProxy(int proxy);
+	// Returns true if the box left its fat box, so the leaf moved
+	bool MoveProxy(int proxy, const AABB& box);
+
+	void* GetUserData(int proxy) const { return mNodes[proxy].mUserData; }
+	const AABB& GetFatBox(int proxy) const { return mNodes[proxy].mBox; }
+
+	// Calls f for every leaf whose fat box overlaps. f returns false to stop.
+	void Query(const AABB& box, const std::function<bool(int proxy)>& f) const;
+	void Query(const Sphere& sphere, const std::function<bool(int proxy)>& f) const;
+	// Calls f for every leaf whose fat box the segment hits, at
+	// t <= the current max t (which starts at 1). f returns the new
+	// max t, so returning the t of a hit skips anything further away,
+	// and returning 0 stops.
+	void RayCast(const LineSegment& l, const std::function<float(int proxy, float maxT)>& f) const;
+	// Same as RayCast, but walks the tree once for a packet of up to
+	// MaxPacketSize segments (which should be close together, since
+	// a node is visited if any of them reaches it)
+	static const int MaxPacketSize = 8;
+	void RayCastPacket(const LineSegment* segments, int count,
+		const std::function<float(int segment, int proxy, float maxT)>& f) const;
+
+	// 0 for an empty tree or a single leaf
+	int GetHeight() const;
+private:
+	struct Node
+	{
+		bool IsLeaf() const { return mChild1 == NullNode; }
+		AABB mBox;
+		void* mUserData;
+		// Parent (or next free node, if this node's free)
+		int mParent;
+		int mChild1;
+		int mChild2;
+		// Leaves are 0, free nodes are -1
+		int mHeight;
+	};
+	int AllocateNode();
+	void FreeNode(int node);
+	void InsertLeaf(int leaf);
+	void RemoveLeaf(int leaf);
+	// Rotate the tree at this node if it's unbalanced,
+	// returns the node that's now in its place
+	int Balance(int node);
+	// Fix up boxes and heights from this node to the root
+	void Refit(int node);
+
+	std::vector<Node> mNodes;
+	int mRoot;
+	int mFreeList;
+	float mMargin;
+};
@@ -10,6 +10,11 @@
 #include "Game.h"
 #include "Component.h"
 #include "LevelLoader.h"
+#include "Profiler.h"
+#include "CommandBuffer.h"
+#include "PoolAllocator.h"
+#include <algorithm>
+#include <SDL/SDL_log.h>
 
 const char* Actor::TypeNames[NUM_ACTOR_TYPES] = {
 	"Actor",
@@ -19,36 +24,64 @@ const char* Actor::TypeNames[NUM_ACTOR_TYPES] = {
 	"TargetActor",
 };
 
+PoolAllocator& Actor::GetPool()
+{
+	// Made on first use, so it's always there before any actor
+	static PoolAllocator pool("Actor");
+	return pool;
+}
+
+void* Actor::operator new(size_t size)
+{
+	return GetPool().Allocate(size);
+}
+
+void Actor::operator delete(void* ptr, size_t size)
+{
+	GetPool().Free(ptr, size);
+}
+
 Actor::Actor(Game* game)
 	:mState(EActive)
-	,mPosition(Vector3::Zero)
-	,mRotation(Quaternion::Identity)
-	,mScale(1.0f)
+	,mTransforms(game->GetTransformStore())
+	,mParent(nullptr)
 	,mGame(game)
-	,mRecomputeTransform(true)
+	,mGameIndex(0)
+	,mIsPending(false)
 {
+	mTransformIndex = mTransforms->Add(this);
 	mGame->AddActor(this);
 }
 
 Actor::~Actor()
 {
 	mGame->RemoveActor(this);
+	// Children stay where they are, but move up to this actor's parent
+	Vector3 pos = GetPosition();
+	Quaternion rot = GetRotation();
+	float scale = GetScale();
+	while (!mChildren.empty())
+	{
+		Actor* child = mChildren.back();
+		child->SetPosition(Vector3::Transform(child->GetPosition() * scale, rot) + pos);
+		child->SetRotation(Quaternion::Concatenate(child->GetRotation(), rot));
+		child->SetScale(child->GetScale() * scale);
+		child->AttachTo(mParent);
+	}
+	Detach();
 	// Need to delete components
 	// Because ~Component calls RemoveComponent, need a different style loop
 	while (!mComponents.empty())
 	{
 		delete mComponents.back();
 	}
+	mTransforms->Remove(mTransformIndex);
 }
 
 void Actor::Update(float deltaTime)
 {
 	if (mState == EActive)
 	{
-		if (mRecomputeTransform)
-		{
-			ComputeWorldTransform();
-		}
 		UpdateComponents(deltaTime);
 		UpdateActor(deltaTime);
 	}
@@ -56,8 +89,10 @@ void Actor::Update(float deltaTime)
 
 void Actor::UpdateComponents(float deltaTime)
 {
+	PROFILE_SCOPE(TypeNames[GetType()]);
 	for (auto comp : mComponents)
 	{
+		PROFILE_SCOPE(Component::TypeNames[comp->GetType()]);
 		comp->Update(deltaTime);
 	}
 }
@@ -85,16 +120,36 @@ void Actor::ActorInput(const uint8_t* keyState)
 
 }
 
+void Actor::OnTriggerEnter(Actor* /*other*/)
+{
+}
+
+void Actor::OnTriggerExit(Actor* /*other*/)
+{
+}
+
+void Actor::SetState(State state)
+{
+	// Other job threads might be looking at this actor
+	if (mGame->IsUpdatingInParallel())
+	{
+		mGame->GetCommandBuffer()->Push([this, state] { mState = state; });
+	}
+	else
+	{
+		mState = state;
+	}
+}
+
 void Actor::ComputeWorldTransform()
 {
-	mRecomputeTransform = false;
-	// Scale, then rotate, then translate
-	mWorldTransform = Matrix4::CreateScale(mScale);
-	mWorldTransform *= Matrix4::CreateFromQuaternion(mRotation);
-	mWorldTransform *= Matrix4::CreateTranslation(mPosition);
+	mTransforms->ComputeWorldTransform(mTransformIndex);
+}
 
+void Actor::NotifyWorldTransform()
+{
 	// Inform components world transform updated
-	for (auto comp : mComponents)
+	for (auto comp : mTransformListeners)
 	{
 		comp->OnUpdateWorldTransform();
 	}
@@ -124,6 +179,93 @@ void Actor::RotateToNewForward(const Vector3& forward)
 	}
 }
 
+Vector3 Actor::GetWorldPosition() const
+{
+	if (mParent)
+	{
+		return Vector3::Transform(GetPosition(), mParent->GetWorldTransform());
+	}
+	return GetPosition();
+}
+
+void Actor::SetWorldPosition(const Vector3& pos)
+{
+	if (mParent)
+	{
+		// Undo the parent's transform to get back to parent space
+		Matrix4 toParent = mParent->GetWorldTransform();
+		toParent.Invert();
+		SetPosition(Vector3::Transform(pos, toParent));
+	}
+	else
+	{
+		SetPosition(pos);
+	}
+}
+
+float Actor::GetWorldScale() const
+{
+	if (mParent)
+	{
+		return GetScale() * mParent->GetWorldScale();
+	}
+	return GetScale();
+}
+
+Quaternion Actor::GetWorldRotation() const
+{
+	if (mParent)
+	{
+		// Our rotation, followed by the parent's
+		return Quaternion::Concatenate(GetRotation(), mParent->GetWorldRotation());
+	}
+	return GetRotation();
+}
+
+void Actor::SetWorldRotation(const Quaternion& rotation)
+{
+	if (mParent)
+	{
+		// Follow the rotation by the inverse of the parent's
+		Quaternion inv = mParent->GetWorldRotation();
+		inv.Conjugate();
+		SetRotation(Quaternion::Concatenate(rotation, inv));
+	}
+	else
+	{
+		SetRotation(rotation);
+	}
+}
+
+void Actor::AttachTo(Actor* parent)
+{
+	// Don't allow attaching to ourselves or anything under us
+	for (Actor* a = parent; a != nullptr; a = a->mParent)
+	{
+		if (a == this)
+		{
+			SDL_Log("Can't attach an actor to its own descendant");
+			return;
+		}
+	}
+
+	if (mParent)
+	{
+		auto iter = std::find(mParent->mChildren.begin(), mParent->mChildren.end(), this);
+		if (iter != mParent->mChildren.end())
+		{
+			mParent->mChildren.erase(iter);
+		}
+	}
+	mParent = parent;
+	if (mParent)
+	{
+		mParent->mChildren.emplace_back(this);
+	}
+	mTransforms->SetParent(mTransformIndex,
+		mParent ? mParent->mTransformIndex : TransformStore::InvalidIndex);
+}
+
 void Actor::AddComponent(Component* component)
 {
 	// Find the insertion point in the sorted vector
@@ -151,6 +293,17 @@ void Actor::RemoveComponent(Component* component)
 	{
 		mComponents.erase(iter);
 	}
+
+	iter = std::find(mTransformListeners.begin(), mTransformListeners.end(), component);
+	if (iter != mTransformListeners.end())
+	{
+		mTransformListeners.erase(iter);
+	}
+}
+
+void Actor::AddTransformListener(Component* component)
+{
+	mTransformListeners.emplace_back(component);
 }
 
 void Actor::LoadProperties(const rapidjson::Value& inObj)
@@ -174,9 +327,15 @@ void Actor::LoadProperties(const rapidjson::Value& inObj)
 	}
 
 	// Load position, rotation, and scale, and compute transform
-	JsonHelper::GetVector3(inObj, "position", mPosition);
-	JsonHelper::GetQuaternion(inObj, "rotation", mRotation);
-	JsonHelper::GetFloat(inObj, "scale", mScale);
+	Vector3 pos = GetPosition();
+	Quaternion rot = GetRotation();
+	float scale = GetScale();
+	JsonHelper::GetVector3(inObj, "position", pos);
+	JsonHelper::GetQuaternion(inObj, "rotation", rot);
+	JsonHelper::GetFloat(inObj, "scale", scale);
+	SetPosition(pos);
+	SetRotation(rot);
+	SetScale(scale);
 	ComputeWorldTransform();
 }
 
@@ -193,7 +352,7 @@ void Actor::SaveProperties(rapidjson::Document::AllocatorType& alloc, rapidjson:
 	}
 
 	JsonHelper::AddString(alloc, inObj, "state", state);
-	JsonHelper::AddVector3(alloc, inObj, "position", mPosition);
-	JsonHelper::AddQuaternion(alloc, inObj, "rotation", mRotation);
-	JsonHelper::AddFloat(alloc, inObj, "scale", mScale);
+	JsonHelper::AddVector3(alloc, inObj, "position", GetPosition());
+	JsonHelper::AddQuaternion(alloc, inObj, "rotation", GetRotation());
+	JsonHelper::AddFloat(alloc, inObj, "scale", GetScale());
 }
@@ -11,6 +11,8 @@
 #include "Math.h"
 #include <rapidjson/document.h>
 #include "Component.h"
+#include "ActorHandle.h"
+#include "TransformStore.h"
 
 class Actor
 {
@@ -38,6 +40,11 @@ public:
 	Actor(class Game* game);
 	virtual ~Actor();
 
+	// Actors (of any subclass) come from a pool, not the general heap
+	static void* operator new(size_t size);
+	static void operator delete(void* ptr, size_t size);
+	static class PoolAllocator& GetPool();
+
 	// Update function called from Game (not overridable)
 	void Update(float deltaTime);
 	// Updates all the components attached to the actor (not overridable)
@@ -48,32 +55,64 @@ public:
 	void ProcessInput(const uint8_t* keyState);
 	// Any actor-specific input code (overridable)
 	virtual void ActorInput(const uint8_t* keyState);
-
-	// Getters/setters
-	const Vector3& GetPosition() const { return mPosition; }
-	void SetPosition(const Vector3& pos) { mPosition = pos; mRecomputeTransform = true; }
-	float GetScale() const { return mScale; }
-	void SetScale(float scale) { mScale = scale; mRecomputeTransform = true; }
-	const Quaternion& GetRotation() const { return mRotation; }
-	void SetRotation(const Quaternion& rotation) { mRotation = rotation;   mRecomputeTransform = true; }
+	// Called from Game on an actor with a trigger box, when another
+	// actor's box starts/stops overlapping it (overridable)
+	virtual void OnTriggerEnter(class Actor* other);
+	virtual void OnTriggerExit(class Actor* other);
+
+	// Getters/setters (the transform itself lives in the game's TransformStore)
+	Vector3 GetPosition() const { return mTransforms->GetPosition(mTransformIndex); }
+	void SetPosition(const Vector3& pos) { mTransforms->SetPosition(mTransformIndex, pos); }
+	float GetScale() const { return mTransforms->GetScale(mTransformIndex); }
+	void SetScale(float scale) { mTransforms->SetScale(mTransformIndex, scale); }
+	Quaternion GetRotation() const { return mTransforms->GetRotation(mTransformIndex); }
+	void SetRotation(const Quaternion& rotation) { mTransforms->SetRotation(mTransformIndex, rotation); }
 	
+	// Recompute the world transform right away
+	// (otherwise, the game recomputes changed ones in a batch)
 	void ComputeWorldTransform();
-	const Matrix4& GetWorldTransform() const { return mWorldTransform; }
+	const Matrix4& GetWorldTransform() const { return mTransforms->GetWorldTransform(mTransformIndex); }
+
+	// Transform to draw with (interpolated between simulation steps)
+	const Matrix4& GetRenderTransform() const { return mTransforms->GetRenderTransform(mTransformIndex); }
+
+	// World-space position/scale/rotation (same as the above
+	// getters/setters unless the actor is attached to a parent)
+	Vector3 GetWorldPosition() const;
+	void SetWorldPosition(const Vector3& pos);
+	float GetWorldScale() const;
+	Quaternion GetWorldRotation() const;
+	void SetWorldRotation(const Quaternion& rotation);
 
-	Vector3 GetForward() const { return Vector3::Transform(Vector3::UnitX, mRotation); }
-	Vector3 GetRight() const { return Vector3::Transform(Vector3::UnitY, mRotation); }
+	Vector3 GetForward() const { return Vector3::Transform(Vector3::UnitX, GetRotation()); }
+	Vector3 GetRight() const { return Vector3::Transform(Vector3::UnitY, GetRotation()); }
 
 	void RotateToNewForward(const Vector3& forward);
 
+	// Attach to a parent actor. Position/rotation/scale are then
+	// relative to the parent (they aren't changed by attaching).
+	void AttachTo(Actor* parent);
+	void Detach() { AttachTo(nullptr); }
+	Actor* GetParent() const { return mParent; }
+	const std::vector<Actor*>& GetChildren() const { return mChildren; }
+
 	State GetState() const { return mState; }
-	void SetState(State state) { mState = state; }
+	// (During a parallel update, the change waits for the sync point)
+	void SetState(State state);
+	// Pending actors were added mid-update, and don't update until
+	// the game moves them to its active actors
+	bool IsPending() const { return mIsPending; }
 
 	class Game* GetGame() { return mGame; }
+	const ActorHandle& GetHandle() const { return mHandle; }
 
 
 	// Add/remove components
 	void AddComponent(class Component* component);
 	void RemoveComponent(class Component* component);
+	// Components that need OnUpdateWorldTransform add themselves here
+	// (it's only called for these, not every component)
+	void AddTransformListener(class Component* component);
 
 	// Load/Save
 	virtual void LoadProperties(const rapidjson::Value& inObj);
@@ -113,13 +152,25 @@ private:
 	// Actor's state
 	State mState;
 
+	// Tell listening components the world transform changed
+	void NotifyWorldTransform();
+
 	// Transform
-	Matrix4 mWorldTransform;
-	Vector3 mPosition;
-	Quaternion mRotation;
-	float mScale;
-	bool mRecomputeTransform;
+	friend class TransformStore;
+	TransformStore* mTransforms;
+	uint32_t mTransformIndex;
+	// Hierarchy
+	Actor* mParent;
+	std::vector<Actor*> mChildren;
 
 	std::vector<Component*> mComponents;
+	std::vector<Component*> mTransformListeners;
 	class Game* mGame;
+
+	// Game manages the handle and where the actor is in its lists
+	friend class Game;
+	ActorHandle mHandle;
+	// Index in the game's active (or pending) actors
+	size_t mGameIndex;
+	bool mIsPending;
 };
@@ -0,0 +1,42 @@
+// ----------------------------------------------------------------
+// From Game Programming in C++ by Sanjay Madhav
+// Copyright (C) 2017 Sanjay Madhav. All rights reserved.
+// 
+// Released under the BSD License
+// See LICENSE in root directory for full details.
+// ----------------------------------------------------------------
+
+#pragma once
+#include <cstdint>
+
+// Safe reference to an actor. Game::GetActor returns null for
+// a handle once its actor is deleted (even if the slot the actor
+// was in now holds a different actor).
+struct ActorHandle
+{
+	ActorHandle()
+		:mIndex(0)
+		,mGeneration(0)
+	{
+	}
+
+	ActorHandle(uint32_t index, uint32_t generation)
+		:mIndex(index)
+		,mGeneration(generation)
+	{
+	}
+
+	bool operator==(const ActorHandle& other) const
+	{
+		return mIndex == other.mIndex && mGeneration == other.mGeneration;
+	}
+	bool operator!=(const ActorHandle& other) const
+	{
+		return !(*this == other);
+	}
+
+	// Slot in the game's actor registry
+	uint32_t mIndex;
+	// Which use of that slot this is (0 is never valid)
+	uint32_t mGeneration;
+};
@@ -11,6 +11,7 @@
 #include <rapidjson/document.h>
 #include <SDL/SDL_log.h>
 #include "LevelLoader.h"
+#include "Profiler.h"
 
 bool Animation::Load(const std::string& fileName)
 {
@@ -115,12 +116,9 @@ bool Animation::Load(const std::string& fileName)
 	return true;
 }
 
-void Animation::GetGlobalPoseAtTime(std::vector<Matrix4>& outPoses, const Skeleton* inSkeleton, float inTime) const
+void Animation::GetGlobalPoseAtTime(Matrix4* outPoses, const Skeleton* inSkeleton, float inTime) const
 {
-	if (outPoses.size() != mNumBones)
-	{
-		outPoses.resize(mNumBones);
-	}
+	PROFILE_SCOPE("Animation::GetGlobalPoseAtTime");
 
 	// Figure out the current frame index and next frame
 	// (This assumes inTime is bounded by [0, AnimDuration]
@@ -14,6 +14,7 @@
 AudioComponent::AudioComponent(Actor* owner, int updateOrder)
 	:Component(owner, updateOrder)
 {
+	mOwner->AddTransformListener(this);
 }
 
 AudioComponent::~AudioComponent()
@@ -7,6 +7,7 @@
 // ----------------------------------------------------------------
 
 #include "AudioSystem.h"
+#include "Game.h"
 #include <SDL/SDL_log.h>
 #include <fmod_studio.hpp>
 #include <fmod_errors.h>
@@ -27,6 +28,13 @@ AudioSystem::~AudioSystem()
 
 bool AudioSystem::Initialize()
 {
+	// A headless game runs with no FMOD system (so no banks or events)
+	if (mGame->IsHeadless())
+	{
+		SDL_Log("Audio system running headless");
+		return true;
+	}
+
 	// Initialize debug logging
 	FMOD::Debug_Initialize(
 		FMOD_DEBUG_LEVEL_ERROR, // Log only errors
@@ -261,7 +269,10 @@ void AudioSystem::Update(float deltaTime)
 	}
 
 	// Update FMOD
-	mSystem->update();
+	if (mSystem)
+	{
+		mSystem->update();
+	}
 }
 
 namespace
@@ -280,6 +291,10 @@ namespace
 
 void AudioSystem::SetListener(const Matrix4& viewMatrix)
 {
+	if (!mSystem)
+	{
+		return;
+	}
 	// Invert the view matrix to get the correct vectors
 	Matrix4 invView = viewMatrix;
 	invView.Invert();
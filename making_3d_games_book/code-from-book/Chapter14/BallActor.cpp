@@ -14,6 +14,8 @@
 #include "BallMove.h"
 #include "AudioComponent.h"
 #include "LevelLoader.h"
+#include "CommandBuffer.h"
+#include "BoxComponent.h"
 
 BallActor::BallActor(Game* game)
 	:Actor(game)
@@ -23,6 +25,13 @@ BallActor::BallActor(Game* game)
 	MeshComponent* mc = new MeshComponent(this);
 	Mesh* mesh = GetGame()->GetRenderer()->GetMesh("Assets/Sphere.gpmesh");
 	mc->SetMesh(mesh);
+	// Swept every step, so the ball can't pass through anything.
+	// It's on its own layer so other casts can skip it.
+	BoxComponent* bc = new BoxComponent(this);
+	bc->SetObjectBox(mesh->GetBox());
+	bc->SetShouldRotate(false);
+	bc->SetContinuous(true);
+	bc->SetLayer(BoxComponent::ProjectileLayer);
 	BallMove* move = new BallMove(this);
 	move->SetForwardSpeed(1500.0f);
 	mAudioComp = new AudioComponent(this);
@@ -41,6 +50,15 @@ void BallActor::UpdateActor(float deltaTime)
 
 void BallActor::HitTarget()
 {
+	// The audio system isn't thread-safe, so on a job
+	// thread this waits for the sync point
+	if (GetGame()->IsUpdatingInParallel())
+	{
+		GetGame()->GetCommandBuffer()->Push([this] {
+			mAudioComp->PlayEvent("event:/Ding");
+		});
+		return;
+	}
 	mAudioComp->PlayEvent("event:/Ding");
 }
 
@@ -12,6 +12,7 @@
 #include "PhysWorld.h"
 #include "TargetActor.h"
 #include "BallActor.h"
+#include "BoxComponent.h"
 
 BallMove::BallMove(Actor* owner)
 	:MoveComponent(owner)
@@ -20,18 +21,26 @@ BallMove::BallMove(Actor* owner)
 
 void BallMove::Update(float deltaTime)
 {
+	BoxComponent* box = static_cast<BoxComponent*>(
+		mOwner->GetComponentOfType(Component::TBoxComponent));
+	if (box && box->IsContinuous())
+	{
+		UpdateContinuous(deltaTime, box);
+		return;
+	}
+
 	const float segmentLength = 30.0f;
 	PhysWorld* phys = mOwner->GetGame()->GetPhysWorld();
 
 	// Construct segment in direction of travel
-	Vector3 start = mOwner->GetPosition();
+	Vector3 start = mOwner->GetWorldPosition();
 	Vector3 dir = mOwner->GetForward();
 	Vector3 end = start + dir * segmentLength;
 	// Create line segment
 	LineSegment l(start, end);
 	// Test segment vs world
 	PhysWorld::CollisionInfo info;
-	if (phys->SegmentCast(l, info))
+	if (phys->SegmentCast(l, info, BoxComponent::DefaultLayer))
 	{
 		// If we collided, reflect the ball about the normal
 		dir = Vector3::Reflect(dir, info.mNormal);
@@ -45,3 +54,56 @@ void BallMove::Update(float deltaTime)
 	}
 	MoveComponent::Update(deltaTime);
 }
+
+void BallMove::UpdateContinuous(float deltaTime, BoxComponent* box)
+{
+	// Most bounces in one step (so it can't bounce forever in a corner)
+	const int maxBounces = 4;
+	PhysWorld* phys = mOwner->GetGame()->GetPhysWorld();
+	// The box fits around the ball
+	const AABB& objectBox = box->GetObjectBox();
+	float radius = (objectBox.mMax.x - objectBox.mMin.x) * 0.5f * mOwner->GetWorldScale();
+
+	// Balls only move forward, so this covers all of MoveComponent
+	Vector3 pos = mOwner->GetWorldPosition();
+	Vector3 dir = mOwner->GetForward();
+	float remaining = mForwardSpeed * deltaTime;
+	// Other balls are on another layer, and this one's own box is skipped
+	PhysWorld::QueryFilter filter(BoxComponent::DefaultLayer);
+	filter.Ignore(mOwner);
+	for (int i = 0; i < maxBounces && remaining > 0.0f; i++)
+	{
+		PhysWorld::CollisionInfo info;
+		if (!phys->SweepSphere(Sphere(pos, radius), dir * remaining, info, filter))
+		{
+			pos += dir * remaining;
+			break;
+		}
+		// Move up to the hit, and reflect the rest of the move about the normal
+		pos += dir * (remaining * info.mT);
+		remaining *= 1.0f - info.mT;
+		dir = Vector3::Reflect(dir, info.mNormal);
+		mOwner->RotateToNewForward(dir);
+		// Did we hit a target?
+		TargetActor* target = dynamic_cast<TargetActor*>(info.mActor);
+		if (target)
+		{
+			static_cast<BallActor*>(mOwner)->HitTarget();
+		}
+	}
+	mOwner->SetWorldPosition(pos);
+}
+
+void BallMove::BounceOff(const Vector3& normal, const Vector3& delta, float t)
+{
+	// The rest of the step's move is lost, but it's one frame
+	Vector3 pos = mOwner->GetWorldPosition() - delta * (1.0f - t);
+	Vector3 dir = mOwner->GetForward();
+	// (Unless it was already heading away)
+	if (Vector3::Dot(dir, normal) < 0.0f)
+	{
+		dir = Vector3::Reflect(dir, normal);
+		mOwner->RotateToNewForward(dir);
+	}
+	mOwner->SetWorldPosition(pos);
+}
@@ -15,6 +15,13 @@ public:
 	BallMove(class Actor* owner);
 
 	void Update(float deltaTime) override;
+	// Sweep the ball along its whole move for the step
+	// (for balls with a continuous box)
+	void UpdateContinuous(float deltaTime, class BoxComponent* box);
+	// Something moving hit the ball during the last step (from
+	// PhysWorld::TestContinuous), so go back to where they touched
+	// and bounce off it. normal points from it toward the ball.
+	void BounceOff(const Vector3& normal, const Vector3& delta, float t);
 
 	TypeID GetType() const override { return TBallMove; }
 protected:
@@ -0,0 +1,899 @@
+// ----------------------------------------------------------------
+// From Game Programming in C++ by Sanjay Madhav
+// Copyright (C) 2017 Sanjay Madhav. All rights reserved.
+// 
+// Released under the BSD License
+// See LICENSE in root directory for full details.
+// ----------------------------------------------------------------
+
+#include "Benchmark.h"
+#include "HeapStats.h"
+#include "BoxKernels.h"
+#include "Game.h"
+#include "Actor.h"
+#include "BoxComponent.h"
+#include "PhysWorld.h"
+#include "DynamicsWorld.h"
+#include "RigidBodyComponent.h"
+#include "TransformStore.h"
+#include "JobSystem.h"
+#include "FrameAllocator.h"
+#include "RenderQueue.h"
+#include <SDL/SDL.h>
+#include <rapidjson/document.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/prettywriter.h>
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+#include <random>
+#include <utility>
+#include <cmath>
+
+const char* Benchmark::PhaseNames[NumPhases] = {
+	"ProcessInput",
+	"UpdateActors",
+	"PendingActors",
+	"Physics",
+	"AudioUpdate",
+	"UIUpdate",
+	"DrawExtract"
+};
+
+const char* Benchmark::DistributionNames[NumDistributions] = {
+	"uniform",
+	"clustered",
+	"corridor"
+};
+
+Benchmark::Benchmark(int numFrames, float deltaTime)
+	:mNumFrames(numFrames)
+	,mDeltaTime(deltaTime)
+	,mNumActors(0)
+	,mNumThreads(1)
+	,mFrameStartAllocs(0)
+	,mCurrentPhase(EProcessInput)
+	,mPhaseStart(0)
+	,mFrameStart(0)
+	,mCullTested(0)
+	,mCullVisible(0)
+	,mDraws(0)
+	,mInstances(0)
+	,mProgramBinds(0)
+	,mTextureBinds(0)
+	,mVAOBinds(0)
+{
+	// Reserve up front so recording doesn't allocate mid-run
+	for (auto& samples : mPhaseSamples)
+	{
+		samples.reserve(numFrames);
+	}
+	mFrameSamples.reserve(numFrames);
+	mHeapAllocSamples.reserve(numFrames);
+}
+
+void Benchmark::BeginFrame()
+{
+	mFrameStartAllocs = HeapStats::GetNumAllocs();
+	mFrameStart = SDL_GetPerformanceCounter();
+}
+
+void Benchmark::EndFrame()
+{
+	mFrameSamples.emplace_back(SDL_GetPerformanceCounter() - mFrameStart);
+	mHeapAllocSamples.emplace_back(HeapStats::GetNumAllocs() - mFrameStartAllocs);
+}
+
+void Benchmark::BeginPhase(Phase phase)
+{
+	mCurrentPhase = phase;
+	mPhaseStart = SDL_GetPerformanceCounter();
+}
+
+void Benchmark::EndPhase()
+{
+	Uint64 elapsed = SDL_GetPerformanceCounter() - mPhaseStart;
+	mPhaseSamples[mCurrentPhase].emplace_back(elapsed);
+}
+
+void Benchmark::AddCullSample(size_t tested, size_t visible)
+{
+	mCullTested += tested;
+	mCullVisible += visible;
+}
+
+void Benchmark::AddRenderSample(const RenderStats& stats)
+{
+	mDraws += stats.mDraws;
+	mInstances += stats.mInstances;
+	mProgramBinds += stats.mProgramBinds;
+	mTextureBinds += stats.mTextureBinds;
+	mVAOBinds += stats.mVAOBinds;
+}
+
+namespace
+{
+	// Adds summary statistics (in microseconds) for the samples to the object
+	void AddStats(rapidjson::Document::AllocatorType& alloc,
+		rapidjson::Value& outObject, std::vector<Uint64> samples)
+	{
+		double toUs = 1000000.0 / static_cast<double>(SDL_GetPerformanceFrequency());
+		double total = 0.0;
+		double mean = 0.0;
+		double minUs = 0.0;
+		double medianUs = 0.0;
+		double p95Us = 0.0;
+		double maxUs = 0.0;
+		if (!samples.empty())
+		{
+			std::sort(samples.begin(), samples.end());
+			for (auto s : samples)
+			{
+				total += s * toUs;
+			}
+			size_t count = samples.size();
+			mean = total / count;
+			minUs = samples.front() * toUs;
+			medianUs = samples[count / 2] * toUs;
+			p95Us = samples[std::min(count - 1, count * 95 / 100)] * toUs;
+			maxUs = samples.back() * toUs;
+		}
+		outObject.AddMember("samples", static_cast<unsigned>(samples.size()), alloc);
+		outObject.AddMember("totalMs", total / 1000.0, alloc);
+		outObject.AddMember("meanUs", mean, alloc);
+		outObject.AddMember("minUs", minUs, alloc);
+		outObject.AddMember("medianUs", medianUs, alloc);
+		outObject.AddMember("p95Us", p95Us, alloc);
+		outObject.AddMember("maxUs", maxUs, alloc);
+	}
+}
+
+namespace
+{
+	bool WriteDocument(const rapidjson::Document& doc, const std::string& fileName)
+	{
+		// Save JSON to string buffer
+		rapidjson::StringBuffer buffer;
+		rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+		doc.Accept(writer);
+		const char* output = buffer.GetString();
+
+		if (fileName.empty())
+		{
+			printf("%s\n", output);
+			return true;
+		}
+
+		std::ofstream outFile(fileName);
+		if (!outFile.is_open())
+		{
+			SDL_Log("Failed to write benchmark results to %s", fileName.c_str());
+			return false;
+		}
+		outFile << output;
+		return true;
+	}
+
+	// Nanoseconds per box test
+	double TicksToNs(Uint64 ticks, size_t numTests)
+	{
+		return ticks * 1000000000.0 /
+			(static_cast<double>(SDL_GetPerformanceFrequency()) * numTests);
+	}
+}
+
+bool Benchmark::WriteJSON(const std::string& fileName) const
+{
+	rapidjson::Document doc;
+	doc.SetObject();
+	auto& alloc = doc.GetAllocator();
+
+	rapidjson::Value level;
+	level.SetString(mLevelName.c_str(), alloc);
+	doc.AddMember("level", level, alloc);
+	doc.AddMember("frames", static_cast<unsigned>(mFrameSamples.size()), alloc);
+	doc.AddMember("deltaTime", mDeltaTime, alloc);
+	doc.AddMember("actors", static_cast<unsigned>(mNumActors), alloc);
+	doc.AddMember("threads", mNumThreads, alloc);
+
+	// Per-phase timings
+	rapidjson::Value phases(rapidjson::kObjectType);
+	for (int i = 0; i < NumPhases; i++)
+	{
+		rapidjson::Value phase(rapidjson::kObjectType);
+		AddStats(alloc, phase, mPhaseSamples[i]);
+		phases.AddMember(rapidjson::StringRef(PhaseNames[i]), phase, alloc);
+	}
+	doc.AddMember("phases", phases, alloc);
+
+	// Whole frame timings
+	rapidjson::Value frame(rapidjson::kObjectType);
+	AddStats(alloc, frame, mFrameSamples);
+	doc.AddMember("frame", frame, alloc);
+
+	// General heap allocations (a steady-state frame should have none,
+	// so everything after lastFrameWithAllocs is allocation free)
+	Uint64 totalAllocs = 0;
+	unsigned framesWithAllocs = 0;
+	int lastFrameWithAllocs = -1;
+	for (size_t i = 0; i < mHeapAllocSamples.size(); i++)
+	{
+		if (mHeapAllocSamples[i] > 0)
+		{
+			totalAllocs += mHeapAllocSamples[i];
+			framesWithAllocs++;
+			lastFrameWithAllocs = static_cast<int>(i);
+		}
+	}
+	rapidjson::Value heap(rapidjson::kObjectType);
+	heap.AddMember("total", static_cast<uint64_t>(totalAllocs), alloc);
+	heap.AddMember("framesWithAllocs", framesWithAllocs, alloc);
+	heap.AddMember("lastFrameWithAllocs", lastFrameWithAllocs, alloc);
+	doc.AddMember("heapAllocs", heap, alloc);
+
+	// Frustum culling, averaged over the frames
+	double numFrames = std::max<size_t>(1, mFrameSamples.size());
+	rapidjson::Value culling(rapidjson::kObjectType);
+	culling.AddMember("testedPerFrame", mCullTested / numFrames, alloc);
+	culling.AddMember("visiblePerFrame", mCullVisible / numFrames, alloc);
+	doc.AddMember("culling", culling, alloc);
+
+	// 3D scene draws and binds, averaged over the frames
+	rapidjson::Value rendering(rapidjson::kObjectType);
+	rendering.AddMember("drawsPerFrame", mDraws / numFrames, alloc);
+	rendering.AddMember("instancesPerFrame", mInstances / numFrames, alloc);
+	rendering.AddMember("programBindsPerFrame", mProgramBinds / numFrames, alloc);
+	rendering.AddMember("textureBindsPerFrame", mTextureBinds / numFrames, alloc);
+	rendering.AddMember("vaoBindsPerFrame", mVAOBinds / numFrames, alloc);
+	doc.AddMember("rendering", rendering, alloc);
+
+	return WriteDocument(doc, fileName);
+}
+
+bool Benchmark::WriteKernelJSON(const std::string& fileName, size_t numBoxes)
+{
+	const int NumQueries = 256;
+	// Same boxes every run, spread out about as much as a level's
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> posDist(-2000.0f, 2000.0f);
+	std::uniform_real_distribution<float> sizeDist(10.0f, 100.0f);
+	auto randomBox = [&rng, &posDist, &sizeDist]() {
+		Vector3 center(posDist(rng), posDist(rng), posDist(rng) * 0.1f);
+		Vector3 extents(sizeDist(rng), sizeDist(rng), sizeDist(rng));
+		return AABB(center - extents, center + extents);
+	};
+	std::vector<AABB> boxes;
+	BoxArrays boxArrays;
+	boxArrays.Resize(numBoxes);
+	for (size_t i = 0; i < numBoxes; i++)
+	{
+		boxes.emplace_back(randomBox());
+		boxArrays.Set(i, boxes.back());
+	}
+	std::vector<AABB> queryBoxes;
+	std::vector<LineSegment> segments;
+	for (int i = 0; i < NumQueries; i++)
+	{
+		queryBoxes.emplace_back(randomBox());
+		Vector3 start(posDist(rng), posDist(rng), posDist(rng) * 0.1f);
+		Vector3 end(posDist(rng), posDist(rng), posDist(rng) * 0.1f);
+		segments.emplace_back(start, end);
+	}
+	size_t numTests = numBoxes * NumQueries;
+	std::vector<uint32_t> hits(numBoxes);
+
+	rapidjson::Document doc;
+	doc.SetObject();
+	auto& alloc = doc.GetAllocator();
+	doc.AddMember("boxes", static_cast<unsigned>(numBoxes), alloc);
+	doc.AddMember("queries", NumQueries, alloc);
+	doc.AddMember("bestLevel",
+		rapidjson::StringRef(BoxKernels::GetLevelName(BoxKernels::GetBestLevel())), alloc);
+
+	// The scalar routines, one box at a time
+	size_t scalarOverlaps = 0;
+	Uint64 start = SDL_GetPerformanceCounter();
+	for (const AABB& query : queryBoxes)
+	{
+		for (const AABB& box : boxes)
+		{
+			if (Intersect(query, box))
+			{
+				scalarOverlaps++;
+			}
+		}
+	}
+	Uint64 overlapTicks = SDL_GetPerformanceCounter() - start;
+
+	size_t scalarHits = 0;
+	start = SDL_GetPerformanceCounter();
+	for (const LineSegment& l : segments)
+	{
+		float closestT = Math::Infinity;
+		for (const AABB& box : boxes)
+		{
+			float t;
+			Vector3 norm;
+			if (Intersect(l, box, t, norm) && t < closestT)
+			{
+				closestT = t;
+			}
+		}
+		if (closestT <= 1.0f)
+		{
+			scalarHits++;
+		}
+	}
+	Uint64 segmentTicks = SDL_GetPerformanceCounter() - start;
+
+	rapidjson::Value scalar(rapidjson::kObjectType);
+	scalar.AddMember("overlapNs", TicksToNs(overlapTicks, numTests), alloc);
+	scalar.AddMember("segmentNs", TicksToNs(segmentTicks, numTests), alloc);
+	scalar.AddMember("overlaps", static_cast<unsigned>(scalarOverlaps), alloc);
+	scalar.AddMember("segmentHits", static_cast<unsigned>(scalarHits), alloc);
+	doc.AddMember("intersect", scalar, alloc);
+
+	// The kernels, at each level
+	BoxKernels::Level oldLevel = BoxKernels::GetLevel();
+	rapidjson::Value levels(rapidjson::kObjectType);
+	for (int i = BoxKernels::EScalar; i <= BoxKernels::GetBestLevel(); i++)
+	{
+		BoxKernels::Level level = static_cast<BoxKernels::Level>(i);
+		BoxKernels::SetLevel(level);
+
+		size_t overlaps = 0;
+		start = SDL_GetPerformanceCounter();
+		for (const AABB& query : queryBoxes)
+		{
+			overlaps += BoxKernels::OverlapBox(boxArrays, 0, numBoxes, query, hits.data());
+		}
+		Uint64 kernelOverlapTicks = SDL_GetPerformanceCounter() - start;
+
+		size_t segmentHits = 0;
+		start = SDL_GetPerformanceCounter();
+		for (const LineSegment& l : segments)
+		{
+			float t;
+			size_t index;
+			if (BoxKernels::SegmentCast(boxArrays, 0, numBoxes, l, t, index))
+			{
+				segmentHits++;
+			}
+		}
+		Uint64 kernelSegmentTicks = SDL_GetPerformanceCounter() - start;
+
+		rapidjson::Value stats(rapidjson::kObjectType);
+		stats.AddMember("overlapNs", TicksToNs(kernelOverlapTicks, numTests), alloc);
+		stats.AddMember("segmentNs", TicksToNs(kernelSegmentTicks, numTests), alloc);
+		stats.AddMember("overlaps", static_cast<unsigned>(overlaps), alloc);
+		stats.AddMember("segmentHits", static_cast<unsigned>(segmentHits), alloc);
+		stats.AddMember("overlapSpeedup", static_cast<double>(overlapTicks) /
+			std::max<Uint64>(1, kernelOverlapTicks), alloc);
+		stats.AddMember("segmentSpeedup", static_cast<double>(segmentTicks) /
+			std::max<Uint64>(1, kernelSegmentTicks), alloc);
+		levels.AddMember(rapidjson::StringRef(BoxKernels::GetLevelName(level)), stats, alloc);
+	}
+	BoxKernels::SetLevel(oldLevel);
+	doc.AddMember("kernels", levels, alloc);
+
+	return WriteDocument(doc, fileName);
+}
+
+bool Benchmark::GetDistribution(const std::string& name, Distribution& outDist)
+{
+	for (int i = 0; i < NumDistributions; i++)
+	{
+		if (name == DistributionNames[i])
+		{
+			outDist = static_cast<Distribution>(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+Benchmark::PhysicsSettings::PhysicsSettings()
+	:mNumBoxes(1000)
+	,mDistribution(EUniform)
+	,mMoveFraction(0.1f)
+	,mSpeed(200.0f)
+	,mNumFrames(100)
+	,mDeltaTime(1.0f / 60.0f)
+	,mNumSegments(1024)
+	,mPairwiseMaxBoxes(20000)
+{
+}
+
+namespace
+{
+	enum PhysicsPhase
+	{
+		ERefit,
+		EBroadphase,
+		ESweepAndPrune,
+		EPairwise,
+		ETree,
+		ENarrowphase,
+		ESegmentCast,
+		NumPhysicsPhases
+	};
+	const char* PhysicsPhaseNames[NumPhysicsPhases] = {
+		"refit",
+		"broadphase",
+		"sweepAndPrune",
+		"pairwise",
+		"tree",
+		"narrowphase",
+		"segmentCast"
+	};
+
+	// A box the benchmark moves around
+	struct Mover
+	{
+		Actor* mActor;
+		Vector3 mVelocity;
+	};
+
+	typedef std::vector<std::pair<Actor*, Actor*>> ActorPairs;
+
+	void AddActorPair(ActorPairs& pairs, Actor* a, Actor* b)
+	{
+		if (b < a)
+		{
+			std::swap(a, b);
+		}
+		pairs.emplace_back(a, b);
+	}
+
+	// Sorts the pairs, and drops the ones where neither actor
+	// moves (the broadphase never pairs two static boxes)
+	void FinishPairs(ActorPairs& pairs, const std::vector<Actor*>& movers)
+	{
+		pairs.erase(std::remove_if(pairs.begin(), pairs.end(),
+			[&movers](const std::pair<Actor*, Actor*>& p) {
+				return !std::binary_search(movers.begin(), movers.end(), p.first) &&
+					!std::binary_search(movers.begin(), movers.end(), p.second);
+			}), pairs.end());
+		std::sort(pairs.begin(), pairs.end());
+	}
+}
+
+bool Benchmark::WritePhysicsJSON(Game* game, const PhysicsSettings& settings,
+	const std::string& fileName)
+{
+	// Roughly this far apart on average, with boxes 20-80 across
+	const float Spacing = 100.0f;
+	size_t numBoxes = settings.mNumBoxes;
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> unitDist(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> sizeDist(10.0f, 40.0f);
+
+	// Every box stays inside these bounds
+	Vector3 halfSize;
+	switch (settings.mDistribution)
+	{
+	case ECorridor:
+		halfSize = Vector3(0.5f * Spacing * numBoxes / 16.0f, 2.0f * Spacing, 2.0f * Spacing);
+		break;
+	default:
+	{
+		float half = 0.5f * Spacing * std::cbrt(static_cast<float>(numBoxes));
+		halfSize = Vector3(half, half, half);
+		break;
+	}
+	}
+	auto randomPoint = [&rng, &unitDist](const Vector3& half) {
+		return Vector3(unitDist(rng) * half.x, unitDist(rng) * half.y, unitDist(rng) * half.z);
+	};
+
+	std::vector<Vector3> clusters;
+	if (settings.mDistribution == EClustered)
+	{
+		size_t numClusters = std::max<size_t>(1, numBoxes / 256);
+		for (size_t i = 0; i < numClusters; i++)
+		{
+			clusters.emplace_back(randomPoint(halfSize));
+		}
+	}
+	std::normal_distribution<float> clusterDist(0.0f, 2.0f * Spacing);
+
+	// Build the world
+	Uint64 start = SDL_GetPerformanceCounter();
+	size_t numMovers = static_cast<size_t>(settings.mMoveFraction * numBoxes);
+	std::vector<Mover> movers;
+	movers.reserve(numMovers);
+	std::vector<BoxComponent*> boxes;
+	boxes.reserve(numBoxes);
+	for (size_t i = 0; i < numBoxes; i++)
+	{
+		Vector3 pos;
+		if (settings.mDistribution == EClustered)
+		{
+			pos = clusters[rng() % clusters.size()];
+			pos += Vector3(clusterDist(rng), clusterDist(rng), clusterDist(rng));
+			pos.x = Math::Clamp(pos.x, -halfSize.x, halfSize.x);
+			pos.y = Math::Clamp(pos.y, -halfSize.y, halfSize.y);
+			pos.z = Math::Clamp(pos.z, -halfSize.z, halfSize.z);
+		}
+		else
+		{
+			pos = randomPoint(halfSize);
+		}
+		Vector3 extents(sizeDist(rng), sizeDist(rng), sizeDist(rng));
+
+		Actor* actor = new Actor(game);
+		actor->SetPosition(pos);
+		BoxComponent* box = new BoxComponent(actor);
+		box->SetObjectBox(AABB(extents * -1.0f, extents));
+		boxes.emplace_back(box);
+		if (i < numMovers)
+		{
+			Mover m;
+			m.mActor = actor;
+			m.mVelocity = randomPoint(Vector3(1.0f, 1.0f, 1.0f)) * settings.mSpeed;
+			movers.emplace_back(m);
+		}
+		else
+		{
+			box->SetStatic(true);
+		}
+	}
+	TransformStore* transforms = game->GetTransformStore();
+	PhysWorld* phys = game->GetPhysWorld();
+	transforms->UpdateWorldTransforms();
+	phys->UpdateBroadphase();
+	Uint64 buildTicks = SDL_GetPerformanceCounter() - start;
+
+	std::vector<Actor*> moverActors;
+	for (const Mover& m : movers)
+	{
+		moverActors.emplace_back(m.mActor);
+	}
+	std::sort(moverActors.begin(), moverActors.end());
+
+	// Same segments every frame, through the whole world
+	std::vector<LineSegment> segments;
+	for (size_t i = 0; i < settings.mNumSegments; i++)
+	{
+		segments.emplace_back(randomPoint(halfSize), randomPoint(halfSize));
+	}
+	std::vector<PhysWorld::CollisionInfo> segmentHits(segments.size());
+
+	bool runPairwise = numBoxes <= settings.mPairwiseMaxBoxes;
+	std::vector<Uint64> samples[NumPhysicsPhases];
+	for (auto& s : samples)
+	{
+		s.reserve(settings.mNumFrames);
+	}
+	ActorPairs sapPairs;
+	ActorPairs pairwisePairs;
+	ActorPairs treePairs;
+	std::vector<BoxComponent*> overlaps;
+	size_t totalPairs = 0;
+	size_t maxPairs = 0;
+	size_t totalContacts = 0;
+	size_t totalSegmentHits = 0;
+	int mismatchedFrames = 0;
+	int firstMismatch = -1;
+	float dt = settings.mDeltaTime;
+
+	for (int frame = 0; frame < settings.mNumFrames; frame++)
+	{
+		// Move the movers, bouncing off the bounds
+		for (Mover& m : movers)
+		{
+			Vector3 pos = m.mActor->GetPosition() + m.mVelocity * dt;
+			float* p = &pos.x;
+			float* v = &m.mVelocity.x;
+			const float* half = &halfSize.x;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				if (p[axis] > half[axis] || p[axis] < -half[axis])
+				{
+					p[axis] = Math::Clamp(p[axis], -half[axis], half[axis]);
+					v[axis] = -v[axis];
+				}
+			}
+			m.mActor->SetPosition(pos);
+		}
+
+		start = SDL_GetPerformanceCounter();
+		transforms->UpdateWorldTransforms();
+		Uint64 now = SDL_GetPerformanceCounter();
+		samples[ERefit].emplace_back(now - start);
+
+		start = now;
+		phys->UpdateBroadphase();
+		now = SDL_GetPerformanceCounter();
+		samples[EBroadphase].emplace_back(now - start);
+
+		sapPairs.clear();
+		start = now;
+		phys->TestSweepAndPrune([&sapPairs](Actor* a, Actor* b) {
+			AddActorPair(sapPairs, a, b);
+		});
+		now = SDL_GetPerformanceCounter();
+		samples[ESweepAndPrune].emplace_back(now - start);
+
+		if (runPairwise)
+		{
+			pairwisePairs.clear();
+			start = now;
+			phys->TestPairwise([&pairwisePairs](Actor* a, Actor* b) {
+				AddActorPair(pairwisePairs, a, b);
+			});
+			now = SDL_GetPerformanceCounter();
+			samples[EPairwise].emplace_back(now - start);
+		}
+
+		// The tree, one box at a time (finds each pair from both sides)
+		treePairs.clear();
+		start = now;
+		for (BoxComponent* box : boxes)
+		{
+			overlaps.clear();
+			phys->OverlapBox(box->GetWorldBox(), overlaps);
+			for (BoxComponent* other : overlaps)
+			{
+				if (box->GetOwner() < other->GetOwner())
+				{
+					treePairs.emplace_back(box->GetOwner(), other->GetOwner());
+				}
+			}
+		}
+		now = SDL_GetPerformanceCounter();
+		samples[ETree].emplace_back(now - start);
+
+		size_t contacts = 0;
+		start = now;
+		phys->ForEachPair([phys, &contacts](BoxComponent* a, BoxComponent* b) {
+			ContactManifold manifold;
+			if (phys->GetContact(a, b, manifold))
+			{
+				contacts += manifold.mNumPoints;
+			}
+		});
+		now = SDL_GetPerformanceCounter();
+		samples[ENarrowphase].emplace_back(now - start);
+
+		start = now;
+		totalSegmentHits += phys->SegmentCastBatch(segments.data(), nullptr,
+			segments.size(), segmentHits.data());
+		now = SDL_GetPerformanceCounter();
+		samples[ESegmentCast].emplace_back(now - start);
+
+		// Every broadphase should have found the same pairs
+		std::sort(sapPairs.begin(), sapPairs.end());
+		FinishPairs(treePairs, moverActors);
+		bool match = sapPairs == treePairs;
+		if (runPairwise)
+		{
+			FinishPairs(pairwisePairs, moverActors);
+			match = match && sapPairs == pairwisePairs;
+		}
+		if (!match)
+		{
+			mismatchedFrames++;
+			if (firstMismatch < 0)
+			{
+				firstMismatch = frame;
+			}
+		}
+
+		totalPairs += sapPairs.size();
+		maxPairs = std::max(maxPairs, sapPairs.size());
+		totalContacts += contacts;
+		FrameAllocator::ResetAll();
+	}
+
+	rapidjson::Document doc;
+	doc.SetObject();
+	auto& alloc = doc.GetAllocator();
+	doc.AddMember("boxes", static_cast<unsigned>(numBoxes), alloc);
+	doc.AddMember("distribution",
+		rapidjson::StringRef(DistributionNames[settings.mDistribution]), alloc);
+	doc.AddMember("moving", static_cast<unsigned>(numMovers), alloc);
+	doc.AddMember("speed", settings.mSpeed, alloc);
+	doc.AddMember("frames", settings.mNumFrames, alloc);
+	doc.AddMember("deltaTime", settings.mDeltaTime, alloc);
+	doc.AddMember("segments", static_cast<unsigned>(segments.size()), alloc);
+	doc.AddMember("threads", game->GetJobSystem()->GetNumThreads(), alloc);
+	doc.AddMember("buildMs", buildTicks * 1000.0 /
+		static_cast<double>(SDL_GetPerformanceFrequency()), alloc);
+
+	rapidjson::Value phases(rapidjson::kObjectType);
+	for (int i = 0; i < NumPhysicsPhases; i++)
+	{
+		// Phases that were skipped are left out
+		if (!samples[i].empty())
+		{
+			rapidjson::Value phase(rapidjson::kObjectType);
+			AddStats(alloc, phase, samples[i]);
+			phases.AddMember(rapidjson::StringRef(PhysicsPhaseNames[i]), phase, alloc);
+		}
+	}
+	doc.AddMember("phases", phases, alloc);
+
+	double numFrames = std::max(1, settings.mNumFrames);
+	rapidjson::Value pairs(rapidjson::kObjectType);
+	pairs.AddMember("mean", totalPairs / numFrames, alloc);
+	pairs.AddMember("max", static_cast<unsigned>(maxPairs), alloc);
+	doc.AddMember("pairs", pairs, alloc);
+	doc.AddMember("contactsPerFrame", totalContacts / numFrames, alloc);
+	doc.AddMember("segmentHitsPerFrame", totalSegmentHits / numFrames, alloc);
+	doc.AddMember("pairwiseChecked", runPairwise, alloc);
+	doc.AddMember("pairsMatch", mismatchedFrames == 0, alloc);
+	doc.AddMember("mismatchedFrames", mismatchedFrames, alloc);
+
+	bool success = WriteDocument(doc, fileName);
+	if (mismatchedFrames > 0)
+	{
+		SDL_Log("Broadphases disagreed on %d frames (first was frame %d)",
+			mismatchedFrames, firstMismatch);
+		success = false;
+	}
+	return success;
+}
+
+Benchmark::StackSettings::StackSettings()
+	:mNumBoxes(100)
+	,mStackHeight(10)
+	,mNumFrames(600)
+	,mDeltaTime(1.0f / 60.0f)
+{
+}
+
+bool Benchmark::WriteStackJSON(Game* game, const StackSettings& settings,
+	const std::string& fileName)
+{
+	// 50 unit cubes (half a player tall), in towers 150 apart
+	const float HalfSize = 25.0f;
+	const float Spacing = 150.0f;
+	// Dropped from just above where they rest
+	const float Gap = 1.0f;
+	const double FrameBudgetMs = 1000.0 / 60.0;
+	size_t stackHeight = std::max<size_t>(1, settings.mStackHeight);
+	size_t numStacks = (settings.mNumBoxes + stackHeight - 1) / stackHeight;
+	size_t perRow = static_cast<size_t>(std::ceil(std::sqrt(static_cast<float>(numStacks))));
+	float rowStart = -0.5f * Spacing * (perRow - 1);
+
+	// A static floor under every tower, with its top at z = 0
+	float floorHalf = 0.5f * Spacing * perRow + HalfSize;
+	Actor* floor = new Actor(game);
+	floor->SetPosition(Vector3(0.0f, 0.0f, -HalfSize));
+	BoxComponent* floorBox = new BoxComponent(floor);
+	floorBox->SetObjectBox(AABB(Vector3(-floorHalf, -floorHalf, -HalfSize),
+		Vector3(floorHalf, floorHalf, HalfSize)));
+	floorBox->SetStatic(true);
+
+	std::vector<RigidBodyComponent*> bodies;
+	bodies.reserve(settings.mNumBoxes);
+	for (size_t i = 0; i < settings.mNumBoxes; i++)
+	{
+		size_t stack = i / stackHeight;
+		size_t level = i % stackHeight;
+		Vector3 pos(rowStart + Spacing * (stack % perRow),
+			rowStart + Spacing * (stack / perRow),
+			HalfSize + level * (2.0f * HalfSize + Gap) + Gap);
+
+		Actor* actor = new Actor(game);
+		actor->SetPosition(pos);
+		BoxComponent* box = new BoxComponent(actor);
+		box->SetObjectBox(AABB(Vector3(-HalfSize, -HalfSize, -HalfSize),
+			Vector3(HalfSize, HalfSize, HalfSize)));
+		bodies.emplace_back(new RigidBodyComponent(actor));
+	}
+	game->GetTransformStore()->UpdateWorldTransforms();
+	game->GetPhysWorld()->UpdateBroadphase();
+
+	DynamicsWorld* dynamics = game->GetDynamicsWorld();
+	std::vector<Uint64> samples;
+	samples.reserve(settings.mNumFrames);
+	size_t totalAwake = 0;
+	size_t maxAwake = 0;
+	size_t totalIslands = 0;
+	size_t maxIslands = 0;
+	size_t totalContacts = 0;
+	size_t maxContacts = 0;
+	int asleepFrame = -1;
+	int overBudgetFrames = 0;
+	double ticksPerMs = SDL_GetPerformanceFrequency() / 1000.0;
+
+	for (int frame = 0; frame < settings.mNumFrames; frame++)
+	{
+		// Step keeps the transforms and broadphase up to date itself
+		Uint64 start = SDL_GetPerformanceCounter();
+		dynamics->Step(settings.mDeltaTime);
+		Uint64 ticks = SDL_GetPerformanceCounter() - start;
+		samples.emplace_back(ticks);
+		if (ticks / ticksPerMs > FrameBudgetMs)
+		{
+			overBudgetFrames++;
+		}
+
+		size_t awake = dynamics->GetNumAwake();
+		totalAwake += awake;
+		maxAwake = std::max(maxAwake, awake);
+		totalIslands += dynamics->GetNumIslands();
+		maxIslands = std::max(maxIslands, dynamics->GetNumIslands());
+		totalContacts += dynamics->GetNumContacts();
+		maxContacts = std::max(maxContacts, dynamics->GetNumContacts());
+		if (awake == 0 && asleepFrame < 0)
+		{
+			asleepFrame = frame;
+		}
+		else if (awake > 0)
+		{
+			asleepFrame = -1;
+		}
+		FrameAllocator::ResetAll();
+	}
+
+	// How the towers ended up
+	size_t sleeping = 0;
+	size_t fellThrough = 0;
+	size_t toppled = 0;
+	for (size_t i = 0; i < bodies.size(); i++)
+	{
+		RigidBodyComponent* body = bodies[i];
+		if (!body->IsAwake())
+		{
+			sleeping++;
+		}
+		Vector3 pos = body->GetOwner()->GetWorldPosition();
+		if (pos.z < 0.0f)
+		{
+			fellThrough++;
+		}
+		size_t stack = i / stackHeight;
+		Vector3 base(rowStart + Spacing * (stack % perRow),
+			rowStart + Spacing * (stack / perRow), pos.z);
+		if ((pos - base).LengthSq() > HalfSize * HalfSize)
+		{
+			toppled++;
+		}
+	}
+
+	rapidjson::Document doc;
+	doc.SetObject();
+	auto& alloc = doc.GetAllocator();
+	doc.AddMember("boxes", static_cast<unsigned>(bodies.size()), alloc);
+	doc.AddMember("stackHeight", static_cast<unsigned>(stackHeight), alloc);
+	doc.AddMember("stacks", static_cast<unsigned>(numStacks), alloc);
+	doc.AddMember("frames", settings.mNumFrames, alloc);
+	doc.AddMember("deltaTime", settings.mDeltaTime, alloc);
+	doc.AddMember("threads", game->GetJobSystem()->GetNumThreads(), alloc);
+
+	rapidjson::Value step(rapidjson::kObjectType);
+	AddStats(alloc, step, samples);
+	doc.AddMember("step", step, alloc);
+	doc.AddMember("budgetMs", FrameBudgetMs, alloc);
+	doc.AddMember("overBudgetFrames", overBudgetFrames, alloc);
+
+	double numFrames = std::max(1, settings.mNumFrames);
+	rapidjson::Value awake(rapidjson::kObjectType);
+	awake.AddMember("mean", totalAwake / numFrames, alloc);
+	awake.AddMember("max", static_cast<unsigned>(maxAwake), alloc);
+	doc.AddMember("awake", awake, alloc);
+	rapidjson::Value islands(rapidjson::kObjectType);
+	islands.AddMember("mean", totalIslands / numFrames, alloc);
+	islands.AddMember("max", static_cast<unsigned>(maxIslands), alloc);
+	doc.AddMember("islands", islands, alloc);
+	rapidjson::Value contacts(rapidjson::kObjectType);
+	contacts.AddMember("mean", totalContacts / numFrames, alloc);
+	contacts.AddMember("max", static_cast<unsigned>(maxContacts), alloc);
+	doc.AddMember("contacts", contacts, alloc);
+	// The frame after which nothing woke up again (-1 if never)
+	doc.AddMember("asleepFrame", asleepFrame, alloc);
+	doc.AddMember("sleeping", static_cast<unsigned>(sleeping), alloc);
+	doc.AddMember("toppled", static_cast<unsigned>(toppled), alloc);
+	doc.AddMember("fellThrough", static_cast<unsigned>(fellThrough), alloc);
+
+	bool success = WriteDocument(doc, fileName);
+	if (fellThrough > 0)
+	{
+		SDL_Log("%u boxes fell through the floor", static_cast<unsigned>(fellThrough));
+		success = false;
+	}
+	return success;
+}
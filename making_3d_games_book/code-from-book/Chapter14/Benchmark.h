@@ -0,0 +1,138 @@
+// ----------------------------------------------------------------
+// From Game Programming in C++ by Sanjay Madhav
+// Copyright (C) 2017 Sanjay Madhav. All rights reserved.
+// 
+// Released under the BSD License
+// See LICENSE in root directory for full details.
+// ----------------------------------------------------------------
+
+#pragma once
+#include <string>
+#include <vector>
+#include <SDL/SDL_types.h>
+
+// Records how long each phase of a frame takes over a
+// fixed number of frames, and reports the timings as JSON
+class Benchmark
+{
+public:
+	enum Phase
+	{
+		EProcessInput,
+		EUpdateActors,
+		EPendingActors,
+		EPhysics,
+		EAudioUpdate,
+		EUIUpdate,
+		EDrawExtract,
+		NumPhases
+	};
+	static const char* PhaseNames[NumPhases];
+
+	Benchmark(int numFrames, float deltaTime);
+
+	// Bracket each frame, and each phase within the frame
+	void BeginFrame();
+	void EndFrame();
+	void BeginPhase(Phase phase);
+	void EndPhase();
+	// How many renderables a frame tested against the
+	// view frustum, and how many of those were visible
+	void AddCullSample(size_t tested, size_t visible);
+	// Draws and state changes the renderer made in a frame
+	void AddRenderSample(const struct RenderStats& stats);
+
+	// Write the report to a file (or stdout if fileName is empty)
+	bool WriteJSON(const std::string& fileName) const;
+
+	// Time the box overlap and segment kernels at every SIMD level
+	// this CPU has, against the scalar Intersect functions, on
+	// numBoxes random boxes, and write the report the same way
+	static bool WriteKernelJSON(const std::string& fileName, size_t numBoxes);
+
+	// How the physics benchmark spreads its boxes out
+	enum Distribution
+	{
+		EUniform,	// Evenly through a cube
+		EClustered,	// In tight clumps of about 256 boxes
+		ECorridor,	// Along a long, thin corridor
+		NumDistributions
+	};
+	static const char* DistributionNames[NumDistributions];
+	// Look up a distribution by name (false if there's no such one)
+	static bool GetDistribution(const std::string& name, Distribution& outDist);
+
+	struct PhysicsSettings
+	{
+		PhysicsSettings();
+		size_t mNumBoxes;
+		Distribution mDistribution;
+		// Fraction of the boxes that move (the rest are static)
+		float mMoveFraction;
+		// How fast the moving boxes go (units/second)
+		float mSpeed;
+		int mNumFrames;
+		float mDeltaTime;
+		// Segments cast each frame
+		size_t mNumSegments;
+		// Pairwise is O(n^2), so skip it above this many boxes
+		size_t mPairwiseMaxBoxes;
+	};
+
+	// Fill the game's (empty) world with boxes, move some of them
+	// each frame, and time the transform refit, broadphase update,
+	// each broadphase's pair finding, the narrowphase and a batch
+	// of segment casts. Checks that pairwise, sweep and prune and
+	// the tree all find the same pairs every frame, and writes the
+	// report the same way (returns false if they didn't agree).
+	static bool WritePhysicsJSON(class Game* game, const PhysicsSettings& settings,
+		const std::string& fileName);
+
+	struct StackSettings
+	{
+		StackSettings();
+		// Rigid bodies, in towers of mStackHeight boxes
+		size_t mNumBoxes;
+		size_t mStackHeight;
+		int mNumFrames;
+		float mDeltaTime;
+	};
+
+	// Drop towers of rigid body boxes on a static floor in the game's
+	// (empty) world, and time DynamicsWorld::Step every frame against
+	// the frame budget. Reports how many bodies are awake, the islands
+	// and contacts, and when everything went to sleep, and writes the
+	// report the same way (returns false if a box fell through the floor).
+	static bool WriteStackJSON(class Game* game, const StackSettings& settings,
+		const std::string& fileName);
+
+	int GetNumFrames() const { return mNumFrames; }
+	float GetDeltaTime() const { return mDeltaTime; }
+	void SetLevelName(const std::string& name) { mLevelName = name; }
+	void SetNumActors(size_t numActors) { mNumActors = numActors; }
+	void SetNumThreads(unsigned numThreads) { mNumThreads = numThreads; }
+private:
+	int mNumFrames;
+	float mDeltaTime;
+	std::string mLevelName;
+	size_t mNumActors;
+	unsigned mNumThreads;
+	// Samples (in performance counter ticks) per phase, and per frame
+	std::vector<Uint64> mPhaseSamples[NumPhases];
+	std::vector<Uint64> mFrameSamples;
+	// General heap allocations per frame
+	std::vector<Uint64> mHeapAllocSamples;
+	Uint64 mFrameStartAllocs;
+	Phase mCurrentPhase;
+	Uint64 mPhaseStart;
+	Uint64 mFrameStart;
+	// Renderables tested/visible over every frame
+	Uint64 mCullTested;
+	Uint64 mCullVisible;
+	// Renderer draws/binds over every frame
+	Uint64 mDraws;
+	Uint64 mInstances;
+	Uint64 mProgramBinds;
+	Uint64 mTextureBinds;
+	Uint64 mVAOBinds;
+};
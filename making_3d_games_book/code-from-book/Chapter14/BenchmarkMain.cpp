@@ -0,0 +1,160 @@
+// ----------------------------------------------------------------
+// From Game Programming in C++ by Sanjay Madhav
+// Copyright (C) 2017 Sanjay Madhav. All rights reserved.
+// 
+// Released under the BSD License
+// See LICENSE in root directory for full details.
+// ----------------------------------------------------------------
+
+#include "Game.h"
+#include "Benchmark.h"
+#include "SelfTest.h"
+#include "Profiler.h"
+#include <string>
+#include <cstdlib>
+#include <SDL/SDL_log.h>
+
+// The benchmark executable. It runs the engine's systems without the
+// game loop, window, GPU or audio, so it can run anywhere (and exits
+// nonzero when a check fails, for gating regressions).
+//
+// Command line options (one of -selftest, -kernels, -physics or -stack):
+// -selftest   Check the engine's systems against reference versions
+//             (this draws Level3, so run it from the game's directory)
+// -kernels N  Time the box collision kernels on N boxes
+// -physics N  Time the broadphases, narrowphase and segment casts
+//             on N boxes
+// -stack N    Time the rigid body step on N boxes stacked in towers
+// -height N   Boxes in each -stack tower
+// -frames N   Frames the -physics or -stack run lasts
+// -dt X       Time step (in seconds) for each frame
+// -dist name  How -physics spreads its boxes out
+//             (uniform, clustered or corridor)
+// -motion F   Fraction of the -physics boxes that move
+// -threads N  Run jobs on N threads (0 means one per core)
+// -out file   Write the report to file (default stdout)
+// -trace file Write the profiler zones to file on exit
+int main(int argc, char** argv)
+{
+	bool selfTest = false;
+	size_t kernelBoxes = 0;
+	Benchmark::PhysicsSettings physics;
+	physics.mNumBoxes = 0;
+	Benchmark::StackSettings stack;
+	stack.mNumBoxes = 0;
+	int numFrames = 0;
+	float deltaTime = 0.0f;
+	unsigned numThreads = 1;
+	std::string benchOut;
+	std::string traceOut;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "-selftest")
+		{
+			selfTest = true;
+		}
+		else if (arg == "-kernels" && hasValue)
+		{
+			kernelBoxes = static_cast<size_t>(std::atoi(argv[++i]));
+		}
+		else if (arg == "-physics" && hasValue)
+		{
+			physics.mNumBoxes = static_cast<size_t>(std::atoi(argv[++i]));
+		}
+		else if (arg == "-stack" && hasValue)
+		{
+			stack.mNumBoxes = static_cast<size_t>(std::atoi(argv[++i]));
+		}
+		else if (arg == "-height" && hasValue)
+		{
+			stack.mStackHeight = static_cast<size_t>(std::atoi(argv[++i]));
+		}
+		else if (arg == "-frames" && hasValue)
+		{
+			numFrames = std::atoi(argv[++i]);
+		}
+		else if (arg == "-dt" && hasValue)
+		{
+			deltaTime = static_cast<float>(std::atof(argv[++i]));
+		}
+		else if (arg == "-dist" && hasValue)
+		{
+			if (!Benchmark::GetDistribution(argv[++i], physics.mDistribution))
+			{
+				SDL_Log("Unknown distribution %s", argv[i]);
+				return 1;
+			}
+		}
+		else if (arg == "-motion" && hasValue)
+		{
+			physics.mMoveFraction = static_cast<float>(std::atof(argv[++i]));
+		}
+		else if (arg == "-threads" && hasValue)
+		{
+			numThreads = static_cast<unsigned>(std::atoi(argv[++i]));
+		}
+		else if (arg == "-out" && hasValue)
+		{
+			benchOut = argv[++i];
+		}
+		else if (arg == "-trace" && hasValue)
+		{
+			traceOut = argv[++i];
+		}
+		else
+		{
+			SDL_Log("Unknown option %s", arg.c_str());
+			return 1;
+		}
+	}
+
+	// Doesn't need the game at all
+	if (kernelBoxes > 0)
+	{
+		return Benchmark::WriteKernelJSON(benchOut, kernelBoxes) ? 0 : 1;
+	}
+	if (!selfTest && physics.mNumBoxes == 0 && stack.mNumBoxes == 0)
+	{
+		SDL_Log("Usage: %s -selftest | -kernels N | -physics N | -stack N [options]",
+			argv[0]);
+		return 1;
+	}
+	// Otherwise each run keeps its own defaults
+	if (numFrames > 0)
+	{
+		physics.mNumFrames = numFrames;
+		stack.mNumFrames = numFrames;
+	}
+	if (deltaTime > 0.0f)
+	{
+		physics.mDeltaTime = deltaTime;
+		stack.mDeltaTime = deltaTime;
+	}
+
+	Game game;
+	game.SetNumThreads(numThreads);
+	bool success = game.InitializeSimulation();
+	if (success)
+	{
+		if (selfTest)
+		{
+			success = SelfTest::RunAll(&game);
+		}
+		else if (physics.mNumBoxes > 0)
+		{
+			success = Benchmark::WritePhysicsJSON(&game, physics, benchOut);
+		}
+		else
+		{
+			success = Benchmark::WriteStackJSON(&game, stack, benchOut);
+		}
+		if (!traceOut.empty())
+		{
+			Profiler::WriteTrace(traceOut);
+		}
+	}
+	game.Shutdown();
+	return success ? 0 : 1;
+}
@@ -10,6 +10,7 @@
 #include "Actor.h"
 #include "Game.h"
 #include "PhysWorld.h"
+#include "RigidBodyComponent.h"
 #include "LevelLoader.h"
 
 BoxComponent::BoxComponent(Actor* owner, int updateOrder)
@@ -17,30 +18,93 @@ BoxComponent::BoxComponent(Actor* owner, int updateOrder)
 	,mObjectBox(Vector3::Zero, Vector3::Zero)
 	,mWorldBox(Vector3::Zero, Vector3::Zero)
 	,mShouldRotate(true)
+	,mStatic(false)
+	,mLayer(DefaultLayer)
+	,mCollisionMask(0xFFFFFFFF)
+	,mTrigger(false)
+	,mContinuous(false)
+	,mOriented(false)
+	,mProxy(0)
+	,mBody(nullptr)
 {
 	mOwner->GetGame()->GetPhysWorld()->AddBox(this);
+	mOwner->AddTransformListener(this);
 }
 
 BoxComponent::~BoxComponent()
 {
+	if (mBody)
+	{
+		mBody->mBox = nullptr;
+	}
 	mOwner->GetGame()->GetPhysWorld()->RemoveBox(this);
 }
 
 void BoxComponent::OnUpdateWorldTransform()
 {
-	// Reset to object space box
-	mWorldBox = mObjectBox;
-	// Scale
-	mWorldBox.mMin *= mOwner->GetScale();
-	mWorldBox.mMax *= mOwner->GetScale();
-	// Rotate (if we want to)
-	if (mShouldRotate)
+	// The box is in world space, so include any parents' transforms
+	float scale = mOwner->GetWorldScale();
+	Quaternion rotation = mOwner->GetWorldRotation();
+	Vector3 position = mOwner->GetWorldPosition();
+	if (mOriented)
 	{
-		mWorldBox.Rotate(mOwner->GetRotation());
+		// Rotate the box's center, and keep its size and rotation
+		Vector3 center = (mObjectBox.mMin + mObjectBox.mMax) * (0.5f * scale);
+		mWorldOBB.mRotation = rotation;
+		mWorldOBB.mCenter = position +
+			Vector3::Transform(center, mWorldOBB.mRotation);
+		mWorldOBB.mExtents = (mObjectBox.mMax - mObjectBox.mMin) * (0.5f * scale);
+		// The broadphase still uses the box around it
+		mWorldBox = mWorldOBB.GetBounds();
 	}
-	// Translate
-	mWorldBox.mMin += mOwner->GetPosition();
-	mWorldBox.mMax += mOwner->GetPosition();
+	else
+	{
+		// Reset to object space box
+		mWorldBox = mObjectBox;
+		// Scale
+		mWorldBox.mMin *= scale;
+		mWorldBox.mMax *= scale;
+		// Rotate (if we want to)
+		if (mShouldRotate)
+		{
+			mWorldBox.Rotate(rotation);
+		}
+		// Translate
+		mWorldBox.mMin += position;
+		mWorldBox.mMax += position;
+
+		mWorldOBB.mCenter = (mWorldBox.mMin + mWorldBox.mMax) * 0.5f;
+		mWorldOBB.mRotation = Quaternion::Identity;
+		mWorldOBB.mExtents = (mWorldBox.mMax - mWorldBox.mMin) * 0.5f;
+	}
+
+	mOwner->GetGame()->GetPhysWorld()->MarkMoved(this);
+}
+
+void BoxComponent::SetLayer(uint32_t layer)
+{
+	mLayer = layer;
+	// The physics world copies the layer when the box moves
+	mOwner->GetGame()->GetPhysWorld()->MarkMoved(this);
+}
+
+void BoxComponent::SetCollisionMask(uint32_t mask)
+{
+	mCollisionMask = mask;
+	mOwner->GetGame()->GetPhysWorld()->MarkMoved(this);
+}
+
+void BoxComponent::SetTrigger(bool value)
+{
+	mTrigger = value;
+	mOwner->GetGame()->GetPhysWorld()->MarkMoved(this);
+}
+
+void BoxComponent::SetOriented(bool value)
+{
+	mOriented = value;
+	// Recompute the world box the new way
+	OnUpdateWorldTransform();
 }
 
 void BoxComponent::LoadProperties(const rapidjson::Value& inObj)
@@ -52,6 +116,28 @@ void BoxComponent::LoadProperties(const rapidjson::Value& inObj)
 	JsonHelper::GetVector3(inObj, "worldMin", mWorldBox.mMin);
 	JsonHelper::GetVector3(inObj, "worldMax", mWorldBox.mMax);
 	JsonHelper::GetBool(inObj, "shouldRotate", mShouldRotate);
+	JsonHelper::GetBool(inObj, "static", mStatic);
+	JsonHelper::GetBool(inObj, "continuous", mContinuous);
+	bool oriented = false;
+	if (JsonHelper::GetBool(inObj, "oriented", oriented))
+	{
+		SetOriented(oriented);
+	}
+	int layer = 0;
+	if (JsonHelper::GetInt(inObj, "layer", layer))
+	{
+		SetLayer(static_cast<uint32_t>(layer));
+	}
+	int mask = 0;
+	if (JsonHelper::GetInt(inObj, "collisionMask", mask))
+	{
+		SetCollisionMask(static_cast<uint32_t>(mask));
+	}
+	bool trigger = false;
+	if (JsonHelper::GetBool(inObj, "trigger", trigger))
+	{
+		SetTrigger(trigger);
+	}
 }
 
 void BoxComponent::SaveProperties(rapidjson::Document::AllocatorType & alloc, rapidjson::Value & inObj) const
@@ -63,4 +149,10 @@ void BoxComponent::SaveProperties(rapidjson::Document::AllocatorType & alloc, ra
 	JsonHelper::AddVector3(alloc, inObj, "worldMin", mWorldBox.mMin);
 	JsonHelper::AddVector3(alloc, inObj, "worldMax", mWorldBox.mMax);
 	JsonHelper::AddBool(alloc, inObj, "shouldRotate", mShouldRotate);
+	JsonHelper::AddBool(alloc, inObj, "static", mStatic);
+	JsonHelper::AddBool(alloc, inObj, "continuous", mContinuous);
+	JsonHelper::AddBool(alloc, inObj, "oriented", mOriented);
+	JsonHelper::AddInt(alloc, inObj, "layer", static_cast<int>(mLayer));
+	JsonHelper::AddInt(alloc, inObj, "collisionMask", static_cast<int>(mCollisionMask));
+	JsonHelper::AddBool(alloc, inObj, "trigger", mTrigger);
 }
@@ -19,7 +19,13 @@ public:
 	void OnUpdateWorldTransform() override;
 
 	void SetObjectBox(const AABB& model) { mObjectBox = model; }
+	const AABB& GetObjectBox() const { return mObjectBox; }
 	const AABB& GetWorldBox() const { return mWorldBox; }
+	// The rigid body moving this box (if any)
+	class RigidBodyComponent* GetRigidBody() const { return mBody; }
+	// The world box as an OBB (for a box that isn't oriented,
+	// this is just the world box with no rotation)
+	const OBB& GetWorldOBB() const { return mWorldOBB; }
 
 	TypeID GetType() const override { return TBoxComponent; }
 
@@ -27,8 +33,48 @@ public:
 	void SaveProperties(rapidjson::Document::AllocatorType& alloc,
 		rapidjson::Value& inObj) const override;
 	void SetShouldRotate(bool value) { mShouldRotate = value; }
+	// Static boxes (such as walls) never move, so the broadphase
+	// never pairs them with each other (set before the box moves)
+	void SetStatic(bool value) { mStatic = value; }
+	bool IsStatic() const { return mStatic; }
+	// Bit per layer the box is on (queries with a mask only see
+	// boxes on one of the layers in the mask)
+	static const uint32_t DefaultLayer = 1;
+	static const uint32_t ProjectileLayer = 2;
+	void SetLayer(uint32_t layer);
+	uint32_t GetLayer() const { return mLayer; }
+	// Layers this box collides with. Two boxes only pair up if
+	// each is on one of the layers in the other's mask.
+	void SetCollisionMask(uint32_t mask);
+	uint32_t GetCollisionMask() const { return mCollisionMask; }
+	// Triggers aren't solid: their overlaps are only reported by
+	// PhysWorld::TestTriggers, and queries skip them by default
+	void SetTrigger(bool value);
+	bool IsTrigger() const { return mTrigger; }
+	// Continuous boxes can move far in one step (such as
+	// projectiles), so they're swept rather than just tested
+	// where they end up
+	void SetContinuous(bool value) { mContinuous = value; }
+	bool IsContinuous() const { return mContinuous; }
+	// Oriented boxes keep the true rotated box, which the physics
+	// world tests exactly once the world boxes around them overlap
+	void SetOriented(bool value);
+	bool IsOriented() const { return mOriented; }
 private:
 	AABB mObjectBox;
 	AABB mWorldBox;
 	bool mShouldRotate;
+	bool mStatic;
+	uint32_t mLayer;
+	uint32_t mCollisionMask;
+	bool mTrigger;
+	bool mContinuous;
+	bool mOriented;
+	OBB mWorldOBB;
+	// The physics world's broadphase proxy for this box
+	friend class PhysWorld;
+	uint32_t mProxy;
+	friend class DynamicsWorld;
+	friend class RigidBodyComponent;
+	class RigidBodyComponent* mBody;
 };
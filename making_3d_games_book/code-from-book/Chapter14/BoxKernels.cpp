@@ -0,0 +1,806 @@
+// ----------------------------------------------------------------
+// From Game Programming in C++ by Sanjay Madhav
+// Copyright (C) 2017 Sanjay Madhav. All rights reserved.
+// 
+// Released under the BSD License
+// See LICENSE in root directory for full details.
+// ----------------------------------------------------------------
+
+#include "BoxKernels.h"
+#include <SDL/SDL_cpuinfo.h>
+#include <algorithm>
+
+// SSE is always there on x64 (and 32-bit builds that ask for it).
+// The AVX kernels are compiled in either way, but only called if
+// the CPU has AVX.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BOX_KERNELS_SSE
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#define BOX_KERNELS_AVX
+#define BOX_KERNELS_AVX_TARGET
+#elif defined(__GNUC__)
+#define BOX_KERNELS_AVX
+#define BOX_KERNELS_AVX_TARGET __attribute__((target("avx")))
+#endif
+#endif
+
+const size_t BoxArrays::Padding;
+const size_t SphereArrays::Padding;
+const uint32_t BoxKernels::AllLayers;
+
+BoxArrays::BoxArrays()
+	:mCount(0)
+{
+	Resize(0);
+}
+
+void BoxArrays::Resize(size_t count)
+{
+	std::vector<float>* arrays[] = { &mMinX, &mMinY, &mMinZ, &mMaxX, &mMaxY, &mMaxZ };
+	for (auto array : arrays)
+	{
+		array->resize(count + Padding, Math::Infinity);
+		// Anything past the last box (including boxes that were
+		// cut off) is padding
+		std::fill(array->begin() + count, array->end(), Math::Infinity);
+	}
+	mLayers.resize(count + Padding, 0);
+	std::fill(mLayers.begin() + count, mLayers.end(), 0);
+	mCount = count;
+}
+
+void BoxArrays::Set(size_t index, const AABB& box)
+{
+	mMinX[index] = box.mMin.x;
+	mMinY[index] = box.mMin.y;
+	mMinZ[index] = box.mMin.z;
+	mMaxX[index] = box.mMax.x;
+	mMaxY[index] = box.mMax.y;
+	mMaxZ[index] = box.mMax.z;
+}
+
+void BoxArrays::Clear(size_t index)
+{
+	Set(index, AABB(Vector3::Infinity, Vector3::Infinity));
+	mLayers[index] = 0;
+}
+
+AABB BoxArrays::Get(size_t index) const
+{
+	return AABB(Vector3(mMinX[index], mMinY[index], mMinZ[index]),
+		Vector3(mMaxX[index], mMaxY[index], mMaxZ[index]));
+}
+
+SphereArrays::SphereArrays()
+	:mCount(0)
+{
+	Resize(0);
+}
+
+void SphereArrays::Resize(size_t count)
+{
+	std::vector<float>* arrays[] = { &mX, &mY, &mZ, &mRadius };
+	for (auto array : arrays)
+	{
+		array->resize(count + Padding, 0.0f);
+		std::fill(array->begin() + count, array->end(), 0.0f);
+	}
+	mCount = count;
+}
+
+void SphereArrays::Set(size_t index, const Sphere& sphere)
+{
+	mX[index] = sphere.mCenter.x;
+	mY[index] = sphere.mCenter.y;
+	mZ[index] = sphere.mCenter.z;
+	mRadius[index] = sphere.mRadius;
+}
+
+Sphere SphereArrays::Get(size_t index) const
+{
+	return Sphere(Vector3(mX[index], mY[index], mZ[index]), mRadius[index]);
+}
+
+namespace
+{
+	// The segment, set up for slab tests
+	struct SegmentAxes
+	{
+		SegmentAxes(const LineSegment& l)
+		{
+			Vector3 delta = l.mEnd - l.mStart;
+			const float* start = l.mStart.GetAsFloatPtr();
+			const float* d = delta.GetAsFloatPtr();
+			for (int i = 0; i < 3; i++)
+			{
+				mStart[i] = start[i];
+				// Same threshold as Intersect uses for a parallel plane
+				mParallel[i] = Math::NearZero(d[i]);
+				mInvDelta[i] = mParallel[i] ? 0.0f : 1.0f / d[i];
+			}
+		}
+		float mStart[3];
+		float mInvDelta[3];
+		bool mParallel[3];
+	};
+
+	// Bits for the lanes from i up to (not including) last
+	int LaneMask(size_t i, size_t last, int width)
+	{
+		size_t remaining = last - i;
+		if (remaining >= static_cast<size_t>(width))
+		{
+			return (1 << width) - 1;
+		}
+		return (1 << remaining) - 1;
+	}
+
+	// The frustum's planes, plus the absolute value of each normal
+	// (how far a box's extents reach towards the plane)
+	struct FrustumPlanes
+	{
+		FrustumPlanes(const Frustum& f)
+		{
+			for (int i = 0; i < Frustum::NumPlanes; i++)
+			{
+				const float* n = f.mNormals[i].GetAsFloatPtr();
+				for (int axis = 0; axis < 3; axis++)
+				{
+					mNormal[i][axis] = n[axis];
+					mAbsNormal[i][axis] = Math::Abs(n[axis]);
+				}
+				mD[i] = f.mD[i];
+			}
+		}
+		float mNormal[Frustum::NumPlanes][3];
+		float mAbsNormal[Frustum::NumPlanes][3];
+		float mD[Frustum::NumPlanes];
+	};
+
+	size_t CullBoxesScalar(const BoxArrays& boxes, size_t first, size_t last,
+		const FrustumPlanes& f, uint32_t* outIndices)
+	{
+		size_t count = 0;
+		for (size_t i = first; i < last; i++)
+		{
+			float cx = (boxes.mMinX[i] + boxes.mMaxX[i]) * 0.5f;
+			float cy = (boxes.mMinY[i] + boxes.mMaxY[i]) * 0.5f;
+			float cz = (boxes.mMinZ[i] + boxes.mMaxZ[i]) * 0.5f;
+			float ex = (boxes.mMaxX[i] - boxes.mMinX[i]) * 0.5f;
+			float ey = (boxes.mMaxY[i] - boxes.mMinY[i]) * 0.5f;
+			float ez = (boxes.mMaxZ[i] - boxes.mMinZ[i]) * 0.5f;
+			bool inside = true;
+			for (int p = 0; p < Frustum::NumPlanes && inside; p++)
+			{
+				float dist = cx * f.mNormal[p][0] + cy * f.mNormal[p][1] +
+					cz * f.mNormal[p][2] - f.mD[p];
+				float reach = ex * f.mAbsNormal[p][0] + ey * f.mAbsNormal[p][1] +
+					ez * f.mAbsNormal[p][2];
+				inside = dist + reach >= 0.0f;
+			}
+			if (inside)
+			{
+				outIndices[count++] = static_cast<uint32_t>(i);
+			}
+		}
+		return count;
+	}
+
+	size_t CullSpheresScalar(const SphereArrays& spheres, size_t first, size_t last,
+		const FrustumPlanes& f, uint32_t* outIndices)
+	{
+		size_t count = 0;
+		for (size_t i = first; i < last; i++)
+		{
+			bool inside = true;
+			for (int p = 0; p < Frustum::NumPlanes && inside; p++)
+			{
+				float dist = spheres.mX[i] * f.mNormal[p][0] + spheres.mY[i] * f.mNormal[p][1] +
+					spheres.mZ[i] * f.mNormal[p][2] - f.mD[p];
+				inside = dist + spheres.mRadius[i] >= 0.0f;
+			}
+			if (inside)
+			{
+				outIndices[count++] = static_cast<uint32_t>(i);
+			}
+		}
+		return count;
+	}
+
+	size_t OverlapBoxScalar(const BoxArrays& boxes, size_t first, size_t last,
+		const AABB& box, uint32_t* outIndices, uint32_t mask)
+	{
+		size_t count = 0;
+		for (size_t i = first; i < last; i++)
+		{
+			if (boxes.mMinX[i] <= box.mMax.x && box.mMin.x <= boxes.mMaxX[i] &&
+				boxes.mMinY[i] <= box.mMax.y && box.mMin.y <= boxes.mMaxY[i] &&
+				boxes.mMinZ[i] <= box.mMax.z && box.mMin.z <= boxes.mMaxZ[i] &&
+				(boxes.mLayers[i] & mask) != 0)
+			{
+				outIndices[count++] = static_cast<uint32_t>(i);
+			}
+		}
+		return count;
+	}
+
+	bool SegmentCastScalar(const BoxArrays& boxes, size_t first, size_t last,
+		const SegmentAxes& seg, float& outT, size_t& outIndex, uint32_t mask)
+	{
+		const float* mins[3] = { boxes.mMinX.data(), boxes.mMinY.data(), boxes.mMinZ.data() };
+		const float* maxs[3] = { boxes.mMaxX.data(), boxes.mMaxY.data(), boxes.mMaxZ.data() };
+		bool found = false;
+		for (size_t i = first; i < last; i++)
+		{
+			float tEnter = -Math::Infinity;
+			float tExit = Math::Infinity;
+			bool valid = true;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				if (seg.mParallel[axis])
+				{
+					valid = valid && mins[axis][i] <= seg.mStart[axis] &&
+						seg.mStart[axis] <= maxs[axis][i];
+				}
+				else
+				{
+					float t1 = (mins[axis][i] - seg.mStart[axis]) * seg.mInvDelta[axis];
+					float t2 = (maxs[axis][i] - seg.mStart[axis]) * seg.mInvDelta[axis];
+					tEnter = Math::Max(tEnter, Math::Min(t1, t2));
+					tExit = Math::Min(tExit, Math::Max(t1, t2));
+				}
+			}
+			// Starting inside the box hits where it leaves
+			float t = tEnter >= 0.0f ? tEnter : tExit;
+			if (valid && tEnter <= tExit && tExit >= 0.0f && t <= 1.0f &&
+				(!found || t < outT) && (boxes.mLayers[i] & mask) != 0)
+			{
+				outT = t;
+				outIndex = i;
+				found = true;
+			}
+		}
+		return found;
+	}
+
+#ifdef BOX_KERNELS_SSE
+	size_t OverlapBoxSSE(const BoxArrays& boxes, size_t first, size_t last,
+		const AABB& box, uint32_t* outIndices, uint32_t mask)
+	{
+		__m128 qMinX = _mm_set1_ps(box.mMin.x);
+		__m128 qMinY = _mm_set1_ps(box.mMin.y);
+		__m128 qMinZ = _mm_set1_ps(box.mMin.z);
+		__m128 qMaxX = _mm_set1_ps(box.mMax.x);
+		__m128 qMaxY = _mm_set1_ps(box.mMax.y);
+		__m128 qMaxZ = _mm_set1_ps(box.mMax.z);
+		size_t count = 0;
+		for (size_t i = first; i < last; i += 4)
+		{
+			__m128 x = _mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(&boxes.mMinX[i]), qMaxX),
+				_mm_cmple_ps(qMinX, _mm_loadu_ps(&boxes.mMaxX[i])));
+			__m128 y = _mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(&boxes.mMinY[i]), qMaxY),
+				_mm_cmple_ps(qMinY, _mm_loadu_ps(&boxes.mMaxY[i])));
+			__m128 z = _mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(&boxes.mMinZ[i]), qMaxZ),
+				_mm_cmple_ps(qMinZ, _mm_loadu_ps(&boxes.mMaxZ[i])));
+			int hits = _mm_movemask_ps(_mm_and_ps(x, _mm_and_ps(y, z))) & LaneMask(i, last, 4);
+			// Hits are rare, so the layers are checked one at a time
+			for (int lane = 0; hits != 0; lane++, hits >>= 1)
+			{
+				if ((hits & 1) && (boxes.mLayers[i + lane] & mask) != 0)
+				{
+					outIndices[count++] = static_cast<uint32_t>(i + lane);
+				}
+			}
+		}
+		return count;
+	}
+
+	bool SegmentCastSSE(const BoxArrays& boxes, size_t first, size_t last,
+		const SegmentAxes& seg, float& outT, size_t& outIndex, uint32_t mask)
+	{
+		const float* mins[3] = { boxes.mMinX.data(), boxes.mMinY.data(), boxes.mMinZ.data() };
+		const float* maxs[3] = { boxes.mMaxX.data(), boxes.mMaxY.data(), boxes.mMaxZ.data() };
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 allOnes = _mm_cmpeq_ps(zero, zero);
+		bool found = false;
+		float bestT = Math::Infinity;
+		for (size_t i = first; i < last; i += 4)
+		{
+			__m128 tEnter = _mm_set1_ps(-Math::Infinity);
+			__m128 tExit = _mm_set1_ps(Math::Infinity);
+			__m128 valid = allOnes;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				__m128 bMin = _mm_loadu_ps(mins[axis] + i);
+				__m128 bMax = _mm_loadu_ps(maxs[axis] + i);
+				__m128 s = _mm_set1_ps(seg.mStart[axis]);
+				if (seg.mParallel[axis])
+				{
+					valid = _mm_and_ps(valid,
+						_mm_and_ps(_mm_cmple_ps(bMin, s), _mm_cmple_ps(s, bMax)));
+				}
+				else
+				{
+					__m128 inv = _mm_set1_ps(seg.mInvDelta[axis]);
+					__m128 t1 = _mm_mul_ps(_mm_sub_ps(bMin, s), inv);
+					__m128 t2 = _mm_mul_ps(_mm_sub_ps(bMax, s), inv);
+					tEnter = _mm_max_ps(tEnter, _mm_min_ps(t1, t2));
+					tExit = _mm_min_ps(tExit, _mm_max_ps(t1, t2));
+				}
+			}
+			// t = tEnter >= 0 ? tEnter : tExit
+			__m128 outside = _mm_cmpge_ps(tEnter, zero);
+			__m128 t = _mm_or_ps(_mm_and_ps(outside, tEnter), _mm_andnot_ps(outside, tExit));
+			__m128 hit = _mm_and_ps(valid, _mm_cmple_ps(tEnter, tExit));
+			hit = _mm_and_ps(hit, _mm_cmpge_ps(tExit, zero));
+			hit = _mm_and_ps(hit, _mm_cmple_ps(t, one));
+			hit = _mm_and_ps(hit, _mm_cmplt_ps(t, _mm_set1_ps(bestT)));
+			int hits = _mm_movemask_ps(hit) & LaneMask(i, last, 4);
+			if (hits != 0)
+			{
+				float ts[4];
+				_mm_storeu_ps(ts, t);
+				for (int lane = 0; lane < 4; lane++)
+				{
+					if ((hits & (1 << lane)) && ts[lane] < bestT &&
+						(boxes.mLayers[i + lane] & mask) != 0)
+					{
+						bestT = ts[lane];
+						outIndex = i + lane;
+						found = true;
+					}
+				}
+			}
+		}
+		if (found)
+		{
+			outT = bestT;
+		}
+		return found;
+	}
+
+	// Writes the lanes set in inside (and not past last) to outIndices
+	size_t AppendLanes(int inside, size_t i, uint32_t* outIndices)
+	{
+		size_t count = 0;
+		for (int lane = 0; inside != 0; lane++, inside >>= 1)
+		{
+			if (inside & 1)
+			{
+				outIndices[count++] = static_cast<uint32_t>(i + lane);
+			}
+		}
+		return count;
+	}
+
+	size_t CullBoxesSSE(const BoxArrays& boxes, size_t first, size_t last,
+		const FrustumPlanes& f, uint32_t* outIndices)
+	{
+		const __m128 half = _mm_set1_ps(0.5f);
+		const __m128 zero = _mm_setzero_ps();
+		size_t count = 0;
+		for (size_t i = first; i < last; i += 4)
+		{
+			__m128 minX = _mm_loadu_ps(&boxes.mMinX[i]);
+			__m128 minY = _mm_loadu_ps(&boxes.mMinY[i]);
+			__m128 minZ = _mm_loadu_ps(&boxes.mMinZ[i]);
+			__m128 maxX = _mm_loadu_ps(&boxes.mMaxX[i]);
+			__m128 maxY = _mm_loadu_ps(&boxes.mMaxY[i]);
+			__m128 maxZ = _mm_loadu_ps(&boxes.mMaxZ[i]);
+			__m128 cx = _mm_mul_ps(_mm_add_ps(minX, maxX), half);
+			__m128 cy = _mm_mul_ps(_mm_add_ps(minY, maxY), half);
+			__m128 cz = _mm_mul_ps(_mm_add_ps(minZ, maxZ), half);
+			__m128 ex = _mm_mul_ps(_mm_sub_ps(maxX, minX), half);
+			__m128 ey = _mm_mul_ps(_mm_sub_ps(maxY, minY), half);
+			__m128 ez = _mm_mul_ps(_mm_sub_ps(maxZ, minZ), half);
+			__m128 inside = _mm_cmpeq_ps(zero, zero);
+			for (int p = 0; p < Frustum::NumPlanes; p++)
+			{
+				__m128 dist = _mm_add_ps(_mm_add_ps(
+					_mm_mul_ps(cx, _mm_set1_ps(f.mNormal[p][0])),
+					_mm_mul_ps(cy, _mm_set1_ps(f.mNormal[p][1]))),
+					_mm_mul_ps(cz, _mm_set1_ps(f.mNormal[p][2])));
+				dist = _mm_sub_ps(dist, _mm_set1_ps(f.mD[p]));
+				__m128 reach = _mm_add_ps(_mm_add_ps(
+					_mm_mul_ps(ex, _mm_set1_ps(f.mAbsNormal[p][0])),
+					_mm_mul_ps(ey, _mm_set1_ps(f.mAbsNormal[p][1]))),
+					_mm_mul_ps(ez, _mm_set1_ps(f.mAbsNormal[p][2])));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(dist, reach), zero));
+			}
+			count += AppendLanes(_mm_movemask_ps(inside) & LaneMask(i, last, 4),
+				i, outIndices + count);
+		}
+		return count;
+	}
+
+	size_t CullSpheresSSE(const SphereArrays& spheres, size_t first, size_t last,
+		const FrustumPlanes& f, uint32_t* outIndices)
+	{
+		const __m128 zero = _mm_setzero_ps();
+		size_t count = 0;
+		for (size_t i = first; i < last; i += 4)
+		{
+			__m128 x = _mm_loadu_ps(&spheres.mX[i]);
+			__m128 y = _mm_loadu_ps(&spheres.mY[i]);
+			__m128 z = _mm_loadu_ps(&spheres.mZ[i]);
+			__m128 r = _mm_loadu_ps(&spheres.mRadius[i]);
+			__m128 inside = _mm_cmpeq_ps(zero, zero);
+			for (int p = 0; p < Frustum::NumPlanes; p++)
+			{
+				__m128 dist = _mm_add_ps(_mm_add_ps(
+					_mm_mul_ps(x, _mm_set1_ps(f.mNormal[p][0])),
+					_mm_mul_ps(y, _mm_set1_ps(f.mNormal[p][1]))),
+					_mm_mul_ps(z, _mm_set1_ps(f.mNormal[p][2])));
+				dist = _mm_sub_ps(dist, _mm_set1_ps(f.mD[p]));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(dist, r), zero));
+			}
+			count += AppendLanes(_mm_movemask_ps(inside) & LaneMask(i, last, 4),
+				i, outIndices + count);
+		}
+		return count;
+	}
+#endif
+
+#ifdef BOX_KERNELS_AVX
+	BOX_KERNELS_AVX_TARGET
+	size_t OverlapBoxAVX(const BoxArrays& boxes, size_t first, size_t last,
+		const AABB& box, uint32_t* outIndices, uint32_t mask)
+	{
+		__m256 qMinX = _mm256_set1_ps(box.mMin.x);
+		__m256 qMinY = _mm256_set1_ps(box.mMin.y);
+		__m256 qMinZ = _mm256_set1_ps(box.mMin.z);
+		__m256 qMaxX = _mm256_set1_ps(box.mMax.x);
+		__m256 qMaxY = _mm256_set1_ps(box.mMax.y);
+		__m256 qMaxZ = _mm256_set1_ps(box.mMax.z);
+		size_t count = 0;
+		for (size_t i = first; i < last; i += 8)
+		{
+			__m256 x = _mm256_and_ps(
+				_mm256_cmp_ps(_mm256_loadu_ps(&boxes.mMinX[i]), qMaxX, _CMP_LE_OQ),
+				_mm256_cmp_ps(qMinX, _mm256_loadu_ps(&boxes.mMaxX[i]), _CMP_LE_OQ));
+			__m256 y = _mm256_and_ps(
+				_mm256_cmp_ps(_mm256_loadu_ps(&boxes.mMinY[i]), qMaxY, _CMP_LE_OQ),
+				_mm256_cmp_ps(qMinY, _mm256_loadu_ps(&boxes.mMaxY[i]), _CMP_LE_OQ));
+			__m256 z = _mm256_and_ps(
+				_mm256_cmp_ps(_mm256_loadu_ps(&boxes.mMinZ[i]), qMaxZ, _CMP_LE_OQ),
+				_mm256_cmp_ps(qMinZ, _mm256_loadu_ps(&boxes.mMaxZ[i]), _CMP_LE_OQ));
+			int hits = _mm256_movemask_ps(_mm256_and_ps(x, _mm256_and_ps(y, z))) &
+				LaneMask(i, last, 8);
+			for (int lane = 0; hits != 0; lane++, hits >>= 1)
+			{
+				if ((hits & 1) && (boxes.mLayers[i + lane] & mask) != 0)
+				{
+					outIndices[count++] = static_cast<uint32_t>(i + lane);
+				}
+			}
+		}
+		return count;
+	}
+
+	BOX_KERNELS_AVX_TARGET
+	bool SegmentCastAVX(const BoxArrays& boxes, size_t first, size_t last,
+		const SegmentAxes& seg, float& outT, size_t& outIndex, uint32_t mask)
+	{
+		const float* mins[3] = { boxes.mMinX.data(), boxes.mMinY.data(), boxes.mMinZ.data() };
+		const float* maxs[3] = { boxes.mMaxX.data(), boxes.mMaxY.data(), boxes.mMaxZ.data() };
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 one = _mm256_set1_ps(1.0f);
+		const __m256 allOnes = _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ);
+		bool found = false;
+		float bestT = Math::Infinity;
+		for (size_t i = first; i < last; i += 8)
+		{
+			__m256 tEnter = _mm256_set1_ps(-Math::Infinity);
+			__m256 tExit = _mm256_set1_ps(Math::Infinity);
+			__m256 valid = allOnes;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				__m256 bMin = _mm256_loadu_ps(mins[axis] + i);
+				__m256 bMax = _mm256_loadu_ps(maxs[axis] + i);
+				__m256 s = _mm256_set1_ps(seg.mStart[axis]);
+				if (seg.mParallel[axis])
+				{
+					valid = _mm256_and_ps(valid, _mm256_and_ps(
+						_mm256_cmp_ps(bMin, s, _CMP_LE_OQ), _mm256_cmp_ps(s, bMax, _CMP_LE_OQ)));
+				}
+				else
+				{
+					__m256 inv = _mm256_set1_ps(seg.mInvDelta[axis]);
+					__m256 t1 = _mm256_mul_ps(_mm256_sub_ps(bMin, s), inv);
+					__m256 t2 = _mm256_mul_ps(_mm256_sub_ps(bMax, s), inv);
+					tEnter = _mm256_max_ps(tEnter, _mm256_min_ps(t1, t2));
+					tExit = _mm256_min_ps(tExit, _mm256_max_ps(t1, t2));
+				}
+			}
+			__m256 outside = _mm256_cmp_ps(tEnter, zero, _CMP_GE_OQ);
+			__m256 t = _mm256_blendv_ps(tExit, tEnter, outside);
+			__m256 hit = _mm256_and_ps(valid, _mm256_cmp_ps(tEnter, tExit, _CMP_LE_OQ));
+			hit = _mm256_and_ps(hit, _mm256_cmp_ps(tExit, zero, _CMP_GE_OQ));
+			hit = _mm256_and_ps(hit, _mm256_cmp_ps(t, one, _CMP_LE_OQ));
+			hit = _mm256_and_ps(hit, _mm256_cmp_ps(t, _mm256_set1_ps(bestT), _CMP_LT_OQ));
+			int hits = _mm256_movemask_ps(hit) & LaneMask(i, last, 8);
+			if (hits != 0)
+			{
+				float ts[8];
+				_mm256_storeu_ps(ts, t);
+				for (int lane = 0; lane < 8; lane++)
+				{
+					if ((hits & (1 << lane)) && ts[lane] < bestT &&
+						(boxes.mLayers[i + lane] & mask) != 0)
+					{
+						bestT = ts[lane];
+						outIndex = i + lane;
+						found = true;
+					}
+				}
+			}
+		}
+		if (found)
+		{
+			outT = bestT;
+		}
+		return found;
+	}
+
+	BOX_KERNELS_AVX_TARGET
+	size_t CullBoxesAVX(const BoxArrays& boxes, size_t first, size_t last,
+		const FrustumPlanes& f, uint32_t* outIndices)
+	{
+		const __m256 half = _mm256_set1_ps(0.5f);
+		const __m256 zero = _mm256_setzero_ps();
+		size_t count = 0;
+		for (size_t i = first; i < last; i += 8)
+		{
+			__m256 minX = _mm256_loadu_ps(&boxes.mMinX[i]);
+			__m256 minY = _mm256_loadu_ps(&boxes.mMinY[i]);
+			__m256 minZ = _mm256_loadu_ps(&boxes.mMinZ[i]);
+			__m256 maxX = _mm256_loadu_ps(&boxes.mMaxX[i]);
+			__m256 maxY = _mm256_loadu_ps(&boxes.mMaxY[i]);
+			__m256 maxZ = _mm256_loadu_ps(&boxes.mMaxZ[i]);
+			__m256 cx = _mm256_mul_ps(_mm256_add_ps(minX, maxX), half);
+			__m256 cy = _mm256_mul_ps(_mm256_add_ps(minY, maxY), half);
+			__m256 cz = _mm256_mul_ps(_mm256_add_ps(minZ, maxZ), half);
+			__m256 ex = _mm256_mul_ps(_mm256_sub_ps(maxX, minX), half);
+			__m256 ey = _mm256_mul_ps(_mm256_sub_ps(maxY, minY), half);
+			__m256 ez = _mm256_mul_ps(_mm256_sub_ps(maxZ, minZ), half);
+			__m256 inside = _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ);
+			for (int p = 0; p < Frustum::NumPlanes; p++)
+			{
+				__m256 dist = _mm256_add_ps(_mm256_add_ps(
+					_mm256_mul_ps(cx, _mm256_set1_ps(f.mNormal[p][0])),
+					_mm256_mul_ps(cy, _mm256_set1_ps(f.mNormal[p][1]))),
+					_mm256_mul_ps(cz, _mm256_set1_ps(f.mNormal[p][2])));
+				dist = _mm256_sub_ps(dist, _mm256_set1_ps(f.mD[p]));
+				__m256 reach = _mm256_add_ps(_mm256_add_ps(
+					_mm256_mul_ps(ex, _mm256_set1_ps(f.mAbsNormal[p][0])),
+					_mm256_mul_ps(ey, _mm256_set1_ps(f.mAbsNormal[p][1]))),
+					_mm256_mul_ps(ez, _mm256_set1_ps(f.mAbsNormal[p][2])));
+				inside = _mm256_and_ps(inside,
+					_mm256_cmp_ps(_mm256_add_ps(dist, reach), zero, _CMP_GE_OQ));
+			}
+			count += AppendLanes(_mm256_movemask_ps(inside) & LaneMask(i, last, 8),
+				i, outIndices + count);
+		}
+		return count;
+	}
+
+	BOX_KERNELS_AVX_TARGET
+	size_t CullSpheresAVX(const SphereArrays& spheres, size_t first, size_t last,
+		const FrustumPlanes& f, uint32_t* outIndices)
+	{
+		const __m256 zero = _mm256_setzero_ps();
+		size_t count = 0;
+		for (size_t i = first; i < last; i += 8)
+		{
+			__m256 x = _mm256_loadu_ps(&spheres.mX[i]);
+			__m256 y = _mm256_loadu_ps(&spheres.mY[i]);
+			__m256 z = _mm256_loadu_ps(&spheres.mZ[i]);
+			__m256 r = _mm256_loadu_ps(&spheres.mRadius[i]);
+			__m256 inside = _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ);
+			for (int p = 0; p < Frustum::NumPlanes; p++)
+			{
+				__m256 dist = _mm256_add_ps(_mm256_add_ps(
+					_mm256_mul_ps(x, _mm256_set1_ps(f.mNormal[p][0])),
+					_mm256_mul_ps(y, _mm256_set1_ps(f.mNormal[p][1]))),
+					_mm256_mul_ps(z, _mm256_set1_ps(f.mNormal[p][2])));
+				dist = _mm256_sub_ps(dist, _mm256_set1_ps(f.mD[p]));
+				inside = _mm256_and_ps(inside,
+					_mm256_cmp_ps(_mm256_add_ps(dist, r), zero, _CMP_GE_OQ));
+			}
+			count += AppendLanes(_mm256_movemask_ps(inside) & LaneMask(i, last, 8),
+				i, outIndices + count);
+		}
+		return count;
+	}
+#endif
+
+	BoxKernels::Level DetectLevel()
+	{
+#ifdef BOX_KERNELS_AVX
+		if (SDL_HasAVX())
+		{
+			return BoxKernels::EAVX;
+		}
+#endif
+#ifdef BOX_KERNELS_SSE
+		return BoxKernels::ESSE;
+#else
+		return BoxKernels::EScalar;
+#endif
+	}
+
+	const BoxKernels::Level sBestLevel = DetectLevel();
+	BoxKernels::Level sLevel = sBestLevel;
+}
+
+BoxKernels::Level BoxKernels::GetLevel()
+{
+	return sLevel;
+}
+
+void BoxKernels::SetLevel(Level level)
+{
+	sLevel = std::min(level, sBestLevel);
+}
+
+BoxKernels::Level BoxKernels::GetBestLevel()
+{
+	return sBestLevel;
+}
+
+const char* BoxKernels::GetLevelName(Level level)
+{
+	switch (level)
+	{
+	case EAVX:
+		return "avx";
+	case ESSE:
+		return "sse";
+	default:
+		return "scalar";
+	}
+}
+
+size_t BoxKernels::OverlapBox(const BoxArrays& boxes, size_t first, size_t last,
+	const AABB& box, uint32_t* outIndices, uint32_t mask)
+{
+	switch (sLevel)
+	{
+#ifdef BOX_KERNELS_AVX
+	case EAVX:
+		return OverlapBoxAVX(boxes, first, last, box, outIndices, mask);
+#endif
+#ifdef BOX_KERNELS_SSE
+	case ESSE:
+		return OverlapBoxSSE(boxes, first, last, box, outIndices, mask);
+#endif
+	default:
+		return OverlapBoxScalar(boxes, first, last, box, outIndices, mask);
+	}
+}
+
+bool BoxKernels::SegmentCast(const BoxArrays& boxes, size_t first, size_t last,
+	const LineSegment& l, float& outT, size_t& outIndex, uint32_t mask)
+{
+	SegmentAxes seg(l);
+	switch (sLevel)
+	{
+#ifdef BOX_KERNELS_AVX
+	case EAVX:
+		return SegmentCastAVX(boxes, first, last, seg, outT, outIndex, mask);
+#endif
+#ifdef BOX_KERNELS_SSE
+	case ESSE:
+		return SegmentCastSSE(boxes, first, last, seg, outT, outIndex, mask);
+#endif
+	default:
+		return SegmentCastScalar(boxes, first, last, seg, outT, outIndex, mask);
+	}
+}
+
+size_t BoxKernels::CullBoxes(const BoxArrays& boxes, size_t first, size_t last,
+	const Frustum& frustum, uint32_t* outIndices)
+{
+	FrustumPlanes f(frustum);
+	switch (sLevel)
+	{
+#ifdef BOX_KERNELS_AVX
+	case EAVX:
+		return CullBoxesAVX(boxes, first, last, f, outIndices);
+#endif
+#ifdef BOX_KERNELS_SSE
+	case ESSE:
+		return CullBoxesSSE(boxes, first, last, f, outIndices);
+#endif
+	default:
+		return CullBoxesScalar(boxes, first, last, f, outIndices);
+	}
+}
+
+size_t BoxKernels::CullSpheres(const SphereArrays& spheres, size_t first, size_t last,
+	const Frustum& frustum, uint32_t* outIndices)
+{
+	FrustumPlanes f(frustum);
+	switch (sLevel)
+	{
+#ifdef BOX_KERNELS_AVX
+	case EAVX:
+		return CullSpheresAVX(spheres, first, last, f, outIndices);
+#endif
+#ifdef BOX_KERNELS_SSE
+	case ESSE:
+		return CullSpheresSSE(spheres, first, last, f, outIndices);
+#endif
+	default:
+		return CullSpheresScalar(spheres, first, last, f, outIndices);
+	}
+}
+
+bool BoxKernels::SegmentBox(const LineSegment& l, const AABB& box,
+	float& outT, Vector3& outNorm)
+{
+	SegmentAxes seg(l);
+	const float* mins = box.mMin.GetAsFloatPtr();
+	const float* maxs = box.mMax.GetAsFloatPtr();
+	float tEnter = -Math::Infinity;
+	float tExit = Math::Infinity;
+	int enterAxis = 0;
+	int exitAxis = 0;
+	float enterSign = 0.0f;
+	float exitSign = 0.0f;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		if (seg.mParallel[axis])
+		{
+			if (seg.mStart[axis] < mins[axis] || seg.mStart[axis] > maxs[axis])
+			{
+				return false;
+			}
+			continue;
+		}
+		// Going forward, the segment enters at the min plane
+		float t1 = (mins[axis] - seg.mStart[axis]) * seg.mInvDelta[axis];
+		float t2 = (maxs[axis] - seg.mStart[axis]) * seg.mInvDelta[axis];
+		float sign = -1.0f;
+		if (t1 > t2)
+		{
+			std::swap(t1, t2);
+			sign = 1.0f;
+		}
+		if (t1 > tEnter)
+		{
+			tEnter = t1;
+			enterAxis = axis;
+			enterSign = sign;
+		}
+		if (t2 < tExit)
+		{
+			tExit = t2;
+			exitAxis = axis;
+			exitSign = -sign;
+		}
+	}
+	if (tEnter > tExit || tExit < 0.0f)
+	{
+		return false;
+	}
+	// Starting inside the box hits where it leaves
+	int axis = enterAxis;
+	float sign = enterSign;
+	outT = tEnter;
+	if (tEnter < 0.0f)
+	{
+		axis = exitAxis;
+		sign = exitSign;
+		outT = tExit;
+	}
+	if (outT > 1.0f)
+	{
+		return false;
+	}
+	const Vector3 axes[3] = { Vector3::UnitX, Vector3::UnitY, Vector3::UnitZ };
+	outNorm = axes[axis] * sign;
+	return true;
+}
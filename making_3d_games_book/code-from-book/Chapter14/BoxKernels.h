@@ -0,0 +1,102 @@
+// ----------------------------------------------------------------
+// From Game Programming in C++ by Sanjay Madhav
+// Copyright (C) 2017 Sanjay Madhav. All rights reserved.
+// 
+// Released under the BSD License
+// See LICENSE in root directory for full details.
+// ----------------------------------------------------------------
+
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "Collision.h"
+
+// Axis-aligned boxes stored as one array per float, so the kernels
+// below can load the same value for 4 or 8 boxes at once. There's
+// always padding after the last box, and unused boxes sit at
+// infinity, so they never overlap or get hit by anything.
+// Each box also has layer bits, and the kernels skip any box
+// that isn't on one of the layers in their mask.
+struct BoxArrays
+{
+	BoxArrays();
+	void Resize(size_t count);
+	void Set(size_t index, const AABB& box);
+	void SetLayer(size_t index, uint32_t layer) { mLayers[index] = layer; }
+	// Move the box to infinity (on no layers)
+	void Clear(size_t index);
+	AABB Get(size_t index) const;
+	size_t GetCount() const { return mCount; }
+
+	// Enough padding for an 8-wide load at the last box
+	static const size_t Padding = 8;
+	std::vector<float> mMinX;
+	std::vector<float> mMinY;
+	std::vector<float> mMinZ;
+	std::vector<float> mMaxX;
+	std::vector<float> mMaxY;
+	std::vector<float> mMaxZ;
+	std::vector<uint32_t> mLayers;
+	size_t mCount;
+};
+
+// Spheres stored the same way (the padding has zero radius)
+struct SphereArrays
+{
+	SphereArrays();
+	void Resize(size_t count);
+	void Set(size_t index, const Sphere& sphere);
+	Sphere Get(size_t index) const;
+	size_t GetCount() const { return mCount; }
+
+	static const size_t Padding = 8;
+	std::vector<float> mX;
+	std::vector<float> mY;
+	std::vector<float> mZ;
+	std::vector<float> mRadius;
+	size_t mCount;
+};
+
+// Tests one box or segment against many boxes, using SSE or AVX if
+// the CPU has it (picked at startup) or a scalar loop if it doesn't
+class BoxKernels
+{
+public:
+	enum Level
+	{
+		EScalar,
+		ESSE,
+		EAVX
+	};
+	static Level GetLevel();
+	// Use this level (or the best one the CPU has, if it's lower)
+	static void SetLevel(Level level);
+	static Level GetBestLevel();
+	static const char* GetLevelName(Level level);
+
+	// Matches boxes on any layer
+	static const uint32_t AllLayers = 0xFFFFFFFF;
+
+	// Writes the index of every box in [first, last) that overlaps
+	// box to outIndices (which needs room for last - first), and
+	// returns how many there are
+	static size_t OverlapBox(const BoxArrays& boxes, size_t first, size_t last,
+		const AABB& box, uint32_t* outIndices, uint32_t mask = AllLayers);
+	// Finds the closest box in [first, last) the segment hits.
+	// Same results as Intersect(LineSegment, AABB): a segment that
+	// starts in a box hits where it leaves.
+	static bool SegmentCast(const BoxArrays& boxes, size_t first, size_t last,
+		const LineSegment& l, float& outT, size_t& outIndex, uint32_t mask = AllLayers);
+	// Writes the index of every box/sphere in [first, last) that
+	// Intersect(frustum, box/sphere) would say is inside the frustum
+	// to outIndices (which needs room for last - first), and returns
+	// how many there are. These ignore layers.
+	static size_t CullBoxes(const BoxArrays& boxes, size_t first, size_t last,
+		const Frustum& frustum, uint32_t* outIndices);
+	static size_t CullSpheres(const SphereArrays& spheres, size_t first, size_t last,
+		const Frustum& frustum, uint32_t* outIndices);
+	// Same as SegmentCast, for one box (and gets the normal of the face
+	// that was hit), but doesn't allocate like Intersect does
+	static bool SegmentBox(const LineSegment& l, const AABB& box,
+		float& outT, Vector3& outNorm);
+};
@@ -0,0 +1,259 @@
+// ----------------------------------------------------------------
+// From Game Programming in C++ by Sanjay Madhav
+// Copyright (C) 2017 Sanjay Madhav. All rights reserved.
+// 
+// Released under the BSD License
+// See LICENSE in root directory for full details.
+// ----------------------------------------------------------------
+
+#include "CharacterController.h"
+#include "Actor.h"
+#include "Game.h"
+#include "BoxComponent.h"
+#include "DynamicsWorld.h"
+#include "LevelLoader.h"
+
+const float CharacterController::Skin = 1.0f;
+
+CharacterController::CharacterController(Actor* owner, int updateOrder)
+	:MoveComponent(owner, updateOrder)
+	,mRadius(25.0f)
+	,mHeight(100.0f)
+	,mStepHeight(30.0f)
+	,mMaxSlope(Math::Pi / 4.0f)
+	,mSnapDistance(20.0f)
+	,mFallSpeed(0.0f)
+	,mOnGround(false)
+	,mGroundNormal(Vector3::UnitZ)
+	,mFilter(BoxComponent::DefaultLayer)
+{
+	mFilter.Ignore(owner);
+}
+
+void CharacterController::Update(float deltaTime)
+{
+	Turn(deltaTime);
+
+	Vector3 start = mOwner->GetWorldPosition();
+	Vector3 pos = start;
+	Depenetrate(pos);
+	Vector3 move = mOwner->GetForward() * mForwardSpeed * deltaTime;
+	move += mOwner->GetRight() * mStrafeSpeed * deltaTime;
+	if (mOnGround)
+	{
+		pos = WalkMove(pos, move);
+	}
+	else
+	{
+		pos = FallMove(pos, move, deltaTime);
+	}
+	if ((pos - start).LengthSq() > 0.0f)
+	{
+		mOwner->SetWorldPosition(pos);
+	}
+}
+
+Capsule CharacterController::MakeCapsule(const Vector3& pos) const
+{
+	// The bottom of the capsule is at the owner's position
+	float height = Math::Max(mHeight, 2.0f * mRadius);
+	return Capsule(pos + Vector3::UnitZ * mRadius,
+		pos + Vector3::UnitZ * (height - mRadius), mRadius);
+}
+
+bool CharacterController::Cast(const Vector3& pos, const Vector3& delta, float& outDist,
+	PhysWorld::CollisionInfo& outColl) const
+{
+	float length = delta.Length();
+	outDist = length;
+	if (length <= 0.0f)
+	{
+		return false;
+	}
+	// Sweep a skin further, and stop a skin short
+	Vector3 dir = delta * (1.0f / length);
+	PhysWorld* phys = mOwner->GetGame()->GetPhysWorld();
+	if (!phys->SweepCapsule(MakeCapsule(pos), dir * (length + Skin), outColl, mFilter))
+	{
+		return false;
+	}
+	outDist = Math::Max(outColl.mT * (length + Skin) - Skin, 0.0f);
+	return true;
+}
+
+Vector3 CharacterController::SlideMove(Vector3 pos, Vector3 delta) const
+{
+	Vector3 lastNormal = Vector3::Zero;
+	for (int i = 0; i < MaxSlides; i++)
+	{
+		float length = delta.Length();
+		if (Math::NearZero(length))
+		{
+			break;
+		}
+		float dist;
+		PhysWorld::CollisionInfo info;
+		if (!Cast(pos, delta, dist, info))
+		{
+			pos += delta;
+			break;
+		}
+		Vector3 dir = delta * (1.0f / length);
+		pos += dir * dist;
+
+		Vector3 normal = info.mNormal;
+		if (mOnGround && !IsWalkable(normal))
+		{
+			// Too steep to walk up, so it's a wall (only
+			// stepping gets it any higher)
+			normal.z = 0.0f;
+			if (normal.LengthSq() < 0.0001f)
+			{
+				break;
+			}
+			normal.Normalize();
+		}
+		// Slide the rest of the way along the surface
+		delta = dir * (length - dist);
+		delta -= normal * Vector3::Dot(delta, normal);
+		if (i > 0 && Vector3::Dot(delta, lastNormal) < 0.0f)
+		{
+			// That would go back into the last surface, so
+			// follow the crease between the two instead
+			Vector3 crease = Vector3::Cross(lastNormal, normal);
+			if (crease.LengthSq() < 0.0001f)
+			{
+				break;
+			}
+			crease.Normalize();
+			delta = crease * Vector3::Dot(delta, crease);
+		}
+		lastNormal = normal;
+	}
+	return pos;
+}
+
+bool CharacterController::IsWalkable(const Vector3& normal) const
+{
+	return normal.z >= Math::Cos(mMaxSlope);
+}
+
+bool CharacterController::SnapToGround(Vector3& pos, float distance)
+{
+	float dist;
+	PhysWorld::CollisionInfo info;
+	if (!Cast(pos, Vector3::UnitZ * -distance, dist, info))
+	{
+		return false;
+	}
+	Vector3 normal = info.mNormal;
+	if (!IsWalkable(normal))
+	{
+		// Coming down on an edge gives a normal partway between the
+		// two faces, so look straight down at the face past the edge
+		Vector3 out(info.mPoint.x - pos.x, info.mPoint.y - pos.y, 0.0f);
+		if (out.LengthSq() > 0.0001f)
+		{
+			out.Normalize();
+		}
+		Vector3 probe = info.mPoint + out * (Skin * 0.5f);
+		LineSegment l(probe + Vector3::UnitZ * Skin, probe - Vector3::UnitZ * Skin);
+		PhysWorld::CollisionInfo face;
+		if (mOwner->GetGame()->GetPhysWorld()->SegmentCast(l, face, mFilter))
+		{
+			normal = face.mNormal;
+		}
+	}
+	if (!IsWalkable(normal))
+	{
+		return false;
+	}
+	pos.z -= dist;
+	mGroundNormal = normal;
+	return true;
+}
+
+void CharacterController::Depenetrate(Vector3& pos)
+{
+	Capsule capsule = MakeCapsule(pos);
+	Vector3 radius(mRadius, mRadius, mRadius);
+	AABB bounds(capsule.mSegment.mStart - radius, capsule.mSegment.mEnd + radius);
+	mNearby.clear();
+	mOwner->GetGame()->GetPhysWorld()->OverlapBox(bounds, mNearby, mFilter);
+	for (BoxComponent* box : mNearby)
+	{
+		ContactManifold contact;
+		if (Intersect(capsule, box->GetWorldOBB(), contact))
+		{
+			// The normal points into the box
+			pos -= contact.mNormal * (contact.mDepth + Skin);
+			capsule = MakeCapsule(pos);
+		}
+	}
+}
+
+Vector3 CharacterController::WalkMove(Vector3 pos, const Vector3& move)
+{
+	if (move.LengthSq() > 0.0f)
+	{
+		// Step up, move across, and come back down (further than it
+		// went up, so it follows the ground down slopes and steps)
+		float up;
+		PhysWorld::CollisionInfo info;
+		Cast(pos, Vector3::UnitZ * mStepHeight, up, info);
+		Vector3 across = SlideMove(pos + Vector3::UnitZ * up, move);
+		if (SnapToGround(across, up + mSnapDistance))
+		{
+			return across;
+		}
+		// Stepped onto something too steep, or off a ledge,
+		// so try again without stepping
+		pos = SlideMove(pos, move);
+	}
+	mOnGround = SnapToGround(pos, mSnapDistance);
+	if (!mOnGround)
+	{
+		mFallSpeed = 0.0f;
+	}
+	return pos;
+}
+
+Vector3 CharacterController::FallMove(Vector3 pos, const Vector3& move, float deltaTime)
+{
+	mFallSpeed -= mOwner->GetGame()->GetDynamicsWorld()->GetGravity().z * deltaTime;
+	pos = SlideMove(pos, move + Vector3::UnitZ * (-mFallSpeed * deltaTime));
+	// Landed?
+	if (SnapToGround(pos, Skin))
+	{
+		mOnGround = true;
+		mFallSpeed = 0.0f;
+	}
+	return pos;
+}
+
+void CharacterController::LoadProperties(const rapidjson::Value& inObj)
+{
+	MoveComponent::LoadProperties(inObj);
+
+	JsonHelper::GetFloat(inObj, "radius", mRadius);
+	JsonHelper::GetFloat(inObj, "height", mHeight);
+	JsonHelper::GetFloat(inObj, "stepHeight", mStepHeight);
+	JsonHelper::GetFloat(inObj, "maxSlope", mMaxSlope);
+	JsonHelper::GetFloat(inObj, "snapDistance", mSnapDistance);
+	JsonHelper::GetFloat(inObj, "fallSpeed", mFallSpeed);
+	JsonHelper::GetBool(inObj, "onGround", mOnGround);
+}
+
+void CharacterController::SaveProperties(rapidjson::Document::AllocatorType& alloc,
+	rapidjson::Value& inObj) const
+{
+	MoveComponent::SaveProperties(alloc, inObj);
+
+	JsonHelper::AddFloat(alloc, inObj, "radius", mRadius);
+	JsonHelper::AddFloat(alloc, inObj, "height", mHeight);
+	JsonHelper::AddFloat(alloc, inObj, "stepHeight", mStepHeight);
+	JsonHelper::AddFloat(alloc, inObj, "maxSlope", mMaxSlope);
+	JsonHelper::AddFloat(alloc, inObj, "snapDistance", mSnapDistance);
+	JsonHelper::AddFloat(alloc, inObj, "fallSpeed", mFallSpeed);
+	JsonHelper::AddBool(alloc, inObj, "onGround", mOnGround);
+}
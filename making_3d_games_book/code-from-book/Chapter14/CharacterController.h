@@ -0,0 +1,87 @@
+// ----------------------------------------------------------------
+// From Game Programming in C++ by Sanjay Madhav
+// Copyright (C) 2017 Sanjay Madhav. All rights reserved.
+// 
+// Released under the BSD License
+// See LICENSE in root directory for full details.
+// ----------------------------------------------------------------
+
+#pragma once
+#include "MoveComponent.h"
+#include "PhysWorld.h"
+#include <vector>
+
+// Moves its owner like a MoveComponent, but as a capsule standing
+// on the owner's position that can't go through boxes. It slides
+// along whatever it runs into, walks up ledges up to the step
+// height, sticks to the ground going down slopes and steps, and
+// falls when there's nothing under it. Each move is a swept query,
+// so only boxes near the capsule's path are ever tested.
+class CharacterController : public MoveComponent
+{
+public:
+	CharacterController(class Actor* owner, int updateOrder = 10);
+	void Update(float deltaTime) override;
+
+	TypeID GetType() const override { return TCharacterController; }
+
+	void LoadProperties(const rapidjson::Value& inObj) override;
+	void SaveProperties(rapidjson::Document::AllocatorType& alloc,
+		rapidjson::Value& inObj) const override;
+
+	// Capsule size (the height includes both rounded ends)
+	void SetRadius(float radius) { mRadius = radius; }
+	float GetRadius() const { return mRadius; }
+	void SetHeight(float height) { mHeight = height; }
+	float GetHeight() const { return mHeight; }
+	// Tallest ledge it can walk up onto
+	void SetStepHeight(float height) { mStepHeight = height; }
+	float GetStepHeight() const { return mStepHeight; }
+	// Steepest ground (in radians) it can stand on
+	void SetMaxSlope(float radians) { mMaxSlope = radians; }
+	float GetMaxSlope() const { return mMaxSlope; }
+	// Furthest it drops to stay on the ground while walking
+	void SetSnapDistance(float distance) { mSnapDistance = distance; }
+	float GetSnapDistance() const { return mSnapDistance; }
+
+	bool IsOnGround() const { return mOnGround; }
+	const Vector3& GetGroundNormal() const { return mGroundNormal; }
+private:
+	// Most surfaces it slides along in one move
+	static const int MaxSlides = 4;
+	// Gap it keeps from everything, so the next sweep
+	// doesn't start out touching
+	static const float Skin;
+
+	Capsule MakeCapsule(const Vector3& pos) const;
+	// Whether it hits something moving by delta, and how far
+	// along delta it can go first
+	bool Cast(const Vector3& pos, const Vector3& delta, float& outDist,
+		PhysWorld::CollisionInfo& outColl) const;
+	// Move by delta, sliding along anything in the way
+	Vector3 SlideMove(Vector3 pos, Vector3 delta) const;
+	bool IsWalkable(const Vector3& normal) const;
+	// If there's walkable ground within distance below,
+	// move down onto it
+	bool SnapToGround(Vector3& pos, float distance);
+	// Push out of any box it ended up inside (such as one
+	// that moved into it)
+	void Depenetrate(Vector3& pos);
+	// Step up, move across, then come back down
+	Vector3 WalkMove(Vector3 pos, const Vector3& move);
+	Vector3 FallMove(Vector3 pos, const Vector3& move, float deltaTime);
+
+	float mRadius;
+	float mHeight;
+	float mStepHeight;
+	float mMaxSlope;
+	float mSnapDistance;
+	// Downward speed while falling
+	float mFallSpeed;
+	bool mOnGround;
+	Vector3 mGroundNormal;
+	// Skips the owner's own boxes
+	PhysWorld::QueryFilter mFilter;
+	// Boxes near the capsule (kept so it doesn't allocate each frame)
+	std::vector<class BoxComponent*> mNearby;
+};
@@ -233,11 +233,65 @@ float AABB::MinDistSq(const Vector3& point) const
 	float dy = Math::Max(mMin.y - point.y, 0.0f);
 	dy = Math::Max(dy, point.y - mMax.y);
 	float dz = Math::Max(mMin.z - point.z, 0.0f);
-	dz = Math::Max(dy, point.z - mMax.z);
+	dz = Math::Max(dz, point.z - mMax.z);
 	// Distance squared formula
 	return dx * dx + dy * dy + dz * dz;
 }
 
+void OBB::GetAxes(Vector3 outAxes[3]) const
+{
+	outAxes[0] = Vector3::Transform(Vector3::UnitX, mRotation);
+	outAxes[1] = Vector3::Transform(Vector3::UnitY, mRotation);
+	outAxes[2] = Vector3::Transform(Vector3::UnitZ, mRotation);
+}
+
+AABB OBB::GetBounds() const
+{
+	Vector3 axes[3];
+	GetAxes(axes);
+	// How far the box reaches along each world axis
+	Vector3 half(
+		Math::Abs(axes[0].x) * mExtents.x + Math::Abs(axes[1].x) * mExtents.y +
+			Math::Abs(axes[2].x) * mExtents.z,
+		Math::Abs(axes[0].y) * mExtents.x + Math::Abs(axes[1].y) * mExtents.y +
+			Math::Abs(axes[2].y) * mExtents.z,
+		Math::Abs(axes[0].z) * mExtents.x + Math::Abs(axes[1].z) * mExtents.y +
+			Math::Abs(axes[2].z) * mExtents.z);
+	return AABB(mCenter - half, mCenter + half);
+}
+
+bool OBB::Contains(const Vector3& point) const
+{
+	Vector3 axes[3];
+	GetAxes(axes);
+	Vector3 diff = point - mCenter;
+	const float* ext = mExtents.GetAsFloatPtr();
+	for (int i = 0; i < 3; i++)
+	{
+		if (Math::Abs(Vector3::Dot(diff, axes[i])) > ext[i])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+Vector3 OBB::ClosestPoint(const Vector3& point) const
+{
+	Vector3 axes[3];
+	GetAxes(axes);
+	Vector3 diff = point - mCenter;
+	const float* ext = mExtents.GetAsFloatPtr();
+	// Clamp the point to the box along each of its axes
+	Vector3 result = mCenter;
+	for (int i = 0; i < 3; i++)
+	{
+		float dist = Math::Clamp(Vector3::Dot(diff, axes[i]), -ext[i], ext[i]);
+		result += axes[i] * dist;
+	}
+	return result;
+}
+
 Capsule::Capsule(const Vector3& start, const Vector3& end, float radius)
 	:mSegment(start, end)
 	, mRadius(radius)
@@ -256,6 +310,29 @@ bool Capsule::Contains(const Vector3& point) const
 	return distSq <= (mRadius * mRadius);
 }
 
+Frustum::Frustum(const Matrix4& viewProj)
+{
+	// With row vectors, clip = (p, 1) * viewProj, so each plane
+	// is a sum of viewProj's columns (x, y and z are inside when
+	// -w <= x <= w, -w <= y <= w and 0 <= z <= w)
+	const int column[NumPlanes] = { 0, 0, 1, 1, 2, 2 };
+	const float sign[NumPlanes] = { 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f };
+	const float wScale[NumPlanes] = { 1.0f, 1.0f, 1.0f, 1.0f, 0.0f, 1.0f };
+	for (int i = 0; i < NumPlanes; i++)
+	{
+		float coeffs[4];
+		for (int row = 0; row < 4; row++)
+		{
+			coeffs[row] = viewProj.mat[row][3] * wScale[i] +
+				viewProj.mat[row][column[i]] * sign[i];
+		}
+		Vector3 normal(coeffs[0], coeffs[1], coeffs[2]);
+		float invLength = 1.0f / normal.Length();
+		mNormals[i] = normal * invLength;
+		mD[i] = -coeffs[3] * invLength;
+	}
+}
+
 bool ConvexPolygon::Contains(const Vector2& point) const
 {
 	float sum = 0.0f;
@@ -314,6 +391,36 @@ bool Intersect(const Sphere& s, const AABB& box)
 	return distSq <= (s.mRadius * s.mRadius);
 }
 
+bool Intersect(const Frustum& f, const Sphere& s)
+{
+	for (int i = 0; i < Frustum::NumPlanes; i++)
+	{
+		if (Vector3::Dot(s.mCenter, f.mNormals[i]) - f.mD[i] < -s.mRadius)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Intersect(const Frustum& f, const AABB& box)
+{
+	Vector3 center = (box.mMin + box.mMax) * 0.5f;
+	Vector3 extents = (box.mMax - box.mMin) * 0.5f;
+	for (int i = 0; i < Frustum::NumPlanes; i++)
+	{
+		// How far the box reaches towards the inside of the plane
+		const Vector3& n = f.mNormals[i];
+		float reach = extents.x * Math::Abs(n.x) + extents.y * Math::Abs(n.y) +
+			extents.z * Math::Abs(n.z);
+		if (Vector3::Dot(center, n) - f.mD[i] < -reach)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
 bool Intersect(const LineSegment& l, const Sphere& s, float& outT)
 {
 	// Compute X, Y, a, b, c as per equations
@@ -479,7 +586,7 @@ bool SweptSphere(const Sphere& P0, const Sphere& P1,
 		disc = Math::Sqrt(disc);
 		// We only care about the smaller solution
 		outT = (-b - disc) / (2.0f * a);
-		if (outT >= 0.0f && outT <= 0.0f)
+		if (outT >= 0.0f && outT <= 1.0f)
 		{
 			return true;
 		}
@@ -489,3 +596,901 @@ bool SweptSphere(const Sphere& P0, const Sphere& P1,
 		}
 	}
 }
+
+bool SweptAABB(const AABB& a, const Vector3& aDelta,
+	const AABB& b, const Vector3& bDelta, float& outT, Vector3& outNorm)
+{
+	if (Intersect(a, b))
+	{
+		outT = 0.0f;
+		outNorm = Vector3::Zero;
+		return true;
+	}
+	// In b's frame, a's center moves along a segment, and hits
+	// b grown by a's half size (the Minkowski sum)
+	Vector3 half = (a.mMax - a.mMin) * 0.5f;
+	Vector3 center = (a.mMin + a.mMax) * 0.5f;
+	Vector3 delta = aDelta - bDelta;
+	AABB grown(b.mMin - half, b.mMax + half);
+
+	const float* start = center.GetAsFloatPtr();
+	const float* d = delta.GetAsFloatPtr();
+	const float* mins = grown.mMin.GetAsFloatPtr();
+	const float* maxs = grown.mMax.GetAsFloatPtr();
+	const Vector3 axes[3] = { Vector3::UnitX, Vector3::UnitY, Vector3::UnitZ };
+	float tEnter = 0.0f;
+	float tExit = 1.0f;
+	outNorm = Vector3::Zero;
+	for (int i = 0; i < 3; i++)
+	{
+		if (Math::NearZero(d[i]))
+		{
+			// Not moving on this axis, so it has to be inside already
+			if (start[i] < mins[i] || start[i] > maxs[i])
+			{
+				return false;
+			}
+			continue;
+		}
+		float t1 = (mins[i] - start[i]) / d[i];
+		float t2 = (maxs[i] - start[i]) / d[i];
+		// Moving forward, it enters at the min face
+		Vector3 norm = axes[i] * -1.0f;
+		if (t1 > t2)
+		{
+			std::swap(t1, t2);
+			norm = axes[i];
+		}
+		if (t1 > tEnter)
+		{
+			tEnter = t1;
+			outNorm = norm;
+		}
+		tExit = Math::Min(tExit, t2);
+		if (tEnter > tExit)
+		{
+			return false;
+		}
+	}
+	outT = tEnter;
+	return true;
+}
+
+bool SweptSphere(const Sphere& s, const Vector3& sDelta,
+	const AABB& box, const Vector3& boxDelta, float& outT, Vector3& outNorm)
+{
+	// Close enough to count as touching
+	const float tolerance = 0.01f;
+	const int maxIterations = 64;
+	// In the box's frame, only the sphere moves
+	Vector3 delta = sDelta - boxDelta;
+	float speed = delta.Length();
+	float t = 0.0f;
+	for (int i = 0; i < maxIterations; i++)
+	{
+		Vector3 center = s.mCenter + delta * t;
+		// Closest point on the box to the center
+		Vector3 closest(Math::Clamp(center.x, box.mMin.x, box.mMax.x),
+			Math::Clamp(center.y, box.mMin.y, box.mMax.y),
+			Math::Clamp(center.z, box.mMin.z, box.mMax.z));
+		Vector3 diff = center - closest;
+		float centerDist = diff.Length();
+		float dist = centerDist - s.mRadius;
+		if (dist <= tolerance)
+		{
+			if (centerDist > 0.0f)
+			{
+				outNorm = diff * (1.0f / centerDist);
+			}
+			else if (speed > 0.0f)
+			{
+				// The center's inside the box
+				outNorm = delta * (-1.0f / speed);
+			}
+			else
+			{
+				outNorm = Vector3::UnitZ;
+			}
+			// Touching but moving apart isn't a hit
+			if (Vector3::Dot(outNorm, delta) >= 0.0f)
+			{
+				return false;
+			}
+			outT = t;
+			return true;
+		}
+		if (speed <= 0.0f)
+		{
+			return false;
+		}
+		// Can't hit anything before it covers the gap
+		t += dist / speed;
+		if (t > 1.0f)
+		{
+			return false;
+		}
+	}
+	// Didn't converge (only just grazing it)
+	return false;
+}
+
+bool SweptCapsule(const Capsule& c, const Vector3& cDelta,
+	const OBB& box, float& outT, Vector3& outNorm)
+{
+	const float tolerance = 0.01f;
+	const int maxIterations = 64;
+	float speed = cDelta.Length();
+	float t = 0.0f;
+	for (int i = 0; i < maxIterations; i++)
+	{
+		Vector3 offset = cDelta * t;
+		LineSegment l(c.mSegment.mStart + offset, c.mSegment.mEnd + offset);
+		Vector3 point = ClosestPointToBox(l, box);
+		Vector3 diff = point - box.ClosestPoint(point);
+		float pointDist = diff.Length();
+		float dist = pointDist - c.mRadius;
+		if (dist <= tolerance)
+		{
+			if (pointDist > 0.0f)
+			{
+				outNorm = diff * (1.0f / pointDist);
+			}
+			else if (speed > 0.0f)
+			{
+				// The segment's inside the box
+				outNorm = cDelta * (-1.0f / speed);
+			}
+			else
+			{
+				outNorm = Vector3::UnitZ;
+			}
+			if (Vector3::Dot(outNorm, cDelta) >= 0.0f)
+			{
+				return false;
+			}
+			outT = t;
+			return true;
+		}
+		if (speed <= 0.0f)
+		{
+			return false;
+		}
+		t += dist / speed;
+		if (t > 1.0f)
+		{
+			return false;
+		}
+	}
+	return false;
+}
+
+namespace
+{
+	// Closest point on l to the point
+	Vector3 ClosestPointOnSegment(const LineSegment& l, const Vector3& point)
+	{
+		Vector3 d = l.mEnd - l.mStart;
+		float lenSq = d.LengthSq();
+		if (lenSq <= 0.0f)
+		{
+			return l.mStart;
+		}
+		float t = Math::Clamp(Vector3::Dot(point - l.mStart, d) / lenSq, 0.0f, 1.0f);
+		return l.mStart + d * t;
+	}
+
+	// Closest points between two segments (the method from Ericson's
+	// Real-Time Collision Detection, which unlike MinDistSq also
+	// gives back the points)
+	void ClosestPoints(const LineSegment& s1, const LineSegment& s2,
+		Vector3& outP1, Vector3& outP2)
+	{
+		const float epsilon = 1e-6f;
+		Vector3 d1 = s1.mEnd - s1.mStart;
+		Vector3 d2 = s2.mEnd - s2.mStart;
+		Vector3 r = s1.mStart - s2.mStart;
+		float a = d1.LengthSq();
+		float e = d2.LengthSq();
+		float f = Vector3::Dot(d2, r);
+		float s = 0.0f;
+		float t = 0.0f;
+		if (a <= epsilon && e <= epsilon)
+		{
+			// Both are points
+		}
+		else if (a <= epsilon)
+		{
+			t = Math::Clamp(f / e, 0.0f, 1.0f);
+		}
+		else
+		{
+			float c = Vector3::Dot(d1, r);
+			if (e <= epsilon)
+			{
+				s = Math::Clamp(-c / a, 0.0f, 1.0f);
+			}
+			else
+			{
+				float b = Vector3::Dot(d1, d2);
+				float denom = a * e - b * b;
+				// If they're parallel any s works, so use 0
+				if (denom > epsilon * a * e)
+				{
+					s = Math::Clamp((b * f - c * e) / denom, 0.0f, 1.0f);
+				}
+				t = (b * s + f) / e;
+				if (t < 0.0f)
+				{
+					t = 0.0f;
+					s = Math::Clamp(-c / a, 0.0f, 1.0f);
+				}
+				else if (t > 1.0f)
+				{
+					t = 1.0f;
+					s = Math::Clamp((b - c) / a, 0.0f, 1.0f);
+				}
+			}
+		}
+		outP1 = s1.mStart + d1 * s;
+		outP2 = s2.mStart + d2 * t;
+	}
+
+	// Some unit vector perpendicular to v
+	Vector3 Perpendicular(const Vector3& v)
+	{
+		Vector3 other = Math::Abs(v.x) < 0.57f ? Vector3::UnitX : Vector3::UnitY;
+		Vector3 result = Vector3::Cross(v, other);
+		if (Math::NearZero(result.LengthSq()))
+		{
+			return Vector3::UnitZ;
+		}
+		result.Normalize();
+		return result;
+	}
+
+	// Middle of where spheres around pointA and pointB overlap, along
+	// the normal between them (dist apart). A deep overlap can reach
+	// past the far sphere's center, so this clamps to both spheres.
+	Vector3 OverlapMidpoint(const Vector3& pointA, float radiusA,
+		const Vector3& normal, float dist, float radiusB)
+	{
+		float lo = Math::Max(-radiusA, dist - radiusB);
+		float hi = Math::Min(radiusA, dist + radiusB);
+		return pointA + normal * ((lo + hi) * 0.5f);
+	}
+
+	void AddContact(ContactManifold& contact, const Vector3& point, float depth)
+	{
+		if (contact.mNumPoints < ContactManifold::MaxPoints)
+		{
+			contact.mPoints[contact.mNumPoints] = point;
+			contact.mDepths[contact.mNumPoints] = depth;
+			contact.mNumPoints++;
+		}
+	}
+
+	// Keep at most MaxPoints of these: the deepest, the one furthest
+	// from it, and then the ones that add the most area on either
+	// side of the line between those two
+	void ReduceContacts(const Vector3* points, const float* depths, int count,
+		const Vector3& normal, ContactManifold& outContact)
+	{
+		if (count <= ContactManifold::MaxPoints)
+		{
+			for (int i = 0; i < count; i++)
+			{
+				AddContact(outContact, points[i], depths[i]);
+			}
+			return;
+		}
+		int deepest = 0;
+		for (int i = 1; i < count; i++)
+		{
+			if (depths[i] > depths[deepest])
+			{
+				deepest = i;
+			}
+		}
+		int furthest = -1;
+		float bestDistSq = -1.0f;
+		for (int i = 0; i < count; i++)
+		{
+			float distSq = (points[i] - points[deepest]).LengthSq();
+			if (i != deepest && distSq > bestDistSq)
+			{
+				bestDistSq = distSq;
+				furthest = i;
+			}
+		}
+		int left = -1;
+		int right = -1;
+		float maxArea = 0.0f;
+		float minArea = 0.0f;
+		Vector3 edge = points[furthest] - points[deepest];
+		for (int i = 0; i < count; i++)
+		{
+			float area = Vector3::Dot(Vector3::Cross(edge, points[i] - points[deepest]), normal);
+			if (area > maxArea)
+			{
+				maxArea = area;
+				left = i;
+			}
+			else if (area < minArea)
+			{
+				minArea = area;
+				right = i;
+			}
+		}
+		AddContact(outContact, points[deepest], depths[deepest]);
+		AddContact(outContact, points[furthest], depths[furthest]);
+		if (left >= 0)
+		{
+			AddContact(outContact, points[left], depths[left]);
+		}
+		if (right >= 0)
+		{
+			AddContact(outContact, points[right], depths[right]);
+		}
+	}
+
+	// Clip a convex polygon to the side of the plane where
+	// Dot(normal, p) <= d, returning the new vertex count
+	const int MaxClipVerts = 8;
+	int ClipPolygon(const Vector3* verts, int count, const Vector3& normal, float d,
+		Vector3* outVerts)
+	{
+		int outCount = 0;
+		for (int i = 0; i < count; i++)
+		{
+			const Vector3& p = verts[i];
+			const Vector3& q = verts[(i + 1) % count];
+			float distP = Vector3::Dot(normal, p) - d;
+			float distQ = Vector3::Dot(normal, q) - d;
+			if (distP <= 0.0f && outCount < MaxClipVerts)
+			{
+				outVerts[outCount++] = p;
+			}
+			// The edge crosses the plane
+			if ((distP <= 0.0f) != (distQ <= 0.0f) && outCount < MaxClipVerts)
+			{
+				float t = distP / (distP - distQ);
+				outVerts[outCount++] = p + (q - p) * t;
+			}
+		}
+		return outCount;
+	}
+
+	// Results of the separating axis test between two boxes
+	struct SATResult
+	{
+		Vector3 mAxesA[3];
+		Vector3 mAxesB[3];
+		// Face axis with the least overlap (0-2 are a's, 3-5 are b's)
+		int mFaceAxis;
+		float mFaceDepth;
+		Vector3 mFaceNormal;
+		// Edge cross product with the least overlap (-1 if none)
+		int mEdgeA;
+		int mEdgeB;
+		float mEdgeDepth;
+		Vector3 mEdgeNormal;
+	};
+
+	// Returns false as soon as it finds a separating axis. Normals
+	// point from a to b.
+	bool SeparatingAxisTest(const OBB& a, const OBB& b, SATResult& out)
+	{
+		a.GetAxes(out.mAxesA);
+		b.GetAxes(out.mAxesB);
+		const Vector3* axesA = out.mAxesA;
+		const Vector3* axesB = out.mAxesB;
+		const float* extA = a.mExtents.GetAsFloatPtr();
+		const float* extB = b.mExtents.GetAsFloatPtr();
+		Vector3 d = b.mCenter - a.mCenter;
+
+		// Rotation from b to a (the epsilon stops nearly
+		// parallel edges from finding a bogus separating axis)
+		float absR[3][3];
+		for (int i = 0; i < 3; i++)
+		{
+			for (int j = 0; j < 3; j++)
+			{
+				absR[i][j] = Math::Abs(Vector3::Dot(axesA[i], axesB[j])) + 1e-5f;
+			}
+		}
+
+		out.mFaceDepth = Math::Infinity;
+		out.mFaceAxis = 0;
+		// a's faces
+		for (int i = 0; i < 3; i++)
+		{
+			float rb = extB[0] * absR[i][0] + extB[1] * absR[i][1] + extB[2] * absR[i][2];
+			float dist = Vector3::Dot(d, axesA[i]);
+			float depth = extA[i] + rb - Math::Abs(dist);
+			if (depth < 0.0f)
+			{
+				return false;
+			}
+			if (depth < out.mFaceDepth)
+			{
+				out.mFaceDepth = depth;
+				out.mFaceAxis = i;
+				out.mFaceNormal = dist >= 0.0f ? axesA[i] : axesA[i] * -1.0f;
+			}
+		}
+		// b's faces
+		for (int j = 0; j < 3; j++)
+		{
+			float ra = extA[0] * absR[0][j] + extA[1] * absR[1][j] + extA[2] * absR[2][j];
+			float dist = Vector3::Dot(d, axesB[j]);
+			float depth = ra + extB[j] - Math::Abs(dist);
+			if (depth < 0.0f)
+			{
+				return false;
+			}
+			if (depth < out.mFaceDepth)
+			{
+				out.mFaceDepth = depth;
+				out.mFaceAxis = 3 + j;
+				out.mFaceNormal = dist >= 0.0f ? axesB[j] : axesB[j] * -1.0f;
+			}
+		}
+		// Edge pairs
+		out.mEdgeDepth = Math::Infinity;
+		out.mEdgeA = -1;
+		out.mEdgeB = -1;
+		for (int i = 0; i < 3; i++)
+		{
+			for (int j = 0; j < 3; j++)
+			{
+				Vector3 axis = Vector3::Cross(axesA[i], axesB[j]);
+				float len = axis.Length();
+				// Parallel edges, which the face axes already cover
+				if (len < 1e-3f)
+				{
+					continue;
+				}
+				axis *= 1.0f / len;
+				float ra = 0.0f;
+				float rb = 0.0f;
+				for (int k = 0; k < 3; k++)
+				{
+					ra += extA[k] * Math::Abs(Vector3::Dot(axesA[k], axis));
+					rb += extB[k] * Math::Abs(Vector3::Dot(axesB[k], axis));
+				}
+				float dist = Vector3::Dot(d, axis);
+				float depth = ra + rb - Math::Abs(dist);
+				if (depth < 0.0f)
+				{
+					return false;
+				}
+				if (depth < out.mEdgeDepth)
+				{
+					out.mEdgeDepth = depth;
+					out.mEdgeA = i;
+					out.mEdgeB = j;
+					out.mEdgeNormal = dist >= 0.0f ? axis : axis * -1.0f;
+				}
+			}
+		}
+		return true;
+	}
+
+	// Contact points where an edge of a crosses an edge of b
+	void EdgeContact(const OBB& a, const OBB& b, const SATResult& sat,
+		ContactManifold& outContact)
+	{
+		const float* extA = a.mExtents.GetAsFloatPtr();
+		const float* extB = b.mExtents.GetAsFloatPtr();
+		const Vector3& n = sat.mEdgeNormal;
+		// The edge of each box that reaches furthest toward the other
+		Vector3 centerA = a.mCenter;
+		Vector3 centerB = b.mCenter;
+		for (int k = 0; k < 3; k++)
+		{
+			if (k != sat.mEdgeA)
+			{
+				float sign = Vector3::Dot(sat.mAxesA[k], n) > 0.0f ? 1.0f : -1.0f;
+				centerA += sat.mAxesA[k] * (extA[k] * sign);
+			}
+			if (k != sat.mEdgeB)
+			{
+				float sign = Vector3::Dot(sat.mAxesB[k], n) > 0.0f ? 1.0f : -1.0f;
+				centerB -= sat.mAxesB[k] * (extB[k] * sign);
+			}
+		}
+		Vector3 halfA = sat.mAxesA[sat.mEdgeA] * extA[sat.mEdgeA];
+		Vector3 halfB = sat.mAxesB[sat.mEdgeB] * extB[sat.mEdgeB];
+		Vector3 pointA;
+		Vector3 pointB;
+		ClosestPoints(LineSegment(centerA - halfA, centerA + halfA),
+			LineSegment(centerB - halfB, centerB + halfB), pointA, pointB);
+		outContact.mNormal = n;
+		outContact.mDepth = sat.mEdgeDepth;
+		AddContact(outContact, (pointA + pointB) * 0.5f, sat.mEdgeDepth);
+	}
+
+	// Contact points where a face of one box (the reference face)
+	// pushes into the other (the incident box)
+	void FaceContact(const OBB& a, const OBB& b, const SATResult& sat,
+		ContactManifold& outContact)
+	{
+		bool refIsB = sat.mFaceAxis >= 3;
+		const OBB& ref = refIsB ? b : a;
+		const OBB& inc = refIsB ? a : b;
+		const Vector3* refAxes = refIsB ? sat.mAxesB : sat.mAxesA;
+		const Vector3* incAxes = refIsB ? sat.mAxesA : sat.mAxesB;
+		const float* refExt = ref.mExtents.GetAsFloatPtr();
+		const float* incExt = inc.mExtents.GetAsFloatPtr();
+		int refIndex = sat.mFaceAxis % 3;
+		// Out of the reference face, toward the incident box
+		Vector3 n = refIsB ? sat.mFaceNormal * -1.0f : sat.mFaceNormal;
+
+		// The incident face is the one facing most against n
+		int incIndex = 0;
+		float best = -1.0f;
+		for (int j = 0; j < 3; j++)
+		{
+			float dot = Math::Abs(Vector3::Dot(incAxes[j], n));
+			if (dot > best)
+			{
+				best = dot;
+				incIndex = j;
+			}
+		}
+		float sign = Vector3::Dot(incAxes[incIndex], n) > 0.0f ? -1.0f : 1.0f;
+		Vector3 incCenter = inc.mCenter + incAxes[incIndex] * (incExt[incIndex] * sign);
+		int u = (incIndex + 1) % 3;
+		int v = (incIndex + 2) % 3;
+		Vector3 halfU = incAxes[u] * incExt[u];
+		Vector3 halfV = incAxes[v] * incExt[v];
+		Vector3 poly[MaxClipVerts];
+		Vector3 clipped[MaxClipVerts];
+		poly[0] = incCenter + halfU + halfV;
+		poly[1] = incCenter - halfU + halfV;
+		poly[2] = incCenter - halfU - halfV;
+		poly[3] = incCenter + halfU - halfV;
+		int count = 4;
+
+		// Clip it to the sides of the reference face
+		for (int side = 1; side <= 2 && count > 0; side++)
+		{
+			int k = (refIndex + side) % 3;
+			Vector3 axis = refAxes[k];
+			float center = Vector3::Dot(axis, ref.mCenter);
+			count = ClipPolygon(poly, count, axis, center + refExt[k], clipped);
+			count = ClipPolygon(clipped, count, axis * -1.0f, refExt[k] - center, poly);
+		}
+
+		// Keep what's below the reference face (give or take rounding,
+		// so a box resting flat on another doesn't lose one side's points)
+		float faceDist = Vector3::Dot(n, ref.mCenter) + refExt[refIndex];
+		float tolerance = 1e-5f * (Math::Abs(faceDist) +
+			ref.mExtents.Length() + inc.mExtents.Length());
+		Vector3 points[MaxClipVerts];
+		float depths[MaxClipVerts];
+		int numPoints = 0;
+		for (int i = 0; i < count; i++)
+		{
+			float depth = faceDist - Vector3::Dot(n, poly[i]);
+			if (depth >= -tolerance)
+			{
+				points[numPoints] = poly[i];
+				depths[numPoints] = Math::Max(depth, 0.0f);
+				numPoints++;
+			}
+		}
+		outContact.mNormal = sat.mFaceNormal;
+		outContact.mDepth = sat.mFaceDepth;
+		if (numPoints == 0)
+		{
+			// Only from rounding, so fall back to a single point
+			AddContact(outContact, inc.ClosestPoint(ref.mCenter), sat.mFaceDepth);
+			return;
+		}
+		ReduceContacts(points, depths, numPoints, n, outContact);
+	}
+}
+
+bool Intersect(const Sphere& s, const OBB& box)
+{
+	float distSq = (box.ClosestPoint(s.mCenter) - s.mCenter).LengthSq();
+	return distSq <= (s.mRadius * s.mRadius);
+}
+
+bool Intersect(const OBB& a, const OBB& b)
+{
+	SATResult sat;
+	return SeparatingAxisTest(a, b, sat);
+}
+
+bool Intersect(const OBB& a, const OBB& b, ContactManifold& outContact)
+{
+	outContact.mNumPoints = 0;
+	SATResult sat;
+	if (!SeparatingAxisTest(a, b, sat))
+	{
+		return false;
+	}
+	// Favor faces, so boxes resting on each other don't flip
+	// between face and edge contacts from rounding
+	if (sat.mEdgeA >= 0 && sat.mEdgeDepth * 1.05f + 0.01f < sat.mFaceDepth)
+	{
+		EdgeContact(a, b, sat, outContact);
+	}
+	else
+	{
+		FaceContact(a, b, sat, outContact);
+	}
+	return true;
+}
+
+Vector3 ClosestPointToBox(const LineSegment& l, const OBB& box)
+{
+	// The distance to a box is convex along the segment,
+	// so a golden section search homes in on the closest point
+	auto distSq = [&l, &box](float t) {
+		Vector3 p = l.PointOnSegment(t);
+		return (box.ClosestPoint(p) - p).LengthSq();
+	};
+	const float ratio = 0.618034f;
+	float lo = 0.0f;
+	float hi = 1.0f;
+	float t1 = hi - ratio * (hi - lo);
+	float t2 = lo + ratio * (hi - lo);
+	float dist1 = distSq(t1);
+	float dist2 = distSq(t2);
+	for (int i = 0; i < 40; i++)
+	{
+		if (dist1 < dist2)
+		{
+			hi = t2;
+			t2 = t1;
+			dist2 = dist1;
+			t1 = hi - ratio * (hi - lo);
+			dist1 = distSq(t1);
+		}
+		else
+		{
+			lo = t1;
+			t1 = t2;
+			dist1 = dist2;
+			t2 = lo + ratio * (hi - lo);
+			dist2 = distSq(t2);
+		}
+	}
+	return l.PointOnSegment((lo + hi) * 0.5f);
+}
+
+bool Intersect(const Capsule& c, const OBB& box, ContactManifold& outContact)
+{
+	outContact.mNumPoints = 0;
+	const LineSegment& l = c.mSegment;
+	Vector3 point = ClosestPointToBox(l, box);
+	Vector3 closest = box.ClosestPoint(point);
+	float dist = (closest - point).Length();
+	if (dist > c.mRadius)
+	{
+		return false;
+	}
+
+	if (dist > 1e-4f)
+	{
+		outContact.mNormal = (closest - point) * (1.0f / dist);
+		outContact.mDepth = c.mRadius - dist;
+		AddContact(outContact, closest, outContact.mDepth);
+		// A capsule lying along the box touches at its ends too
+		const Vector3* ends[2] = { &l.mStart, &l.mEnd };
+		for (const Vector3* end : ends)
+		{
+			if ((*end - point).LengthSq() > c.mRadius * c.mRadius)
+			{
+				Vector3 endClosest = box.ClosestPoint(*end);
+				float endDist = (endClosest - *end).Length();
+				if (endDist <= c.mRadius)
+				{
+					AddContact(outContact, endClosest, c.mRadius - endDist);
+				}
+			}
+		}
+		return true;
+	}
+
+	// The segment goes into the box, so push it out through
+	// whichever face needs the smallest move
+	Quaternion inv = box.mRotation;
+	inv.Conjugate();
+	Vector3 start = Vector3::Transform(l.mStart - box.mCenter, inv);
+	Vector3 end = Vector3::Transform(l.mEnd - box.mCenter, inv);
+	const float* s = start.GetAsFloatPtr();
+	const float* e = end.GetAsFloatPtr();
+	const float* ext = box.mExtents.GetAsFloatPtr();
+	float bestDepth = Math::Infinity;
+	int bestAxis = 0;
+	float bestSign = 1.0f;
+	for (int i = 0; i < 3; i++)
+	{
+		// Out through the + face
+		float depth = ext[i] + c.mRadius - Math::Min(s[i], e[i]);
+		if (depth < bestDepth)
+		{
+			bestDepth = depth;
+			bestAxis = i;
+			bestSign = 1.0f;
+		}
+		// Out through the - face
+		depth = ext[i] + c.mRadius + Math::Max(s[i], e[i]);
+		if (depth < bestDepth)
+		{
+			bestDepth = depth;
+			bestAxis = i;
+			bestSign = -1.0f;
+		}
+	}
+	Vector3 axes[3];
+	box.GetAxes(axes);
+	// The capsule moves out along the face normal, so the
+	// normal from the capsule to the box is the opposite
+	outContact.mNormal = axes[bestAxis] * -bestSign;
+	outContact.mDepth = bestDepth;
+	bool startDeeper = (bestSign > 0.0f) == (s[bestAxis] <= e[bestAxis]);
+	AddContact(outContact, startDeeper ? l.mStart : l.mEnd, bestDepth);
+	return true;
+}
+
+bool Intersect(const Capsule& a, const Capsule& b, ContactManifold& outContact)
+{
+	outContact.mNumPoints = 0;
+	Vector3 pointA;
+	Vector3 pointB;
+	ClosestPoints(a.mSegment, b.mSegment, pointA, pointB);
+	float sumRadii = a.mRadius + b.mRadius;
+	Vector3 diff = pointB - pointA;
+	float dist = diff.Length();
+	if (dist > sumRadii)
+	{
+		return false;
+	}
+	Vector3 dirA = a.mSegment.mEnd - a.mSegment.mStart;
+	Vector3 dirB = b.mSegment.mEnd - b.mSegment.mStart;
+	if (dist > 1e-4f)
+	{
+		outContact.mNormal = diff * (1.0f / dist);
+	}
+	else
+	{
+		// The segments cross, so any direction off them will do
+		outContact.mNormal = Perpendicular(
+			dirA.LengthSq() > 0.0f ? dirA : (dirB.LengthSq() > 0.0f ? dirB : Vector3::UnitX));
+	}
+	outContact.mDepth = sumRadii - dist;
+
+	// Parallel capsules touch along a line, so use both of its ends
+	float lenA = dirA.Length();
+	float lenB = dirB.Length();
+	if (lenA > 0.0f && lenB > 0.0f &&
+		Math::Abs(Vector3::Dot(dirA, dirB)) > 0.999f * lenA * lenB)
+	{
+		// Each segment's ends paired with the closest point on the other
+		Vector3 pairs[4][2] = {
+			{ a.mSegment.mStart, ClosestPointOnSegment(b.mSegment, a.mSegment.mStart) },
+			{ a.mSegment.mEnd, ClosestPointOnSegment(b.mSegment, a.mSegment.mEnd) },
+			{ ClosestPointOnSegment(a.mSegment, b.mSegment.mStart), b.mSegment.mStart },
+			{ ClosestPointOnSegment(a.mSegment, b.mSegment.mEnd), b.mSegment.mEnd }
+		};
+		int first = -1;
+		int last = -1;
+		float minProj = Math::Infinity;
+		float maxProj = -Math::Infinity;
+		for (int i = 0; i < 4; i++)
+		{
+			if ((pairs[i][1] - pairs[i][0]).LengthSq() > sumRadii * sumRadii)
+			{
+				continue;
+			}
+			float proj = Vector3::Dot(pairs[i][0], dirA);
+			if (proj < minProj)
+			{
+				minProj = proj;
+				first = i;
+			}
+			if (proj > maxProj)
+			{
+				maxProj = proj;
+				last = i;
+			}
+		}
+		if (first >= 0 && (maxProj - minProj) > 1e-3f * lenA)
+		{
+			for (int i : { first, last })
+			{
+				Vector3 pairDiff = pairs[i][1] - pairs[i][0];
+				float pairDist = pairDiff.Length();
+				Vector3 normal = outContact.mNormal;
+				if (pairDist > 1e-4f)
+				{
+					normal = pairDiff * (1.0f / pairDist);
+				}
+				AddContact(outContact, OverlapMidpoint(pairs[i][0], a.mRadius,
+					normal, pairDist, b.mRadius), sumRadii - pairDist);
+			}
+			return true;
+		}
+	}
+	AddContact(outContact, OverlapMidpoint(pointA, a.mRadius,
+		outContact.mNormal, dist, b.mRadius), outContact.mDepth);
+	return true;
+}
+
+bool Intersect(const LineSegment& l, const OBB& b, float& outT,
+	Vector3& outNorm)
+{
+	// In the box's local space, this is a segment against an AABB
+	Quaternion inv = b.mRotation;
+	inv.Conjugate();
+	Vector3 start = Vector3::Transform(l.mStart - b.mCenter, inv);
+	Vector3 delta = Vector3::Transform(l.mEnd - l.mStart, inv);
+	const float* s = start.GetAsFloatPtr();
+	const float* d = delta.GetAsFloatPtr();
+	const float* ext = b.mExtents.GetAsFloatPtr();
+	float tEnter = -Math::Infinity;
+	float tExit = Math::Infinity;
+	int enterAxis = 0;
+	int exitAxis = 0;
+	float enterSign = 0.0f;
+	float exitSign = 0.0f;
+	for (int i = 0; i < 3; i++)
+	{
+		if (Math::NearZero(d[i]))
+		{
+			if (s[i] < -ext[i] || s[i] > ext[i])
+			{
+				return false;
+			}
+			continue;
+		}
+		// Going forward, the segment enters at the - face
+		float t1 = (-ext[i] - s[i]) / d[i];
+		float t2 = (ext[i] - s[i]) / d[i];
+		float sign = -1.0f;
+		if (t1 > t2)
+		{
+			std::swap(t1, t2);
+			sign = 1.0f;
+		}
+		if (t1 > tEnter)
+		{
+			tEnter = t1;
+			enterAxis = i;
+			enterSign = sign;
+		}
+		if (t2 < tExit)
+		{
+			tExit = t2;
+			exitAxis = i;
+			exitSign = -sign;
+		}
+	}
+	if (tEnter > tExit || tExit < 0.0f)
+	{
+		return false;
+	}
+	// Starting inside the box hits where it leaves
+	int axis = enterAxis;
+	float sign = enterSign;
+	outT = tEnter;
+	if (tEnter < 0.0f)
+	{
+		axis = exitAxis;
+		sign = exitSign;
+		outT = tExit;
+	}
+	if (outT > 1.0f)
+	{
+		return false;
+	}
+	Vector3 axes[3];
+	b.GetAxes(axes);
+	outNorm = axes[axis] * sign;
+	return true;
+}
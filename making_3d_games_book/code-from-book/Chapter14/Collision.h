@@ -62,8 +62,17 @@ struct AABB
 
 struct OBB
 {
+	// World-space directions of the box's local x, y and z axes
+	void GetAxes(Vector3 outAxes[3]) const;
+	// Smallest AABB around the box
+	AABB GetBounds() const;
+	bool Contains(const Vector3& point) const;
+	// Closest point in (or on) the box to this point
+	Vector3 ClosestPoint(const Vector3& point) const;
+
 	Vector3 mCenter;
 	Quaternion mRotation;
+	// Half size along each local axis
 	Vector3 mExtents;
 };
 
@@ -78,6 +87,43 @@ struct Capsule
 	float mRadius;
 };
 
+// The 6 planes around a view frustum. Each normal points in,
+// so a point is inside if Dot(point, mNormals[i]) - mD[i] >= 0
+// for every plane (the same signed distance as Plane uses).
+struct Frustum
+{
+	// Get the planes from a view-projection matrix (with clip
+	// space depth from 0 to w, like CreatePerspectiveFOV)
+	explicit Frustum(const Matrix4& viewProj);
+
+	enum
+	{
+		ELeft,
+		ERight,
+		EBottom,
+		ETop,
+		ENear,
+		EFar,
+		NumPlanes
+	};
+	Vector3 mNormals[NumPlanes];
+	float mD[NumPlanes];
+};
+
+// Where two shapes touch: up to MaxPoints contact points,
+// each with how far the shapes overlap there. mNormal points
+// from the first shape to the second, and moving the second
+// by mNormal * mDepth separates them.
+struct ContactManifold
+{
+	static const int MaxPoints = 4;
+	Vector3 mPoints[MaxPoints];
+	float mDepths[MaxPoints];
+	int mNumPoints;
+	Vector3 mNormal;
+	float mDepth;
+};
+
 struct ConvexPolygon
 {
 	bool Contains(const Vector2& point) const;
@@ -90,11 +136,46 @@ bool Intersect(const Sphere& a, const Sphere& b);
 bool Intersect(const AABB& a, const AABB& b);
 bool Intersect(const Capsule& a, const Capsule& b);
 bool Intersect(const Sphere& s, const AABB& box);
+bool Intersect(const Sphere& s, const OBB& box);
+// Separating axis test (the 3 face axes of each box
+// and the 9 cross products of their edges)
+bool Intersect(const OBB& a, const OBB& b);
+// Plane by plane, so these can say a shape just outside
+// a corner of the frustum is inside (but never the reverse)
+bool Intersect(const Frustum& f, const Sphere& s);
+bool Intersect(const Frustum& f, const AABB& box);
+
+// These also fill in a contact manifold
+bool Intersect(const OBB& a, const OBB& b, ContactManifold& outContact);
+bool Intersect(const Capsule& c, const OBB& box, ContactManifold& outContact);
+bool Intersect(const Capsule& a, const Capsule& b, ContactManifold& outContact);
 
 bool Intersect(const LineSegment& l, const Sphere& s, float& outT);
 bool Intersect(const LineSegment& l, const Plane& p, float& outT);
 bool Intersect(const LineSegment& l, const AABB& b, float& outT,
 	Vector3& outNorm);
+// Like the AABB version, a segment that starts inside
+// the box hits it where it leaves
+bool Intersect(const LineSegment& l, const OBB& b, float& outT,
+	Vector3& outNorm);
+
+// Point on the segment closest to the box
+Vector3 ClosestPointToBox(const LineSegment& l, const OBB& box);
 
 bool SweptSphere(const Sphere& P0, const Sphere& P1,
 	const Sphere& Q0, const Sphere& Q1, float& t);
+// Box a moves by aDelta while box b moves by bDelta. Finds the
+// first t in [0, 1] where they touch (0 if they already overlap)
+// and the normal of the face of b that a hits.
+bool SweptAABB(const AABB& a, const Vector3& aDelta,
+	const AABB& b, const Vector3& bDelta, float& outT, Vector3& outNorm);
+// Same for a sphere and a box, using conservative advancement (step
+// forward by the distance between them over their closing speed,
+// which can never step past the contact). Only counts contacts
+// where the sphere is moving into the box. outNorm points from the
+// box to the sphere.
+bool SweptSphere(const Sphere& s, const Vector3& sDelta,
+	const AABB& box, const Vector3& boxDelta, float& outT, Vector3& outNorm);
+// The same for a capsule moving into a box that stays put
+bool SweptCapsule(const Capsule& c, const Vector3& cDelta,
+	const OBB& box, float& outT, Vector3& outNorm);
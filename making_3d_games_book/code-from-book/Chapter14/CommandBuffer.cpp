@@ -0,0 +1,46 @@
+// ----------------------------------------------------------------
+// From Game Programming in C++ by Sanjay Madhav
+// Copyright (C) 2017 Sanjay Madhav. All rights reserved.
+// 
+// Released under the BSD License
+// See LICENSE in root directory for full details.
+// ----------------------------------------------------------------
+
+#include "CommandBuffer.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+
+void CommandBuffer::Initialize(unsigned numThreads)
+{
+	mCommands.resize(numThreads);
+}
+
+void CommandBuffer::Push(Command command)
+{
+	mCommands[JobSystem::GetThreadIndex()].emplace_back(std::move(command));
+}
+
+void CommandBuffer::Execute()
+{
+	PROFILE_SCOPE("CommandBuffer::Execute");
+	// Run in thread order (and the order each thread pushed them).
+	// A command can push more commands, so loop until they're all gone.
+	bool ranAny = true;
+	while (ranAny)
+	{
+		ranAny = false;
+		for (auto& commands : mCommands)
+		{
+			if (!commands.empty())
+			{
+				mRunning.swap(commands);
+				for (auto& command : mRunning)
+				{
+					command();
+				}
+				mRunning.clear();
+				ranAny = true;
+			}
+		}
+	}
+}
@@ -0,0 +1,33 @@
+// ----------------------------------------------------------------
+// From Game Programming in C++ by Sanjay Madhav
+// Copyright (C) 2017 Sanjay Madhav. All rights reserved.
+// 
+// Released under the BSD License
+// See LICENSE in root directory for full details.
+// ----------------------------------------------------------------
+
+#pragma once
+#include <functional>
+#include <vector>
+
+// Changes to the game's structure (creating actors, changing an
+// actor's state, adding/removing boxes) that were made on a job
+// thread. These wait until the game runs them at a sync point.
+class CommandBuffer
+{
+public:
+	using Command = std::function<void()>;
+
+	// One list of commands for each job thread
+	void Initialize(unsigned numThreads);
+
+	// Queue a command (from any job thread)
+	void Push(Command command);
+	// Run every queued command, on the main thread
+	void Execute();
+private:
+	// Each thread only pushes to its own list, so this needs no lock
+	std::vector<std::vector<Command>> mCommands;
+	// Swapped with each list while its commands run
+	std::vector<Command> mRunning;
+};
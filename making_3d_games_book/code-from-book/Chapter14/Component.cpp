@@ -8,6 +8,9 @@
 
 #include "Component.h"
 #include "Actor.h"
+#include "Game.h"
+#include "ComponentSystem.h"
+#include "PoolAllocator.h"
 #include "LevelLoader.h"
 
 const char* Component::TypeNames[NUM_COMPONENT_TYPES] = {
@@ -23,20 +26,44 @@ const char* Component::TypeNames[NUM_COMPONENT_TYPES] = {
 	"SpriteComponent",
 	"MirrorCamera",
 	"PointLightComponent",
-	"TargetComponent"
+	"TargetComponent",
+	"RigidBodyComponent",
+	"CharacterController"
 };
 
+PoolAllocator& Component::GetPool()
+{
+	// Made on first use, so it's always there before any component
+	static PoolAllocator pool("Component");
+	return pool;
+}
+
+void* Component::operator new(size_t size)
+{
+	return GetPool().Allocate(size);
+}
+
+void Component::operator delete(void* ptr, size_t size)
+{
+	GetPool().Free(ptr, size);
+}
+
 Component::Component(Actor* owner, int updateOrder)
 	:mOwner(owner)
 	,mUpdateOrder(updateOrder)
+	,mPool(NoPool)
+	,mPoolIndex(0)
 {
 	// Add to actor's vector of components
 	mOwner->AddComponent(this);
+	// And to the game's pools
+	mOwner->GetGame()->GetComponentSystem()->AddComponent(this);
 }
 
 Component::~Component()
 {
 	mOwner->RemoveComponent(this);
+	mOwner->GetGame()->GetComponentSystem()->RemoveComponent(this);
 }
 
 void Component::Update(float deltaTime)
@@ -28,6 +28,8 @@ public:
 		TMirrorCamera,
 		TPointLightComponent,
 		TTargetComponent,
+		TRigidBodyComponent,
+		TCharacterController,
 
 		NUM_COMPONENT_TYPES
 	};
@@ -39,6 +41,11 @@ public:
 	Component(class Actor* owner, int updateOrder = 100);
 	// Destructor
 	virtual ~Component();
+
+	// Components (of any subclass) come from a pool, not the general heap
+	static void* operator new(size_t size);
+	static void operator delete(void* ptr, size_t size);
+	static class PoolAllocator& GetPool();
 	// Update this component by delta time
 	virtual void Update(float deltaTime);
 	// Process input for this component
@@ -71,4 +78,10 @@ protected:
 	class Actor* mOwner;
 	// Update order of component
 	int mUpdateOrder;
+private:
+	// Where this is in the game's ComponentSystem
+	friend class ComponentSystem;
+	static const int NoPool = -1;
+	int mPool;
+	size_t mPoolIndex;
 };
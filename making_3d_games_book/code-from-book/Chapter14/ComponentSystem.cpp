@@ -0,0 +1,205 @@
+// ----------------------------------------------------------------
+// From Game Programming in C++ by Sanjay Madhav
+// Copyright (C) 2017 Sanjay Madhav. All rights reserved.
+// 
+// Released under the BSD License
+// See LICENSE in root directory for full details.
+// ----------------------------------------------------------------
+
+#include "ComponentSystem.h"
+#include "Actor.h"
+#include "AudioComponent.h"
+#include "BallMove.h"
+#include "CharacterController.h"
+#include "FollowCamera.h"
+#include "MirrorCamera.h"
+#include "MoveComponent.h"
+#include "SkeletalMeshComponent.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+#include <algorithm>
+
+namespace
+{
+	// Update every component in the array as a T. Calling T::Update
+	// directly (rather than through the vtable) lets it inline.
+	template <typename T>
+	void UpdateBatch(Component** comps, size_t count, float deltaTime)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			Component* comp = comps[i];
+			// Skip removed components and ones on actors that
+			// wouldn't update (paused, dead or still pending)
+			if (comp != nullptr)
+			{
+				Actor* owner = comp->GetOwner();
+				if (owner->GetState() == Actor::EActive && !owner->IsPending())
+				{
+					static_cast<T*>(comp)->T::Update(deltaTime);
+				}
+			}
+		}
+	}
+}
+
+// Indexed by Component::TypeID. Types that don't override Update
+// are null, since there's nothing to do for them. (If one of them
+// gets an Update, it needs an entry here.)
+const ComponentSystem::BatchUpdateFunc ComponentSystem::sUpdateFuncs[] = {
+	nullptr, // Component
+	&UpdateBatch<AudioComponent>,
+	&UpdateBatch<BallMove>,
+	nullptr, // BoxComponent
+	nullptr, // CameraComponent
+	&UpdateBatch<FollowCamera>,
+	nullptr, // MeshComponent
+	&UpdateBatch<MoveComponent>,
+	&UpdateBatch<SkeletalMeshComponent>,
+	nullptr, // SpriteComponent
+	&UpdateBatch<MirrorCamera>,
+	nullptr, // PointLightComponent
+	nullptr, // TargetComponent
+	nullptr, // RigidBodyComponent
+	&UpdateBatch<CharacterController>
+};
+
+ComponentSystem::ComponentSystem()
+	:mUpdating(false)
+{
+	// Every TypeID needs an entry (even if it's null)
+	static_assert(sizeof(sUpdateFuncs) / sizeof(sUpdateFuncs[0]) == Component::NUM_COMPONENT_TYPES,
+		"sUpdateFuncs needs an entry for each Component::TypeID");
+}
+
+void ComponentSystem::AddComponent(Component* comp)
+{
+	comp->mPool = Component::NoPool;
+	comp->mPoolIndex = mPending.size();
+	mPending.emplace_back(comp);
+}
+
+void ComponentSystem::RemoveComponent(Component* comp)
+{
+	if (comp->mPool == Component::NoPool)
+	{
+		// Swap to end of vector and pop off
+		size_t index = comp->mPoolIndex;
+		Component* last = mPending.back();
+		mPending[index] = last;
+		last->mPoolIndex = index;
+		mPending.pop_back();
+	}
+	else
+	{
+		Pool& pool = mPools[comp->mPool];
+		if (mUpdating)
+		{
+			// Don't move anything mid-update, just leave a hole
+			pool.mComponents[comp->mPoolIndex] = nullptr;
+			pool.mNumHoles++;
+		}
+		else
+		{
+			size_t index = comp->mPoolIndex;
+			Component* last = pool.mComponents.back();
+			pool.mComponents[index] = last;
+			last->mPoolIndex = index;
+			pool.mComponents.pop_back();
+		}
+	}
+}
+
+void ComponentSystem::Update(float deltaTime, JobSystem* jobs)
+{
+	PROFILE_SCOPE("ComponentSystem::Update");
+	FlushPending();
+
+	mUpdating = true;
+	for (size_t p : mPoolOrder)
+	{
+		Pool& pool = mPools[p];
+		BatchUpdateFunc func = sUpdateFuncs[pool.mType];
+		if (func && !pool.mComponents.empty())
+		{
+			PROFILE_SCOPE(Component::TypeNames[pool.mType]);
+			// (Captures just the pool and delta time, so
+			// the std::function doesn't need to allocate)
+			jobs->ParallelFor(pool.mComponents.size(), GrainSize,
+				[&pool, deltaTime](size_t begin, size_t end) {
+				sUpdateFuncs[pool.mType](pool.mComponents.data() + begin, end - begin, deltaTime);
+			});
+		}
+	}
+	mUpdating = false;
+
+	// Clean up after anything removed during the update
+	for (Pool& pool : mPools)
+	{
+		if (pool.mNumHoles > 0)
+		{
+			Compact(pool);
+		}
+	}
+}
+
+void ComponentSystem::FlushPending()
+{
+	for (Component* comp : mPending)
+	{
+		size_t p = GetPool(comp->GetType(), comp->GetUpdateOrder());
+		Pool& pool = mPools[p];
+		comp->mPool = static_cast<int>(p);
+		comp->mPoolIndex = pool.mComponents.size();
+		pool.mComponents.emplace_back(comp);
+	}
+	mPending.clear();
+}
+
+size_t ComponentSystem::GetPool(Component::TypeID type, int updateOrder)
+{
+	for (size_t i = 0; i < mPools.size(); i++)
+	{
+		if (mPools[i].mType == type && mPools[i].mUpdateOrder == updateOrder)
+		{
+			return i;
+		}
+	}
+
+	// Need a new pool
+	Pool pool;
+	pool.mUpdateOrder = updateOrder;
+	pool.mType = type;
+	pool.mNumHoles = 0;
+	mPools.emplace_back(pool);
+
+	// Keep the update order sorted
+	size_t index = mPools.size() - 1;
+	auto iter = std::upper_bound(mPoolOrder.begin(), mPoolOrder.end(), index,
+		[this](size_t a, size_t b) {
+			if (mPools[a].mUpdateOrder != mPools[b].mUpdateOrder)
+			{
+				return mPools[a].mUpdateOrder < mPools[b].mUpdateOrder;
+			}
+			return mPools[a].mType < mPools[b].mType;
+	});
+	mPoolOrder.insert(iter, index);
+	return index;
+}
+
+void ComponentSystem::Compact(Pool& pool)
+{
+	size_t count = 0;
+	for (size_t i = 0; i < pool.mComponents.size(); i++)
+	{
+		Component* comp = pool.mComponents[i];
+		if (comp != nullptr)
+		{
+			comp->mPoolIndex = count;
+			pool.mComponents[count] = comp;
+			count++;
+		}
+	}
+	pool.mComponents.resize(count);
+	pool.mNumHoles = 0;
+}
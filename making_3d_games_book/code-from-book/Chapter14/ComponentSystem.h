@@ -0,0 +1,61 @@
+// ----------------------------------------------------------------
+// From Game Programming in C++ by Sanjay Madhav
+// Copyright (C) 2017 Sanjay Madhav. All rights reserved.
+// 
+// Released under the BSD License
+// See LICENSE in root directory for full details.
+// ----------------------------------------------------------------
+
+#pragma once
+#include <vector>
+#include "Component.h"
+
+// Keeps every component in a pool for its type (and update order),
+// so the game can update all components of one type in a single
+// loop instead of walking each actor's components in turn.
+class ComponentSystem
+{
+public:
+	ComponentSystem();
+
+	// Components call these when they're created/destroyed
+	void AddComponent(class Component* comp);
+	void RemoveComponent(class Component* comp);
+
+	// Update every component of an active actor, one pool at a
+	// time (pools with a lower update order go first). Each pool
+	// is split across the job threads.
+	void Update(float deltaTime, class JobSystem* jobs);
+
+	size_t GetNumPools() const { return mPools.size(); }
+private:
+	// Update count components of one type
+	using BatchUpdateFunc = void(*)(class Component** comps, size_t count, float deltaTime);
+	static const BatchUpdateFunc sUpdateFuncs[];
+
+	struct Pool
+	{
+		int mUpdateOrder;
+		Component::TypeID mType;
+		std::vector<class Component*> mComponents;
+		// Number of removed (null) entries left to compact
+		size_t mNumHoles;
+	};
+	// Sort new components into their pools
+	void FlushPending();
+	// Find (or make) the pool for this type and update order
+	size_t GetPool(Component::TypeID type, int updateOrder);
+	// Remove the null entries from a pool
+	void Compact(Pool& pool);
+
+	std::vector<Pool> mPools;
+	// Indices into mPools, sorted by update order (then type)
+	std::vector<size_t> mPoolOrder;
+	// Components created since the last update. Their type isn't
+	// known yet in the Component constructor, so they wait here.
+	std::vector<class Component*> mPending;
+	// Whether pools are being updated right now
+	bool mUpdating;
+	// Components per job when updating in parallel
+	static const size_t GrainSize = 128;
+};
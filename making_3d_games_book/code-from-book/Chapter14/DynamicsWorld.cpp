@@ -0,0 +1,549 @@
+// ----------------------------------------------------------------
+// From Game Programming in C++ by Sanjay Madhav
+// Copyright (C) 2017 Sanjay Madhav. All rights reserved.
+// 
+// Released under the BSD License
+// See LICENSE in root directory for full details.
+// ----------------------------------------------------------------
+
+#include "DynamicsWorld.h"
+#include <algorithm>
+#include <functional>
+#include "Actor.h"
+#include "BoxComponent.h"
+#include "RigidBodyComponent.h"
+#include "PhysWorld.h"
+#include "Game.h"
+#include "JobSystem.h"
+#include "CommandBuffer.h"
+#include "TransformStore.h"
+#include "Profiler.h"
+
+namespace
+{
+	// (Distances are in world units, where the player is
+	// about 100 tall)
+	// Fraction of the penetration to fix each second per substep
+	const float Baumgarte = 0.2f;
+	// Penetration that's left alone, so resting contacts
+	// stay touching from one substep to the next
+	const float LinearSlop = 0.5f;
+	// Slower impacts than this don't bounce
+	const float RestitutionThreshold = 100.0f;
+	// Bodies slower than these for TimeToSleep can sleep
+	const float LinearSleepTolerance = 2.0f;
+	const float AngularSleepTolerance = 0.035f;
+	const float TimeToSleep = 0.5f;
+	// A contact point this close to last substep's
+	// starts with its impulses
+	const float WarmStartDistSq = 4.0f;
+	// Boxes without a body
+	const float DefaultFriction = 0.6f;
+
+	// Some unit vector perpendicular to v
+	Vector3 Perpendicular(const Vector3& v)
+	{
+		Vector3 other = Math::Abs(v.x) < 0.57f ? Vector3::UnitX : Vector3::UnitY;
+		Vector3 result = Vector3::Cross(v, other);
+		result.Normalize();
+		return result;
+	}
+}
+
+const size_t DynamicsWorld::IslandGrainSize;
+const uint32_t DynamicsWorld::NoIsland;
+
+DynamicsWorld::DynamicsWorld(Game* game)
+	:mGame(game)
+	,mPhysWorld(game->GetPhysWorld())
+	,mGravity(0.0f, 0.0f, -980.0f)
+	,mFixedBody(0)
+	,mNumIslands(0)
+{
+}
+
+bool DynamicsWorld::CachedContact::operator<(const CachedContact& other) const
+{
+	std::less<const BoxComponent*> less;
+	if (mBoxA != other.mBoxA)
+	{
+		return less(mBoxA, other.mBoxA);
+	}
+	return less(mBoxB, other.mBoxB);
+}
+
+void DynamicsWorld::Step(float deltaTime)
+{
+	PROFILE_SCOPE("DynamicsWorld::Step");
+	if (mBodies.empty())
+	{
+		return;
+	}
+	float subStep = deltaTime / SubSteps;
+	for (int i = 0; i < SubSteps; i++)
+	{
+		SubStep(subStep);
+	}
+}
+
+void DynamicsWorld::SubStep(float deltaTime)
+{
+	PrepareBodies();
+	FindContacts();
+	BuildIslands();
+	{
+		PROFILE_SCOPE("DynamicsWorld::SolveIslands");
+		mGame->GetJobSystem()->ParallelFor(mNumIslands, IslandGrainSize,
+			[this, deltaTime](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++)
+			{
+				SolveIsland(i, deltaTime);
+			}
+		});
+	}
+	FinishSubStep();
+}
+
+void DynamicsWorld::PrepareBodies()
+{
+	size_t numBodies = mBodies.size();
+	for (RigidBodyComponent* body : mBodies)
+	{
+		if (body->mBox == nullptr)
+		{
+			BoxComponent* box = static_cast<BoxComponent*>(
+				body->GetOwner()->GetComponentOfType(Component::TBoxComponent));
+			if (box)
+			{
+				body->mBox = box;
+				box->mBody = body;
+				box->SetOriented(true);
+			}
+		}
+	}
+
+	// The solver bodies are filled in by their island, except
+	// for the one at the end, which stands in for boxes that
+	// don't move
+	mSolverBodies.resize(numBodies + 1);
+	mFixedBody = static_cast<uint32_t>(numBodies);
+	SolverBody& fixed = mSolverBodies[mFixedBody];
+	fixed.mLinearVelocity = Vector3::Zero;
+	fixed.mAngularVelocity = Vector3::Zero;
+	fixed.mInvMass = 0.0f;
+	for (int i = 0; i < 3; i++)
+	{
+		fixed.mInvInertia[i] = Vector3::Zero;
+	}
+}
+
+void DynamicsWorld::FindContacts()
+{
+	PROFILE_SCOPE("DynamicsWorld::FindContacts");
+	mContacts.clear();
+	mPhysWorld->ForEachPair([this](BoxComponent* a, BoxComponent* b) {
+		AddContact(a, b);
+	});
+}
+
+void DynamicsWorld::AddContact(BoxComponent* a, BoxComponent* b)
+{
+	// Order every pair the same way, so it can be found in the cache
+	if (std::less<BoxComponent*>()(b, a))
+	{
+		std::swap(a, b);
+	}
+	RigidBodyComponent* bodyA = a->GetRigidBody();
+	RigidBodyComponent* bodyB = b->GetRigidBody();
+	bool dynamicA = bodyA && bodyA->GetInvMass() > 0.0f;
+	bool dynamicB = bodyB && bodyB->GetInvMass() > 0.0f;
+	// Nothing to do unless one of them is awake
+	if (!(dynamicA && bodyA->IsAwake()) && !(dynamicB && bodyB->IsAwake()))
+	{
+		return;
+	}
+	ContactManifold manifold;
+	if (!mPhysWorld->GetContact(a, b, manifold))
+	{
+		return;
+	}
+
+	mContacts.emplace_back();
+	Contact& c = mContacts.back();
+	c.mBoxA = a;
+	c.mBoxB = b;
+	c.mBodyA = dynamicA ? static_cast<uint32_t>(bodyA->mBodyIndex) : mFixedBody;
+	c.mBodyB = dynamicB ? static_cast<uint32_t>(bodyB->mBodyIndex) : mFixedBody;
+	c.mNormal = manifold.mNormal;
+	c.mTangents[0] = Perpendicular(c.mNormal);
+	c.mTangents[1] = Vector3::Cross(c.mNormal, c.mTangents[0]);
+	float frictionA = bodyA ? bodyA->GetFriction() : DefaultFriction;
+	float frictionB = bodyB ? bodyB->GetFriction() : DefaultFriction;
+	c.mFriction = Math::Sqrt(frictionA * frictionB);
+	c.mRestitution = Math::Max(bodyA ? bodyA->GetRestitution() : 0.0f,
+		bodyB ? bodyB->GetRestitution() : 0.0f);
+	c.mNumPoints = manifold.mNumPoints;
+	const Vector3& centerA = a->GetWorldOBB().mCenter;
+	const Vector3& centerB = b->GetWorldOBB().mCenter;
+	for (int i = 0; i < c.mNumPoints; i++)
+	{
+		ContactPoint& p = c.mPoints[i];
+		p.mRelA = manifold.mPoints[i] - centerA;
+		p.mRelB = manifold.mPoints[i] - centerB;
+		p.mDepth = manifold.mDepths[i];
+		p.mNormalImpulse = 0.0f;
+		p.mTangentImpulse[0] = 0.0f;
+		p.mTangentImpulse[1] = 0.0f;
+	}
+
+	// Start from the impulses of the matching points last substep
+	CachedContact key;
+	key.mBoxA = a;
+	key.mBoxB = b;
+	auto iter = std::lower_bound(mCache.begin(), mCache.end(), key);
+	if (iter != mCache.end() && iter->mBoxA == a && iter->mBoxB == b)
+	{
+		for (int i = 0; i < c.mNumPoints; i++)
+		{
+			ContactPoint& p = c.mPoints[i];
+			for (int j = 0; j < iter->mNumPoints; j++)
+			{
+				if ((p.mRelA - iter->mRelA[j]).LengthSq() < WarmStartDistSq)
+				{
+					p.mNormalImpulse = iter->mNormalImpulse[j];
+					p.mTangentImpulse[0] = iter->mTangentImpulse[j][0];
+					p.mTangentImpulse[1] = iter->mTangentImpulse[j][1];
+					break;
+				}
+			}
+		}
+	}
+}
+
+uint32_t DynamicsWorld::FindRoot(uint32_t body)
+{
+	while (mParents[body] != body)
+	{
+		// Path halving
+		mParents[body] = mParents[mParents[body]];
+		body = mParents[body];
+	}
+	return body;
+}
+
+void DynamicsWorld::BuildIslands()
+{
+	PROFILE_SCOPE("DynamicsWorld::BuildIslands");
+	uint32_t numBodies = static_cast<uint32_t>(mBodies.size());
+	mParents.resize(numBodies);
+	for (uint32_t i = 0; i < numBodies; i++)
+	{
+		mParents[i] = i;
+	}
+	// Bodies that touch are in the same island (boxes that
+	// don't move don't join islands together)
+	for (const Contact& c : mContacts)
+	{
+		if (c.mBodyA != mFixedBody && c.mBodyB != mFixedBody)
+		{
+			uint32_t rootA = FindRoot(c.mBodyA);
+			uint32_t rootB = FindRoot(c.mBodyB);
+			if (rootA != rootB)
+			{
+				mParents[rootA] = rootB;
+			}
+		}
+	}
+
+	// Only islands with an awake body in them are solved
+	mIslandOf.assign(numBodies, NoIsland);
+	mNumIslands = 0;
+	for (uint32_t i = 0; i < numBodies; i++)
+	{
+		RigidBodyComponent* body = mBodies[i];
+		if (body->IsAwake() && body->GetInvMass() > 0.0f)
+		{
+			uint32_t root = FindRoot(i);
+			if (mIslandOf[root] == NoIsland)
+			{
+				mIslandOf[root] = static_cast<uint32_t>(mNumIslands++);
+			}
+		}
+	}
+	// Give every body its root's island, waking any that
+	// are touching an awake body
+	mIslandBodyStart.assign(mNumIslands + 1, 0);
+	for (uint32_t i = 0; i < numBodies; i++)
+	{
+		RigidBodyComponent* body = mBodies[i];
+		if (body->GetInvMass() > 0.0f)
+		{
+			mIslandOf[i] = mIslandOf[FindRoot(i)];
+			if (mIslandOf[i] != NoIsland)
+			{
+				if (!body->IsAwake())
+				{
+					body->Wake();
+				}
+				mIslandBodyStart[mIslandOf[i]]++;
+			}
+		}
+	}
+	mIslandContactStart.assign(mNumIslands + 1, 0);
+	for (const Contact& c : mContacts)
+	{
+		uint32_t body = c.mBodyA != mFixedBody ? c.mBodyA : c.mBodyB;
+		mIslandContactStart[mIslandOf[body]]++;
+	}
+
+	// Sort the bodies and contacts by island (each count becomes
+	// its island's end, and then counts down to its start)
+	for (size_t i = 1; i <= mNumIslands; i++)
+	{
+		mIslandBodyStart[i] += mIslandBodyStart[i - 1];
+		mIslandContactStart[i] += mIslandContactStart[i - 1];
+	}
+	mIslandBodies.resize(mIslandBodyStart[mNumIslands]);
+	mIslandContacts.resize(mIslandContactStart[mNumIslands]);
+	for (uint32_t i = numBodies; i-- > 0; )
+	{
+		if (mBodies[i]->GetInvMass() > 0.0f && mIslandOf[i] != NoIsland)
+		{
+			mIslandBodies[--mIslandBodyStart[mIslandOf[i]]] = i;
+		}
+	}
+	for (uint32_t i = static_cast<uint32_t>(mContacts.size()); i-- > 0; )
+	{
+		const Contact& c = mContacts[i];
+		uint32_t body = c.mBodyA != mFixedBody ? c.mBodyA : c.mBodyB;
+		mIslandContacts[--mIslandContactStart[mIslandOf[body]]] = i;
+	}
+}
+
+Vector3 DynamicsWorld::GetRelativeVelocity(const Contact& c, const ContactPoint& p) const
+{
+	const SolverBody& a = mSolverBodies[c.mBodyA];
+	const SolverBody& b = mSolverBodies[c.mBodyB];
+	return b.mLinearVelocity + Vector3::Cross(b.mAngularVelocity, p.mRelB) -
+		a.mLinearVelocity - Vector3::Cross(a.mAngularVelocity, p.mRelA);
+}
+
+void DynamicsWorld::ApplyImpulse(const Contact& c, const ContactPoint& p,
+	const Vector3& impulse)
+{
+	// (The fixed body is shared by every island, so it's never written)
+	if (c.mBodyA != mFixedBody)
+	{
+		SolverBody& a = mSolverBodies[c.mBodyA];
+		a.mLinearVelocity -= impulse * a.mInvMass;
+		a.mAngularVelocity -= a.ApplyInvInertia(Vector3::Cross(p.mRelA, impulse));
+	}
+	if (c.mBodyB != mFixedBody)
+	{
+		SolverBody& b = mSolverBodies[c.mBodyB];
+		b.mLinearVelocity += impulse * b.mInvMass;
+		b.mAngularVelocity += b.ApplyInvInertia(Vector3::Cross(p.mRelB, impulse));
+	}
+}
+
+void DynamicsWorld::SolveIsland(size_t island, float deltaTime)
+{
+	const uint32_t* bodies = mIslandBodies.data() + mIslandBodyStart[island];
+	size_t numBodies = mIslandBodyStart[island + 1] - mIslandBodyStart[island];
+	const uint32_t* contacts = mIslandContacts.data() + mIslandContactStart[island];
+	size_t numContacts = mIslandContactStart[island + 1] - mIslandContactStart[island];
+
+	// Load the bodies, and apply gravity
+	for (size_t i = 0; i < numBodies; i++)
+	{
+		RigidBodyComponent* body = mBodies[bodies[i]];
+		SolverBody& sb = mSolverBodies[bodies[i]];
+		const OBB& obb = body->mBox->GetWorldOBB();
+		sb.mPosition = obb.mCenter;
+		sb.mRotation = obb.mRotation;
+		sb.mInvMass = body->GetInvMass();
+		// Rotate the local inverse inertia into world space
+		Vector3 axes[3];
+		obb.GetAxes(axes);
+		Vector3 local = body->GetLocalInvInertia();
+		const float* d = local.GetAsFloatPtr();
+		for (int row = 0; row < 3; row++)
+		{
+			sb.mInvInertia[row] = Vector3::Zero;
+			for (int k = 0; k < 3; k++)
+			{
+				sb.mInvInertia[row] += axes[k] * (d[k] * axes[k].GetAsFloatPtr()[row]);
+			}
+		}
+		sb.mLinearVelocity = body->mLinearVelocity + mGravity * deltaTime;
+		sb.mAngularVelocity = body->mAngularVelocity;
+	}
+
+	// Effective masses and target velocities, then warm start
+	for (size_t i = 0; i < numContacts; i++)
+	{
+		Contact& c = mContacts[contacts[i]];
+		const SolverBody& a = mSolverBodies[c.mBodyA];
+		const SolverBody& b = mSolverBodies[c.mBodyB];
+		for (int j = 0; j < c.mNumPoints; j++)
+		{
+			ContactPoint& p = c.mPoints[j];
+			auto effectiveMass = [&a, &b, &p](const Vector3& dir) {
+				Vector3 rA = Vector3::Cross(p.mRelA, dir);
+				Vector3 rB = Vector3::Cross(p.mRelB, dir);
+				float k = a.mInvMass + b.mInvMass +
+					Vector3::Dot(rA, a.ApplyInvInertia(rA)) +
+					Vector3::Dot(rB, b.ApplyInvInertia(rB));
+				return k > 0.0f ? 1.0f / k : 0.0f;
+			};
+			p.mNormalMass = effectiveMass(c.mNormal);
+			p.mTangentMass[0] = effectiveMass(c.mTangents[0]);
+			p.mTangentMass[1] = effectiveMass(c.mTangents[1]);
+
+			// Push out penetration past the slop, and bounce
+			// off anything hit fast enough
+			p.mBias = Baumgarte / deltaTime * Math::Max(p.mDepth - LinearSlop, 0.0f);
+			float normalVel = Vector3::Dot(GetRelativeVelocity(c, p), c.mNormal);
+			if (normalVel < -RestitutionThreshold)
+			{
+				p.mBias = Math::Max(p.mBias, -c.mRestitution * normalVel);
+			}
+
+			ApplyImpulse(c, p, c.mNormal * p.mNormalImpulse +
+				c.mTangents[0] * p.mTangentImpulse[0] +
+				c.mTangents[1] * p.mTangentImpulse[1]);
+		}
+	}
+
+	for (int iter = 0; iter < VelocityIterations; iter++)
+	{
+		for (size_t i = 0; i < numContacts; i++)
+		{
+			Contact& c = mContacts[contacts[i]];
+			for (int j = 0; j < c.mNumPoints; j++)
+			{
+				ContactPoint& p = c.mPoints[j];
+				// Friction first, limited by the normal impulse
+				float maxFriction = c.mFriction * p.mNormalImpulse;
+				for (int t = 0; t < 2; t++)
+				{
+					float vel = Vector3::Dot(GetRelativeVelocity(c, p), c.mTangents[t]);
+					float old = p.mTangentImpulse[t];
+					p.mTangentImpulse[t] = Math::Clamp(old - p.mTangentMass[t] * vel,
+						-maxFriction, maxFriction);
+					ApplyImpulse(c, p, c.mTangents[t] * (p.mTangentImpulse[t] - old));
+				}
+				// Then the normal, which can only push
+				float vel = Vector3::Dot(GetRelativeVelocity(c, p), c.mNormal);
+				float old = p.mNormalImpulse;
+				p.mNormalImpulse = Math::Max(old + p.mNormalMass * (p.mBias - vel), 0.0f);
+				ApplyImpulse(c, p, c.mNormal * (p.mNormalImpulse - old));
+			}
+		}
+	}
+
+	// Move the bodies, and put the island to sleep if
+	// every body in it has been still long enough
+	float minSleepTime = Math::Infinity;
+	for (size_t i = 0; i < numBodies; i++)
+	{
+		RigidBodyComponent* body = mBodies[bodies[i]];
+		SolverBody& sb = mSolverBodies[bodies[i]];
+		sb.mPosition += sb.mLinearVelocity * deltaTime;
+		float speed = sb.mAngularVelocity.Length();
+		if (speed > 0.0f)
+		{
+			Quaternion spin(sb.mAngularVelocity * (1.0f / speed), speed * deltaTime);
+			sb.mRotation = Quaternion::Concatenate(sb.mRotation, spin);
+			sb.mRotation.Normalize();
+		}
+		body->mLinearVelocity = sb.mLinearVelocity;
+		body->mAngularVelocity = sb.mAngularVelocity;
+
+		if (sb.mLinearVelocity.LengthSq() > LinearSleepTolerance * LinearSleepTolerance ||
+			speed > AngularSleepTolerance)
+		{
+			body->mSleepTime = 0.0f;
+		}
+		else
+		{
+			body->mSleepTime += deltaTime;
+		}
+		minSleepTime = Math::Min(minSleepTime, body->mSleepTime);
+	}
+	if (minSleepTime >= TimeToSleep)
+	{
+		for (size_t i = 0; i < numBodies; i++)
+		{
+			RigidBodyComponent* body = mBodies[bodies[i]];
+			body->mAwake = false;
+			body->mLinearVelocity = Vector3::Zero;
+			body->mAngularVelocity = Vector3::Zero;
+		}
+	}
+}
+
+void DynamicsWorld::FinishSubStep()
+{
+	// Save the impulses to warm start the next substep
+	mNewCache.clear();
+	for (const Contact& c : mContacts)
+	{
+		CachedContact cached;
+		cached.mBoxA = c.mBoxA;
+		cached.mBoxB = c.mBoxB;
+		cached.mNumPoints = c.mNumPoints;
+		for (int i = 0; i < c.mNumPoints; i++)
+		{
+			cached.mRelA[i] = c.mPoints[i].mRelA;
+			cached.mNormalImpulse[i] = c.mPoints[i].mNormalImpulse;
+			cached.mTangentImpulse[i][0] = c.mPoints[i].mTangentImpulse[0];
+			cached.mTangentImpulse[i][1] = c.mPoints[i].mTangentImpulse[1];
+		}
+		mNewCache.emplace_back(cached);
+	}
+	std::sort(mNewCache.begin(), mNewCache.end());
+	mCache.swap(mNewCache);
+
+	// Move each solved body's actor so its box's center ends up
+	// at the body's center
+	for (uint32_t index : mIslandBodies)
+	{
+		RigidBodyComponent* body = mBodies[index];
+		const SolverBody& sb = mSolverBodies[index];
+		Actor* owner = body->GetOwner();
+		const AABB& objectBox = body->mBox->GetObjectBox();
+		Vector3 center = (objectBox.mMin + objectBox.mMax) * (0.5f * owner->GetWorldScale());
+		owner->SetWorldRotation(sb.mRotation);
+		owner->SetWorldPosition(sb.mPosition - Vector3::Transform(center, sb.mRotation));
+	}
+	// Which moves their boxes (the broadphase picks them
+	// up before the next contacts are found)
+	mGame->GetTransformStore()->UpdateWorldTransforms();
+}
+
+void DynamicsWorld::AddBody(RigidBodyComponent* body)
+{
+	// Other job threads might be using the bodies
+	if (mGame->IsUpdatingInParallel())
+	{
+		mGame->GetCommandBuffer()->Push([this, body] { AddBody(body); });
+		return;
+	}
+	body->mBodyIndex = mBodies.size();
+	mBodies.emplace_back(body);
+}
+
+void DynamicsWorld::RemoveBody(RigidBodyComponent* body)
+{
+	if (mGame->IsUpdatingInParallel())
+	{
+		mGame->GetCommandBuffer()->Push([this, body] { RemoveBody(body); });
+		return;
+	}
+	// Swap to end of vector and pop off
+	RigidBodyComponent* last = mBodies.back();
+	mBodies[body->mBodyIndex] = last;
+	last->mBodyIndex = body->mBodyIndex;
+	mBodies.pop_back();
+}
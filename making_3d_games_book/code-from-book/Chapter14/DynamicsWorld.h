@@ -0,0 +1,148 @@
+// ----------------------------------------------------------------
+// From Game Programming in C++ by Sanjay Madhav
+// Copyright (C) 2017 Sanjay Madhav. All rights reserved.
+// 
+// Released under the BSD License
+// See LICENSE in root directory for full details.
+// ----------------------------------------------------------------
+
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "Math.h"
+#include "Collision.h"
+
+// Moves the rigid bodies each simulation step, in SubSteps fixed
+// substeps. Each substep adds gravity, solves the contacts with
+// sequential impulses (warm started with the last substep's
+// impulses, with friction and restitution), and then moves the
+// bodies. Bodies that touch form an island, and islands are solved
+// in parallel on the job threads. An island that stays still long
+// enough goes to sleep, and costs nothing until an awake body
+// touches it.
+class DynamicsWorld
+{
+public:
+	DynamicsWorld(class Game* game);
+
+	// Call once per simulation step, after the broadphase is up to date
+	void Step(float deltaTime);
+
+	void AddBody(class RigidBodyComponent* body);
+	void RemoveBody(class RigidBodyComponent* body);
+
+	void SetGravity(const Vector3& gravity) { mGravity = gravity; }
+	const Vector3& GetGravity() const { return mGravity; }
+
+	// Stats from the last substep
+	size_t GetNumBodies() const { return mBodies.size(); }
+	size_t GetNumAwake() const { return mIslandBodies.size(); }
+	size_t GetNumIslands() const { return mNumIslands; }
+	size_t GetNumContacts() const { return mContacts.size(); }
+
+	// Stacks settle better with more substeps than with more
+	// iterations per substep (for the same total)
+	static const int SubSteps = 4;
+	static const int VelocityIterations = 8;
+private:
+	// The solver's copy of a body
+	struct SolverBody
+	{
+		// Center of mass and rotation
+		Vector3 mPosition;
+		Quaternion mRotation;
+		Vector3 mLinearVelocity;
+		Vector3 mAngularVelocity;
+		float mInvMass;
+		// World space inverse inertia (symmetric, so rows or columns)
+		Vector3 mInvInertia[3];
+		Vector3 ApplyInvInertia(const Vector3& v) const
+		{
+			return Vector3(Vector3::Dot(mInvInertia[0], v),
+				Vector3::Dot(mInvInertia[1], v), Vector3::Dot(mInvInertia[2], v));
+		}
+	};
+	struct ContactPoint
+	{
+		// From each body's center to the point
+		Vector3 mRelA;
+		Vector3 mRelB;
+		float mDepth;
+		float mNormalMass;
+		float mTangentMass[2];
+		// Velocity the solver aims for along the normal
+		float mBias;
+		// Total impulses so far this substep
+		float mNormalImpulse;
+		float mTangentImpulse[2];
+	};
+	struct Contact
+	{
+		class BoxComponent* mBoxA;
+		class BoxComponent* mBoxB;
+		// Index in mSolverBodies (mFixedBody for a box that doesn't move)
+		uint32_t mBodyA;
+		uint32_t mBodyB;
+		// From a to b
+		Vector3 mNormal;
+		Vector3 mTangents[2];
+		float mFriction;
+		float mRestitution;
+		int mNumPoints;
+		ContactPoint mPoints[ContactManifold::MaxPoints];
+	};
+	// Impulses at the end of a substep, to warm start the next one
+	struct CachedContact
+	{
+		const class BoxComponent* mBoxA;
+		const class BoxComponent* mBoxB;
+		int mNumPoints;
+		Vector3 mRelA[ContactManifold::MaxPoints];
+		float mNormalImpulse[ContactManifold::MaxPoints];
+		float mTangentImpulse[ContactManifold::MaxPoints][2];
+		bool operator<(const CachedContact& other) const;
+	};
+
+	void SubStep(float deltaTime);
+	// Copy the bodies into mSolverBodies
+	void PrepareBodies();
+	// Make a contact for every pair of touching boxes
+	// where at least one is an awake body
+	void FindContacts();
+	void AddContact(class BoxComponent* a, class BoxComponent* b);
+	// Group the awake bodies (and the ones they wake) into islands
+	void BuildIslands();
+	uint32_t FindRoot(uint32_t body);
+	void SolveIsland(size_t island, float deltaTime);
+	// Velocity of b relative to a at the contact point
+	Vector3 GetRelativeVelocity(const Contact& c, const ContactPoint& p) const;
+	// Apply the impulse to b (and the opposite to a)
+	void ApplyImpulse(const Contact& c, const ContactPoint& p, const Vector3& impulse);
+	// Save the contact impulses, and move the actors
+	void FinishSubStep();
+
+	class Game* mGame;
+	class PhysWorld* mPhysWorld;
+	std::vector<class RigidBodyComponent*> mBodies;
+	Vector3 mGravity;
+
+	// Per substep (these keep their memory between substeps)
+	std::vector<SolverBody> mSolverBodies;
+	// The last solver body never moves
+	uint32_t mFixedBody;
+	std::vector<Contact> mContacts;
+	std::vector<CachedContact> mCache;
+	std::vector<CachedContact> mNewCache;
+	// Union-find parents, then each root's island
+	std::vector<uint32_t> mParents;
+	std::vector<uint32_t> mIslandOf;
+	// Each island's bodies and contacts, by island
+	std::vector<uint32_t> mIslandBodies;
+	std::vector<uint32_t> mIslandBodyStart;
+	std::vector<uint32_t> mIslandContacts;
+	std::vector<uint32_t> mIslandContactStart;
+	size_t mNumIslands;
+	// Islands per job
+	static const size_t IslandGrainSize = 4;
+	static const uint32_t NoIsland = 0xFFFFFFFF;
+};
@@ -11,7 +11,7 @@
 #include "Game.h"
 #include "Renderer.h"
 #include "FollowCamera.h"
-#include "MoveComponent.h"
+#include "CharacterController.h"
 #include "MirrorCamera.h"
 #include "LevelLoader.h"
 
@@ -25,7 +25,7 @@ FollowActor::FollowActor(Game* game)
 	mMeshComp->PlayAnimation(game->GetAnimation("Assets/CatActionIdle.gpanim"));
 	SetPosition(Vector3(0.0f, 0.0f, -100.0f));
 
-	mMoveComp = new MoveComponent(this);
+	mMoveComp = new CharacterController(this);
 	mCameraComp = new FollowCamera(this);
 	mCameraComp->SnapToIdeal();
 
@@ -24,7 +24,7 @@ public:
 
 	TypeID GetType() const override { return TFollowActor; }
 private:
-	class MoveComponent* mMoveComp;
+	class CharacterController* mMoveComp;
 	class FollowCamera* mCameraComp;
 	class SkeletalMeshComponent* mMeshComp;
 	bool mMoving;
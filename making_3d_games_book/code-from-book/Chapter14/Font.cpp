@@ -10,6 +10,7 @@
 #include "Texture.h"
 #include <vector>
 #include "Game.h"
+#include "Renderer.h"
 
 Font::Font(class Game* game)
 	:mGame(game)
@@ -24,6 +25,12 @@ Font::~Font()
 
 bool Font::Load(const std::string& fileName)
 {
+	// SDL_ttf isn't initialized when headless, so there's nothing to load
+	if (mGame->IsHeadless())
+	{
+		return true;
+	}
+
 	// We support these font sizes
 	std::vector<int> fontSizes = {
 		8, 9,
@@ -62,6 +69,10 @@ Texture* Font::RenderText(const std::string& textKey,
 						  int pointSize /*= 24*/)
 {
 	Texture* texture = nullptr;
+	if (mGame->IsHeadless())
+	{
+		return texture;
+	}
 	
 	// Convert to SDL_Color
 	SDL_Color sdlColor;
@@ -81,7 +92,7 @@ Texture* Font::RenderText(const std::string& textKey,
 		if (surf != nullptr)
 		{
 			// Convert from surface to texture
-			texture = new Texture();
+			texture = new Texture(mGame->GetRenderer()->GetDevice());
 			texture->CreateFromSurface(surf);
 			SDL_FreeSurface(surf);
 		}
@@ -0,0 +1,105 @@
+// ----------------------------------------------------------------
+// From Game Programming in C++ by Sanjay Madhav
+// Copyright (C) 2017 Sanjay Madhav. All rights reserved.
+// 
+// Released under the BSD License
+// See LICENSE in root directory for full details.
+// ----------------------------------------------------------------
+
+#include "FrameAllocator.h"
+#include <mutex>
+#include <new>
+
+namespace
+{
+	// Every thread's allocator (these live until the program exits)
+	std::mutex sAllocatorMutex;
+	std::vector<FrameAllocator*> sAllocators;
+	thread_local FrameAllocator* tAllocator = nullptr;
+}
+
+FrameAllocator& FrameAllocator::Get()
+{
+	if (tAllocator == nullptr)
+	{
+		// First use on this thread, so register a new allocator
+		tAllocator = new FrameAllocator();
+		std::lock_guard<std::mutex> lock(sAllocatorMutex);
+		sAllocators.emplace_back(tAllocator);
+	}
+	return *tAllocator;
+}
+
+void FrameAllocator::ResetAll()
+{
+	std::lock_guard<std::mutex> lock(sAllocatorMutex);
+	for (FrameAllocator* alloc : sAllocators)
+	{
+		alloc->Reset();
+	}
+}
+
+FrameAllocator::FrameAllocator()
+	:mBlock(nullptr)
+	,mBlockSize(DefaultBlockSize)
+	,mTop(0)
+	,mUsedBefore(0)
+	,mPeakUsed(0)
+{
+	mBlock = static_cast<char*>(::operator new(mBlockSize));
+}
+
+FrameAllocator::~FrameAllocator()
+{
+	Reset();
+	::operator delete(mBlock);
+}
+
+void* FrameAllocator::Allocate(size_t size, size_t alignment)
+{
+	size_t start = (mTop + alignment - 1) & ~(alignment - 1);
+	if (start + size > mBlockSize)
+	{
+		// This block is full, so start another at least twice as
+		// big. Reset frees the full ones, so after a few frames
+		// one block holds a whole frame.
+		mFullBlocks.emplace_back(mBlock);
+		mUsedBefore += mTop;
+		mBlockSize *= 2;
+		while (mBlockSize < size)
+		{
+			mBlockSize *= 2;
+		}
+		// (operator new aligns to max_align_t)
+		mBlock = static_cast<char*>(::operator new(mBlockSize));
+		start = 0;
+	}
+	mTop = start + size;
+	return mBlock + start;
+}
+
+void FrameAllocator::Free(void* ptr, size_t size)
+{
+	char* bytes = static_cast<char*>(ptr);
+	if (bytes + size == mBlock + mTop && bytes >= mBlock)
+	{
+		mTop = bytes - mBlock;
+	}
+}
+
+void FrameAllocator::Reset()
+{
+	size_t used = GetBytesUsed();
+	if (used > mPeakUsed)
+	{
+		mPeakUsed = used;
+	}
+	// The current block is the biggest, so keep it
+	for (char* block : mFullBlocks)
+	{
+		::operator delete(block);
+	}
+	mFullBlocks.clear();
+	mUsedBefore = 0;
+	mTop = 0;
+}
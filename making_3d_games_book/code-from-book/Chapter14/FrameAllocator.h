@@ -0,0 +1,82 @@
+// ----------------------------------------------------------------
+// From Game Programming in C++ by Sanjay Madhav
+// Copyright (C) 2017 Sanjay Madhav. All rights reserved.
+// 
+// Released under the BSD License
+// See LICENSE in root directory for full details.
+// ----------------------------------------------------------------
+
+#pragma once
+#include <cstddef>
+#include <vector>
+
+// Scratch memory that only lasts until the end of the frame. Each
+// thread has its own, and allocating just bumps a pointer. Nothing
+// is freed individually; the game resets every thread's allocator
+// once the frame is done.
+class FrameAllocator
+{
+public:
+	// Size of the first block (it grows to fit a whole frame)
+	static const size_t DefaultBlockSize = 256 * 1024;
+
+	// The calling thread's allocator
+	static FrameAllocator& Get();
+	// Reset every thread's allocator (only call when no jobs are running)
+	static void ResetAll();
+
+	void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+	// Only gives memory back if it's the most recent allocation
+	// (so a vector that grows doesn't waste its old buffer)
+	void Free(void* ptr, size_t size);
+	void Reset();
+
+	// Bytes allocated this frame, and the most in any frame
+	size_t GetBytesUsed() const { return mUsedBefore + mTop; }
+	size_t GetPeakBytesUsed() const { return mPeakUsed; }
+private:
+	FrameAllocator();
+	~FrameAllocator();
+
+	// Block allocations are coming from
+	char* mBlock;
+	size_t mBlockSize;
+	size_t mTop;
+	// Blocks that filled up this frame (freed on reset)
+	std::vector<char*> mFullBlocks;
+	size_t mUsedBefore;
+	size_t mPeakUsed;
+};
+
+// STL allocator that uses the calling thread's FrameAllocator
+// (the container must not outlive the frame)
+template <typename T>
+class FrameStdAllocator
+{
+public:
+	using value_type = T;
+
+	FrameStdAllocator() :mArena(&FrameAllocator::Get()) {}
+	template <typename U>
+	FrameStdAllocator(const FrameStdAllocator<U>& other) :mArena(other.mArena) {}
+
+	T* allocate(size_t n)
+	{
+		return static_cast<T*>(mArena->Allocate(n * sizeof(T), alignof(T)));
+	}
+	void deallocate(T* ptr, size_t n)
+	{
+		mArena->Free(ptr, n * sizeof(T));
+	}
+
+	template <typename U>
+	bool operator==(const FrameStdAllocator<U>& other) const { return mArena == other.mArena; }
+	template <typename U>
+	bool operator!=(const FrameStdAllocator<U>& other) const { return mArena != other.mArena; }
+private:
+	template <typename U> friend class FrameStdAllocator;
+	FrameAllocator* mArena;
+};
+
+template <typename T>
+using FrameVector = std::vector<T, FrameStdAllocator<T>>;
@@ -7,11 +7,11 @@
 // ----------------------------------------------------------------
 
 #include "GBuffer.h"
-#include <GL/glew.h>
 #include "Texture.h"
 
-GBuffer::GBuffer()
-	:mBufferID(0)
+GBuffer::GBuffer(RenderDevice* device)
+	:mDevice(device)
+	,mBufferID(0)
 {
 	
 }
@@ -23,44 +23,24 @@ GBuffer::~GBuffer()
 
 bool GBuffer::Create(int width, int height)
 {
-	// Create the framebuffer object
-	glGenFramebuffers(1, &mBufferID);
-	glBindFramebuffer(GL_FRAMEBUFFER, mBufferID);
-	
-	// Add a depth buffer to this target
-	GLuint depthBuffer;
-	glGenRenderbuffers(1, &depthBuffer);
-	glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT,
-						  width, height);
-	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
-							  GL_RENDERBUFFER, depthBuffer);
-	
 	// Create textures for each output in the G-buffer
+	unsigned textureIDs[NUM_GBUFFER_TEXTURES];
 	for (int i = 0; i < NUM_GBUFFER_TEXTURES; i++)
 	{
-		Texture* tex = new Texture();
+		Texture* tex = new Texture(mDevice);
 		// We want three 32-bit float components for each texture
-		tex->CreateForRendering(width, height, GL_RGB32F);
+		tex->CreateForRendering(width, height, RenderDevice::ERGB32F);
 		mTextures.emplace_back(tex);
-		// Attach this texture to a color output
-		glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i,
-							 tex->GetTextureID(), 0);
-	}
-	
-	// Create a vector of the color attachments
-	std::vector<GLenum> attachments;
-	for (int i = 0; i < NUM_GBUFFER_TEXTURES; i++)
-	{
-		attachments.emplace_back(GL_COLOR_ATTACHMENT0 + i);
+		textureIDs[i] = tex->GetTextureID();
 	}
 	
-	// Set the list of buffers to draw to
-	glDrawBuffers(static_cast<GLsizei>(attachments.size()),
-				  attachments.data());
+	// Create the framebuffer object, with a depth buffer,
+	// drawing to each texture as a color output
+	mBufferID = mDevice->CreateFramebuffer(width, height, textureIDs,
+		NUM_GBUFFER_TEXTURES);
 	
 	// Make sure everything worked
-	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	if (mBufferID == 0)
 	{
 		Destroy();
 		return false;
@@ -71,12 +51,17 @@ bool GBuffer::Create(int width, int height)
 
 void GBuffer::Destroy()
 {
-	glDeleteFramebuffers(1, &mBufferID);
+	if (mBufferID != 0)
+	{
+		mDevice->DestroyFramebuffer(mBufferID);
+		mBufferID = 0;
+	}
 	for (Texture* t : mTextures)
 	{
 		t->Unload();
 		delete t;
 	}
+	mTextures.clear();
 }
 
 Texture* GBuffer::GetTexture(Type type)
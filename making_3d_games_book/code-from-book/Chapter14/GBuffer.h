@@ -21,7 +21,7 @@ public:
 		NUM_GBUFFER_TEXTURES
 	};
 
-	GBuffer();
+	GBuffer(class RenderDevice* device);
 	~GBuffer();
 
 	// Create/destroy the G-buffer
@@ -35,6 +35,7 @@ public:
 	// Setup all the G-buffer textures for sampling
 	void SetTexturesActive();
 private:
+	class RenderDevice* mDevice;
 	// Textures associated with G-buffer
 	std::vector<class Texture*> mTextures;
 	// Frame buffer object ID
@@ -0,0 +1,500 @@
+// ----------------------------------------------------------------
+// From Game Programming in C++ by Sanjay Madhav
+// Copyright (C) 2017 Sanjay Madhav. All rights reserved.
+// 
+// Released under the BSD License
+// See LICENSE in root directory for full details.
+// ----------------------------------------------------------------
+
+#include "GLRenderDevice.h"
+#include <SDL/SDL.h>
+#include <cstring>
+
+GLRenderDevice::GLRenderDevice()
+{
+}
+
+bool GLRenderDevice::Initialize()
+{
+	// Initialize GLEW
+	glewExperimental = GL_TRUE;
+	if (glewInit() != GLEW_OK)
+	{
+		SDL_Log("Failed to initialize GLEW.");
+		return false;
+	}
+
+	// On some platforms, GLEW will emit a benign error code,
+	// so clear it
+	glGetError();
+	return true;
+}
+
+void GLRenderDevice::BeginFrame()
+{
+}
+
+unsigned GLRenderDevice::CreateBuffer(BufferType /*type*/, size_t size, const void* data,
+	bool dynamic)
+{
+	// Upload through the copy target, since binding an index buffer
+	// would change the element buffer of the bound vertex array
+	GLuint buffer = 0;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, size, data,
+		dynamic ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
+	return buffer;
+}
+
+void GLRenderDevice::DestroyBuffer(unsigned buffer)
+{
+	glDeleteBuffers(1, &buffer);
+}
+
+void GLRenderDevice::SetBufferData(unsigned buffer, size_t size, const void* data)
+{
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, size, data, GL_STREAM_DRAW);
+}
+
+void GLRenderDevice::UpdateBuffer(unsigned buffer, size_t offset, size_t size,
+	const void* data)
+{
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, data);
+}
+
+void GLRenderDevice::BindUniformBuffer(unsigned buffer, unsigned binding)
+{
+	glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer);
+}
+
+unsigned GLRenderDevice::CreateVertexArray(unsigned vertexBuffer, unsigned indexBuffer,
+	unsigned stride, const VertexAttrib* attribs, unsigned numAttribs)
+{
+	GLuint vertexArray = 0;
+	glGenVertexArrays(1, &vertexArray);
+	glBindVertexArray(vertexArray);
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+
+	// Specify the vertex attributes
+	for (unsigned i = 0; i < numAttribs; i++)
+	{
+		const VertexAttrib& a = attribs[i];
+		void* offset = reinterpret_cast<void*>(static_cast<size_t>(a.mOffset));
+		glEnableVertexAttribArray(a.mIndex);
+		switch (a.mType)
+		{
+		case EAttribFloat:
+			glVertexAttribPointer(a.mIndex, a.mCount, GL_FLOAT, GL_FALSE, stride, offset);
+			break;
+		case EAttribUInt8:
+			// Keep as ints
+			glVertexAttribIPointer(a.mIndex, a.mCount, GL_UNSIGNED_BYTE, stride, offset);
+			break;
+		case EAttribUNorm8:
+			// Convert to floats
+			glVertexAttribPointer(a.mIndex, a.mCount, GL_UNSIGNED_BYTE, GL_TRUE, stride, offset);
+			break;
+		}
+	}
+	return vertexArray;
+}
+
+void GLRenderDevice::DestroyVertexArray(unsigned vertexArray)
+{
+	glDeleteVertexArrays(1, &vertexArray);
+}
+
+void GLRenderDevice::BindVertexArray(unsigned vertexArray)
+{
+	glBindVertexArray(vertexArray);
+}
+
+void GLRenderDevice::SetInstanceTransforms(unsigned buffer, unsigned firstAttrib,
+	size_t offset)
+{
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	// Each row of the matrix is 4 floats, and advances once per instance
+	const unsigned matrixSize = sizeof(float) * 16;
+	for (unsigned row = 0; row < 4; row++)
+	{
+		GLuint loc = firstAttrib + row;
+		glEnableVertexAttribArray(loc);
+		glVertexAttribPointer(loc, 4, GL_FLOAT, GL_FALSE, matrixSize,
+			reinterpret_cast<void*>(offset + sizeof(float) * 4 * row));
+		glVertexAttribDivisor(loc, 1);
+	}
+}
+
+unsigned GLRenderDevice::CreateTexture(int width, int height, TextureFormat format,
+	const void* pixels, TextureFilter filter)
+{
+	GLint internalFormat = GL_RGB;
+	GLenum pixelFormat = GL_RGB;
+	GLenum pixelType = GL_UNSIGNED_BYTE;
+	switch (format)
+	{
+	case ERGB8:
+		break;
+	case ERGBA8:
+		internalFormat = GL_RGBA;
+		pixelFormat = GL_RGBA;
+		break;
+	case EBGRA8:
+		internalFormat = GL_RGBA;
+		pixelFormat = GL_BGRA;
+		break;
+	case ERGB32F:
+		internalFormat = GL_RGB32F;
+		pixelType = GL_FLOAT;
+		break;
+	}
+
+	GLuint texture = 0;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, pixelFormat,
+		pixelType, pixels);
+
+	if (filter == EMipmapped)
+	{
+		// Generate mipmaps for texture
+		glGenerateMipmap(GL_TEXTURE_2D);
+		// Enable linear filtering
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		// Enable anisotropic filtering, if supported
+		if (GLEW_EXT_texture_filter_anisotropic)
+		{
+			// Get the maximum anisotropy value
+			GLfloat largest;
+			glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &largest);
+			// Enable it
+			glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, largest);
+		}
+	}
+	else
+	{
+		GLint glFilter = (filter == ELinear) ? GL_LINEAR : GL_NEAREST;
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, glFilter);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, glFilter);
+	}
+	return texture;
+}
+
+void GLRenderDevice::DestroyTexture(unsigned texture)
+{
+	glDeleteTextures(1, &texture);
+}
+
+void GLRenderDevice::BindTexture(unsigned texture, unsigned unit)
+{
+	glActiveTexture(GL_TEXTURE0 + unit);
+	glBindTexture(GL_TEXTURE_2D, texture);
+}
+
+unsigned GLRenderDevice::CreateFramebuffer(int width, int height,
+	const unsigned* textures, unsigned numTextures)
+{
+	// Create the framebuffer object
+	GLuint framebuffer = 0;
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+	// Add a depth buffer to this target
+	GLuint depthBuffer = 0;
+	glGenRenderbuffers(1, &depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, width, height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+		GL_RENDERBUFFER, depthBuffer);
+
+	// Attach each texture to a color output, and draw to all of them
+	std::vector<GLenum> attachments;
+	for (unsigned i = 0; i < numTextures; i++)
+	{
+		glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i,
+			textures[i], 0);
+		attachments.emplace_back(GL_COLOR_ATTACHMENT0 + i);
+	}
+	glDrawBuffers(static_cast<GLsizei>(attachments.size()), attachments.data());
+
+	// Make sure everything worked
+	bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	if (!complete)
+	{
+		glDeleteFramebuffers(1, &framebuffer);
+		glDeleteRenderbuffers(1, &depthBuffer);
+		return 0;
+	}
+	mDepthBuffers.emplace(framebuffer, depthBuffer);
+	return framebuffer;
+}
+
+void GLRenderDevice::DestroyFramebuffer(unsigned framebuffer)
+{
+	glDeleteFramebuffers(1, &framebuffer);
+	auto iter = mDepthBuffers.find(framebuffer);
+	if (iter != mDepthBuffers.end())
+	{
+		glDeleteRenderbuffers(1, &iter->second);
+		mDepthBuffers.erase(iter);
+	}
+}
+
+void GLRenderDevice::BindFramebuffer(unsigned framebuffer)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+}
+
+void GLRenderDevice::BlitDepth(unsigned framebuffer, int width, int height)
+{
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	glBlitFramebuffer(0, 0, width, height,
+		0, 0, width, height,
+		GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+}
+
+unsigned GLRenderDevice::CreateProgram(const char* vertSource, const char* fragSource)
+{
+	// Compile vertex and pixel shaders
+	GLuint vertShader = CompileShader(vertSource, GL_VERTEX_SHADER);
+	GLuint fragShader = CompileShader(fragSource, GL_FRAGMENT_SHADER);
+	if (vertShader == 0 || fragShader == 0)
+	{
+		glDeleteShader(vertShader);
+		glDeleteShader(fragShader);
+		return 0;
+	}
+
+	// Now create a shader program that
+	// links together the vertex/frag shaders
+	GLuint program = glCreateProgram();
+	glAttachShader(program, vertShader);
+	glAttachShader(program, fragShader);
+	glLinkProgram(program);
+	// The program keeps the shaders until it's deleted
+	glDeleteShader(vertShader);
+	glDeleteShader(fragShader);
+
+	// Verify that the program linked successfully
+	if (!IsValidProgram(program))
+	{
+		glDeleteProgram(program);
+		return 0;
+	}
+	return program;
+}
+
+void GLRenderDevice::DestroyProgram(unsigned program)
+{
+	glDeleteProgram(program);
+}
+
+void GLRenderDevice::UseProgram(unsigned program)
+{
+	glUseProgram(program);
+}
+
+void GLRenderDevice::GetUniforms(unsigned program, std::vector<UniformDesc>& outUniforms)
+{
+	outUniforms.clear();
+	GLint numUniforms = 0;
+	glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &numUniforms);
+	for (GLint i = 0; i < numUniforms; i++)
+	{
+		char name[256];
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveUniform(program, static_cast<GLuint>(i), sizeof(name),
+			&length, &size, &type, name);
+		GLint loc = glGetUniformLocation(program, name);
+		// Uniforms in a block don't have a location
+		if (loc == -1)
+		{
+			continue;
+		}
+		// Arrays are reported as "name[0]", but set by "name"
+		if (length > 3 && strcmp(name + length - 3, "[0]") == 0)
+		{
+			name[length - 3] = '\0';
+		}
+
+		UniformDesc desc;
+		desc.mName = name;
+		desc.mLocation = loc;
+		switch (type)
+		{
+		case GL_FLOAT_MAT4:
+			desc.mType = EUniformMatrix4;
+			break;
+		case GL_FLOAT_VEC3:
+			desc.mType = EUniformVector3;
+			break;
+		case GL_FLOAT_VEC2:
+			desc.mType = EUniformVector2;
+			break;
+		case GL_FLOAT:
+			desc.mType = EUniformFloat;
+			break;
+		case GL_INT:
+			desc.mType = EUniformInt;
+			break;
+		case GL_SAMPLER_1D:
+		case GL_SAMPLER_2D:
+		case GL_SAMPLER_3D:
+		case GL_SAMPLER_CUBE:
+		case GL_SAMPLER_2D_SHADOW:
+			desc.mType = EUniformSampler;
+			break;
+		default:
+			desc.mType = EUniformOther;
+			break;
+		}
+		outUniforms.emplace_back(desc);
+	}
+}
+
+bool GLRenderDevice::BindUniformBlock(unsigned program, const char* name,
+	unsigned binding)
+{
+	GLuint index = glGetUniformBlockIndex(program, name);
+	if (index == GL_INVALID_INDEX)
+	{
+		return false;
+	}
+	glUniformBlockBinding(program, index, binding);
+	return true;
+}
+
+void GLRenderDevice::SetUniform(int location, const Matrix4* matrices, unsigned count)
+{
+	// Matrix4 is row-major, so transpose it
+	glUniformMatrix4fv(location, count, GL_TRUE, matrices->GetAsFloatPtr());
+}
+
+void GLRenderDevice::SetUniform(int location, const Vector3& vector)
+{
+	glUniform3fv(location, 1, vector.GetAsFloatPtr());
+}
+
+void GLRenderDevice::SetUniform(int location, const Vector2& vector)
+{
+	glUniform2fv(location, 1, vector.GetAsFloatPtr());
+}
+
+void GLRenderDevice::SetUniform(int location, float value)
+{
+	glUniform1f(location, value);
+}
+
+void GLRenderDevice::SetUniform(int location, int value)
+{
+	glUniform1i(location, value);
+}
+
+void GLRenderDevice::Clear()
+{
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void GLRenderDevice::SetDepthState(bool test, bool write)
+{
+	if (test)
+	{
+		glEnable(GL_DEPTH_TEST);
+	}
+	else
+	{
+		glDisable(GL_DEPTH_TEST);
+	}
+	glDepthMask(write ? GL_TRUE : GL_FALSE);
+}
+
+void GLRenderDevice::SetBlendMode(BlendMode mode)
+{
+	switch (mode)
+	{
+	case EBlendNone:
+		glDisable(GL_BLEND);
+		break;
+	case EBlendAlpha:
+		glEnable(GL_BLEND);
+		glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
+		glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ZERO);
+		break;
+	case EBlendAdd:
+		glEnable(GL_BLEND);
+		glBlendEquation(GL_FUNC_ADD);
+		glBlendFunc(GL_ONE, GL_ONE);
+		break;
+	}
+}
+
+void GLRenderDevice::DrawIndexed(unsigned numIndices)
+{
+	glDrawElements(GL_TRIANGLES, numIndices, GL_UNSIGNED_INT, nullptr);
+}
+
+void GLRenderDevice::DrawIndexedInstanced(unsigned numIndices, unsigned numInstances)
+{
+	glDrawElementsInstanced(GL_TRIANGLES, numIndices, GL_UNSIGNED_INT, nullptr,
+		numInstances);
+}
+
+GLuint GLRenderDevice::CompileShader(const char* source, GLenum shaderType)
+{
+	// Create a shader of the specified type
+	GLuint shader = glCreateShader(shaderType);
+	// Set the source characters and try to compile
+	glShaderSource(shader, 1, &source, nullptr);
+	glCompileShader(shader);
+	if (!IsCompiled(shader))
+	{
+		glDeleteShader(shader);
+		return 0;
+	}
+	return shader;
+}
+
+bool GLRenderDevice::IsCompiled(GLuint shader)
+{
+	GLint status;
+	// Query the compile status
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+
+	if (status != GL_TRUE)
+	{
+		char buffer[512];
+		memset(buffer, 0, 512);
+		glGetShaderInfoLog(shader, 511, nullptr, buffer);
+		SDL_Log("GLSL Compile Failed:\n%s", buffer);
+		return false;
+	}
+
+	return true;
+}
+
+bool GLRenderDevice::IsValidProgram(GLuint program)
+{
+	GLint status;
+	// Query the link status
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	if (status != GL_TRUE)
+	{
+		char buffer[512];
+		memset(buffer, 0, 512);
+		glGetProgramInfoLog(program, 511, nullptr, buffer);
+		SDL_Log("GLSL Link Status:\n%s", buffer);
+		return false;
+	}
+
+	return true;
+}
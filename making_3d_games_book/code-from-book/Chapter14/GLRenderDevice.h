@@ -0,0 +1,78 @@
+// ----------------------------------------------------------------
+// From Game Programming in C++ by Sanjay Madhav
+// Copyright (C) 2017 Sanjay Madhav. All rights reserved.
+// 
+// Released under the BSD License
+// See LICENSE in root directory for full details.
+// ----------------------------------------------------------------
+
+#pragma once
+#include "RenderDevice.h"
+#include <GL/glew.h>
+#include <unordered_map>
+
+// Render device that draws with OpenGL 3.3. Needs a current GL context.
+class GLRenderDevice : public RenderDevice
+{
+public:
+	GLRenderDevice();
+	// Load the GL functions (once the context is created)
+	bool Initialize();
+
+	void BeginFrame() override;
+
+	unsigned CreateBuffer(BufferType type, size_t size, const void* data,
+		bool dynamic) override;
+	void DestroyBuffer(unsigned buffer) override;
+	void SetBufferData(unsigned buffer, size_t size, const void* data) override;
+	void UpdateBuffer(unsigned buffer, size_t offset, size_t size,
+		const void* data) override;
+	void BindUniformBuffer(unsigned buffer, unsigned binding) override;
+
+	unsigned CreateVertexArray(unsigned vertexBuffer, unsigned indexBuffer,
+		unsigned stride, const VertexAttrib* attribs, unsigned numAttribs) override;
+	void DestroyVertexArray(unsigned vertexArray) override;
+	void BindVertexArray(unsigned vertexArray) override;
+	void SetInstanceTransforms(unsigned buffer, unsigned firstAttrib,
+		size_t offset) override;
+
+	unsigned CreateTexture(int width, int height, TextureFormat format,
+		const void* pixels, TextureFilter filter) override;
+	void DestroyTexture(unsigned texture) override;
+	void BindTexture(unsigned texture, unsigned unit) override;
+
+	unsigned CreateFramebuffer(int width, int height,
+		const unsigned* textures, unsigned numTextures) override;
+	void DestroyFramebuffer(unsigned framebuffer) override;
+	void BindFramebuffer(unsigned framebuffer) override;
+	void BlitDepth(unsigned framebuffer, int width, int height) override;
+
+	unsigned CreateProgram(const char* vertSource, const char* fragSource) override;
+	void DestroyProgram(unsigned program) override;
+	void UseProgram(unsigned program) override;
+	void GetUniforms(unsigned program, std::vector<UniformDesc>& outUniforms) override;
+	bool BindUniformBlock(unsigned program, const char* name,
+		unsigned binding) override;
+	void SetUniform(int location, const Matrix4* matrices, unsigned count) override;
+	void SetUniform(int location, const Vector3& vector) override;
+	void SetUniform(int location, const Vector2& vector) override;
+	void SetUniform(int location, float value) override;
+	void SetUniform(int location, int value) override;
+
+	void Clear() override;
+	void SetDepthState(bool test, bool write) override;
+	void SetBlendMode(BlendMode mode) override;
+
+	void DrawIndexed(unsigned numIndices) override;
+	void DrawIndexedInstanced(unsigned numIndices, unsigned numInstances) override;
+private:
+	// Tries to compile a shader (returns 0 if it fails)
+	GLuint CompileShader(const char* source, GLenum shaderType);
+	// Tests whether shader compiled successfully
+	bool IsCompiled(GLuint shader);
+	// Tests whether vertex/fragment programs link
+	bool IsValidProgram(GLuint program);
+
+	// Depth buffer of each framebuffer
+	std::unordered_map<unsigned, GLuint> mDepthBuffers;
+};
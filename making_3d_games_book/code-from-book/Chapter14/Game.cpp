@@ -11,6 +11,7 @@
 #include "Renderer.h"
 #include "AudioSystem.h"
 #include "PhysWorld.h"
+#include "DynamicsWorld.h"
 #include "Actor.h"
 #include "UIScreen.h"
 #include "HUD.h"
@@ -19,6 +20,8 @@
 #include "PlaneActor.h"
 #include "TargetActor.h"
 #include "BallActor.h"
+#include "BallMove.h"
+#include "RigidBodyComponent.h"
 #include "PauseMenu.h"
 #include <SDL/SDL.h>
 #include <SDL/SDL_ttf.h>
@@ -28,20 +31,56 @@
 #include "Animation.h"
 #include "PointLightComponent.h"
 #include "LevelLoader.h"
+#include "Benchmark.h"
+#include "Profiler.h"
+#include "TransformStore.h"
+#include "ComponentSystem.h"
+#include "JobSystem.h"
+#include "CommandBuffer.h"
+#include "PoolAllocator.h"
+#include "FrameAllocator.h"
+#include "HeapStats.h"
+#include <thread>
+
+// Simulate at a fixed 60 Hz
+const float Game::FixedStep = 1.0f / 60.0f;
+const int Game::MaxStepsPerFrame = 5;
+// Actors per job when updating in parallel
+const size_t Game::ActorGrainSize = 64;
 
 Game::Game()
-:mRenderer(nullptr)
+:mFreeSlot(InvalidSlot)
+,mRenderer(nullptr)
 ,mAudioSystem(nullptr)
 ,mPhysWorld(nullptr)
+,mDynamicsWorld(nullptr)
+,mTransforms(nullptr)
+,mComponentSystem(nullptr)
+,mJobSystem(nullptr)
+,mCommands(nullptr)
+,mHUD(nullptr)
+,mStepTicks(0)
+,mLastCounter(0)
+,mAccumulator(0)
 ,mGameState(EGameplay)
 ,mUpdatingActors(false)
+,mHeadless(false)
+,mLevelFile("Assets/Level3.gplevel")
+,mBatchComponents(false)
+,mUpdatingInParallel(false)
+,mNumThreads(1)
+,mFrameHeapAllocs(0)
+,mFollowActor(nullptr)
 {
 	
 }
 
-bool Game::Initialize()
+bool Game::Initialize(bool headless)
 {
-	if (SDL_Init(SDL_INIT_VIDEO|SDL_INIT_AUDIO) != 0)
+	mHeadless = headless;
+	// Headless only needs events (for input and quit)
+	Uint32 flags = mHeadless ? SDL_INIT_EVENTS : SDL_INIT_VIDEO|SDL_INIT_AUDIO;
+	if (SDL_Init(flags) != 0)
 	{
 		SDL_Log("Unable to initialize SDL: %s", SDL_GetError());
 		return false;
@@ -68,11 +107,10 @@ bool Game::Initialize()
 		return false;
 	}
 
-	// Create the physics world
-	mPhysWorld = new PhysWorld(this);
+	CreateSimulation();
 	
 	// Initialize SDL_ttf
-	if (TTF_Init() != 0)
+	if (!mHeadless && TTF_Init() != 0)
 	{
 		SDL_Log("Failed to initialize SDL_ttf");
 		return false;
@@ -80,23 +118,128 @@ bool Game::Initialize()
 
 	LoadData();
 
-	mTicksCount = SDL_GetTicks();
+	// Convert the fixed step into performance counter ticks
+	mStepTicks = static_cast<Uint64>(SDL_GetPerformanceFrequency() *
+		static_cast<double>(FixedStep));
+	mLastCounter = SDL_GetPerformanceCounter();
+	mAccumulator = 0;
 	
 	return true;
 }
 
+bool Game::InitializeSimulation()
+{
+	mHeadless = true;
+	// Nothing here needs any SDL subsystems
+	if (SDL_Init(0) != 0)
+	{
+		SDL_Log("Unable to initialize SDL: %s", SDL_GetError());
+		return false;
+	}
+	CreateSimulation();
+	return true;
+}
+
+void Game::CreateSimulation()
+{
+	// Create the physics world, and the rigid bodies moving in it
+	mPhysWorld = new PhysWorld(this);
+	mDynamicsWorld = new DynamicsWorld(this);
+
+	// Create the store for actor transforms
+	mTransforms = new TransformStore();
+
+	// Create the pools for batched component updates
+	mComponentSystem = new ComponentSystem();
+
+	// Start the job threads, and the buffer for changes made on them
+	mJobSystem = new JobSystem();
+	mJobSystem->Initialize(mNumThreads);
+	mCommands = new CommandBuffer();
+	mCommands->Initialize(mJobSystem->GetNumThreads());
+}
+
 void Game::RunLoop()
 {
 	while (mGameState != EQuit)
 	{
+		Uint64 allocs = HeapStats::GetNumAllocs();
 		ProcessInput();
-		UpdateGame();
+		AdvanceSimulation();
 		GenerateOutput();
+		// Done with this frame's scratch memory
+		FrameAllocator::ResetAll();
+		mFrameHeapAllocs = HeapStats::GetNumAllocs() - allocs;
+		WaitForNextStep();
+		Profiler::MarkFrame();
 	}
 }
 
+void Game::RunBenchmark(Benchmark* bench)
+{
+	bench->SetLevelName(mLevelFile);
+	float deltaTime = bench->GetDeltaTime();
+	for (int i = 0; i < bench->GetNumFrames() && mGameState != EQuit; i++)
+	{
+		// Same as a frame with one simulation step in it,
+		// but with each phase timed separately
+		bench->BeginFrame();
+
+		bench->BeginPhase(Benchmark::EProcessInput);
+		ProcessInput();
+		bench->EndPhase();
+
+		bench->BeginPhase(Benchmark::EUpdateActors);
+		SnapshotTransforms();
+		if (mGameState == EGameplay)
+		{
+			UpdateActors(deltaTime);
+		}
+		bench->EndPhase();
+
+		bench->BeginPhase(Benchmark::EPendingActors);
+		if (mGameState == EGameplay)
+		{
+			UpdatePendingActors();
+		}
+		bench->EndPhase();
+
+		bench->BeginPhase(Benchmark::EPhysics);
+		if (mGameState == EGameplay)
+		{
+			UpdateCollisions();
+			mDynamicsWorld->Step(deltaTime);
+		}
+		bench->EndPhase();
+
+		bench->BeginPhase(Benchmark::EAudioUpdate);
+		mAudioSystem->Update(deltaTime);
+		bench->EndPhase();
+
+		bench->BeginPhase(Benchmark::EUIUpdate);
+		UpdateUI(deltaTime);
+		bench->EndPhase();
+
+		bench->BeginPhase(Benchmark::EDrawExtract);
+		GenerateOutput();
+		bench->EndPhase();
+		const CullStats& cull = mRenderer->GetCullStats();
+		bench->AddCullSample(
+			cull.mMeshesTested + cull.mSkeletalTested + cull.mPointLightsTested,
+			cull.mMeshesVisible + cull.mSkeletalVisible + cull.mPointLightsVisible);
+		bench->AddRenderSample(mRenderer->GetRenderStats());
+
+		FrameAllocator::ResetAll();
+		bench->EndFrame();
+		Profiler::MarkFrame();
+	}
+	bench->SetNumActors(mActors.size());
+	bench->SetNumThreads(mJobSystem->GetNumThreads());
+}
+
 void Game::ProcessInput()
 {
+	PROFILE_SCOPE("Game::ProcessInput");
 	SDL_Event event;
 	while (SDL_PollEvent(&event))
 	{
@@ -195,6 +338,24 @@ void Game::HandleKeyPress(int key)
 		LevelLoader::SaveLevel(this, "Assets/Saved.gplevel");
 		break;
 	}
+	case 'p':
+	{
+		// Dump profiler zones, recent frame times and pool usage
+		Profiler::WriteTrace("Profile.json");
+		Profiler::LogFrameHistogram();
+		Actor::GetPool().LogStats();
+		Component::GetPool().LogStats();
+		SDL_Log("Heap allocations last frame: %llu",
+			static_cast<unsigned long long>(mFrameHeapAllocs));
+		break;
+	}
+	case 'b':
+	{
+		// Toggle batched component updates
+		mBatchComponents = !mBatchComponents;
+		SDL_Log("Batched component updates %s", mBatchComponents ? "on" : "off");
+		break;
+	}
 	case SDL_BUTTON_LEFT:
 	{
 		break;
@@ -204,58 +365,198 @@ void Game::HandleKeyPress(int key)
 	}
 }
 
-void Game::UpdateGame()
+void Game::AdvanceSimulation()
 {
-	// Compute delta time
-	// Wait until 16ms has elapsed since last frame
-	while (!SDL_TICKS_PASSED(SDL_GetTicks(), mTicksCount + 16))
-		;
+	// Accumulate the time elapsed since the last frame
+	Uint64 now = SDL_GetPerformanceCounter();
+	mAccumulator += now - mLastCounter;
+	mLastCounter = now;
 
-	float deltaTime = (SDL_GetTicks() - mTicksCount) / 1000.0f;
-	if (deltaTime > 0.05f)
+	// Run fixed steps until the simulation catches up to real time
+	int steps = 0;
+	while (mAccumulator >= mStepTicks && steps < MaxStepsPerFrame)
 	{
-		deltaTime = 0.05f;
+		UpdateGame(FixedStep);
+		mAccumulator -= mStepTicks;
+		steps++;
 	}
-	mTicksCount = SDL_GetTicks();
+
+	// If we still haven't caught up (such as after a long stall),
+	// drop the excess rather than spiral trying to catch up
+	if (mAccumulator >= mStepTicks)
+	{
+		mAccumulator %= mStepTicks;
+	}
+}
+
+void Game::UpdateGame(float deltaTime)
+{
+	PROFILE_SCOPE("Game::UpdateGame");
+	SnapshotTransforms();
 
 	if (mGameState == EGameplay)
 	{
-		// Update all actors
-		mUpdatingActors = true;
-		for (auto actor : mActors)
+		StepSimulation(deltaTime);
+	}
+	
+	// Update audio system
+	mAudioSystem->Update(deltaTime);
+	
+	UpdateUI(deltaTime);
+}
+
+void Game::StepSimulation(float deltaTime)
+{
+	UpdateActors(deltaTime);
+	UpdatePendingActors();
+	UpdateCollisions();
+	mDynamicsWorld->Step(deltaTime);
+}
+
+void Game::SnapshotTransforms()
+{
+	// Remember where everything was at the start of this step,
+	// so rendering can interpolate between steps
+	mTransforms->SnapshotTransforms();
+	mRenderer->SnapshotView();
+}
+
+void Game::UpdateActors(float deltaTime)
+{
+	// Pick up any transform changes since the last update
+	mTransforms->UpdateWorldTransforms();
+
+	// Update all actors (spread across the job threads)
+	mUpdatingActors = true;
+	mUpdatingInParallel = mJobSystem->GetNumThreads() > 1;
+	if (mBatchComponents)
+	{
+		// All the components first, one type at a time,
+		// then any actor-specific updates
+		mComponentSystem->Update(deltaTime, mJobSystem);
+		mJobSystem->ParallelFor(mActors.size(), ActorGrainSize,
+			[this, deltaTime](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++)
+			{
+				if (mActors[i]->GetState() == Actor::EActive)
+				{
+					mActors[i]->UpdateActor(deltaTime);
+				}
+			}
+		});
+	}
+	else
+	{
+		mJobSystem->ParallelFor(mActors.size(), ActorGrainSize,
+			[this, deltaTime](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++)
+			{
+				mActors[i]->Update(deltaTime);
+			}
+		});
+	}
+	mUpdatingInParallel = false;
+
+	// Sync point, so apply any changes deferred during the update
+	// (new actors still go in pending)
+	mCommands->Execute();
+	mUpdatingActors = false;
+}
+
+void Game::UpdatePendingActors()
+{
+	// Move any pending actors to mActors
+	for (auto pending : mPendingActors)
+	{
+		pending->mIsPending = false;
+		pending->mGameIndex = mActors.size();
+		mActors.emplace_back(pending);
+	}
+	mPendingActors.clear();
+
+	// Add any dead actors to a temp vector
+	FrameVector<Actor*> deadActors;
+	for (auto actor : mActors)
+	{
+		if (actor->GetState() == Actor::EDead)
 		{
-			actor->Update(deltaTime);
+			deadActors.emplace_back(actor);
 		}
-		mUpdatingActors = false;
+	}
+
+	// Delete dead actors (which removes them from mActors)
+	for (auto actor : deadActors)
+	{
+		delete actor;
+	}
 
-		// Move any pending actors to mActors
-		for (auto pending : mPendingActors)
+	// Recompute the world transforms of everything that moved
+	// (including the new actors)
+	mTransforms->UpdateWorldTransforms();
+}
+
+void Game::UpdateCollisions()
+{
+	PROFILE_SCOPE("Game::UpdateCollisions");
+	// Balls that hit something else that moved (BallMove's own
+	// sweep treats everything as standing still, and skips other
+	// balls), which has to happen before the broadphase forgets
+	// where everything started the step
+	bool moved = false;
+	mPhysWorld->TestContinuous([&moved](const PhysWorld::ContinuousHit& hit) {
+		BallMove* a = static_cast<BallMove*>(
+			hit.mActorA->GetComponentOfType(Component::TBallMove));
+		BallMove* b = static_cast<BallMove*>(
+			hit.mActorB->GetComponentOfType(Component::TBallMove));
+		if (a && b)
 		{
-			pending->ComputeWorldTransform();
-			mActors.emplace_back(pending);
+			a->BounceOff(hit.mNormal, hit.mDeltaA, hit.mT);
+			b->BounceOff(hit.mNormal * -1.0f, hit.mDeltaB, hit.mT);
+			moved = true;
 		}
-		mPendingActors.clear();
+	});
+	if (moved)
+	{
+		mTransforms->UpdateWorldTransforms();
+	}
 
-		// Add any dead actors to a temp vector
-		std::vector<Actor*> deadActors;
-		for (auto actor : mActors)
+	// Re-sort the boxes that moved in the broadphase
+	mPhysWorld->UpdateBroadphase();
+
+	// Something that starts touching a sleeping body wakes it up.
+	// Bodies wake each other, but the dynamics world never sees
+	// anything without a body (such as a ball) run into one.
+	mPhysWorld->TestOverlaps([](Actor* a, Actor* b, PhysWorld::OverlapEvent event) {
+		if (event != PhysWorld::EBegin)
+		{
+			return;
+		}
+		for (Actor* actor : { a, b })
 		{
-			if (actor->GetState() == Actor::EDead)
+			RigidBodyComponent* body = static_cast<RigidBodyComponent*>(
+				actor->GetComponentOfType(Component::TRigidBodyComponent));
+			if (body && !body->IsAwake())
 			{
-				deadActors.emplace_back(actor);
+				body->Wake();
 			}
 		}
+	});
 
-		// Delete dead actors (which removes them from mActors)
-		for (auto actor : deadActors)
+	// Let trigger boxes' actors know what came and went
+	mPhysWorld->TestTriggers([](Actor* trigger, Actor* other, PhysWorld::OverlapEvent event) {
+		if (event == PhysWorld::EBegin)
 		{
-			delete actor;
+			trigger->OnTriggerEnter(other);
 		}
-	}
-	
-	// Update audio system
-	mAudioSystem->Update(deltaTime);
-	
+		else if (event == PhysWorld::EEnd)
+		{
+			trigger->OnTriggerExit(other);
+		}
+	});
+}
+
+void Game::UpdateUI(float deltaTime)
+{
 	// Update UI screens
 	for (auto ui : mUIStack)
 	{
@@ -282,7 +583,38 @@ void Game::UpdateGame()
 
 void Game::GenerateOutput()
 {
-	mRenderer->Draw();
+	PROFILE_SCOPE("Game::GenerateOutput");
+	// How far (as a fraction of a step) real time is past the simulation
+	float alpha = static_cast<float>(mAccumulator) /
+		static_cast<float>(mStepTicks);
+
+	// Blend each actor between its last two simulated transforms
+	mTransforms->ComputeRenderTransforms(alpha);
+	mRenderer->Draw(alpha);
+}
+
+void Game::WaitForNextStep()
+{
+	// Ticks left until the next simulation step is due
+	Uint64 elapsed = mAccumulator + (SDL_GetPerformanceCounter() - mLastCounter);
+	if (elapsed >= mStepTicks)
+	{
+		return;
+	}
+	Uint64 remaining = mStepTicks - elapsed;
+
+	// Sleep through most of the wait (SDL_Delay is only millisecond accurate)
+	Uint32 ms = static_cast<Uint32>(remaining * 1000 / SDL_GetPerformanceFrequency());
+	if (ms > 1)
+	{
+		SDL_Delay(ms - 1);
+	}
+
+	// Yield away whatever is left
+	while (mAccumulator + (SDL_GetPerformanceCounter() - mLastCounter) < mStepTicks)
+	{
+		std::this_thread::yield();
+	}
 }
 
 void Game::LoadData()
@@ -293,15 +625,21 @@ void Game::LoadData()
 	mHUD = new HUD(this);
 
 	// Load the level from file
-	LevelLoader::LoadLevel(this, "Assets/Level3.gplevel");
+	if (!mLevelFile.empty())
+	{
+		LevelLoader::LoadLevel(this, mLevelFile);
+	}
 	
 	// Start music
 	mMusicEvent = mAudioSystem->PlayEvent("event:/Music");
 
 	// Enable relative mouse mode for camera look
-	SDL_SetRelativeMouseMode(SDL_TRUE);
-	// Make an initial call to get relative to clear out
-	SDL_GetRelativeMouseState(nullptr, nullptr);
+	if (!mHeadless)
+	{
+		SDL_SetRelativeMouseMode(SDL_TRUE);
+		// Make an initial call to get relative to clear out
+		SDL_GetRelativeMouseState(nullptr, nullptr);
+	}
 }
 
 void Game::UnloadData()
@@ -348,8 +686,20 @@ void Game::UnloadData()
 void Game::Shutdown()
 {
 	UnloadData();
-	TTF_Quit();
+	if (!mHeadless)
+	{
+		TTF_Quit();
+	}
+	delete mDynamicsWorld;
 	delete mPhysWorld;
+	delete mTransforms;
+	delete mComponentSystem;
+	delete mCommands;
+	if (mJobSystem)
+	{
+		mJobSystem->Shutdown();
+		delete mJobSystem;
+	}
 	if (mRenderer)
 	{
 		mRenderer->Shutdown();
@@ -363,36 +713,78 @@ void Game::Shutdown()
 
 void Game::AddActor(Actor* actor)
 {
-	// If we're updating actors, need to add to pending
-	if (mUpdatingActors)
+	// Job threads need to create actors through the command buffer
+	SDL_assert(!mUpdatingInParallel);
+
+	// Give the actor a slot in the registry (reusing a free one if possible)
+	uint32_t index = mFreeSlot;
+	if (index != InvalidSlot)
 	{
-		mPendingActors.emplace_back(actor);
+		mFreeSlot = mActorSlots[index].mNextFree;
 	}
 	else
 	{
-		mActors.emplace_back(actor);
+		index = static_cast<uint32_t>(mActorSlots.size());
+		ActorSlot slot;
+		slot.mGeneration = 1;
+		mActorSlots.emplace_back(slot);
 	}
+	ActorSlot& slot = mActorSlots[index];
+	slot.mActor = actor;
+	slot.mNextFree = InvalidSlot;
+	actor->mHandle = ActorHandle(index, slot.mGeneration);
+
+	// If we're updating actors, need to add to pending
+	std::vector<Actor*>& actors = mUpdatingActors ? mPendingActors : mActors;
+	actor->mIsPending = mUpdatingActors;
+	actor->mGameIndex = actors.size();
+	actors.emplace_back(actor);
 }
 
 void Game::RemoveActor(Actor* actor)
 {
-	// Is it in pending actors?
-	auto iter = std::find(mPendingActors.begin(), mPendingActors.end(), actor);
-	if (iter != mPendingActors.end())
-	{
-		// Swap to end of vector and pop off (avoid erase copies)
-		std::iter_swap(iter, mPendingActors.end() - 1);
-		mPendingActors.pop_back();
+	// Swap the last actor into this one's place and pop off
+	// (avoids the erase copies, and the search to find it)
+	std::vector<Actor*>& actors = actor->mIsPending ? mPendingActors : mActors;
+	size_t index = actor->mGameIndex;
+	if (index < actors.size() && actors[index] == actor)
+	{
+		Actor* last = actors.back();
+		actors[index] = last;
+		last->mGameIndex = index;
+		actors.pop_back();
+	}
+
+	// Free the slot, and bump its generation so old handles go stale
+	uint32_t slotIndex = actor->mHandle.mIndex;
+	if (slotIndex < mActorSlots.size() &&
+		mActorSlots[slotIndex].mActor == actor)
+	{
+		ActorSlot& slot = mActorSlots[slotIndex];
+		slot.mActor = nullptr;
+		slot.mGeneration++;
+		// Never hand out generation 0 (that's the invalid handle)
+		if (slot.mGeneration == 0)
+		{
+			slot.mGeneration = 1;
+		}
+		slot.mNextFree = mFreeSlot;
+		mFreeSlot = slotIndex;
 	}
+	actor->mHandle = ActorHandle();
+}
 
-	// Is it in actors?
-	iter = std::find(mActors.begin(), mActors.end(), actor);
-	if (iter != mActors.end())
+Actor* Game::GetActor(const ActorHandle& handle) const
+{
+	if (handle.mIndex < mActorSlots.size())
 	{
-		// Swap to end of vector and pop off (avoid erase copies)
-		std::iter_swap(iter, mActors.end() - 1);
-		mActors.pop_back();
+		const ActorSlot& slot = mActorSlots[handle.mIndex];
+		if (slot.mGeneration == handle.mGeneration)
+		{
+			return slot.mActor;
+		}
 	}
+	return nullptr;
 }
 
 void Game::PushUI(UIScreen* screen)
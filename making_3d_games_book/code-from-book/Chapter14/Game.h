@@ -12,22 +12,59 @@
 #include <vector>
 #include "Math.h"
 #include "SoundEvent.h"
+#include "ActorHandle.h"
 #include <SDL/SDL_types.h>
 
 class Game
 {
 public:
 	Game();
-	bool Initialize();
+	// A headless game has no window, GL context, audio or fonts
+	bool Initialize(bool headless = false);
+	// Just the simulation (actors, transforms, physics and jobs), with
+	// no renderer, audio, UI or level, for benchmarks and self tests
+	bool InitializeSimulation();
 	void RunLoop();
+	// Run the benchmark's number of frames with its fixed time step,
+	// timing each phase of every frame
+	void RunBenchmark(class Benchmark* bench);
+	// One gameplay step of just the simulation: actors, collisions
+	// and dynamics (what UpdateGame does, less input, audio and UI)
+	void StepSimulation(float deltaTime);
 	void Shutdown();
 
+	bool IsHeadless() const { return mHeadless; }
+
+	// Level that Initialize loads (call before Initialize,
+	// and an empty name starts with no level at all)
+	void SetLevelFile(const std::string& fileName) { mLevelFile = fileName; }
+	const std::string& GetLevelFile() const { return mLevelFile; }
+
+	// Update components in per-type batches (see ComponentSystem),
+	// rather than each actor updating its own components
+	void SetBatchComponents(bool batch) { mBatchComponents = batch; }
+	bool GetBatchComponents() const { return mBatchComponents; }
+
+	// Number of threads to update actors on (call before Initialize,
+	// 0 means one per hardware thread)
+	void SetNumThreads(unsigned numThreads) { mNumThreads = numThreads; }
+	// While this is true, actors are updating on job threads, so
+	// structural changes must go through the command buffer
+	bool IsUpdatingInParallel() const { return mUpdatingInParallel; }
+
 	void AddActor(class Actor* actor);
 	void RemoveActor(class Actor* actor);
+	// Returns null if the handle's actor has been deleted
+	class Actor* GetActor(const ActorHandle& handle) const;
 
 	class Renderer* GetRenderer() { return mRenderer; }
 	class AudioSystem* GetAudioSystem() { return mAudioSystem; }
 	class PhysWorld* GetPhysWorld() { return mPhysWorld; }
+	class DynamicsWorld* GetDynamicsWorld() { return mDynamicsWorld; }
+	class TransformStore* GetTransformStore() { return mTransforms; }
+	class ComponentSystem* GetComponentSystem() { return mComponentSystem; }
+	class JobSystem* GetJobSystem() { return mJobSystem; }
+	class CommandBuffer* GetCommandBuffer() { return mCommands; }
 	class HUD* GetHUD() { return mHUD; }
 	
 	// Manage UI stack
@@ -60,8 +97,22 @@ public:
 private:
 	void ProcessInput();
 	void HandleKeyPress(int key);
-	void UpdateGame();
+	// Runs as many fixed simulation steps as have elapsed
+	void AdvanceSimulation();
+	// Advance the game simulation by one fixed step
+	void UpdateGame(float deltaTime);
+	// The phases of UpdateGame
+	void SnapshotTransforms();
+	void UpdateActors(float deltaTime);
+	void UpdatePendingActors();
+	// Update the broadphase, and act on what hit what
+	void UpdateCollisions();
+	void UpdateUI(float deltaTime);
 	void GenerateOutput();
+	// Sleep/yield until the next simulation step is due
+	void WaitForNextStep();
+	// Create the systems every game has (including simulation-only ones)
+	void CreateSimulation();
 	void LoadData();
 	void UnloadData();
 	
@@ -80,15 +131,53 @@ private:
 	// Any pending actors
 	std::vector<class Actor*> mPendingActors;
 
+	// Registry of every actor (active or pending), indexed by handle
+	struct ActorSlot
+	{
+		class Actor* mActor;
+		uint32_t mGeneration;
+		// Next free slot (if this one is free)
+		uint32_t mNextFree;
+	};
+	std::vector<ActorSlot> mActorSlots;
+	// First free slot, or InvalidSlot if none are free
+	uint32_t mFreeSlot;
+	static const uint32_t InvalidSlot = 0xFFFFFFFF;
+
 	class Renderer* mRenderer;
 	class AudioSystem* mAudioSystem;
 	class PhysWorld* mPhysWorld;
+	class DynamicsWorld* mDynamicsWorld;
+	class TransformStore* mTransforms;
+	class ComponentSystem* mComponentSystem;
+	class JobSystem* mJobSystem;
+	class CommandBuffer* mCommands;
 	class HUD* mHUD;
 
-	Uint32 mTicksCount;
+	// Fixed simulation step (in seconds and in performance counter ticks)
+	static const float FixedStep;
+	Uint64 mStepTicks;
+	// Most steps to run in one frame before dropping time
+	static const int MaxStepsPerFrame;
+	// Performance counter value at the last frame
+	Uint64 mLastCounter;
+	// Elapsed time not yet consumed by simulation steps (in ticks)
+	Uint64 mAccumulator;
 	GameState mGameState;
 	// Track if we're updating actors right now
 	bool mUpdatingActors;
+	// Running without a window/GL/audio/fonts?
+	bool mHeadless;
+	std::string mLevelFile;
+	// Updating components in per-type batches?
+	bool mBatchComponents;
+	// Updating actors on job threads right now?
+	bool mUpdatingInParallel;
+	unsigned mNumThreads;
+	static const size_t ActorGrainSize;
+	// General heap allocations in the last frame (should be 0 once
+	// everything's warmed up)
+	Uint64 mFrameHeapAllocs;
 
 	// Game-specific code
 	class FollowActor* mFollowActor;
@@ -16,6 +16,7 @@
 #include <algorithm>
 #include "GBuffer.h"
 #include "TargetComponent.h"
+#include "BoxComponent.h"
 
 HUD::HUD(Game* game)
 	:UIScreen(game)
@@ -70,16 +71,22 @@ void HUD::Draw(Shader* shader)
 	//DrawTexture(shader, tex, Vector2::Zero, 1.0f, true);
 }
 
-void HUD::AddTargetComponent(TargetComponent* tc)
+void HUD::AddTarget(const ActorHandle& target)
 {
-	mTargetComps.emplace_back(tc);
+	mTargets.emplace_back(target);
+	// Room for a blip per target, so UpdateRadar doesn't allocate
+	mBlips.reserve(mTargets.size());
 }
 
-void HUD::RemoveTargetComponent(TargetComponent* tc)
+void HUD::RemoveTarget(const ActorHandle& target)
 {
-	auto iter = std::find(mTargetComps.begin(), mTargetComps.end(),
-		tc);
-	mTargetComps.erase(iter);
+	auto iter = std::find(mTargets.begin(), mTargets.end(), target);
+	if (iter != mTargets.end())
+	{
+		// Order doesn't matter, so swap the last one in and pop off
+		*iter = mTargets.back();
+		mTargets.pop_back();
+	}
 }
 
 void HUD::UpdateCrosshair(float deltaTime)
@@ -91,18 +98,14 @@ void HUD::UpdateCrosshair(float deltaTime)
 	Vector3 start, dir;
 	mGame->GetRenderer()->GetScreenDirection(start, dir);
 	LineSegment l(start, start + dir * cAimDist);
-	// Segment cast
+	// Segment cast (past any balls in flight)
 	PhysWorld::CollisionInfo info;
-	if (mGame->GetPhysWorld()->SegmentCast(l, info))
+	if (mGame->GetPhysWorld()->SegmentCast(l, info, BoxComponent::DefaultLayer))
 	{
 		// Is this a target?
-		for (auto tc : mTargetComps)
+		if (info.mActor->GetComponentOfType(Component::TTargetComponent))
 		{
-			if (tc->GetOwner() == info.mActor)
-			{
-				mTargetEnemy = true;
-				break;
-			}
+			mTargetEnemy = true;
 		}
 	}
 }
@@ -125,9 +128,9 @@ void HUD::UpdateRadar(float deltaTime)
 	Matrix3 rotMat = Matrix3::CreateRotation(angle);
 	
 	// Get positions of blips
-	for (auto tc : mTargetComps)
+	for (const ActorHandle& handle : mTargets)
 	{
-		Vector3 targetPos = tc->GetOwner()->GetPosition();
+		Vector3 targetPos = mGame->GetActor(handle)->GetPosition();
 		Vector2 actorPos2D(targetPos.y, targetPos.x);
 		
 		// Calculate vector between player and target
@@ -8,6 +8,7 @@
 
 #pragma once
 #include "UIScreen.h"
+#include "ActorHandle.h"
 #include <vector>
 
 class HUD : public UIScreen
@@ -20,8 +21,9 @@ public:
 	void Update(float deltaTime) override;
 	void Draw(class Shader* shader) override;
 	
-	void AddTargetComponent(class TargetComponent* tc);
-	void RemoveTargetComponent(class TargetComponent* tc);
+	// Add/remove an actor to show on the radar
+	void AddTarget(const ActorHandle& target);
+	void RemoveTarget(const ActorHandle& target);
 protected:
 	void UpdateCrosshair(float deltaTime);
 	void UpdateRadar(float deltaTime);
@@ -33,8 +35,8 @@ protected:
 	class Texture* mBlipTex;
 	class Texture* mRadarArrow;
 	
-	// All the target components in the game
-	std::vector<class TargetComponent*> mTargetComps;
+	// All the targets in the game (in no particular order)
+	std::vector<ActorHandle> mTargets;
 	// 2D offsets of blips relative to radar
 	std::vector<Vector2> mBlips;
 	// Adjust range of radar and radius
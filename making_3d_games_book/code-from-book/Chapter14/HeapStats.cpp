@@ -0,0 +1,104 @@
+// ----------------------------------------------------------------
+// From Game Programming in C++ by Sanjay Madhav
+// Copyright (C) 2017 Sanjay Madhav. All rights reserved.
+// 
+// Released under the BSD License
+// See LICENSE in root directory for full details.
+// ----------------------------------------------------------------
+
+#include "HeapStats.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+	std::atomic<Uint64> sNumAllocs(0);
+	std::atomic<Uint64> sNumFrees(0);
+
+	void* CountedAlloc(size_t size)
+	{
+		sNumAllocs.fetch_add(1, std::memory_order_relaxed);
+		// malloc(0) can return null, but new can't
+		return std::malloc(size > 0 ? size : 1);
+	}
+
+	void CountedFree(void* ptr)
+	{
+		if (ptr)
+		{
+			sNumFrees.fetch_add(1, std::memory_order_relaxed);
+			std::free(ptr);
+		}
+	}
+}
+
+Uint64 HeapStats::GetNumAllocs()
+{
+	return sNumAllocs.load(std::memory_order_relaxed);
+}
+
+Uint64 HeapStats::GetNumFrees()
+{
+	return sNumFrees.load(std::memory_order_relaxed);
+}
+
+void* operator new(size_t size)
+{
+	void* ptr = CountedAlloc(size);
+	if (ptr == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void* operator new[](size_t size)
+{
+	void* ptr = CountedAlloc(size);
+	if (ptr == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return CountedAlloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return CountedAlloc(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+	CountedFree(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+	CountedFree(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+	CountedFree(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+	CountedFree(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+	CountedFree(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+	CountedFree(ptr);
+}
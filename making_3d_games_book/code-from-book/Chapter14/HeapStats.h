@@ -0,0 +1,21 @@
+// ----------------------------------------------------------------
+// From Game Programming in C++ by Sanjay Madhav
+// Copyright (C) 2017 Sanjay Madhav. All rights reserved.
+// 
+// Released under the BSD License
+// See LICENSE in root directory for full details.
+// ----------------------------------------------------------------
+
+#pragma once
+#include <SDL/SDL_types.h>
+
+// Counts general heap allocations. HeapStats.cpp replaces the global
+// operator new/delete to do this, so the counts cover everything
+// (including STL containers).
+class HeapStats
+{
+public:
+	// Total allocations/frees since the program started
+	static Uint64 GetNumAllocs();
+	static Uint64 GetNumFrees();
+};
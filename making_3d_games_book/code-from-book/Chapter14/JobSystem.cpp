@@ -0,0 +1,282 @@
+// ----------------------------------------------------------------
+// From Game Programming in C++ by Sanjay Madhav
+// Copyright (C) 2017 Sanjay Madhav. All rights reserved.
+// 
+// Released under the BSD License
+// See LICENSE in root directory for full details.
+// ----------------------------------------------------------------
+
+#include "JobSystem.h"
+#include "Profiler.h"
+#include <SDL/SDL_log.h>
+
+namespace
+{
+	thread_local unsigned tThreadIndex = 0;
+}
+
+JobSystem::JobSystem()
+	:mNumThreads(1)
+	,mNumQueued(0)
+	,mQuit(false)
+{
+}
+
+JobSystem::~JobSystem()
+{
+	Shutdown();
+}
+
+void JobSystem::Initialize(unsigned numThreads)
+{
+	if (numThreads == 0)
+	{
+		numThreads = std::thread::hardware_concurrency();
+		if (numThreads == 0)
+		{
+			numThreads = 1;
+		}
+	}
+	mNumThreads = numThreads;
+	mQuit = false;
+
+	for (unsigned i = 0; i < mNumThreads; i++)
+	{
+		mQueues.emplace_back(new JobQueue());
+	}
+	// The calling thread is thread 0, so start the rest
+	for (unsigned i = 1; i < mNumThreads; i++)
+	{
+		mThreads.emplace_back(&JobSystem::WorkerLoop, this, i);
+	}
+	SDL_Log("Job system running on %u threads", mNumThreads);
+}
+
+void JobSystem::Shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock(mWakeMutex);
+		mQuit = true;
+	}
+	mWakeCond.notify_all();
+	for (auto& t : mThreads)
+	{
+		t.join();
+	}
+	mThreads.clear();
+	mQueues.clear();
+	mNumThreads = 1;
+}
+
+unsigned JobSystem::GetThreadIndex()
+{
+	return tThreadIndex;
+}
+
+void JobSystem::Run(JobFunc func, JobCounter* counter, const JobCounter* dependency)
+{
+	if (counter)
+	{
+		counter->mCount.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	// Add to the back of this thread's queue
+	JobQueue& queue = *mQueues[tThreadIndex];
+	{
+		std::lock_guard<std::mutex> lock(queue.mMutex);
+		Job job;
+		job.mFunc = std::move(func);
+		job.mCounter = counter;
+		job.mDependency = dependency;
+		queue.PushBack(std::move(job));
+	}
+
+	// Wake up a worker to take it
+	{
+		std::lock_guard<std::mutex> lock(mWakeMutex);
+		mNumQueued.fetch_add(1, std::memory_order_relaxed);
+	}
+	mWakeCond.notify_one();
+}
+
+void JobSystem::Wait(const JobCounter& counter)
+{
+	// Help out rather than block
+	while (!counter.IsDone())
+	{
+		if (!RunOneJob(tThreadIndex))
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+void JobSystem::ParallelFor(size_t count, size_t grainSize,
+	const std::function<void(size_t begin, size_t end)>& func)
+{
+	if (grainSize == 0)
+	{
+		grainSize = 1;
+	}
+	if (mNumThreads == 1 || count <= grainSize)
+	{
+		func(0, count);
+		return;
+	}
+
+	// The jobs only capture a pointer to this and where they start,
+	// which is small enough that std::function doesn't allocate
+	// (this outlives the jobs, since it waits for them)
+	struct Range
+	{
+		const std::function<void(size_t begin, size_t end)>* mFunc;
+		size_t mCount;
+		size_t mGrainSize;
+	};
+	Range range;
+	range.mFunc = &func;
+	range.mCount = count;
+	range.mGrainSize = grainSize;
+
+	JobCounter counter;
+	for (size_t begin = 0; begin < count; begin += grainSize)
+	{
+		const Range* r = &range;
+		Run([r, begin] {
+			size_t end = begin + r->mGrainSize;
+			(*r->mFunc)(begin, end < r->mCount ? end : r->mCount);
+		}, &counter);
+	}
+	Wait(counter);
+}
+
+void JobSystem::WorkerLoop(unsigned index)
+{
+	tThreadIndex = index;
+	while (!mQuit)
+	{
+		if (!RunOneJob(index))
+		{
+			// Sleep until there's something in a queue
+			std::unique_lock<std::mutex> lock(mWakeMutex);
+			mWakeCond.wait(lock, [this] {
+				return mQuit || mNumQueued.load(std::memory_order_relaxed) > 0;
+			});
+		}
+	}
+}
+
+bool JobSystem::RunOneJob(unsigned index)
+{
+	Job job;
+	if (!PopJob(index, job) && !StealJob(index, job))
+	{
+		return false;
+	}
+
+	// If it's waiting on other jobs, put it back for later
+	if (job.mDependency && !job.mDependency->IsDone())
+	{
+		JobQueue& queue = *mQueues[index];
+		{
+			std::lock_guard<std::mutex> lock(queue.mMutex);
+			queue.PushFront(std::move(job));
+		}
+		mNumQueued.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	{
+		PROFILE_SCOPE("Job");
+		job.mFunc();
+	}
+	if (job.mCounter)
+	{
+		job.mCounter->mCount.fetch_sub(1, std::memory_order_release);
+	}
+	return true;
+}
+
+JobSystem::JobQueue::JobQueue()
+	:mHead(0)
+	,mCount(0)
+{
+}
+
+void JobSystem::JobQueue::PushBack(Job&& job)
+{
+	if (mCount == mJobs.size())
+	{
+		Grow();
+	}
+	mJobs[(mHead + mCount) % mJobs.size()] = std::move(job);
+	mCount++;
+}
+
+void JobSystem::JobQueue::PushFront(Job&& job)
+{
+	if (mCount == mJobs.size())
+	{
+		Grow();
+	}
+	mHead = (mHead + mJobs.size() - 1) % mJobs.size();
+	mJobs[mHead] = std::move(job);
+	mCount++;
+}
+
+void JobSystem::JobQueue::PopBack(Job& outJob)
+{
+	mCount--;
+	outJob = std::move(mJobs[(mHead + mCount) % mJobs.size()]);
+}
+
+void JobSystem::JobQueue::PopFront(Job& outJob)
+{
+	outJob = std::move(mJobs[mHead]);
+	mHead = (mHead + 1) % mJobs.size();
+	mCount--;
+}
+
+void JobSystem::JobQueue::Grow()
+{
+	// Unwrap into a bigger buffer, oldest first
+	std::vector<Job> jobs(mJobs.empty() ? 64 : mJobs.size() * 2);
+	for (size_t i = 0; i < mCount; i++)
+	{
+		jobs[i] = std::move(mJobs[(mHead + i) % mJobs.size()]);
+	}
+	mJobs.swap(jobs);
+	mHead = 0;
+}
+
+bool JobSystem::PopJob(unsigned index, Job& outJob)
+{
+	// Take the newest job from our own queue (it's the most
+	// likely to still be in cache)
+	JobQueue& queue = *mQueues[index];
+	std::lock_guard<std::mutex> lock(queue.mMutex);
+	if (queue.IsEmpty())
+	{
+		return false;
+	}
+	queue.PopBack(outJob);
+	mNumQueued.fetch_sub(1, std::memory_order_relaxed);
+	return true;
+}
+
+bool JobSystem::StealJob(unsigned index, Job& outJob)
+{
+	// Take the oldest job from another thread's queue
+	for (unsigned i = 1; i < mNumThreads; i++)
+	{
+		JobQueue& queue = *mQueues[(index + i) % mNumThreads];
+		std::lock_guard<std::mutex> lock(queue.mMutex);
+		if (!queue.IsEmpty())
+		{
+			queue.PopFront(outJob);
+			mNumQueued.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+	return false;
+}
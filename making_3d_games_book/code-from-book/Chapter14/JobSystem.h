@@ -0,0 +1,104 @@
+// ----------------------------------------------------------------
+// From Game Programming in C++ by Sanjay Madhav
+// Copyright (C) 2017 Sanjay Madhav. All rights reserved.
+// 
+// Released under the BSD License
+// See LICENSE in root directory for full details.
+// ----------------------------------------------------------------
+
+#pragma once
+#include <functional>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+// Counts jobs that haven't finished yet
+class JobCounter
+{
+public:
+	JobCounter() :mCount(0) {}
+	bool IsDone() const { return mCount.load(std::memory_order_acquire) == 0; }
+private:
+	friend class JobSystem;
+	std::atomic<int> mCount;
+};
+
+// Pool of threads that each have their own queue of jobs. A thread
+// that runs out of jobs steals from the other threads' queues.
+class JobSystem
+{
+public:
+	using JobFunc = std::function<void()>;
+
+	JobSystem();
+	~JobSystem();
+
+	// Start the threads (the calling thread counts as one of them,
+	// and 0 means one per hardware thread)
+	void Initialize(unsigned numThreads = 0);
+	void Shutdown();
+
+	// Queue a job. The counter (if any) counts the job until it's
+	// finished, and the job doesn't start until the dependency
+	// counter (if any) is done.
+	void Run(JobFunc func, JobCounter* counter = nullptr,
+		const JobCounter* dependency = nullptr);
+	// Run jobs on this thread until the counter is done
+	void Wait(const JobCounter& counter);
+
+	// Call func on ranges of about grainSize from [0, count), across
+	// every thread, and return once they're all done. (With one
+	// thread, this just calls func(0, count).)
+	void ParallelFor(size_t count, size_t grainSize,
+		const std::function<void(size_t begin, size_t end)>& func);
+
+	unsigned GetNumThreads() const { return mNumThreads; }
+	// Index of the calling thread (0 is the thread that called
+	// Initialize, and any thread that isn't in the pool)
+	static unsigned GetThreadIndex();
+private:
+	struct Job
+	{
+		JobFunc mFunc;
+		JobCounter* mCounter;
+		const JobCounter* mDependency;
+	};
+	// Ring buffer of jobs. It grows but never shrinks, so once it's
+	// big enough, queueing jobs doesn't allocate.
+	struct JobQueue
+	{
+		JobQueue();
+		bool IsEmpty() const { return mCount == 0; }
+		void PushBack(Job&& job);
+		void PushFront(Job&& job);
+		void PopBack(Job& outJob);
+		void PopFront(Job& outJob);
+		void Grow();
+
+		std::mutex mMutex;
+		std::vector<Job> mJobs;
+		// Index of the oldest job
+		size_t mHead;
+		size_t mCount;
+	};
+	void WorkerLoop(unsigned index);
+	// Run one job from this thread's queue (or stolen from another
+	// thread), returns false if there wasn't one ready to run
+	bool RunOneJob(unsigned index);
+	bool PopJob(unsigned index, Job& outJob);
+	bool StealJob(unsigned index, Job& outJob);
+
+	std::vector<std::thread> mThreads;
+	// One per thread (including the main thread)
+	std::vector<std::unique_ptr<JobQueue>> mQueues;
+	unsigned mNumThreads;
+	// Jobs in every queue
+	std::atomic<int> mNumQueued;
+	// Idle workers sleep on this until there's a job
+	std::mutex mWakeMutex;
+	std::condition_variable mWakeCond;
+	std::atomic<bool> mQuit;
+};
@@ -30,6 +30,9 @@
 #include "MirrorCamera.h"
 #include "PointLightComponent.h"
 #include "TargetComponent.h"
+#include "RigidBodyComponent.h"
+#include "CharacterController.h"
+#include "Profiler.h"
 #include <rapidjson/stringbuffer.h>
 #include <rapidjson/prettywriter.h>
 
@@ -59,10 +62,13 @@ std::unordered_map<std::string, std::pair<int, ComponentFunc>> LevelLoader::sCom
 	{ "MirrorCamera", { Component::TMirrorCamera, &Component::Create<MirrorCamera> } },
 	{ "PointLightComponent", { Component::TPointLightComponent, &Component::Create<PointLightComponent> }},
 	{ "TargetComponent",{ Component::TTargetComponent, &Component::Create<TargetComponent> } },
+	{ "RigidBodyComponent", { Component::TRigidBodyComponent, &Component::Create<RigidBodyComponent> } },
+	{ "CharacterController", { Component::TCharacterController, &Component::Create<CharacterController> } },
 };
 
 bool LevelLoader::LoadLevel(Game* game, const std::string& fileName)
 {
+	PROFILE_SCOPE("LevelLoader::LoadLevel");
 	rapidjson::Document doc;
 	if (!LoadJSON(fileName, doc))
 	{
@@ -186,36 +192,60 @@ void LevelLoader::LoadActors(Game* game, const rapidjson::Value& inArray)
 	// Loop through array of actors
 	for (rapidjson::SizeType i = 0; i < inArray.Size(); i++)
 	{
-		const rapidjson::Value& actorObj = inArray[i];
-		if (actorObj.IsObject())
+		LoadActor(game, inArray[i]);
+	}
+}
+
+Actor* LevelLoader::LoadActor(Game* game, const rapidjson::Value& actorObj)
+{
+	Actor* actor = nullptr;
+	if (actorObj.IsObject())
+	{
+		// Get the type
+		std::string type;
+		if (JsonHelper::GetString(actorObj, "type", type))
 		{
-			// Get the type
-			std::string type;
-			if (JsonHelper::GetString(actorObj, "type", type))
+			// Is this type in the map?
+			auto iter = sActorFactoryMap.find(type);
+			if (iter != sActorFactoryMap.end())
 			{
-				// Is this type in the map?
-				auto iter = sActorFactoryMap.find(type);
-				if (iter != sActorFactoryMap.end())
+				// Construct with function stored in map
+				actor = iter->second(game, actorObj["properties"]);
+				// Get the actor's components
+				if (actorObj.HasMember("components"))
 				{
-					// Construct with function stored in map
-					Actor* actor = iter->second(game, actorObj["properties"]);
-					// Get the actor's components
-					if (actorObj.HasMember("components"))
+					const rapidjson::Value& components = actorObj["components"];
+					if (components.IsArray())
 					{
-						const rapidjson::Value& components = actorObj["components"];
-						if (components.IsArray())
-						{
-							LoadComponents(actor, components);
-						}
+						LoadComponents(actor, components);
 					}
 				}
-				else
+				// Get the actor's children (their transforms are
+				// relative to this actor)
+				if (actorObj.HasMember("children"))
 				{
-					SDL_Log("Unknown actor type %s", type.c_str());
+					const rapidjson::Value& children = actorObj["children"];
+					if (children.IsArray())
+					{
+						for (rapidjson::SizeType i = 0; i < children.Size(); i++)
+						{
+							Actor* child = LoadActor(game, children[i]);
+							if (child)
+							{
+								child->AttachTo(actor);
+								child->ComputeWorldTransform();
+							}
+						}
+					}
 				}
 			}
+			else
+			{
+				SDL_Log("Unknown actor type %s", type.c_str());
+			}
 		}
 	}
+	return actor;
 }
 
 void LevelLoader::LoadComponents(Actor* actor, const rapidjson::Value& inArray)
@@ -278,26 +308,47 @@ void LevelLoader::SaveActors(rapidjson::Document::AllocatorType& alloc,
 	const auto& actors = game->GetActors();
 	for (const Actor* actor : actors)
 	{
-		// Make a JSON object
-		rapidjson::Value obj(rapidjson::kObjectType);
-		// Add type
-		JsonHelper::AddString(alloc, obj, "type", Actor::TypeNames[actor->GetType()]);
-
-		// Make object for properties
-		rapidjson::Value props(rapidjson::kObjectType);
-		// Save properties
-		actor->SaveProperties(alloc, props);
-		// Add the properties member
-		obj.AddMember("properties", props, alloc);
-
-		// Save components
-		rapidjson::Value components(rapidjson::kArrayType);
-		SaveComponents(alloc, actor, components);
-		obj.AddMember("components", components, alloc);
+		// Children are saved with their parent
+		if (actor->GetParent() == nullptr)
+		{
+			SaveActor(alloc, actor, inArray);
+		}
+	}
+}
 
-		// Add actor to inArray
-		inArray.PushBack(obj, alloc);
+void LevelLoader::SaveActor(rapidjson::Document::AllocatorType& alloc,
+	const Actor* actor, rapidjson::Value& inArray)
+{
+	// Make a JSON object
+	rapidjson::Value obj(rapidjson::kObjectType);
+	// Add type
+	JsonHelper::AddString(alloc, obj, "type", Actor::TypeNames[actor->GetType()]);
+
+	// Make object for properties
+	rapidjson::Value props(rapidjson::kObjectType);
+	// Save properties
+	actor->SaveProperties(alloc, props);
+	// Add the properties member
+	obj.AddMember("properties", props, alloc);
+
+	// Save components
+	rapidjson::Value components(rapidjson::kArrayType);
+	SaveComponents(alloc, actor, components);
+	obj.AddMember("components", components, alloc);
+
+	// Save children
+	if (!actor->GetChildren().empty())
+	{
+		rapidjson::Value children(rapidjson::kArrayType);
+		for (const Actor* child : actor->GetChildren())
+		{
+			SaveActor(alloc, child, children);
+		}
+		obj.AddMember("children", children, alloc);
 	}
+
+	// Add actor to inArray
+	inArray.PushBack(obj, alloc);
 }
 
 void LevelLoader::SaveComponents(rapidjson::Document::AllocatorType& alloc, 
@@ -32,6 +32,8 @@ protected:
 	static void LoadGlobalProperties(class Game* game, const rapidjson::Value& inObject);
 	// Helper to load in actors
 	static void LoadActors(class Game* game, const rapidjson::Value& inArray);
+	// Helper to load one actor (and any children), returns nullptr on failure
+	static class Actor* LoadActor(class Game* game, const rapidjson::Value& actorObj);
 	// Helper to load in components
 	static void LoadComponents(class Actor* actor, const rapidjson::Value& inArray);
 	// Maps for data
@@ -43,6 +45,9 @@ protected:
 	// Helper to save actors
 	static void SaveActors(rapidjson::Document::AllocatorType& alloc,
 		class Game* game, rapidjson::Value& inArray);
+	// Helper to save one actor (and any children)
+	static void SaveActor(rapidjson::Document::AllocatorType& alloc,
+		const class Actor* actor, rapidjson::Value& inArray);
 	// Helper to save components
 	static void SaveComponents(rapidjson::Document::AllocatorType& alloc,
 		const class Actor* actor, rapidjson::Value& inArray);
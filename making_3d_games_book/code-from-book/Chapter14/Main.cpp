@@ -7,15 +7,96 @@
 // ----------------------------------------------------------------
 
 #include "Game.h"
+#include "Benchmark.h"
+#include "Profiler.h"
+#include <string>
+#include <cstdlib>
 
+// Command line options:
+// -headless   Run without a window, OpenGL, audio or fonts
+//             (the renderer draws to a device that records commands)
+// -bench N    Run N frames with a fixed time step and report
+//             how long each phase of the frame takes as JSON
+// -dt X       Time step (in seconds) for each benchmark frame
+// -out file   Write the benchmark report to file (default stdout)
+// -trace file Write the profiler zones to file on exit
+// -batch      Update components in per-type batches
+// -threads N  Update actors on N threads (0 means one per core)
+// -level file Level to load (default Assets/Level3.gplevel)
+// (The kernel and physics benchmarks are in the Benchmark executable)
 int main(int argc, char** argv)
 {
+	bool headless = false;
+	int benchFrames = 0;
+	float benchDelta = 1.0f / 60.0f;
+	std::string benchOut;
+	std::string traceOut;
+	bool batch = false;
+	unsigned numThreads = 1;
+	std::string levelFile;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "-headless")
+		{
+			headless = true;
+		}
+		else if (arg == "-bench" && hasValue)
+		{
+			benchFrames = std::atoi(argv[++i]);
+		}
+		else if (arg == "-dt" && hasValue)
+		{
+			benchDelta = static_cast<float>(std::atof(argv[++i]));
+		}
+		else if (arg == "-out" && hasValue)
+		{
+			benchOut = argv[++i];
+		}
+		else if (arg == "-trace" && hasValue)
+		{
+			traceOut = argv[++i];
+		}
+		else if (arg == "-batch")
+		{
+			batch = true;
+		}
+		else if (arg == "-threads" && hasValue)
+		{
+			numThreads = static_cast<unsigned>(std::atoi(argv[++i]));
+		}
+		else if (arg == "-level" && hasValue)
+		{
+			levelFile = argv[++i];
+		}
+	}
+
 	Game game;
-	bool success = game.Initialize();
+	game.SetBatchComponents(batch);
+	game.SetNumThreads(numThreads);
+	if (!levelFile.empty())
+	{
+		game.SetLevelFile(levelFile);
+	}
+	bool success = game.Initialize(headless);
 	if (success)
 	{
-		game.RunLoop();
+		if (benchFrames > 0)
+		{
+			Benchmark bench(benchFrames, benchDelta);
+			game.RunBenchmark(&bench);
+			success = bench.WriteJSON(benchOut);
+		}
+		else
+		{
+			game.RunLoop();
+		}
+		if (!traceOut.empty())
+		{
+			Profiler::WriteTrace(traceOut);
+		}
 	}
 	game.Shutdown();
-	return 0;
+	return success ? 0 : 1;
 }
@@ -49,6 +49,7 @@ Mesh::Mesh()
 	,mVertexArray(nullptr)
 	,mRadius(0.0f)
 	,mSpecPower(100.0f)
+	,mSortID(0)
 {
 }
 
@@ -214,7 +215,7 @@ bool Mesh::Load(const std::string& fileName, Renderer* renderer)
 
 	// Now create a vertex array
 	unsigned int numVerts = static_cast<unsigned>(vertices.size()) / vertSize;
-	mVertexArray = new VertexArray(vertices.data(), numVerts,
+	mVertexArray = new VertexArray(renderer->GetDevice(), vertices.data(), numVerts,
 		layout, indices.data(), static_cast<unsigned>(indices.size()));
 
 	// Save the binary mesh
@@ -344,7 +345,7 @@ bool Mesh::LoadBinary(const std::string& fileName, Renderer* renderer)
 			header.mNumIndices * sizeof(uint32_t));
 
 		// Now create the vertex array
-		mVertexArray = new VertexArray(verts, header.mNumVerts,
+		mVertexArray = new VertexArray(renderer->GetDevice(), verts, header.mNumVerts,
 			header.mLayout, indices, header.mNumIndices);
 
 		// Cleanup memory
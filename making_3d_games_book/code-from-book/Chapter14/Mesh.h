@@ -34,6 +34,9 @@ public:
 	const AABB& GetBox() const { return mBox; }
 	// Get specular power of mesh
 	float GetSpecPower() const { return mSpecPower; }
+	// Small ID the renderer sorts draws by
+	unsigned int GetSortID() const { return mSortID; }
+	void SetSortID(unsigned int id) { mSortID = id; }
 
 	// Save the mesh in binary format
 	void SaveBinary(const std::string& fileName, const void* verts, 
@@ -59,4 +62,5 @@ private:
 	float mRadius;
 	// Specular power of surface
 	float mSpecPower;
+	unsigned int mSortID;
 };
\ No newline at end of file
@@ -14,6 +14,7 @@
 #include "Renderer.h"
 #include "Texture.h"
 #include "VertexArray.h"
+#include "RenderDevice.h"
 #include "LevelLoader.h"
 
 MeshComponent::MeshComponent(Actor* owner, bool isSkeletal)
@@ -35,13 +36,9 @@ void MeshComponent::Draw(Shader* shader)
 {
 	if (mMesh)
 	{
-		// Set the world transform
-		shader->SetMatrixUniform("uWorldTransform", 
-			mOwner->GetWorldTransform());
-		// Set specular power
-		shader->SetFloatUniform("uSpecPower", mMesh->GetSpecPower());
+		SetDrawUniforms(shader);
 		// Set the active texture
-		Texture* t = mMesh->GetTexture(mTextureIndex);
+		Texture* t = GetTexture();
 		if (t)
 		{
 			t->SetActive();
@@ -50,10 +47,24 @@ void MeshComponent::Draw(Shader* shader)
 		VertexArray* va = mMesh->GetVertexArray();
 		va->SetActive();
 		// Draw
-		glDrawElements(GL_TRIANGLES, va->GetNumIndices(), GL_UNSIGNED_INT, nullptr);
+		mOwner->GetGame()->GetRenderer()->GetDevice()->DrawIndexed(va->GetNumIndices());
 	}
 }
 
+void MeshComponent::SetDrawUniforms(Shader* shader)
+{
+	// Set the world transform
+	shader->SetMatrixUniform("uWorldTransform", 
+		mOwner->GetRenderTransform());
+	// Set specular power
+	shader->SetFloatUniform("uSpecPower", mMesh->GetSpecPower());
+}
+
+Texture* MeshComponent::GetTexture() const
+{
+	return mMesh ? mMesh->GetTexture(mTextureIndex) : nullptr;
+}
+
 void MeshComponent::LoadProperties(const rapidjson::Value& inObj)
 {
 	Component::LoadProperties(inObj);
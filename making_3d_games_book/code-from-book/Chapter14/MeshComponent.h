@@ -15,9 +15,15 @@ public:
 	MeshComponent(class Actor* owner, bool isSkeletal = false);
 	~MeshComponent();
 	// Draw this mesh component
-	virtual void Draw(class Shader* shader);
+	void Draw(class Shader* shader);
+	// Set the uniforms that change from one draw to the next
+	// (the render queue binds the texture and vertex array)
+	virtual void SetDrawUniforms(class Shader* shader);
+	// Texture to draw with (or null)
+	class Texture* GetTexture() const;
 	// Set the mesh/texture index used by mesh component
 	virtual void SetMesh(class Mesh* mesh) { mMesh = mesh; }
+	class Mesh* GetMesh() const { return mMesh; }
 	void SetTextureIndex(size_t index) { mTextureIndex = index; }
 
 	void SetVisible(bool visible) { mVisible = visible; }
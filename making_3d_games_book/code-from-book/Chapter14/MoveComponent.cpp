@@ -14,11 +14,25 @@ MoveComponent::MoveComponent(class Actor* owner, int updateOrder)
 :Component(owner, updateOrder)
 ,mAngularSpeed(0.0f)
 ,mForwardSpeed(0.0f)
+,mStrafeSpeed(0.0f)
 {
 	
 }
 
 void MoveComponent::Update(float deltaTime)
+{
+	Turn(deltaTime);
+	
+	if (!Math::NearZero(mForwardSpeed) || !Math::NearZero(mStrafeSpeed))
+	{
+		Vector3 pos = mOwner->GetPosition();
+		pos += mOwner->GetForward() * mForwardSpeed * deltaTime;
+		pos += mOwner->GetRight() * mStrafeSpeed * deltaTime;
+		mOwner->SetPosition(pos);
+	}
+}
+
+void MoveComponent::Turn(float deltaTime)
 {
 	if (!Math::NearZero(mAngularSpeed))
 	{
@@ -31,14 +45,6 @@ void MoveComponent::Update(float deltaTime)
 		rot = Quaternion::Concatenate(rot, inc);
 		mOwner->SetRotation(rot);
 	}
-	
-	if (!Math::NearZero(mForwardSpeed) || !Math::NearZero(mStrafeSpeed))
-	{
-		Vector3 pos = mOwner->GetPosition();
-		pos += mOwner->GetForward() * mForwardSpeed * deltaTime;
-		pos += mOwner->GetRight() * mStrafeSpeed * deltaTime;
-		mOwner->SetPosition(pos);
-	}
 }
 
 void MoveComponent::LoadProperties(const rapidjson::Value& inObj)
@@ -29,6 +29,9 @@ public:
 	void SaveProperties(rapidjson::Document::AllocatorType& alloc,
 		rapidjson::Value& inObj) const override;
 protected:
+	// Rotate about the up axis by the angular speed
+	void Turn(float deltaTime);
+
 	float mAngularSpeed;
 	float mForwardSpeed;
 	float mStrafeSpeed;
@@ -0,0 +1,255 @@
+// ----------------------------------------------------------------
+// From Game Programming in C++ by Sanjay Madhav
+// Copyright (C) 2017 Sanjay Madhav. All rights reserved.
+// 
+// Released under the BSD License
+// See LICENSE in root directory for full details.
+// ----------------------------------------------------------------
+
+#include "NullRenderDevice.h"
+#include <SDL/SDL.h>
+
+const char* NullRenderDevice::CommandNames[NumCommandTypes] = {
+	"CreateBuffer",
+	"DestroyBuffer",
+	"SetBufferData",
+	"UpdateBuffer",
+	"BindUniformBuffer",
+	"CreateVertexArray",
+	"DestroyVertexArray",
+	"BindVertexArray",
+	"SetInstanceTransforms",
+	"CreateTexture",
+	"DestroyTexture",
+	"BindTexture",
+	"CreateFramebuffer",
+	"DestroyFramebuffer",
+	"BindFramebuffer",
+	"BlitDepth",
+	"CreateProgram",
+	"DestroyProgram",
+	"UseProgram",
+	"BindUniformBlock",
+	"SetUniform",
+	"Clear",
+	"SetDepthState",
+	"SetBlendMode",
+	"Draw",
+	"DrawInstanced"
+};
+
+NullRenderDevice::NullRenderDevice()
+	:mLastID(0)
+{
+	for (int i = 0; i < NumCommandTypes; i++)
+	{
+		mCounts[i] = 0;
+		mTotalCounts[i] = 0;
+	}
+}
+
+void NullRenderDevice::LogCounts() const
+{
+	SDL_Log("Render commands (last frame):");
+	for (int i = 0; i < NumCommandTypes; i++)
+	{
+		if (mCounts[i] > 0)
+		{
+			SDL_Log("  %-22s %zu", CommandNames[i], mCounts[i]);
+		}
+	}
+}
+
+void NullRenderDevice::BeginFrame()
+{
+	// Keep the capacity, so recording doesn't allocate every frame
+	mCommands.clear();
+	for (int i = 0; i < NumCommandTypes; i++)
+	{
+		mCounts[i] = 0;
+	}
+}
+
+void NullRenderDevice::Record(CommandType type, unsigned arg0, unsigned arg1)
+{
+	Command c;
+	c.mType = type;
+	c.mArg0 = arg0;
+	c.mArg1 = arg1;
+	mCommands.emplace_back(c);
+	mCounts[type]++;
+	mTotalCounts[type]++;
+}
+
+unsigned NullRenderDevice::CreateBuffer(BufferType /*type*/, size_t size, const void* /*data*/,
+	bool /*dynamic*/)
+{
+	unsigned buffer = NewID();
+	Record(ECreateBuffer, buffer, static_cast<unsigned>(size));
+	return buffer;
+}
+
+void NullRenderDevice::DestroyBuffer(unsigned buffer)
+{
+	Record(EDestroyBuffer, buffer);
+}
+
+void NullRenderDevice::SetBufferData(unsigned buffer, size_t size, const void* /*data*/)
+{
+	Record(ESetBufferData, buffer, static_cast<unsigned>(size));
+}
+
+void NullRenderDevice::UpdateBuffer(unsigned buffer, size_t /*offset*/, size_t size,
+	const void* /*data*/)
+{
+	Record(EUpdateBuffer, buffer, static_cast<unsigned>(size));
+}
+
+void NullRenderDevice::BindUniformBuffer(unsigned buffer, unsigned binding)
+{
+	Record(EBindUniformBuffer, buffer, binding);
+}
+
+unsigned NullRenderDevice::CreateVertexArray(unsigned vertexBuffer, unsigned /*indexBuffer*/,
+	unsigned /*stride*/, const VertexAttrib* /*attribs*/, unsigned /*numAttribs*/)
+{
+	unsigned vertexArray = NewID();
+	Record(ECreateVertexArray, vertexArray, vertexBuffer);
+	return vertexArray;
+}
+
+void NullRenderDevice::DestroyVertexArray(unsigned vertexArray)
+{
+	Record(EDestroyVertexArray, vertexArray);
+}
+
+void NullRenderDevice::BindVertexArray(unsigned vertexArray)
+{
+	Record(EBindVertexArray, vertexArray);
+}
+
+void NullRenderDevice::SetInstanceTransforms(unsigned buffer, unsigned /*firstAttrib*/,
+	size_t offset)
+{
+	Record(ESetInstanceTransforms, buffer, static_cast<unsigned>(offset));
+}
+
+unsigned NullRenderDevice::CreateTexture(int /*width*/, int /*height*/, TextureFormat format,
+	const void* /*pixels*/, TextureFilter /*filter*/)
+{
+	unsigned texture = NewID();
+	Record(ECreateTexture, texture, format);
+	return texture;
+}
+
+void NullRenderDevice::DestroyTexture(unsigned texture)
+{
+	Record(EDestroyTexture, texture);
+}
+
+void NullRenderDevice::BindTexture(unsigned texture, unsigned unit)
+{
+	Record(EBindTexture, texture, unit);
+}
+
+unsigned NullRenderDevice::CreateFramebuffer(int /*width*/, int /*height*/,
+	const unsigned* /*textures*/, unsigned numTextures)
+{
+	unsigned framebuffer = NewID();
+	Record(ECreateFramebuffer, framebuffer, numTextures);
+	return framebuffer;
+}
+
+void NullRenderDevice::DestroyFramebuffer(unsigned framebuffer)
+{
+	Record(EDestroyFramebuffer, framebuffer);
+}
+
+void NullRenderDevice::BindFramebuffer(unsigned framebuffer)
+{
+	Record(EBindFramebuffer, framebuffer);
+}
+
+void NullRenderDevice::BlitDepth(unsigned framebuffer, int /*width*/, int /*height*/)
+{
+	Record(EBlitDepth, framebuffer);
+}
+
+unsigned NullRenderDevice::CreateProgram(const char* /*vertSource*/, const char* /*fragSource*/)
+{
+	unsigned program = NewID();
+	Record(ECreateProgram, program);
+	return program;
+}
+
+void NullRenderDevice::DestroyProgram(unsigned program)
+{
+	Record(EDestroyProgram, program);
+}
+
+void NullRenderDevice::UseProgram(unsigned program)
+{
+	Record(EUseProgram, program);
+}
+
+void NullRenderDevice::GetUniforms(unsigned /*program*/, std::vector<UniformDesc>& outUniforms)
+{
+	outUniforms.clear();
+}
+
+bool NullRenderDevice::BindUniformBlock(unsigned program, const char* /*name*/,
+	unsigned binding)
+{
+	Record(EBindUniformBlock, program, binding);
+	return true;
+}
+
+void NullRenderDevice::SetUniform(int location, const Matrix4* /*matrices*/, unsigned count)
+{
+	Record(ESetUniform, static_cast<unsigned>(location), count);
+}
+
+void NullRenderDevice::SetUniform(int location, const Vector3& /*vector*/)
+{
+	Record(ESetUniform, static_cast<unsigned>(location));
+}
+
+void NullRenderDevice::SetUniform(int location, const Vector2& /*vector*/)
+{
+	Record(ESetUniform, static_cast<unsigned>(location));
+}
+
+void NullRenderDevice::SetUniform(int location, float /*value*/)
+{
+	Record(ESetUniform, static_cast<unsigned>(location));
+}
+
+void NullRenderDevice::SetUniform(int location, int /*value*/)
+{
+	Record(ESetUniform, static_cast<unsigned>(location));
+}
+
+void NullRenderDevice::Clear()
+{
+	Record(EClear);
+}
+
+void NullRenderDevice::SetDepthState(bool test, bool write)
+{
+	Record(ESetDepthState, test ? 1 : 0, write ? 1 : 0);
+}
+
+void NullRenderDevice::SetBlendMode(BlendMode mode)
+{
+	Record(ESetBlendMode, mode);
+}
+
+void NullRenderDevice::DrawIndexed(unsigned numIndices)
+{
+	Record(EDraw, numIndices, 1);
+}
+
+void NullRenderDevice::DrawIndexedInstanced(unsigned numIndices, unsigned numInstances)
+{
+	Record(EDrawInstanced, numIndices, numInstances);
+}
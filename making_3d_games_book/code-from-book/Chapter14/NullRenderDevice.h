@@ -0,0 +1,127 @@
+// ----------------------------------------------------------------
+// From Game Programming in C++ by Sanjay Madhav
+// Copyright (C) 2017 Sanjay Madhav. All rights reserved.
+// 
+// Released under the BSD License
+// See LICENSE in root directory for full details.
+// ----------------------------------------------------------------
+
+#pragma once
+#include "RenderDevice.h"
+
+// Render device that draws nothing, and instead records each call
+// as a command. The renderer does all of its CPU-side work as usual,
+// so it can run (and be timed, or checked) without a GPU.
+class NullRenderDevice : public RenderDevice
+{
+public:
+	enum CommandType
+	{
+		ECreateBuffer,
+		EDestroyBuffer,
+		ESetBufferData,
+		EUpdateBuffer,
+		EBindUniformBuffer,
+		ECreateVertexArray,
+		EDestroyVertexArray,
+		EBindVertexArray,
+		ESetInstanceTransforms,
+		ECreateTexture,
+		EDestroyTexture,
+		EBindTexture,
+		ECreateFramebuffer,
+		EDestroyFramebuffer,
+		EBindFramebuffer,
+		EBlitDepth,
+		ECreateProgram,
+		EDestroyProgram,
+		EUseProgram,
+		EBindUniformBlock,
+		ESetUniform,
+		EClear,
+		ESetDepthState,
+		ESetBlendMode,
+		EDraw,
+		EDrawInstanced,
+		NumCommandTypes
+	};
+	static const char* CommandNames[NumCommandTypes];
+
+	// A recorded call. The arguments are the main ones of the call,
+	// such as the ID it binds, or the indices/instances it draws.
+	struct Command
+	{
+		CommandType mType;
+		unsigned mArg0;
+		unsigned mArg1;
+	};
+
+	NullRenderDevice();
+
+	// Commands recorded since the frame began
+	const std::vector<Command>& GetCommands() const { return mCommands; }
+	// Commands of this type recorded since the frame began
+	size_t GetCount(CommandType type) const { return mCounts[type]; }
+	// Commands of every type recorded since the device was created
+	size_t GetTotalCount(CommandType type) const { return mTotalCounts[type]; }
+	// Log how many of each command the last frame recorded
+	void LogCounts() const;
+
+	// Forgets the last frame's commands
+	void BeginFrame() override;
+
+	unsigned CreateBuffer(BufferType type, size_t size, const void* data,
+		bool dynamic) override;
+	void DestroyBuffer(unsigned buffer) override;
+	void SetBufferData(unsigned buffer, size_t size, const void* data) override;
+	void UpdateBuffer(unsigned buffer, size_t offset, size_t size,
+		const void* data) override;
+	void BindUniformBuffer(unsigned buffer, unsigned binding) override;
+
+	unsigned CreateVertexArray(unsigned vertexBuffer, unsigned indexBuffer,
+		unsigned stride, const VertexAttrib* attribs, unsigned numAttribs) override;
+	void DestroyVertexArray(unsigned vertexArray) override;
+	void BindVertexArray(unsigned vertexArray) override;
+	void SetInstanceTransforms(unsigned buffer, unsigned firstAttrib,
+		size_t offset) override;
+
+	unsigned CreateTexture(int width, int height, TextureFormat format,
+		const void* pixels, TextureFilter filter) override;
+	void DestroyTexture(unsigned texture) override;
+	void BindTexture(unsigned texture, unsigned unit) override;
+
+	unsigned CreateFramebuffer(int width, int height,
+		const unsigned* textures, unsigned numTextures) override;
+	void DestroyFramebuffer(unsigned framebuffer) override;
+	void BindFramebuffer(unsigned framebuffer) override;
+	void BlitDepth(unsigned framebuffer, int width, int height) override;
+
+	// Programs aren't compiled, so they have no uniforms
+	unsigned CreateProgram(const char* vertSource, const char* fragSource) override;
+	void DestroyProgram(unsigned program) override;
+	void UseProgram(unsigned program) override;
+	void GetUniforms(unsigned program, std::vector<UniformDesc>& outUniforms) override;
+	bool BindUniformBlock(unsigned program, const char* name,
+		unsigned binding) override;
+	void SetUniform(int location, const Matrix4* matrices, unsigned count) override;
+	void SetUniform(int location, const Vector3& vector) override;
+	void SetUniform(int location, const Vector2& vector) override;
+	void SetUniform(int location, float value) override;
+	void SetUniform(int location, int value) override;
+
+	void Clear() override;
+	void SetDepthState(bool test, bool write) override;
+	void SetBlendMode(BlendMode mode) override;
+
+	void DrawIndexed(unsigned numIndices) override;
+	void DrawIndexedInstanced(unsigned numIndices, unsigned numInstances) override;
+private:
+	void Record(CommandType type, unsigned arg0 = 0, unsigned arg1 = 0);
+	// IDs are handed out in order, for every kind of object
+	unsigned NewID() { return ++mLastID; }
+
+	std::vector<Command> mCommands;
+	size_t mCounts[NumCommandTypes];
+	size_t mTotalCounts[NumCommandTypes];
+	unsigned mLastID;
+};
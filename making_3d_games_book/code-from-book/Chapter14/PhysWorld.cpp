@@ -9,53 +9,495 @@
 #include "PhysWorld.h"
 #include <algorithm>
 #include "BoxComponent.h"
+#include "Profiler.h"
+#include "Game.h"
+#include "CommandBuffer.h"
+#include "FrameAllocator.h"
+#include "JobSystem.h"
 #include <SDL/SDL.h>
 
 PhysWorld::PhysWorld(Game* game)
 	:mGame(game)
+	,mFreeProxy(InvalidProxy)
+	,mNumOriented(0)
 {
 }
 
-bool PhysWorld::SegmentCast(const LineSegment& l, CollisionInfo& outColl)
+namespace
 {
-	bool collided = false;
-	// Initialize closestT to infinity, so first
-	// intersection will always update closestT
-	float closestT = Math::Infinity;
-	Vector3 norm;
-	// Test against all boxes
-	for (auto box : mBoxes)
+	// Segment against a box (its true rotated box, if it's oriented)
+	bool SegmentBox(const LineSegment& l, const BoxComponent* box,
+		float& outT, Vector3& outNorm)
 	{
+		if (box->IsOriented())
+		{
+			return Intersect(l, box->GetWorldOBB(), outT, outNorm);
+		}
+		return BoxKernels::SegmentBox(l, box->GetWorldBox(), outT, outNorm);
+	}
+
+	// Exact test for boxes whose world boxes overlap
+	bool BoxesOverlap(const BoxComponent* a, const BoxComponent* b)
+	{
+		if (!a->IsOriented() && !b->IsOriented())
+		{
+			return true;
+		}
+		return Intersect(a->GetWorldOBB(), b->GetWorldOBB());
+	}
+
+	// Solid boxes whose layers and masks let them collide
+	bool CanCollide(const BoxComponent* a, const BoxComponent* b)
+	{
+		return !a->IsTrigger() && !b->IsTrigger() &&
+			(a->GetLayer() & b->GetCollisionMask()) != 0 &&
+			(b->GetLayer() & a->GetCollisionMask()) != 0;
+	}
+
+	// The kernels only know about layers, so triggers are
+	// on no layer as far as they're concerned
+	uint32_t GetKernelLayer(const BoxComponent* box)
+	{
+		return box->IsTrigger() ? 0 : box->GetLayer();
+	}
+}
+
+void PhysWorld::QueryFilter::Ignore(const Actor* actor)
+{
+	SDL_assert(mNumIgnored < MaxIgnored);
+	if (mNumIgnored < MaxIgnored)
+	{
+		mIgnored[mNumIgnored++] = actor;
+	}
+}
+
+bool PhysWorld::QueryFilter::Accepts(BoxComponent* box) const
+{
+	if ((box->GetLayer() & mMask) == 0 || (box->IsTrigger() && !mHitTriggers))
+	{
+		return false;
+	}
+	for (int i = 0; i < mNumIgnored; i++)
+	{
+		if (box->GetOwner() == mIgnored[i])
+		{
+			return false;
+		}
+	}
+	return !mPredicate || mPredicate(box);
+}
+
+bool PhysWorld::SegmentCast(const LineSegment& l, CollisionInfo& outColl,
+	const QueryFilter& filter)
+{
+	PROFILE_SCOPE("PhysWorld::SegmentCast");
+	CastPacket(&l, &filter.mMask, &filter, 1, &outColl);
+	return outColl.mBox != nullptr;
+}
+
+size_t PhysWorld::SegmentCastBatch(const LineSegment* segments, const uint32_t* masks,
+	size_t count, CollisionInfo* outColl)
+{
+	PROFILE_SCOPE("PhysWorld::SegmentCastBatch");
+	// Neighboring segments (which are usually close together) go in
+	// the same packet, and each one's result goes in its own slot
+	const size_t packetSize = AABBTree::MaxPacketSize;
+	struct Batch
+	{
+		const LineSegment* mSegments;
+		const uint32_t* mMasks;
+		size_t mCount;
+		CollisionInfo* mColl;
+	};
+	Batch batch{ segments, masks, count, outColl };
+	// (The lambda only captures two pointers, so it doesn't allocate)
+	mGame->GetJobSystem()->ParallelFor((count + packetSize - 1) / packetSize, CastGrainSize,
+		[this, &batch](size_t begin, size_t end) {
+		for (size_t packet = begin; packet < end; packet++)
+		{
+			size_t first = packet * packetSize;
+			size_t num = batch.mCount - first;
+			if (num > packetSize)
+			{
+				num = packetSize;
+			}
+			CastPacket(batch.mSegments + first,
+				batch.mMasks ? batch.mMasks + first : nullptr, nullptr, num, batch.mColl + first);
+		}
+	});
+
+	size_t numHits = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		if (outColl[i].mBox != nullptr)
+		{
+			numHits++;
+		}
+	}
+	return numHits;
+}
+
+void PhysWorld::CastPacket(const LineSegment* segments, const uint32_t* masks,
+	const QueryFilter* filter, size_t count, CollisionInfo* outColl) const
+{
+	BoxComponent* closest[AABBTree::MaxPacketSize] = {};
+	// The kernels can only check the mask
+	bool justMask = filter == nullptr || (filter->mNumIgnored == 0 &&
+		!filter->mHitTriggers && !filter->mPredicate);
+	if (mBoxes.size() <= LinearCastMaxBoxes && mNumOriented == 0 && justMask)
+	{
+		// Few enough boxes to test them all (they're all in cache
+		// after the first segment)
+		for (size_t i = 0; i < count; i++)
+		{
+			float t;
+			size_t proxy;
+			if (BoxKernels::SegmentCast(mBoxArrays, 0, mProxies.size(), segments[i], t, proxy,
+				masks ? masks[i] : BoxKernels::AllLayers))
+			{
+				closest[i] = mProxies[proxy].mBox;
+			}
+		}
+	}
+	else
+	{
+		// Only test boxes whose tree leaf a segment reaches
+		// before its closest hit so far
+		struct Packet
+		{
+			const LineSegment* mSegments;
+			const uint32_t* mMasks;
+			const QueryFilter* mFilter;
+			BoxComponent** mClosest;
+		};
+		Packet packet{ segments, masks, filter, closest };
+		mTree.RayCastPacket(segments, static_cast<int>(count),
+			[this, &packet](int i, int proxy, float maxT) {
+			BoxComponent* box = static_cast<BoxComponent*>(mTree.GetUserData(proxy));
+			// Skip boxes the filter rejects before testing them
+			if (packet.mFilter ? !packet.mFilter->Accepts(box) : (box->IsTrigger() ||
+				(packet.mMasks && (box->GetLayer() & packet.mMasks[i]) == 0)))
+			{
+				return maxT;
+			}
+			float t;
+			Vector3 norm;
+			// Does the segment intersect with the box?
+			if (SegmentBox(packet.mSegments[i], box, t, norm) && t < maxT)
+			{
+				packet.mClosest[i] = box;
+				// (Returning 0 stops this segment)
+				return packet.mFilter && packet.mFilter->mAnyHit ? 0.0f : t;
+			}
+			return maxT;
+		});
+	}
+
+	for (size_t i = 0; i < count; i++)
+	{
+		CollisionInfo& coll = outColl[i];
+		coll.mBox = closest[i];
+		coll.mActor = nullptr;
+		if (closest[i] != nullptr)
+		{
+			// Get the normal of the face that was hit
+			float t;
+			SegmentBox(segments[i], closest[i], t, coll.mNormal);
+			coll.mPoint = segments[i].PointOnSegment(t);
+			coll.mT = t;
+			coll.mActor = closest[i]->GetOwner();
+		}
+	}
+}
+
+void PhysWorld::OverlapBox(const AABB& box, std::vector<BoxComponent*>& outBoxes,
+	const QueryFilter& filter) const
+{
+	struct Overlap
+	{
+		const AABB* mBox;
+		const QueryFilter* mFilter;
+		std::vector<BoxComponent*>* mOutBoxes;
+	};
+	Overlap overlap{ &box, &filter, &outBoxes };
+	mTree.Query(box, [this, &overlap](int proxy) {
+		BoxComponent* other = static_cast<BoxComponent*>(mTree.GetUserData(proxy));
+		const AABB& overlapBox = *overlap.mBox;
+		if (!overlap.mFilter->Accepts(other))
+		{
+			return true;
+		}
+		if (Intersect(overlapBox, other->GetWorldBox()) && (!other->IsOriented() ||
+			Intersect(OBB{ (overlapBox.mMin + overlapBox.mMax) * 0.5f,
+				Quaternion::Identity, (overlapBox.mMax - overlapBox.mMin) * 0.5f },
+				other->GetWorldOBB())))
+		{
+			overlap.mOutBoxes->emplace_back(other);
+			return !overlap.mFilter->mAnyHit;
+		}
+		return true;
+	});
+}
+
+void PhysWorld::OverlapSphere(const Sphere& sphere, std::vector<BoxComponent*>& outBoxes,
+	const QueryFilter& filter) const
+{
+	struct Overlap
+	{
+		const Sphere* mSphere;
+		const QueryFilter* mFilter;
+		std::vector<BoxComponent*>* mOutBoxes;
+	};
+	Overlap overlap{ &sphere, &filter, &outBoxes };
+	mTree.Query(sphere, [this, &overlap](int proxy) {
+		BoxComponent* other = static_cast<BoxComponent*>(mTree.GetUserData(proxy));
+		if (!overlap.mFilter->Accepts(other))
+		{
+			return true;
+		}
+		const Sphere& overlapSphere = *overlap.mSphere;
+		bool hit = other->IsOriented() ? Intersect(overlapSphere, other->GetWorldOBB()) :
+			Intersect(overlapSphere, other->GetWorldBox());
+		if (hit)
+		{
+			overlap.mOutBoxes->emplace_back(other);
+			return !overlap.mFilter->mAnyHit;
+		}
+		return true;
+	});
+}
+
+bool PhysWorld::SweepBox(const AABB& box, const Vector3& delta, CollisionInfo& outColl,
+	const QueryFilter& filter) const
+{
+	PROFILE_SCOPE("PhysWorld::SweepBox");
+	AABB end(box.mMin + delta, box.mMax + delta);
+	AABB bounds = box;
+	bounds.UpdateMinMax(end.mMin);
+	bounds.UpdateMinMax(end.mMax);
+	if (!SweepQuery(bounds, filter, [&box, &delta](BoxComponent* other, float& t, Vector3& norm) {
+		return SweptAABB(box, delta, other->GetWorldBox(), Vector3::Zero, t, norm);
+	}, outColl))
+	{
+		return false;
+	}
+	// The middle of the box's face that touches
+	Vector3 half = (box.mMax - box.mMin) * 0.5f;
+	Vector3 absNorm(Math::Abs(outColl.mNormal.x), Math::Abs(outColl.mNormal.y),
+		Math::Abs(outColl.mNormal.z));
+	outColl.mPoint = (box.mMin + box.mMax) * 0.5f + delta * outColl.mT -
+		outColl.mNormal * Vector3::Dot(half, absNorm);
+	return true;
+}
+
+bool PhysWorld::SweepSphere(const Sphere& sphere, const Vector3& delta, CollisionInfo& outColl,
+	const QueryFilter& filter) const
+{
+	PROFILE_SCOPE("PhysWorld::SweepSphere");
+	Vector3 radius(sphere.mRadius, sphere.mRadius, sphere.mRadius);
+	AABB bounds(sphere.mCenter - radius, sphere.mCenter + radius);
+	AABB end(bounds.mMin + delta, bounds.mMax + delta);
+	bounds.UpdateMinMax(end.mMin);
+	bounds.UpdateMinMax(end.mMax);
+	if (!SweepQuery(bounds, filter, [&sphere, &delta](BoxComponent* other, float& t, Vector3& norm) {
+		return SweptSphere(sphere, delta, other->GetWorldBox(), Vector3::Zero, t, norm);
+	}, outColl))
+	{
+		return false;
+	}
+	outColl.mPoint = sphere.mCenter + delta * outColl.mT - outColl.mNormal * sphere.mRadius;
+	return true;
+}
+
+bool PhysWorld::SweepCapsule(const Capsule& capsule, const Vector3& delta, CollisionInfo& outColl,
+	const QueryFilter& filter) const
+{
+	PROFILE_SCOPE("PhysWorld::SweepCapsule");
+	Vector3 radius(capsule.mRadius, capsule.mRadius, capsule.mRadius);
+	AABB bounds(capsule.mSegment.mStart, capsule.mSegment.mStart);
+	bounds.UpdateMinMax(capsule.mSegment.mEnd);
+	bounds.mMin -= radius;
+	bounds.mMax += radius;
+	AABB end(bounds.mMin + delta, bounds.mMax + delta);
+	bounds.UpdateMinMax(end.mMin);
+	bounds.UpdateMinMax(end.mMax);
+	if (!SweepQuery(bounds, filter, [&capsule, &delta](BoxComponent* other, float& t, Vector3& norm) {
+		return SweptCapsule(capsule, delta, other->GetWorldOBB(), t, norm);
+	}, outColl))
+	{
+		return false;
+	}
+	// Where the moved segment comes closest to the box
+	const OBB& box = outColl.mBox->GetWorldOBB();
+	Vector3 offset = delta * outColl.mT;
+	LineSegment l(capsule.mSegment.mStart + offset, capsule.mSegment.mEnd + offset);
+	outColl.mPoint = box.ClosestPoint(ClosestPointToBox(l, box));
+	return true;
+}
+
+bool PhysWorld::SweepQuery(const AABB& bounds, const QueryFilter& filter,
+	const std::function<bool(BoxComponent*, float&, Vector3&)>& test,
+	CollisionInfo& outColl) const
+{
+	struct Sweep
+	{
+		const QueryFilter* mFilter;
+		const std::function<bool(BoxComponent*, float&, Vector3&)>* mTest;
+		BoxComponent* mClosest;
+		float mT;
+		Vector3 mNormal;
+	};
+	Sweep sweep{ &filter, &test, nullptr, Math::Infinity, Vector3::Zero };
+	mTree.Query(bounds, [this, &sweep](int proxy) {
+		BoxComponent* box = static_cast<BoxComponent*>(mTree.GetUserData(proxy));
+		if (!sweep.mFilter->Accepts(box))
+		{
+			return true;
+		}
 		float t;
-		// Does the segment intersect with the box?
-		if (Intersect(l, box->GetWorldBox(), t, norm))
+		Vector3 norm;
+		if ((*sweep.mTest)(box, t, norm) && t < sweep.mT)
+		{
+			sweep.mClosest = box;
+			sweep.mT = t;
+			sweep.mNormal = norm;
+			return !sweep.mFilter->mAnyHit;
+		}
+		return true;
+	});
+	if (sweep.mClosest == nullptr)
+	{
+		return false;
+	}
+	outColl.mBox = sweep.mClosest;
+	outColl.mActor = sweep.mClosest->GetOwner();
+	outColl.mNormal = sweep.mNormal;
+	outColl.mT = sweep.mT;
+	return true;
+}
+
+void PhysWorld::TestContinuous(const std::function<void(const ContinuousHit&)>& f)
+{
+	PROFILE_SCOPE("PhysWorld::TestContinuous");
+	auto hasMoved = [this](const BoxComponent* box) {
+		AABB start = GetStartBox(box);
+		const AABB& now = box->GetWorldBox();
+		return (start.mMin - now.mMin).LengthSq() > 0.0f ||
+			(start.mMax - now.mMax).LengthSq() > 0.0f;
+	};
+	// Continuous boxes that moved. These are tested against each
+	// other directly, since two of them can cross paths and
+	// still end up nowhere near each other.
+	FrameVector<BoxComponent*> movers;
+	for (BoxComponent* box : mBoxes)
+	{
+		if (box->IsContinuous() && !box->IsTrigger() && hasMoved(box))
+		{
+			movers.emplace_back(box);
+		}
+	}
+
+	struct Mover
+	{
+		BoxComponent* mBox;
+		AABB mStart;
+		Vector3 mDelta;
+	};
+	for (size_t i = 0; i < movers.size(); i++)
+	{
+		BoxComponent* a = movers[i];
+		const AABB& aEnd = a->GetWorldBox();
+		Mover mover{ a, GetStartBox(a), Vector3::Zero };
+		const AABB& aStart = mover.mStart;
+		Vector3& aDelta = mover.mDelta;
+		aDelta = (aEnd.mMin + aEnd.mMax - aStart.mMin - aStart.mMax) * 0.5f;
+		for (size_t j = i + 1; j < movers.size(); j++)
 		{
-			// Is this closer than previous intersection?
-			if (t < closestT)
+			BoxComponent* b = movers[j];
+			if (!CanCollide(a, b))
+			{
+				continue;
+			}
+			AABB bStart = GetStartBox(b);
+			const AABB& bEnd = b->GetWorldBox();
+			Vector3 bDelta = (bEnd.mMin + bEnd.mMax - bStart.mMin - bStart.mMax) * 0.5f;
+			ContinuousHit hit{ a->GetOwner(), b->GetOwner(), 0.0f,
+				aDelta, bDelta, Vector3::Zero };
+			if (SweptAABB(aStart, aDelta, bStart, bDelta, hit.mT, hit.mNormal))
 			{
-				closestT = t;
-				outColl.mPoint = l.PointOnSegment(t);
-				outColl.mNormal = norm;
-				outColl.mBox = box;
-				outColl.mActor = box->GetOwner();
-				collided = true;
+				f(hit);
 			}
 		}
+
+		// Everything else near where it went
+		AABB bounds = aStart;
+		bounds.UpdateMinMax(aEnd.mMin);
+		bounds.UpdateMinMax(aEnd.mMax);
+		// (Everything goes through one pointer, so the lambda doesn't allocate)
+		struct Query
+		{
+			const Mover* mMover;
+			const decltype(hasMoved)* mHasMoved;
+			const std::function<void(const ContinuousHit&)>* mFunc;
+		};
+		Query query{ &mover, &hasMoved, &f };
+		mTree.Query(bounds, [this, &query](int proxy) {
+			BoxComponent* b = static_cast<BoxComponent*>(mTree.GetUserData(proxy));
+			const Mover& m = *query.mMover;
+			if (b == m.mBox || !CanCollide(m.mBox, b) ||
+				(b->IsContinuous() && (*query.mHasMoved)(b)))
+			{
+				return true;
+			}
+			AABB bStart = GetStartBox(b);
+			const AABB& bEnd = b->GetWorldBox();
+			Vector3 bDelta = (bEnd.mMin + bEnd.mMax - bStart.mMin - bStart.mMax) * 0.5f;
+			ContinuousHit hit{ m.mBox->GetOwner(), b->GetOwner(), 0.0f,
+				m.mDelta, bDelta, Vector3::Zero };
+			if (SweptAABB(m.mStart, m.mDelta, bStart, bDelta, hit.mT, hit.mNormal))
+			{
+				(*query.mFunc)(hit);
+			}
+			return true;
+		});
 	}
-	return collided;
 }
 
-void PhysWorld::TestPairwise(std::function<void(Actor*, Actor*)> f)
+AABB PhysWorld::GetStartBox(const BoxComponent* box) const
 {
-	// Naive implementation O(n^2)
-	for (size_t i = 0; i < mBoxes.size(); i++)
+	const Proxy& p = mProxies[box->mProxy];
+	// A box that hasn't been sorted in yet only has its current box
+	return p.mInserted ? p.mBounds : box->GetWorldBox();
+}
+
+bool PhysWorld::GetContact(const BoxComponent* a, const BoxComponent* b,
+	ContactManifold& outContact) const
+{
+	return Intersect(a->GetWorldOBB(), b->GetWorldOBB(), outContact);
+}
+
+void PhysWorld::TestPairwise(const std::function<void(Actor*, Actor*)>& f)
+{
+	PROFILE_SCOPE("PhysWorld::TestPairwise");
+	// Naive implementation O(n^2), over proxies (free ones
+	// are at infinity, so they never overlap anything)
+	size_t numProxies = mProxies.size();
+	FrameVector<uint32_t> hits(numProxies);
+	for (size_t i = 0; i < numProxies; i++)
 	{
+		BoxComponent* a = mProxies[i].mBox;
+		if (a == nullptr || a->IsTrigger())
+		{
+			continue;
+		}
 		// Don't need to test vs itself and any previous i values
-		for (size_t j = i + 1; j < mBoxes.size(); j++)
+		// (the kernel skips boxes that aren't in a's mask)
+		size_t numHits = BoxKernels::OverlapBox(mBoxArrays, i + 1, numProxies,
+			mBoxArrays.Get(i), hits.data(), a->GetCollisionMask());
+		for (size_t h = 0; h < numHits; h++)
 		{
-			BoxComponent* a = mBoxes[i];
-			BoxComponent* b = mBoxes[j];
-			if (Intersect(a->GetWorldBox(), b->GetWorldBox()))
+			BoxComponent* b = mProxies[hits[h]].mBox;
+			if (CanCollide(a, b) && BoxesOverlap(a, b))
 			{
 				// Call supplied function to handle intersection
 				f(a->GetOwner(), b->GetOwner());
@@ -64,50 +506,682 @@ void PhysWorld::TestPairwise(std::function<void(Actor*, Actor*)> f)
 	}
 }
 
-void PhysWorld::TestSweepAndPrune(std::function<void(Actor*, Actor*)> f)
+void PhysWorld::TestSweepAndPrune(const std::function<void(Actor*, Actor*)>& f)
 {
-	// Sort by min.x
-	std::sort(mBoxes.begin(), mBoxes.end(),
-		[](BoxComponent* a, BoxComponent* b) {
-			return a->GetWorldBox().mMin.x <
-				b->GetWorldBox().mMin.x;
-	});
+	PROFILE_SCOPE("PhysWorld::TestSweepAndPrune");
+	UpdateBroadphase();
+	for (const Pair& pair : mPairs)
+	{
+		BoxComponent* a = mProxies[pair.mA].mBox;
+		BoxComponent* b = mProxies[pair.mB].mBox;
+		if (!pair.mRemoved && !pair.mTrigger && BoxesOverlap(a, b))
+		{
+			f(a->GetOwner(), b->GetOwner());
+		}
+	}
+}
+
+void PhysWorld::ForEachPair(const std::function<void(BoxComponent*, BoxComponent*)>& f)
+{
+	UpdateBroadphase();
+	for (const Pair& pair : mPairs)
+	{
+		if (!pair.mRemoved && !pair.mTrigger)
+		{
+			f(mProxies[pair.mA].mBox, mProxies[pair.mB].mBox);
+		}
+	}
+}
+
+void PhysWorld::TestOverlaps(const std::function<void(Actor*, Actor*, OverlapEvent)>& f)
+{
+	PROFILE_SCOPE("PhysWorld::TestOverlaps");
+	UpdateBroadphase();
+	// f can destroy actors (which clears their proxies' boxes), so
+	// every pair's boxes are checked, and a pair is done with before f
+	size_t i = 0;
+	while (i < mPairs.size())
+	{
+		Pair& pair = mPairs[i];
+		if (pair.mTrigger)
+		{
+			i++;
+			continue;
+		}
+		BoxComponent* a = mProxies[pair.mA].mBox;
+		BoxComponent* b = mProxies[pair.mB].mBox;
+		if (a == nullptr || b == nullptr)
+		{
+			// One was destroyed since the broadphase last ran
+			ErasePair(i);
+			continue;
+		}
+		if (pair.mRemoved)
+		{
+			// Report it one last time, then it's gone
+			ErasePair(i);
+			f(a->GetOwner(), b->GetOwner(), EEnd);
+			continue;
+		}
+		OverlapEvent event = pair.mNew ? EBegin : EPersist;
+		pair.mNew = false;
+		i++;
+		f(a->GetOwner(), b->GetOwner(), event);
+	}
+}
+
+void PhysWorld::TestTriggers(const std::function<void(Actor*, Actor*, OverlapEvent)>& f)
+{
+	PROFILE_SCOPE("PhysWorld::TestTriggers");
+	UpdateBroadphase();
+	size_t i = 0;
+	while (i < mPairs.size())
+	{
+		Pair& pair = mPairs[i];
+		if (!pair.mTrigger)
+		{
+			i++;
+			continue;
+		}
+		BoxComponent* a = mProxies[pair.mA].mBox;
+		BoxComponent* b = mProxies[pair.mB].mBox;
+		// (The same as TestOverlaps, since f can destroy actors)
+		if (a == nullptr || b == nullptr)
+		{
+			ErasePair(i);
+			continue;
+		}
+		if (!a->IsTrigger())
+		{
+			std::swap(a, b);
+		}
+		if (pair.mRemoved)
+		{
+			ErasePair(i);
+			f(a->GetOwner(), b->GetOwner(), EEnd);
+			continue;
+		}
+		OverlapEvent event = pair.mNew ? EBegin : EPersist;
+		pair.mNew = false;
+		i++;
+		f(a->GetOwner(), b->GetOwner(), event);
+	}
+}
 
-	for (size_t i = 0; i < mBoxes.size(); i++)
+void PhysWorld::UpdateBroadphase()
+{
+	PROFILE_SCOPE("PhysWorld::UpdateBroadphase");
+	// Inserting or removing a box sorts its endpoints in from (or
+	// out to) infinity, past every other box, so when a lot of
+	// boxes come or go at once (such as when a level loads or
+	// unloads) sorting everything from scratch is faster
+	size_t numChanged = mRemoved.size();
+	for (uint32_t proxy : mMoved)
 	{
-		// Get max.x for current box
-		BoxComponent* a = mBoxes[i];
-		float max = a->GetWorldBox().mMax.x;
-		for (size_t j = i + 1; j < mBoxes.size(); j++)
+		if (mProxies[proxy].mMoved && !mProxies[proxy].mInserted)
 		{
-			BoxComponent* b = mBoxes[j];
-			// If AABB[j] min is past the max bounds of AABB[i],
-			// then there aren't any other possible intersections
-			// against AABB[i]
-			if (b->GetWorldBox().mMin.x > max)
+			numChanged++;
+		}
+	}
+	if (numChanged >= RebuildMinChanged)
+	{
+		RebuildBroadphase();
+		return;
+	}
+
+	for (uint32_t proxy : mRemoved)
+	{
+		FreeProxy(proxy);
+	}
+	mRemoved.clear();
+
+	// Only boxes that moved need sorting (static boxes are only
+	// here when they're first added)
+	for (uint32_t proxy : mMoved)
+	{
+		Proxy& p = mProxies[proxy];
+		if (p.mMoved)
+		{
+			p.mMoved = false;
+			bool refilter = CopyFilter(p) && p.mInserted;
+			p.mInserted = true;
+			MoveProxy(proxy, p.mBox->GetWorldBox());
+			if (refilter)
 			{
-				break;
+				RefilterPairs(proxy);
 			}
-			else if (Intersect(a->GetWorldBox(), b->GetWorldBox()))
+		}
+	}
+	mMoved.clear();
+}
+
+void PhysWorld::RebuildBroadphase()
+{
+	PROFILE_SCOPE("PhysWorld::RebuildBroadphase");
+	for (uint32_t proxy : mMoved)
+	{
+		Proxy& p = mProxies[proxy];
+		if (p.mMoved)
+		{
+			p.mMoved = false;
+			p.mInserted = true;
+			CopyFilter(p);
+			p.mBounds = p.mBox->GetWorldBox();
+		}
+	}
+	mMoved.clear();
+	for (uint32_t proxy : mRemoved)
+	{
+		mProxies[proxy].mBounds = AABB(Vector3::Infinity, Vector3::Infinity);
+	}
+
+	// Sort every axis from scratch (free proxies are at infinity)
+	for (int axis = 0; axis < 3; axis++)
+	{
+		std::vector<Endpoint>& endpoints = mEndpoints[axis];
+		for (Endpoint& e : endpoints)
+		{
+			const AABB& bounds = mProxies[e.GetProxy()].mBounds;
+			e.mValue = (e.IsMax() ? bounds.mMax : bounds.mMin).GetAsFloatPtr()[axis];
+		}
+		std::sort(endpoints.begin(), endpoints.end(),
+			[](const Endpoint& a, const Endpoint& b) { return b > a; });
+		for (uint32_t i = 0; i < endpoints.size(); i++)
+		{
+			Proxy& p = mProxies[endpoints[i].GetProxy()];
+			(endpoints[i].IsMax() ? p.mMax : p.mMin)[axis] = i;
+		}
+	}
+
+	// Find every overlap in one pass along x, keeping
+	// the boxes the pass is inside of
+	FrameVector<uint64_t> keys;
+	FrameVector<uint32_t> active;
+	for (const Endpoint& e : mEndpoints[0])
+	{
+		uint32_t proxy = e.GetProxy();
+		const Proxy& p = mProxies[proxy];
+		if (!p.mInserted)
+		{
+			continue;
+		}
+		if (e.IsMax())
+		{
+			auto iter = std::find(active.begin(), active.end(), proxy);
+			*iter = active.back();
+			active.pop_back();
+		}
+		else
+		{
+			for (uint32_t other : active)
 			{
-				f(a->GetOwner(), b->GetOwner());
+				const Proxy& q = mProxies[other];
+				if (ShouldPair(p, q) && Intersect(p.mBounds, q.mBounds))
+				{
+					keys.emplace_back(GetPairKey(proxy, other));
+				}
 			}
+			active.emplace_back(proxy);
+		}
+	}
+	std::sort(keys.begin(), keys.end());
+
+	// Pairs that aren't there any more stop, the same as
+	// if they'd moved apart (going backwards, since
+	// removing a pair moves the last one into its slot)
+	for (size_t i = mPairs.size(); i-- > 0; )
+	{
+		uint32_t a = mPairs[i].mA;
+		uint32_t b = mPairs[i].mB;
+		if (!mProxies[a].mInserted || !mProxies[b].mInserted ||
+			mPairs[i].mTrigger != (mProxies[a].mTrigger || mProxies[b].mTrigger))
+		{
+			// Removed boxes' pairs just go, as do ones that
+			// switched between solid and trigger (see RefilterPairs)
+			ErasePair(i);
+		}
+		else if (!std::binary_search(keys.begin(), keys.end(), GetPairKey(a, b)))
+		{
+			RemovePair(a, b);
 		}
 	}
+	for (uint64_t key : keys)
+	{
+		AddPair(static_cast<uint32_t>(key >> 32), static_cast<uint32_t>(key));
+	}
+
+	for (uint32_t proxy : mRemoved)
+	{
+		mProxies[proxy].mNextFree = mFreeProxy;
+		mFreeProxy = proxy;
+	}
+	mRemoved.clear();
+}
+
+bool PhysWorld::CopyFilter(Proxy& p)
+{
+	const BoxComponent* box = p.mBox;
+	bool changed = p.mLayer != box->GetLayer() ||
+		p.mCollisionMask != box->GetCollisionMask() || p.mTrigger != box->IsTrigger();
+	p.mStatic = box->IsStatic();
+	p.mLayer = box->GetLayer();
+	p.mCollisionMask = box->GetCollisionMask();
+	p.mTrigger = box->IsTrigger();
+	return changed;
 }
 
 void PhysWorld::AddBox(BoxComponent* box)
 {
+	// Other job threads might be testing against the boxes
+	if (mGame->IsUpdatingInParallel())
+	{
+		mGame->GetCommandBuffer()->Push([this, box] { AddBox(box); });
+		return;
+	}
+
+	// Reuse a free proxy if there is one (its endpoints are
+	// already parked at infinity)
+	uint32_t proxy = mFreeProxy;
+	if (proxy != InvalidProxy)
+	{
+		mFreeProxy = mProxies[proxy].mNextFree;
+	}
+	else
+	{
+		proxy = static_cast<uint32_t>(mProxies.size());
+		Proxy p;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			Endpoint e;
+			e.mValue = Math::Infinity;
+			e.mData = proxy << 1;
+			p.mMin[axis] = static_cast<uint32_t>(mEndpoints[axis].size());
+			mEndpoints[axis].emplace_back(e);
+			e.mData |= 1;
+			p.mMax[axis] = static_cast<uint32_t>(mEndpoints[axis].size());
+			mEndpoints[axis].emplace_back(e);
+		}
+		mProxies.emplace_back(p);
+		mBoxArrays.Resize(mProxies.size());
+	}
+
+	Proxy& p = mProxies[proxy];
+	p.mBox = box;
+	p.mBoxIndex = mBoxes.size();
+	p.mStatic = false;
+	p.mLayer = 0;
+	p.mCollisionMask = 0;
+	p.mTrigger = false;
+	p.mOriented = false;
+	p.mMoved = false;
+	p.mInserted = false;
+	p.mNextFree = InvalidProxy;
+	p.mTreeProxy = mTree.CreateProxy(box->GetWorldBox(), box);
+	mBoxArrays.Set(proxy, box->GetWorldBox());
+	mBoxArrays.SetLayer(proxy, GetKernelLayer(box));
+	box->mProxy = proxy;
 	mBoxes.emplace_back(box);
+
+	// It gets sorted in with its first world box
+	MarkMoved(box);
 }
 
 void PhysWorld::RemoveBox(BoxComponent* box)
 {
-	auto iter = std::find(mBoxes.begin(), mBoxes.end(), box);
-	if (iter != mBoxes.end())
+	if (mGame->IsUpdatingInParallel())
+	{
+		mGame->GetCommandBuffer()->Push([this, box] { RemoveBox(box); });
+		return;
+	}
+
+	uint32_t proxy = box->mProxy;
+	Proxy& p = mProxies[proxy];
+
+	// Swap to end of vector and pop off (avoid erase copies)
+	BoxComponent* last = mBoxes.back();
+	mBoxes[p.mBoxIndex] = last;
+	mProxies[last->mProxy].mBoxIndex = p.mBoxIndex;
+	mBoxes.pop_back();
+
+	mTree.DestroyProxy(p.mTreeProxy);
+	p.mTreeProxy = AABBTree::NullNode;
+	mBoxArrays.Clear(proxy);
+	if (p.mOriented)
+	{
+		mNumOriented--;
+		p.mOriented = false;
+	}
+	p.mBox = nullptr;
+	p.mMoved = false;
+	// Its endpoints and pairs are cleaned up by the next
+	// UpdateBroadphase (all at once, if a lot of boxes go)
+	p.mInserted = false;
+	mRemoved.emplace_back(proxy);
+	box->mProxy = InvalidProxy;
+}
+
+void PhysWorld::FreeProxy(uint32_t proxy)
+{
+	// Park the endpoints at infinity, which removes its pairs
+	MoveProxy(proxy, AABB(Vector3::Infinity, Vector3::Infinity));
+	// Drop any pair that was waiting to report it stopped
+	while (mProxies[proxy].mFirstPair != InvalidPair)
+	{
+		ErasePair(mProxies[proxy].mFirstPair);
+	}
+	mProxies[proxy].mNextFree = mFreeProxy;
+	mFreeProxy = proxy;
+}
+
+void PhysWorld::MarkMoved(BoxComponent* box)
+{
+	if (mGame->IsUpdatingInParallel())
+	{
+		mGame->GetCommandBuffer()->Push([this, box] { MarkMoved(box); });
+		return;
+	}
+
+	Proxy& p = mProxies[box->mProxy];
+	// The tree is refit right away, so casts later this
+	// frame see the new box (this is usually a no-op, since
+	// small moves stay inside the leaf's fat box)
+	mTree.MoveProxy(p.mTreeProxy, box->GetWorldBox());
+	mBoxArrays.Set(box->mProxy, box->GetWorldBox());
+	mBoxArrays.SetLayer(box->mProxy, GetKernelLayer(box));
+	if (p.mOriented != box->IsOriented())
+	{
+		p.mOriented = box->IsOriented();
+		if (p.mOriented)
+		{
+			mNumOriented++;
+		}
+		else
+		{
+			mNumOriented--;
+		}
+	}
+	if (!p.mMoved)
+	{
+		p.mMoved = true;
+		mMoved.emplace_back(box->mProxy);
+	}
+}
+
+void PhysWorld::MoveProxy(uint32_t proxy, const AABB& bounds)
+{
+	AABB old = mProxies[proxy].mBounds;
+	mProxies[proxy].mBounds = bounds;
+	const float* oldMin = old.mMin.GetAsFloatPtr();
+	const float* oldMax = old.mMax.GetAsFloatPtr();
+	const float* newMin = bounds.mMin.GetAsFloatPtr();
+	const float* newMax = bounds.mMax.GetAsFloatPtr();
+	for (int axis = 0; axis < 3; axis++)
+	{
+		Proxy& p = mProxies[proxy];
+		mEndpoints[axis][p.mMin[axis]].mValue = newMin[axis];
+		mEndpoints[axis][p.mMax[axis]].mValue = newMax[axis];
+		// Grow first, then shrink, so the min never passes its own max
+		if (newMin[axis] < oldMin[axis])
+		{
+			SortDown(axis, p.mMin[axis]);
+		}
+		if (newMax[axis] > oldMax[axis])
+		{
+			SortUp(axis, p.mMax[axis]);
+		}
+		if (newMin[axis] > oldMin[axis])
+		{
+			SortUp(axis, p.mMin[axis]);
+		}
+		if (newMax[axis] < oldMax[axis])
+		{
+			SortDown(axis, p.mMax[axis]);
+		}
+	}
+}
+
+void PhysWorld::SortDown(int axis, uint32_t i)
+{
+	std::vector<Endpoint>& endpoints = mEndpoints[axis];
+	while (i > 0 && endpoints[i - 1] > endpoints[i])
+	{
+		Endpoint& e = endpoints[i];
+		Endpoint& prev = endpoints[i - 1];
+		// A min moving down past a max might start an overlap, and
+		// a max moving down past a min ends one
+		if (e.IsMax() != prev.IsMax())
+		{
+			OnCrossing(e.GetProxy(), prev.GetProxy(), !e.IsMax());
+		}
+
+		// Swap, and update where the proxies' endpoints are
+		std::swap(e, prev);
+		Proxy& moved = mProxies[prev.GetProxy()];
+		Proxy& other = mProxies[e.GetProxy()];
+		(prev.IsMax() ? moved.mMax : moved.mMin)[axis] = i - 1;
+		(e.IsMax() ? other.mMax : other.mMin)[axis] = i;
+		i--;
+	}
+}
+
+void PhysWorld::SortUp(int axis, uint32_t i)
+{
+	std::vector<Endpoint>& endpoints = mEndpoints[axis];
+	uint32_t last = static_cast<uint32_t>(endpoints.size()) - 1;
+	while (i < last && endpoints[i] > endpoints[i + 1])
+	{
+		Endpoint& e = endpoints[i];
+		Endpoint& next = endpoints[i + 1];
+		// A max moving up past a min might start an overlap, and
+		// a min moving up past a max ends one
+		if (e.IsMax() != next.IsMax())
+		{
+			OnCrossing(e.GetProxy(), next.GetProxy(), e.IsMax());
+		}
+
+		std::swap(e, next);
+		Proxy& moved = mProxies[next.GetProxy()];
+		Proxy& other = mProxies[e.GetProxy()];
+		(next.IsMax() ? moved.mMax : moved.mMin)[axis] = i + 1;
+		(e.IsMax() ? other.mMax : other.mMin)[axis] = i;
+		i++;
+	}
+}
+
+void PhysWorld::OnCrossing(uint32_t proxy, uint32_t other, bool startsOverlap)
+{
+	if (proxy == other)
+	{
+		return;
+	}
+	if (startsOverlap)
+	{
+		// They overlap on this axis now, but check the rest
+		const Proxy& a = mProxies[proxy];
+		const Proxy& b = mProxies[other];
+		if (a.mInserted && b.mInserted && ShouldPair(a, b) &&
+			Intersect(a.mBounds, b.mBounds))
+		{
+			AddPair(proxy, other);
+		}
+	}
+	else
+	{
+		RemovePair(proxy, other);
+	}
+}
+
+bool PhysWorld::ShouldPair(const Proxy& a, const Proxy& b)
+{
+	return !(a.mStatic && b.mStatic) && !(a.mTrigger && b.mTrigger) &&
+		(a.mLayer & b.mCollisionMask) != 0 && (b.mLayer & a.mCollisionMask) != 0;
+}
+
+void PhysWorld::RefilterPairs(uint32_t proxy)
+{
+	// Pairs it shouldn't have any more stop overlapping
+	FrameVector<uint32_t> others;
+	for (uint32_t i = mProxies[proxy].mFirstPair; i != InvalidPair; )
+	{
+		const Pair& pair = mPairs[i];
+		others.emplace_back(pair.mA == proxy ? pair.mB : pair.mA);
+		i = pair.mNext[pair.GetSide(proxy)];
+	}
+	const Proxy& p = mProxies[proxy];
+	for (uint32_t other : others)
+	{
+		const Proxy& q = mProxies[other];
+		uint32_t index = FindPair(proxy, other);
+		if (mPairs[index].mTrigger != (p.mTrigger || q.mTrigger))
+		{
+			// It switched between solid and trigger, so it just goes
+			// away (like a destroyed box's pairs), and starts again below
+			ErasePair(index);
+		}
+		else if (!ShouldPair(p, q))
+		{
+			RemovePair(proxy, other);
+		}
+	}
+
+	// Nothing crossed, so the sorted lists won't find the pairs it
+	// should have now, but the tree can
+	mTree.Query(mProxies[proxy].mBounds, [this, proxy](int treeProxy) {
+		uint32_t other = static_cast<BoxComponent*>(mTree.GetUserData(treeProxy))->mProxy;
+		const Proxy& a = mProxies[proxy];
+		const Proxy& b = mProxies[other];
+		// (AddPair keeps a pair that's already there, or brings
+		// back one that stopped this frame)
+		if (other != proxy && b.mInserted && ShouldPair(a, b) &&
+			Intersect(a.mBounds, b.mBounds))
+		{
+			AddPair(proxy, other);
+		}
+		return true;
+	});
+}
+
+uint64_t PhysWorld::GetPairKey(uint32_t a, uint32_t b)
+{
+	if (a > b)
+	{
+		std::swap(a, b);
+	}
+	return (static_cast<uint64_t>(a) << 32) | b;
+}
+
+uint32_t PhysWorld::FindPair(uint32_t a, uint32_t b) const
+{
+	if (mProxies[a].mNumPairs > mProxies[b].mNumPairs)
+	{
+		std::swap(a, b);
+	}
+	uint32_t i = mProxies[a].mFirstPair;
+	while (i != InvalidPair)
+	{
+		const Pair& pair = mPairs[i];
+		if (pair.mA == b || pair.mB == b)
+		{
+			break;
+		}
+		i = pair.mNext[pair.GetSide(a)];
+	}
+	return i;
+}
+
+void PhysWorld::LinkPair(uint32_t index)
+{
+	Pair& pair = mPairs[index];
+	for (int side = 0; side < 2; side++)
+	{
+		// Push onto the front of the proxy's list
+		uint32_t proxy = side == 0 ? pair.mA : pair.mB;
+		Proxy& p = mProxies[proxy];
+		pair.mPrev[side] = InvalidPair;
+		pair.mNext[side] = p.mFirstPair;
+		if (p.mFirstPair != InvalidPair)
+		{
+			Pair& next = mPairs[p.mFirstPair];
+			next.mPrev[next.GetSide(proxy)] = index;
+		}
+		p.mFirstPair = index;
+		p.mNumPairs++;
+	}
+}
+
+void PhysWorld::UnlinkPair(uint32_t index)
+{
+	const Pair& pair = mPairs[index];
+	for (int side = 0; side < 2; side++)
+	{
+		uint32_t proxy = side == 0 ? pair.mA : pair.mB;
+		Proxy& p = mProxies[proxy];
+		if (pair.mPrev[side] != InvalidPair)
+		{
+			Pair& prev = mPairs[pair.mPrev[side]];
+			prev.mNext[prev.GetSide(proxy)] = pair.mNext[side];
+		}
+		else
+		{
+			p.mFirstPair = pair.mNext[side];
+		}
+		if (pair.mNext[side] != InvalidPair)
+		{
+			Pair& next = mPairs[pair.mNext[side]];
+			next.mPrev[next.GetSide(proxy)] = pair.mPrev[side];
+		}
+		p.mNumPairs--;
+	}
+}
+
+void PhysWorld::AddPair(uint32_t a, uint32_t b)
+{
+	uint32_t index = FindPair(a, b);
+	if (index != InvalidPair)
+	{
+		// It stopped and started again before anyone saw,
+		// so it's still the same overlap
+		mPairs[index].mRemoved = false;
+		return;
+	}
+	Pair pair;
+	pair.mA = a < b ? a : b;
+	pair.mB = a < b ? b : a;
+	pair.mNew = true;
+	pair.mRemoved = false;
+	pair.mTrigger = mProxies[a].mTrigger || mProxies[b].mTrigger;
+	mPairs.emplace_back(pair);
+	LinkPair(static_cast<uint32_t>(mPairs.size() - 1));
+}
+
+void PhysWorld::RemovePair(uint32_t a, uint32_t b)
+{
+	uint32_t index = FindPair(a, b);
+	if (index != InvalidPair)
+	{
+		Pair& pair = mPairs[index];
+		if (pair.mNew)
+		{
+			// Nobody saw it start, so it can just go
+			ErasePair(index);
+		}
+		else
+		{
+			pair.mRemoved = true;
+		}
+	}
+}
+
+void PhysWorld::ErasePair(size_t index)
+{
+	UnlinkPair(static_cast<uint32_t>(index));
+	// Move the last pair into this slot (relinking it there)
+	uint32_t last = static_cast<uint32_t>(mPairs.size() - 1);
+	if (index != last)
 	{
-		// Swap to end of vector and pop off (avoid erase copies)
-		std::iter_swap(iter, mBoxes.end() - 1);
-		mBoxes.pop_back();
+		UnlinkPair(last);
+		mPairs[index] = mPairs[last];
+		LinkPair(static_cast<uint32_t>(index));
 	}
+	mPairs.pop_back();
 }
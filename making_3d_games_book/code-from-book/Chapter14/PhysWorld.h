@@ -9,8 +9,11 @@
 #pragma once
 #include <vector>
 #include <functional>
+#include <cstdint>
 #include "Math.h"
 #include "Collision.h"
+#include "AABBTree.h"
+#include "BoxKernels.h"
 
 class PhysWorld
 {
@@ -28,21 +31,285 @@ public:
 		class BoxComponent* mBox;
 		// Owning actor of component
 		class Actor* mActor;
+		// Fraction of the way along the segment (or sweep)
+		float mT;
+	};
+
+	// Which boxes a query can hit. Everything here is checked
+	// before a box is tested, so a box the filter rejects never
+	// hides a box behind it.
+	struct QueryFilter
+	{
+		// (A layer mask converts to a filter with just that mask)
+		QueryFilter(uint32_t mask = BoxKernels::AllLayers)
+			:mMask(mask)
+			,mNumIgnored(0)
+			,mHitTriggers(false)
+			,mAnyHit(false)
+		{
+		}
+		// Skip every box on this actor (such as the one asking)
+		void Ignore(const class Actor* actor);
+		// Whether the query tests this box at all
+		bool Accepts(class BoxComponent* box) const;
+
+		static const int MaxIgnored = 4;
+		// Only boxes on one of these layers
+		uint32_t mMask;
+		const class Actor* mIgnored[MaxIgnored];
+		int mNumIgnored;
+		// Triggers are skipped unless this is set
+		bool mHitTriggers;
+		// Stop at the first hit rather than finding the closest
+		// (for line of sight, where any hit will do)
+		bool mAnyHit;
+		// Optional, for anything else (a box only counts if this
+		// returns true)
+		std::function<bool(class BoxComponent*)> mPredicate;
 	};
 
 	// Test a line segment against boxes
 	// Returns true if it collides against a box
-	bool SegmentCast(const LineSegment& l, CollisionInfo& outColl);
+	// (the closest one the filter accepts)
+	bool SegmentCast(const LineSegment& l, CollisionInfo& outColl,
+		const QueryFilter& filter = QueryFilter());
+	// Test a batch of segments, split across the job threads. Segment
+	// i only hits boxes on one of the layers in masks[i] (or any box,
+	// if masks is null), and never hits triggers. outColl[i] is
+	// segment i's closest hit, or has a null mBox if it missed, so
+	// the results are the same however the work is split. Returns
+	// how many hit something.
+	size_t SegmentCastBatch(const LineSegment* segments, const uint32_t* masks,
+		size_t count, CollisionInfo* outColl);
+	// Get every box (that the filter accepts) that overlaps this box/sphere
+	void OverlapBox(const AABB& box, std::vector<class BoxComponent*>& outBoxes,
+		const QueryFilter& filter = QueryFilter()) const;
+	void OverlapSphere(const Sphere& sphere, std::vector<class BoxComponent*>& outBoxes,
+		const QueryFilter& filter = QueryFilter()) const;
+	// Move a box/sphere/capsule by delta and find the first box it hits
+	// (that the filter accepts). Other boxes count as staying
+	// where they are. mPoint is where it touches the box, and
+	// mNormal points out of the box.
+	bool SweepBox(const AABB& box, const Vector3& delta, CollisionInfo& outColl,
+		const QueryFilter& filter = QueryFilter()) const;
+	bool SweepSphere(const Sphere& sphere, const Vector3& delta, CollisionInfo& outColl,
+		const QueryFilter& filter = QueryFilter()) const;
+	bool SweepCapsule(const Capsule& capsule, const Vector3& delta, CollisionInfo& outColl,
+		const QueryFilter& filter = QueryFilter()) const;
 
-	// Tests collisions using naive pairwise
-	void TestPairwise(std::function<void(class Actor*, class Actor*)> f);
+	// Calls f for every pair of solid boxes whose world boxes overlap
+	// (like TestSweepAndPrune, but with the boxes themselves)
+	void ForEachPair(const std::function<void(class BoxComponent*, class BoxComponent*)>& f);
+
+	// Contact manifold between two boxes that overlap (using
+	// the true rotated box for oriented boxes). Returns false
+	// if they don't touch.
+	bool GetContact(const class BoxComponent* a, const class BoxComponent* b,
+		ContactManifold& outContact) const;
+
+	// Tests collisions using naive pairwise (each box
+	// against 4 or 8 others at once)
+	// These only report pairs of solid boxes whose layers
+	// and collision masks let them collide.
+	void TestPairwise(const std::function<void(class Actor*, class Actor*)>& f);
 	// Test collisions using sweep and prune
-	void TestSweepAndPrune(std::function<void(class Actor*, class Actor*)> f);
+	// (calls f for every pair of boxes overlapping right now)
+	// Both of these skip pairs of oriented boxes whose world
+	// boxes overlap but the boxes themselves don't.
+	void TestSweepAndPrune(const std::function<void(class Actor*, class Actor*)>& f);
+
+	enum OverlapEvent
+	{
+		EBegin,
+		EPersist,
+		EEnd
+	};
+	// Calls f for every pair that started overlapping, still overlaps,
+	// or stopped overlapping since the last call. (A pair whose box
+	// was destroyed, or that switched between solid and trigger, just
+	// goes away, without an EEnd.) This only looks at world boxes,
+	// even for oriented boxes.
+	void TestOverlaps(const std::function<void(class Actor*, class Actor*, OverlapEvent)>& f);
+	// The same, but only for pairs with a trigger (which TestOverlaps
+	// skips), with the trigger's actor first. Two triggers never pair.
+	void TestTriggers(const std::function<void(class Actor*, class Actor*, OverlapEvent)>& f);
+
+	// Two boxes that touched while moving, from TestContinuous
+	struct ContinuousHit
+	{
+		// A is always the continuous box
+		class Actor* mActorA;
+		class Actor* mActorB;
+		// First time (0 to 1) they touched
+		float mT;
+		// How far each box moved since the last UpdateBroadphase
+		// (so A was at its position - mDeltaA * (1 - mT) when they touched)
+		Vector3 mDeltaA;
+		Vector3 mDeltaB;
+		// Normal of the face of B that A hit
+		Vector3 mNormal;
+	};
+	// Calls f for every continuous box that touched another solid box at
+	// some point since the last UpdateBroadphase (so call this before
+	// it, right after actors move). This counts both boxes' motion, so
+	// two boxes that passed right through each other are still reported.
+	void TestContinuous(const std::function<void(const ContinuousHit&)>& f);
+
+	// Re-sort the boxes that moved since the last call
+	void UpdateBroadphase();
 
 	// Add/remove box components from world
 	void AddBox(class BoxComponent* box);
 	void RemoveBox(class BoxComponent* box);
+	// Boxes call this when their world box changes
+	void MarkMoved(class BoxComponent* box);
 private:
+	// Sweep and prune keeps the min/max of every box sorted on each
+	// axis from frame to frame. Boxes only move a little each frame,
+	// so insertion sort only has a few swaps to do, and each swap
+	// of a min past a max is where a pair starts or stops overlapping.
+	struct Endpoint
+	{
+		float mValue;
+		// Proxy index << 1, with the low bit set for a max
+		uint32_t mData;
+		uint32_t GetProxy() const { return mData >> 1; }
+		bool IsMax() const { return (mData & 1) != 0; }
+		// Ties put mins first, so touching boxes overlap
+		// (the same as Intersect)
+		bool operator>(const Endpoint& other) const
+		{
+			return mValue > other.mValue ||
+				(mValue == other.mValue && IsMax() && !other.IsMax());
+		}
+	};
+	struct Proxy
+	{
+		Proxy()
+			:mBounds(Vector3::Infinity, Vector3::Infinity)
+			,mFirstPair(InvalidPair)
+			,mNumPairs(0)
+		{}
+		class BoxComponent* mBox;
+		// Box the endpoints were last sorted with
+		AABB mBounds;
+		// Where this box's endpoints are on each axis
+		uint32_t mMin[3];
+		uint32_t mMax[3];
+		// Index in mBoxes
+		size_t mBoxIndex;
+		// Static boxes don't pair with each other
+		bool mStatic;
+		// The box's filter, as of the last UpdateBroadphase
+		uint32_t mLayer;
+		uint32_t mCollisionMask;
+		bool mTrigger;
+		// Counted in mNumOriented?
+		bool mOriented;
+		// In mMoved?
+		bool mMoved;
+		// In the sorted lists (rather than parked at infinity)?
+		bool mInserted;
+		// Next free proxy (if this one's free)
+		uint32_t mNextFree;
+		// Leaf in mTree
+		int mTreeProxy;
+		// First of this proxy's pairs in mPairs (each pair
+		// links to the next/previous one for both its proxies)
+		uint32_t mFirstPair;
+		uint32_t mNumPairs;
+	};
+	struct Pair
+	{
+		uint32_t mA;
+		uint32_t mB;
+		// Started overlapping since the last TestOverlaps
+		bool mNew;
+		// Stopped overlapping since the last TestOverlaps
+		bool mRemoved;
+		// One of them is a trigger (so TestTriggers reports it)
+		bool mTrigger;
+		// Links in mA's ([0]) and mB's ([1]) lists of pairs
+		uint32_t mNext[2];
+		uint32_t mPrev[2];
+		// Which of the links are for this proxy
+		int GetSide(uint32_t proxy) const { return proxy == mA ? 0 : 1; }
+	};
+
+	// Calls test on every box (that the filter accepts) whose tree
+	// leaf overlaps bounds, and fills in outColl with the one test
+	// says is hit first
+	bool SweepQuery(const AABB& bounds, const QueryFilter& filter,
+		const std::function<bool(class BoxComponent*, float&, Vector3&)>& test,
+		CollisionInfo& outColl) const;
+	// Where a box was at the last UpdateBroadphase
+	AABB GetStartBox(const class BoxComponent* box) const;
+
+	// Cast up to AABBTree::MaxPacketSize segments together (with
+	// just the masks, or with filter if there's only one segment)
+	void CastPacket(const LineSegment* segments, const uint32_t* masks,
+		const QueryFilter* filter, size_t count, CollisionInfo* outColl) const;
+
+	// Sort every endpoint and find every pair from scratch
+	void RebuildBroadphase();
+	// Park a removed box's proxy at infinity, drop its
+	// pairs, and put it on the free list
+	void FreeProxy(uint32_t proxy);
+	// Copy the box's static flag and filter into its proxy
+	// (returns whether the filter changed)
+	static bool CopyFilter(Proxy& p);
+	// Move a proxy's endpoints to these bounds
+	void MoveProxy(uint32_t proxy, const AABB& bounds);
+	// Move endpoint i on this axis down/up to where it belongs
+	void SortDown(int axis, uint32_t i);
+	void SortUp(int axis, uint32_t i);
+	// The proxy just moved past the other on one axis
+	void OnCrossing(uint32_t proxy, uint32_t other, bool startsOverlap);
+	// Whether the broadphase pairs these at all (checked before
+	// anything else, since it's the cheapest test)
+	static bool ShouldPair(const Proxy& a, const Proxy& b);
+	// The proxy's filter changed, so drop the pairs it shouldn't
+	// have and add the ones it should
+	void RefilterPairs(uint32_t proxy);
+	void AddPair(uint32_t a, uint32_t b);
+	void RemovePair(uint32_t a, uint32_t b);
+	void ErasePair(size_t index);
+	static uint64_t GetPairKey(uint32_t a, uint32_t b);
+	// Index of the pair in mPairs (or InvalidPair), found by
+	// walking whichever proxy has fewer pairs
+	uint32_t FindPair(uint32_t a, uint32_t b) const;
+	// Add/remove the pair at index to/from its proxies' lists
+	void LinkPair(uint32_t index);
+	void UnlinkPair(uint32_t index);
+
 	class Game* mGame;
 	std::vector<class BoxComponent*> mBoxes;
+
+	// Broadphase
+	std::vector<Proxy> mProxies;
+	uint32_t mFreeProxy;
+	std::vector<Endpoint> mEndpoints[3];
+	// Proxies that moved since the last UpdateBroadphase
+	std::vector<uint32_t> mMoved;
+	// Proxies whose boxes were removed since then
+	std::vector<uint32_t> mRemoved;
+	// Every overlapping pair (plus ones that just stopped)
+	std::vector<Pair> mPairs;
+	// Tree of every box, for segment casts and overlap queries
+	AABBTree mTree;
+	// Every proxy's world box, for the SIMD kernels
+	BoxArrays mBoxArrays;
+	// Number of oriented boxes (the kernels only test world
+	// boxes, so segment casts use the tree when there are any)
+	size_t mNumOriented;
+	// With at most this many boxes, a segment cast tests every box
+	// (8 at a time with AVX) rather than walking the tree
+	static const size_t LinearCastMaxBoxes = 128;
+	// Packets per job in SegmentCastBatch
+	static const size_t CastGrainSize = 16;
+	// With at least this many boxes added or removed, UpdateBroadphase
+	// rebuilds rather than sorting them in or out one by one
+	static const size_t RebuildMinChanged = 64;
+	static const uint32_t InvalidProxy = 0xFFFFFFFF;
+	static const uint32_t InvalidPair = 0xFFFFFFFF;
 };
@@ -23,4 +23,6 @@ PlaneActor::PlaneActor(Game* game)
 	// Add collision box
 	BoxComponent* bc = new BoxComponent(this);
 	bc->SetObjectBox(mesh->GetBox());
+	// Walls/floors never move
+	bc->SetStatic(true);
 }
@@ -12,9 +12,20 @@
 #include "Renderer.h"
 #include "Mesh.h"
 #include "VertexArray.h"
+#include "RenderDevice.h"
 #include "Actor.h"
 #include "LevelLoader.h"
 
+namespace
+{
+	// The point light shader's uniforms
+	UniformHandle<Matrix4> sWorldTransform;
+	UniformHandle<Vector3> sWorldPos;
+	UniformHandle<Vector3> sDiffuseColor;
+	UniformHandle<float> sInnerRadius;
+	UniformHandle<float> sOuterRadius;
+}
+
 PointLightComponent::PointLightComponent(Actor* owner)
 	:Component(owner)
 {
@@ -26,6 +37,15 @@ PointLightComponent::~PointLightComponent()
 	mOwner->GetGame()->GetRenderer()->RemovePointLight(this);
 }
 
+void PointLightComponent::FindUniforms(Shader* shader)
+{
+	sWorldTransform = shader->GetUniform<Matrix4>("uWorldTransform");
+	sWorldPos = shader->GetUniform<Vector3>("uPointLight.mWorldPos");
+	sDiffuseColor = shader->GetUniform<Vector3>("uPointLight.mDiffuseColor");
+	sInnerRadius = shader->GetUniform<float>("uPointLight.mInnerRadius");
+	sOuterRadius = shader->GetUniform<float>("uPointLight.mOuterRadius");
+}
+
 void PointLightComponent::Draw(Shader* shader, Mesh* mesh)
 {
 	// We assume, coming into this function, that the shader is active
@@ -33,20 +53,22 @@ void PointLightComponent::Draw(Shader* shader, Mesh* mesh)
 
 	// World transform is scaled to the outer radius (divided by the mesh radius)
 	// and positioned to the world position
+	// (Use the interpolated render position, so lights stay with their meshes)
+	Vector3 pos = mOwner->GetRenderTransform().GetTranslation();
 	Matrix4 scale = Matrix4::CreateScale(mOwner->GetScale() *
 		mOuterRadius / mesh->GetRadius());
-	Matrix4 trans = Matrix4::CreateTranslation(mOwner->GetPosition());
+	Matrix4 trans = Matrix4::CreateTranslation(pos);
 	Matrix4 worldTransform = scale * trans;
-	shader->SetMatrixUniform("uWorldTransform", worldTransform);
+	shader->SetUniform(sWorldTransform, worldTransform);
 	// Set point light shader constants
-	shader->SetVectorUniform("uPointLight.mWorldPos", mOwner->GetPosition());
-	shader->SetVectorUniform("uPointLight.mDiffuseColor", mDiffuseColor);
-	shader->SetFloatUniform("uPointLight.mInnerRadius", mInnerRadius);
-	shader->SetFloatUniform("uPointLight.mOuterRadius", mOuterRadius);
+	shader->SetUniform(sWorldPos, pos);
+	shader->SetUniform(sDiffuseColor, mDiffuseColor);
+	shader->SetUniform(sInnerRadius, mInnerRadius);
+	shader->SetUniform(sOuterRadius, mOuterRadius);
 
 	// Draw the sphere
-	glDrawElements(GL_TRIANGLES, mesh->GetVertexArray()->GetNumIndices(), 
-		GL_UNSIGNED_INT, nullptr);
+	mOwner->GetGame()->GetRenderer()->GetDevice()->DrawIndexed(
+		mesh->GetVertexArray()->GetNumIndices());
 }
 
 void PointLightComponent::LoadProperties(const rapidjson::Value& inObj)
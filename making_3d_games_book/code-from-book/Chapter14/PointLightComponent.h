@@ -16,6 +16,8 @@ public:
 	PointLightComponent(class Actor* owner);
 	~PointLightComponent();
 
+	// Find the point light shader's uniforms (once, after it loads)
+	static void FindUniforms(class Shader* shader);
 	// Draw this point light as geometry
 	void Draw(class Shader* shader, class Mesh* mesh);
 
@@ -0,0 +1,172 @@
+// ----------------------------------------------------------------
+// From Game Programming in C++ by Sanjay Madhav
+// Copyright (C) 2017 Sanjay Madhav. All rights reserved.
+// 
+// Released under the BSD License
+// See LICENSE in root directory for full details.
+// ----------------------------------------------------------------
+
+#include "PoolAllocator.h"
+#include <SDL/SDL_log.h>
+#include <cstring>
+#include <new>
+
+namespace
+{
+	// Patterns for new (not yet constructed) and freed memory
+	const unsigned char NewByte = 0xCD;
+	const unsigned char FreeByte = 0xDD;
+}
+
+PoolAllocator::PoolAllocator(const char* name)
+	:mName(name)
+	,mLargeInUse(0)
+	,mLargeTotal(0)
+{
+	for (SizeClass& c : mClasses)
+	{
+		c.mFreeList = nullptr;
+		c.mCapacity = 0;
+		c.mInUse = 0;
+		c.mPeakInUse = 0;
+		c.mTotalAllocs = 0;
+	}
+}
+
+PoolAllocator::~PoolAllocator()
+{
+	for (char* chunk : mChunks)
+	{
+		::operator delete(chunk);
+	}
+}
+
+void* PoolAllocator::Allocate(size_t size)
+{
+	if (size == 0 || size > MaxSize)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mLargeInUse++;
+		mLargeTotal++;
+		return ::operator new(size);
+	}
+
+	size_t classIndex = (size - 1) / Granularity;
+	size_t slotSize = (classIndex + 1) * Granularity;
+	FreeSlot* slot = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		SizeClass& c = mClasses[classIndex];
+		if (c.mFreeList == nullptr)
+		{
+			Grow(classIndex);
+		}
+		slot = c.mFreeList;
+		c.mFreeList = slot->mNext;
+		c.mInUse++;
+		c.mTotalAllocs++;
+		if (c.mInUse > c.mPeakInUse)
+		{
+			c.mPeakInUse = c.mInUse;
+		}
+	}
+
+#ifdef POOL_ALLOCATOR_POISON
+	// Everything after the free list link should still be the freed
+	// pattern, otherwise something wrote to it after it was freed
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(slot);
+	for (size_t i = sizeof(FreeSlot); i < slotSize; i++)
+	{
+		if (bytes[i] != FreeByte)
+		{
+			SDL_Log("%s pool: slot %p (%zu bytes) was written to after it was freed",
+				mName, static_cast<void*>(slot), slotSize);
+			break;
+		}
+	}
+	memset(slot, NewByte, slotSize);
+#endif
+	return slot;
+}
+
+void PoolAllocator::Free(void* ptr, size_t size)
+{
+	if (ptr == nullptr)
+	{
+		return;
+	}
+	if (size == 0 || size > MaxSize)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mLargeInUse--;
+		::operator delete(ptr);
+		return;
+	}
+
+	size_t classIndex = (size - 1) / Granularity;
+#ifdef POOL_ALLOCATOR_POISON
+	memset(ptr, FreeByte, (classIndex + 1) * Granularity);
+#endif
+	FreeSlot* slot = static_cast<FreeSlot*>(ptr);
+	std::lock_guard<std::mutex> lock(mMutex);
+	SizeClass& c = mClasses[classIndex];
+	slot->mNext = c.mFreeList;
+	c.mFreeList = slot;
+	c.mInUse--;
+}
+
+void PoolAllocator::Grow(size_t classIndex)
+{
+	size_t slotSize = (classIndex + 1) * Granularity;
+	size_t numSlots = ChunkSize / slotSize;
+	char* chunk = static_cast<char*>(::operator new(numSlots * slotSize));
+	mChunks.emplace_back(chunk);
+#ifdef POOL_ALLOCATOR_POISON
+	memset(chunk, FreeByte, numSlots * slotSize);
+#endif
+
+	// Link every slot into the free list (in address order, so
+	// objects allocated together sit next to each other)
+	SizeClass& c = mClasses[classIndex];
+	for (size_t i = numSlots; i > 0; i--)
+	{
+		FreeSlot* slot = reinterpret_cast<FreeSlot*>(chunk + (i - 1) * slotSize);
+		slot->mNext = c.mFreeList;
+		c.mFreeList = slot;
+	}
+	c.mCapacity += numSlots;
+}
+
+void PoolAllocator::GetStats(std::vector<Stats>& outStats) const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	outStats.clear();
+	for (size_t i = 0; i < NumClasses; i++)
+	{
+		const SizeClass& c = mClasses[i];
+		if (c.mTotalAllocs > 0)
+		{
+			Stats s;
+			s.mSlotSize = (i + 1) * Granularity;
+			s.mCapacity = c.mCapacity;
+			s.mInUse = c.mInUse;
+			s.mPeakInUse = c.mPeakInUse;
+			s.mTotalAllocs = c.mTotalAllocs;
+			outStats.emplace_back(s);
+		}
+	}
+}
+
+void PoolAllocator::LogStats() const
+{
+	std::vector<Stats> stats;
+	GetStats(stats);
+	SDL_Log("%s pool:", mName);
+	for (const Stats& s : stats)
+	{
+		SDL_Log("  %4zu bytes: %zu/%zu in use (peak %zu, %zu allocs)",
+			s.mSlotSize, s.mInUse, s.mCapacity, s.mPeakInUse, s.mTotalAllocs);
+	}
+	std::lock_guard<std::mutex> lock(mMutex);
+	SDL_Log("  large: %zu in use (%zu allocs)", mLargeInUse, mLargeTotal);
+}
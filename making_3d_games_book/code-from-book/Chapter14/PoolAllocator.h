@@ -0,0 +1,85 @@
+// ----------------------------------------------------------------
+// From Game Programming in C++ by Sanjay Madhav
+// Copyright (C) 2017 Sanjay Madhav. All rights reserved.
+// 
+// Released under the BSD License
+// See LICENSE in root directory for full details.
+// ----------------------------------------------------------------
+
+#pragma once
+#include <cstddef>
+#include <vector>
+#include <mutex>
+
+// Debug builds fill new and freed slots with a pattern, to catch
+// use after free (define POOL_ALLOCATOR_NO_POISON to turn it off)
+#if !defined(NDEBUG) && !defined(POOL_ALLOCATOR_NO_POISON)
+#define POOL_ALLOCATOR_POISON
+#endif
+
+// Hands out fixed-size slots from big chunks, with a free list for
+// each size class. Freed slots are reused by the next allocation
+// of the same size class, so spawning and destroying objects
+// doesn't go to the general heap.
+//
+// Pools are per base class (actors and components), not per type.
+// A class-level operator new is only given the size, not the type
+// being made, so keying by type would mean every subclass declaring
+// its own. Types of the same size class share slots instead, which
+// is all reuse needs.
+class PoolAllocator
+{
+public:
+	// Size classes are multiples of Granularity, up to MaxSize
+	// (anything bigger goes to the general heap)
+	static const size_t Granularity = 16;
+	static const size_t MaxSize = 1024;
+	static const size_t NumClasses = MaxSize / Granularity;
+	// Bytes per chunk
+	static const size_t ChunkSize = 64 * 1024;
+
+	PoolAllocator(const char* name);
+	~PoolAllocator();
+
+	void* Allocate(size_t size);
+	// Size must be the same as what was allocated
+	void Free(void* ptr, size_t size);
+
+	// Occupancy of each size class that's been used
+	struct Stats
+	{
+		size_t mSlotSize;
+		// Slots in every chunk for this class
+		size_t mCapacity;
+		size_t mInUse;
+		size_t mPeakInUse;
+		size_t mTotalAllocs;
+	};
+	void GetStats(std::vector<Stats>& outStats) const;
+	void LogStats() const;
+private:
+	struct FreeSlot
+	{
+		FreeSlot* mNext;
+	};
+	struct SizeClass
+	{
+		FreeSlot* mFreeList;
+		size_t mCapacity;
+		size_t mInUse;
+		size_t mPeakInUse;
+		size_t mTotalAllocs;
+	};
+	// Add a chunk of slots to this class's free list
+	void Grow(size_t classIndex);
+
+	const char* mName;
+	SizeClass mClasses[NumClasses];
+	std::vector<char*> mChunks;
+	// Allocations too big for any size class
+	size_t mLargeInUse;
+	size_t mLargeTotal;
+	// Objects are usually made on the main thread, but the
+	// command buffer and job threads can get here too
+	mutable std::mutex mMutex;
+};
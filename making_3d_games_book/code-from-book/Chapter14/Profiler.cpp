@@ -0,0 +1,186 @@
+// ----------------------------------------------------------------
+// From Game Programming in C++ by Sanjay Madhav
+// Copyright (C) 2017 Sanjay Madhav. All rights reserved.
+// 
+// Released under the BSD License
+// See LICENSE in root directory for full details.
+// ----------------------------------------------------------------
+
+#include "Profiler.h"
+#include <SDL/SDL.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <fstream>
+
+namespace
+{
+	struct ZoneEvent
+	{
+		const char* mName;
+		Uint64 mStart;
+		Uint64 mEnd;
+	};
+
+	// Ring buffer of zones for one thread. Only the owning thread
+	// writes to it, so recording a zone doesn't need a lock.
+	struct ThreadBuffer
+	{
+		static const unsigned Capacity = 1 << 16;
+		ZoneEvent mEvents[Capacity];
+		// Total number of zones ever written (the newest
+		// Capacity of them are still in the buffer)
+		std::atomic<Uint64> mCount;
+		int mThreadIndex;
+	};
+
+	// Every thread's buffer (these live until the program exits,
+	// so zones from finished threads can still be exported)
+	std::mutex sBufferMutex;
+	std::vector<ThreadBuffer*> sBuffers;
+	thread_local ThreadBuffer* tBuffer = nullptr;
+
+	// Trace timestamps are relative to this
+	const Uint64 sStartCounter = SDL_GetPerformanceCounter();
+
+	ThreadBuffer* GetThreadBuffer()
+	{
+		if (tBuffer == nullptr)
+		{
+			// First zone on this thread, so register a new buffer
+			tBuffer = new ThreadBuffer();
+			tBuffer->mCount.store(0);
+			std::lock_guard<std::mutex> lock(sBufferMutex);
+			tBuffer->mThreadIndex = static_cast<int>(sBuffers.size());
+			sBuffers.emplace_back(tBuffer);
+		}
+		return tBuffer;
+	}
+
+	// Rolling frame-time histogram (main thread only)
+	int sFrameBucketIndex[Profiler::FrameWindow];
+	int sFrameBuckets[Profiler::NumFrameBuckets];
+	int sFrameCount = 0;
+	int sFrameNext = 0;
+	Uint64 sLastFrame = 0;
+}
+
+void Profiler::RecordZone(const char* name, Uint64 start, Uint64 end)
+{
+	ThreadBuffer* buf = GetThreadBuffer();
+	Uint64 count = buf->mCount.load(std::memory_order_relaxed);
+	ZoneEvent& e = buf->mEvents[count & (ThreadBuffer::Capacity - 1)];
+	e.mName = name;
+	e.mStart = start;
+	e.mEnd = end;
+	// Publish the zone to the exporter
+	buf->mCount.store(count + 1, std::memory_order_release);
+}
+
+void Profiler::MarkFrame()
+{
+	Uint64 now = SDL_GetPerformanceCounter();
+	if (sLastFrame != 0)
+	{
+		double ms = (now - sLastFrame) * 1000.0 /
+			static_cast<double>(SDL_GetPerformanceFrequency());
+		int bucket = static_cast<int>(ms);
+		if (bucket >= NumFrameBuckets)
+		{
+			bucket = NumFrameBuckets - 1;
+		}
+
+		// Once the window is full, drop the oldest frame
+		if (sFrameCount == FrameWindow)
+		{
+			sFrameBuckets[sFrameBucketIndex[sFrameNext]]--;
+		}
+		else
+		{
+			sFrameCount++;
+		}
+		sFrameBucketIndex[sFrameNext] = bucket;
+		sFrameBuckets[bucket]++;
+		sFrameNext = (sFrameNext + 1) % FrameWindow;
+	}
+	sLastFrame = now;
+}
+
+bool Profiler::WriteTrace(const std::string& fileName)
+{
+	double toUs = 1000000.0 / static_cast<double>(SDL_GetPerformanceFrequency());
+
+	rapidjson::StringBuffer buffer;
+	rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+	writer.StartObject();
+	writer.Key("traceEvents");
+	writer.StartArray();
+	{
+		std::lock_guard<std::mutex> lock(sBufferMutex);
+		for (ThreadBuffer* buf : sBuffers)
+		{
+			Uint64 count = buf->mCount.load(std::memory_order_acquire);
+			Uint64 first = 0;
+			if (count > ThreadBuffer::Capacity)
+			{
+				first = count - ThreadBuffer::Capacity;
+			}
+			for (Uint64 i = first; i < count; i++)
+			{
+				const ZoneEvent& e = buf->mEvents[i & (ThreadBuffer::Capacity - 1)];
+				// "X" is a complete event (with a start and duration)
+				writer.StartObject();
+				writer.Key("name");
+				writer.String(e.mName);
+				writer.Key("ph");
+				writer.String("X");
+				writer.Key("ts");
+				writer.Double((e.mStart - sStartCounter) * toUs);
+				writer.Key("dur");
+				writer.Double((e.mEnd - e.mStart) * toUs);
+				writer.Key("pid");
+				writer.Int(0);
+				writer.Key("tid");
+				writer.Int(buf->mThreadIndex);
+				writer.EndObject();
+			}
+		}
+	}
+	writer.EndArray();
+	writer.Key("displayTimeUnit");
+	writer.String("ms");
+	writer.EndObject();
+
+	std::ofstream outFile(fileName);
+	if (!outFile.is_open())
+	{
+		SDL_Log("Failed to write profile trace to %s", fileName.c_str());
+		return false;
+	}
+	outFile << buffer.GetString();
+	SDL_Log("Wrote profile trace to %s", fileName.c_str());
+	return true;
+}
+
+void Profiler::GetFrameHistogram(int outBuckets[NumFrameBuckets])
+{
+	for (int i = 0; i < NumFrameBuckets; i++)
+	{
+		outBuckets[i] = sFrameBuckets[i];
+	}
+}
+
+void Profiler::LogFrameHistogram()
+{
+	SDL_Log("Frame times (last %d frames):", sFrameCount);
+	for (int i = 0; i < NumFrameBuckets; i++)
+	{
+		if (sFrameBuckets[i] > 0)
+		{
+			const char* over = (i == NumFrameBuckets - 1) ? "+" : " ";
+			SDL_Log("  %2d ms%s %d", i, over, sFrameBuckets[i]);
+		}
+	}
+}
@@ -0,0 +1,62 @@
+// ----------------------------------------------------------------
+// From Game Programming in C++ by Sanjay Madhav
+// Copyright (C) 2017 Sanjay Madhav. All rights reserved.
+// 
+// Released under the BSD License
+// See LICENSE in root directory for full details.
+// ----------------------------------------------------------------
+
+#pragma once
+#include <string>
+#include <SDL/SDL_timer.h>
+
+// Records timed zones into per-thread buffers, which can be
+// exported as Chrome trace_event JSON (load in chrome://tracing).
+// Also keeps a rolling histogram of recent frame times.
+class Profiler
+{
+public:
+	// Record a completed zone for the calling thread
+	// (name must outlive the profiler, such as a string literal)
+	static void RecordZone(const char* name, Uint64 start, Uint64 end);
+
+	// Call once per frame to update the frame-time histogram
+	static void MarkFrame();
+
+	// Write every recorded zone as Chrome trace_event JSON
+	static bool WriteTrace(const std::string& fileName);
+
+	// Frame-time histogram, in 1 ms buckets (the last bucket
+	// counts every frame at or over NumFrameBuckets - 1 ms)
+	static const int NumFrameBuckets = 34;
+	static const int FrameWindow = 600;
+	static void GetFrameHistogram(int outBuckets[NumFrameBuckets]);
+	static void LogFrameHistogram();
+};
+
+// Times from construction to destruction of this object
+class ProfileScope
+{
+public:
+	ProfileScope(const char* name)
+		:mName(name)
+		,mStart(SDL_GetPerformanceCounter())
+	{
+	}
+	~ProfileScope()
+	{
+		Profiler::RecordZone(mName, mStart, SDL_GetPerformanceCounter());
+	}
+private:
+	const char* mName;
+	Uint64 mStart;
+};
+
+// Define PROFILER_DISABLED to compile out every zone
+#ifdef PROFILER_DISABLED
+#define PROFILE_SCOPE(name)
+#else
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#endif
@@ -0,0 +1,160 @@
+// ----------------------------------------------------------------
+// From Game Programming in C++ by Sanjay Madhav
+// Copyright (C) 2017 Sanjay Madhav. All rights reserved.
+// 
+// Released under the BSD License
+// See LICENSE in root directory for full details.
+// ----------------------------------------------------------------
+
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "Math.h"
+
+// Thin interface over the graphics API. The renderer (and its
+// textures, vertex arrays, shaders and G-buffer) create and draw
+// everything through a device. Objects are referred to by IDs,
+// and 0 is never a valid ID.
+class RenderDevice
+{
+public:
+	virtual ~RenderDevice() { }
+
+	enum BufferType
+	{
+		EVertexBuffer,
+		EIndexBuffer,
+		EUniformBuffer
+	};
+	enum TextureFormat
+	{
+		ERGB8,
+		ERGBA8,
+		// Same as ERGBA8, but the pixels are in BGRA order
+		EBGRA8,
+		ERGB32F
+	};
+	enum TextureFilter
+	{
+		ENearest,
+		ELinear,
+		// Linear, with mipmaps (and anisotropic filtering, if supported)
+		EMipmapped
+	};
+	enum BlendMode
+	{
+		EBlendNone,
+		// Blend by source alpha
+		EBlendAlpha,
+		// Add source to destination
+		EBlendAdd
+	};
+	enum AttribType
+	{
+		EAttribFloat,
+		// Bytes, read as ints
+		EAttribUInt8,
+		// Bytes, read as floats from 0 to 1
+		EAttribUNorm8
+	};
+	enum UniformType
+	{
+		EUniformMatrix4,
+		EUniformVector3,
+		EUniformVector2,
+		EUniformFloat,
+		EUniformInt,
+		EUniformSampler,
+		EUniformOther
+	};
+
+	// One attribute of a vertex
+	struct VertexAttrib
+	{
+		unsigned mIndex;
+		// Number of components
+		unsigned mCount;
+		AttribType mType;
+		// Offset in bytes from the start of the vertex
+		unsigned mOffset;
+	};
+
+	// One active uniform of a program (arrays are named without "[0]")
+	struct UniformDesc
+	{
+		std::string mName;
+		int mLocation;
+		UniformType mType;
+	};
+
+	// Called at the start of every frame drawn
+	virtual void BeginFrame() = 0;
+
+	// Buffers. Dynamic buffers are updated often.
+	virtual unsigned CreateBuffer(BufferType type, size_t size, const void* data,
+		bool dynamic) = 0;
+	virtual void DestroyBuffer(unsigned buffer) = 0;
+	// Replace all of a buffer's data (such as data written every frame)
+	virtual void SetBufferData(unsigned buffer, size_t size, const void* data) = 0;
+	// Overwrite part of a buffer's data
+	virtual void UpdateBuffer(unsigned buffer, size_t offset, size_t size,
+		const void* data) = 0;
+	// Use a uniform buffer for the blocks read from this binding point
+	virtual void BindUniformBuffer(unsigned buffer, unsigned binding) = 0;
+
+	// Vertex arrays read these attributes from the vertex
+	// buffer (stride bytes per vertex), with an index buffer
+	virtual unsigned CreateVertexArray(unsigned vertexBuffer, unsigned indexBuffer,
+		unsigned stride, const VertexAttrib* attribs, unsigned numAttribs) = 0;
+	virtual void DestroyVertexArray(unsigned vertexArray) = 0;
+	virtual void BindVertexArray(unsigned vertexArray) = 0;
+	// Read a Matrix4 per instance, starting offset bytes into the
+	// buffer, as the four attributes from firstAttrib (into the
+	// bound vertex array)
+	virtual void SetInstanceTransforms(unsigned buffer, unsigned firstAttrib,
+		size_t offset) = 0;
+
+	// Textures (pixels can be null, for a texture to render to)
+	virtual unsigned CreateTexture(int width, int height, TextureFormat format,
+		const void* pixels, TextureFilter filter) = 0;
+	virtual void DestroyTexture(unsigned texture) = 0;
+	virtual void BindTexture(unsigned texture, unsigned unit) = 0;
+
+	// Framebuffers draw to these textures, and have their own depth
+	// buffer (returns 0 if the framebuffer can't be created)
+	virtual unsigned CreateFramebuffer(int width, int height,
+		const unsigned* textures, unsigned numTextures) = 0;
+	virtual void DestroyFramebuffer(unsigned framebuffer) = 0;
+	// Framebuffer 0 is the window
+	virtual void BindFramebuffer(unsigned framebuffer) = 0;
+	// Copy a framebuffer's depth into the bound framebuffer
+	virtual void BlitDepth(unsigned framebuffer, int width, int height) = 0;
+
+	// Compile and link a program from GLSL source
+	// (returns 0 and logs the errors if it fails)
+	virtual unsigned CreateProgram(const char* vertSource, const char* fragSource) = 0;
+	virtual void DestroyProgram(unsigned program) = 0;
+	virtual void UseProgram(unsigned program) = 0;
+	// Get every active uniform of a program (outside of blocks)
+	virtual void GetUniforms(unsigned program, std::vector<UniformDesc>& outUniforms) = 0;
+	// Read the named uniform block from this binding point
+	// (returns false if the program has no such block)
+	virtual bool BindUniformBlock(unsigned program, const char* name,
+		unsigned binding) = 0;
+	// Set a uniform of the program in use (location -1 is ignored)
+	virtual void SetUniform(int location, const Matrix4* matrices, unsigned count) = 0;
+	virtual void SetUniform(int location, const Vector3& vector) = 0;
+	virtual void SetUniform(int location, const Vector2& vector) = 0;
+	virtual void SetUniform(int location, float value) = 0;
+	virtual void SetUniform(int location, int value) = 0;
+
+	// Clear the bound framebuffer's color (to black) and depth
+	virtual void Clear() = 0;
+	virtual void SetDepthState(bool test, bool write) = 0;
+	virtual void SetBlendMode(BlendMode mode) = 0;
+
+	// Draw triangles from the bound vertex array
+	virtual void DrawIndexed(unsigned numIndices) = 0;
+	virtual void DrawIndexedInstanced(unsigned numIndices, unsigned numInstances) = 0;
+};
@@ -0,0 +1,96 @@
+// ----------------------------------------------------------------
+// From Game Programming in C++ by Sanjay Madhav
+// Copyright (C) 2017 Sanjay Madhav. All rights reserved.
+// 
+// Released under the BSD License
+// See LICENSE in root directory for full details.
+// ----------------------------------------------------------------
+
+#include "RenderQueue.h"
+#include "Math.h"
+#include "MeshComponent.h"
+
+uint64_t RenderQueue::MakeKey(Pass pass, unsigned shader, unsigned texture,
+	unsigned mesh, float depth)
+{
+	const uint32_t MaxDepth = (1 << 24) - 1;
+	uint32_t depthBits = static_cast<uint32_t>(Math::Clamp(depth, 0.0f, 1.0f) * MaxDepth);
+	if (pass == ETransparent)
+	{
+		depthBits = MaxDepth - depthBits;
+	}
+	return (static_cast<uint64_t>(pass & 0x3) << 62) |
+		(static_cast<uint64_t>(shader & 0x3F) << ShaderShift) |
+		(static_cast<uint64_t>(texture & 0xFFFF) << 40) |
+		(static_cast<uint64_t>(mesh & 0xFFFF) << 24) |
+		depthBits;
+}
+
+void RenderQueue::Sort(uint32_t instancedShaders)
+{
+	// Count every byte of every key up front
+	size_t counts[8][256] = {};
+	for (const Packet& p : mPackets)
+	{
+		for (int byte = 0; byte < 8; byte++)
+		{
+			counts[byte][(p.mKey >> (byte * 8)) & 0xFF]++;
+		}
+	}
+
+	// Then sort by each byte, lowest first. Most bytes are the
+	// same for every packet (few shaders, the pass), so skip those.
+	mSorted.resize(mPackets.size());
+	for (int byte = 0; byte < 8; byte++)
+	{
+		size_t* count = counts[byte];
+		if (mPackets.empty() || count[(mPackets[0].mKey >> (byte * 8)) & 0xFF] == mPackets.size())
+		{
+			continue;
+		}
+		size_t offset = 0;
+		for (int i = 0; i < 256; i++)
+		{
+			size_t c = count[i];
+			count[i] = offset;
+			offset += c;
+		}
+		for (const Packet& p : mPackets)
+		{
+			mSorted[count[(p.mKey >> (byte * 8)) & 0xFF]++] = p;
+		}
+		mPackets.swap(mSorted);
+	}
+
+	BuildBatches(instancedShaders);
+}
+
+void RenderQueue::BuildBatches(uint32_t instancedShaders)
+{
+	mBatches.clear();
+	size_t i = 0;
+	while (i < mPackets.size())
+	{
+		Batch batch{ i, 1 };
+		const MeshComponent* first = mPackets[i].mMeshComp;
+		unsigned shader = GetShader(mPackets[i].mKey);
+		if ((instancedShaders & (1u << shader)) != 0)
+		{
+			// The keys only hold the low bits of the IDs,
+			// so check the mesh and texture themselves
+			while (i + batch.mCount < mPackets.size())
+			{
+				const Packet& p = mPackets[i + batch.mCount];
+				if (GetShader(p.mKey) != shader ||
+					p.mMeshComp->GetMesh() != first->GetMesh() ||
+					p.mMeshComp->GetTexture() != first->GetTexture())
+				{
+					break;
+				}
+				batch.mCount++;
+			}
+		}
+		mBatches.emplace_back(batch);
+		i += batch.mCount;
+	}
+}
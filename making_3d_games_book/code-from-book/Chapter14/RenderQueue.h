@@ -0,0 +1,88 @@
+// ----------------------------------------------------------------
+// From Game Programming in C++ by Sanjay Madhav
+// Copyright (C) 2017 Sanjay Madhav. All rights reserved.
+// 
+// Released under the BSD License
+// See LICENSE in root directory for full details.
+// ----------------------------------------------------------------
+
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// GL work the renderer did to draw the meshes in a frame
+struct RenderStats
+{
+	size_t mDraws;
+	// Meshes drawn (more than mDraws when they're instanced)
+	size_t mInstances;
+	size_t mProgramBinds;
+	size_t mTextureBinds;
+	size_t mVAOBinds;
+};
+
+// Everything a pass draws, as packets with a 64-bit sort key.
+// Sorting by key groups draws that share a shader, texture and
+// mesh, so the renderer can skip binding what's already bound,
+// and orders draws with the same state front to back.
+class RenderQueue
+{
+public:
+	enum Pass
+	{
+		// Drawn first, front to back (so early-z rejects more)
+		EOpaque,
+		// Drawn after, back to front
+		ETransparent
+	};
+
+	struct Packet
+	{
+		uint64_t mKey;
+		class MeshComponent* mMeshComp;
+	};
+
+	// Packets [mFirst, mFirst + mCount) drawn with one draw call
+	struct Batch
+	{
+		size_t mFirst;
+		size_t mCount;
+	};
+
+	// Pack a key. From the top bit down, it's the pass (2 bits),
+	// shader (6), texture (16), mesh (16) and depth (24). IDs past
+	// their bits wrap, which only costs extra binds. depth is the
+	// distance from the camera over the far plane distance.
+	static uint64_t MakeKey(Pass pass, unsigned shader, unsigned texture,
+		unsigned mesh, float depth);
+	static unsigned GetShader(uint64_t key)
+	{
+		return static_cast<unsigned>(key >> ShaderShift) & 0x3F;
+	}
+
+	void Clear()
+	{
+		mPackets.clear();
+		mBatches.clear();
+	}
+	void Add(uint64_t key, class MeshComponent* meshComp)
+	{
+		mPackets.emplace_back(Packet{ key, meshComp });
+	}
+	// Radix sort the packets by key, then batch them. Packets next
+	// to each other with the same mesh and texture go in one batch
+	// if their shader is one of the instancedShaders bits (every
+	// other packet gets a batch of its own).
+	void Sort(uint32_t instancedShaders = 0);
+	const std::vector<Packet>& GetPackets() const { return mPackets; }
+	const std::vector<Batch>& GetBatches() const { return mBatches; }
+private:
+	void BuildBatches(uint32_t instancedShaders);
+
+	static const int ShaderShift = 56;
+	std::vector<Packet> mPackets;
+	std::vector<Batch> mBatches;
+	// Scratch space for the sort
+	std::vector<Packet> mSorted;
+};
@@ -16,21 +16,123 @@
 #include "MeshComponent.h"
 #include "UIScreen.h"
 #include "Game.h"
-#include <GL/glew.h>
+#include "GLRenderDevice.h"
+#include "NullRenderDevice.h"
 #include "SkeletalMeshComponent.h"
 #include "GBuffer.h"
 #include "PointLightComponent.h"
+#include "Profiler.h"
+#include "Actor.h"
+
+namespace
+{
+	const float NearPlane = 10.0f;
+	const float FarPlane = 10000.0f;
+
+	// Shader field of the render queue keys
+	const unsigned MeshShaderID = 0;
+	const unsigned SkinnedShaderID = 1;
+
+	// Uniform buffer binding point for the FrameData block
+	const unsigned FrameDataBinding = 0;
+
+	// Matches the FrameData uniform block. With std140,
+	// each vec3 is padded out to 16 bytes.
+	struct FrameUniforms
+	{
+		Matrix4 mViewProj;
+		Vector3 mCameraPos;
+		float mPad0;
+		Vector3 mAmbientLight;
+		float mPad1;
+		Vector3 mDirDirection;
+		float mPad2;
+		Vector3 mDirDiffuseColor;
+		float mPad3;
+		Vector3 mDirSpecColor;
+		float mPad4;
+	};
+	static_assert(sizeof(FrameUniforms) == 144, "FrameUniforms doesn't match FrameData");
+
+	uint64_t MakeMeshKey(MeshComponent* mc, unsigned shader, const Matrix4& view)
+	{
+		Mesh* mesh = mc->GetMesh();
+		Texture* t = mc->GetTexture();
+		float depth = Vector3::Transform(mc->GetOwner()->GetRenderTransform().GetTranslation(),
+			view).z / FarPlane;
+		return RenderQueue::MakeKey(RenderQueue::EOpaque, shader,
+			t ? t->GetSortID() : 0, mesh->GetSortID(), depth);
+	}
+
+	// Get the camera position and orientation back out of a view
+	// matrix from CreateLookAt. The rotation takes +x/+y/+z to the
+	// camera's side/up/forward, which are the columns of the view.
+	void DecomposeView(const Matrix4& view, Vector3& outEye, Quaternion& outRot)
+	{
+		const float (*m)[4] = view.mat;
+		Vector3 side(m[0][0], m[1][0], m[2][0]);
+		Vector3 up(m[0][1], m[1][1], m[2][1]);
+		Vector3 forward(m[0][2], m[1][2], m[2][2]);
+		outEye = (side * m[3][0] + up * m[3][1] + forward * m[3][2]) * -1.0f;
+
+		// Rotation matrix to quaternion (from the largest
+		// component, so it doesn't divide by something tiny)
+		float trace = m[0][0] + m[1][1] + m[2][2];
+		if (trace > 0.0f)
+		{
+			float s = Math::Sqrt(trace + 1.0f) * 2.0f;
+			outRot.w = 0.25f * s;
+			outRot.x = (m[2][1] - m[1][2]) / s;
+			outRot.y = (m[0][2] - m[2][0]) / s;
+			outRot.z = (m[1][0] - m[0][1]) / s;
+		}
+		else if (m[0][0] > m[1][1] && m[0][0] > m[2][2])
+		{
+			float s = Math::Sqrt(1.0f + m[0][0] - m[1][1] - m[2][2]) * 2.0f;
+			outRot.w = (m[2][1] - m[1][2]) / s;
+			outRot.x = 0.25f * s;
+			outRot.y = (m[0][1] + m[1][0]) / s;
+			outRot.z = (m[0][2] + m[2][0]) / s;
+		}
+		else if (m[1][1] > m[2][2])
+		{
+			float s = Math::Sqrt(1.0f + m[1][1] - m[0][0] - m[2][2]) * 2.0f;
+			outRot.w = (m[0][2] - m[2][0]) / s;
+			outRot.x = (m[0][1] + m[1][0]) / s;
+			outRot.y = 0.25f * s;
+			outRot.z = (m[1][2] + m[2][1]) / s;
+		}
+		else
+		{
+			float s = Math::Sqrt(1.0f + m[2][2] - m[0][0] - m[1][1]) * 2.0f;
+			outRot.w = (m[1][0] - m[0][1]) / s;
+			outRot.x = (m[0][2] + m[2][0]) / s;
+			outRot.y = (m[1][2] + m[2][1]) / s;
+			outRot.z = 0.25f * s;
+		}
+	}
+}
 
 Renderer::Renderer(Game* game)
-	:mGame(game)
+	:mCullStats()
+	,mRenderStats()
+	,mGame(game)
 	,mSpriteShader(nullptr)
+	,mSpriteVerts(nullptr)
 	,mMeshShader(nullptr)
 	,mSkinnedShader(nullptr)
+	,mHeadless(false)
+	,mDevice(nullptr)
+	,mWindow(nullptr)
+	,mContext(nullptr)
 	,mMirrorBuffer(0)
 	,mMirrorTexture(nullptr)
 	,mGBuffer(nullptr)
 	,mGGlobalShader(nullptr)
 	,mGPointLightShader(nullptr)
+	,mPointLightMesh(nullptr)
+	,mInstanceBuffer(0)
+	,mFrameUniformBuffer(0)
 {
 }
 
@@ -43,46 +145,25 @@ bool Renderer::Initialize(float screenWidth, float screenHeight)
 	mScreenWidth = screenWidth;
 	mScreenHeight = screenHeight;
 
-	// Set OpenGL attributes
-	// Use the core OpenGL profile
-	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
-	// Specify version 3.3
-	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
-	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
-	// Request a color buffer with 8-bits per RGBA channel
-	SDL_GL_SetAttribute(SDL_GL_RED_SIZE, 8);
-	SDL_GL_SetAttribute(SDL_GL_GREEN_SIZE, 8);
-	SDL_GL_SetAttribute(SDL_GL_BLUE_SIZE, 8);
-	SDL_GL_SetAttribute(SDL_GL_ALPHA_SIZE, 8);
-	SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
-	// Enable double buffering
-	SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
-	// Force OpenGL to use hardware acceleration
-	SDL_GL_SetAttribute(SDL_GL_ACCELERATED_VISUAL, 1);
+	// Set up the view/projection matrices
+	mView = Matrix4::CreateLookAt(Vector3::Zero, Vector3::UnitX, Vector3::UnitZ);
+	mPrevView = mView;
+	mRenderView = mView;
+	mProjection = Matrix4::CreatePerspectiveFOV(Math::ToRadians(70.0f),
+		mScreenWidth, mScreenHeight, NearPlane, FarPlane);
 
-	mWindow = SDL_CreateWindow("Game Programming in C++ (Chapter 14)", 100, 100,
-		static_cast<int>(mScreenWidth), static_cast<int>(mScreenHeight), SDL_WINDOW_OPENGL);
-	if (!mWindow)
+	// Without a window, draw to a device that only records commands
+	mHeadless = mGame->IsHeadless();
+	if (mHeadless)
 	{
-		SDL_Log("Failed to create window: %s", SDL_GetError());
-		return false;
+		SDL_Log("Renderer running headless");
+		mDevice = new NullRenderDevice();
 	}
-
-	// Create an OpenGL context
-	mContext = SDL_GL_CreateContext(mWindow);
-
-	// Initialize GLEW
-	glewExperimental = GL_TRUE;
-	if (glewInit() != GLEW_OK)
+	else if (!CreateGLDevice())
 	{
-		SDL_Log("Failed to initialize GLEW.");
 		return false;
 	}
 
-	// On some platforms, GLEW will emit a benign error code,
-	// so clear it
-	glGetError();
-
 	// Make sure we can create/compile shaders
 	if (!LoadShaders())
 	{
@@ -90,6 +171,11 @@ bool Renderer::Initialize(float screenWidth, float screenHeight)
 		return false;
 	}
 
+	// Create the buffer for the per-frame uniforms
+	mFrameUniformBuffer = mDevice->CreateBuffer(RenderDevice::EUniformBuffer,
+		sizeof(FrameUniforms), nullptr, true);
+	mDevice->BindUniformBuffer(mFrameUniformBuffer, FrameDataBinding);
+
 	// Create quad for drawing sprites
 	CreateSpriteVerts();
 
@@ -101,7 +187,7 @@ bool Renderer::Initialize(float screenWidth, float screenHeight)
 	//}
 	
 	// Create G-buffer
-	mGBuffer = new GBuffer();
+	mGBuffer = new GBuffer(mDevice);
 	int width = static_cast<int>(mScreenWidth);
 	int height = static_cast<int>(mScreenHeight);
 	if (!mGBuffer->Create(width, height))
@@ -113,15 +199,63 @@ bool Renderer::Initialize(float screenWidth, float screenHeight)
 	// Load point light mesh
 	mPointLightMesh = GetMesh("Assets/PointLight.gpmesh");
 
+	// Create the buffer for instance transforms
+	mInstanceBuffer = mDevice->CreateBuffer(RenderDevice::EVertexBuffer, 0, nullptr, true);
+
 	return true;
 }
 
+bool Renderer::CreateGLDevice()
+{
+	// Set OpenGL attributes
+	// Use the core OpenGL profile
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+	// Specify version 3.3
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+	// Request a color buffer with 8-bits per RGBA channel
+	SDL_GL_SetAttribute(SDL_GL_RED_SIZE, 8);
+	SDL_GL_SetAttribute(SDL_GL_GREEN_SIZE, 8);
+	SDL_GL_SetAttribute(SDL_GL_BLUE_SIZE, 8);
+	SDL_GL_SetAttribute(SDL_GL_ALPHA_SIZE, 8);
+	SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
+	// Enable double buffering
+	SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+	// Force OpenGL to use hardware acceleration
+	SDL_GL_SetAttribute(SDL_GL_ACCELERATED_VISUAL, 1);
+
+	mWindow = SDL_CreateWindow("Game Programming in C++ (Chapter 14)", 100, 100,
+		static_cast<int>(mScreenWidth), static_cast<int>(mScreenHeight), SDL_WINDOW_OPENGL);
+	if (!mWindow)
+	{
+		SDL_Log("Failed to create window: %s", SDL_GetError());
+		return false;
+	}
+
+	// Create an OpenGL context
+	mContext = SDL_GL_CreateContext(mWindow);
+
+	// Create the device (this initializes GLEW)
+	GLRenderDevice* device = new GLRenderDevice();
+	mDevice = device;
+	return device->Initialize();
+}
+
 void Renderer::Shutdown()
 {
+	// Delete point lights
+	while (!mPointLights.empty())
+	{
+		delete mPointLights.back();
+	}
+	if (mDevice == nullptr)
+	{
+		return;
+	}
 	// Get rid of any render target textures, if they exist
 	if (mMirrorTexture != nullptr)
 	{
-		glDeleteFramebuffers(1, &mMirrorBuffer);
+		mDevice->DestroyFramebuffer(mMirrorBuffer);
 		mMirrorTexture->Unload();
 		delete mMirrorTexture;
 	}
@@ -131,18 +265,20 @@ void Renderer::Shutdown()
 		mGBuffer->Destroy();
 		delete mGBuffer;
 	}
-	// Delete point lights
-	while (!mPointLights.empty())
-	{
-		delete mPointLights.back();
-	}
+	mDevice->DestroyBuffer(mInstanceBuffer);
+	mDevice->DestroyBuffer(mFrameUniformBuffer);
 	delete mSpriteVerts;
 	mSpriteShader->Unload();
 	delete mSpriteShader;
 	mMeshShader->Unload();
 	delete mMeshShader;
-	SDL_GL_DeleteContext(mContext);
-	SDL_DestroyWindow(mWindow);
+	delete mDevice;
+	mDevice = nullptr;
+	if (!mHeadless)
+	{
+		SDL_GL_DeleteContext(mContext);
+		SDL_DestroyWindow(mWindow);
+	}
 }
 
 void Renderer::UnloadData()
@@ -164,24 +300,48 @@ void Renderer::UnloadData()
 	mMeshes.clear();
 }
 
-void Renderer::Draw()
+void Renderer::Draw(float alpha)
 {
+	// Blend the camera between simulation steps (lerp its position,
+	// slerp its orientation, and rebuild the view from them)
+	Vector3 prevEye, eye;
+	Quaternion prevRot, rot;
+	DecomposeView(mPrevView, prevEye, prevRot);
+	DecomposeView(mView, eye, rot);
+	eye = Vector3::Lerp(prevEye, eye, alpha);
+	rot = Quaternion::Slerp(prevRot, rot, alpha);
+	mRenderView = Matrix4::CreateLookAt(eye, eye + Vector3::Transform(Vector3::UnitZ, rot),
+		Vector3::Transform(Vector3::UnitY, rot));
+
+	// Figure out what needs to be drawn
+	mRenderStats = RenderStats();
+	ExtractScene();
+	mDevice->BeginFrame();
+
 	// Draw to the mirror texture first
-	//Draw3DScene(mMirrorBuffer, mMirrorView, mProjection);
+	//UpdateFrameUniforms(mMirrorView, mProjection);
+	//Draw3DScene(mMirrorBuffer, mMirrorQueue);
+	// Everything else this frame uses the camera's view
+	UpdateFrameUniforms(mRenderView, mProjection);
 	// Draw the 3D scene to the G-buffer
-	Draw3DScene(mGBuffer->GetBufferID(), mView, mProjection, false);
+	{
+		PROFILE_SCOPE("Renderer::GBufferPass");
+		Draw3DScene(mGBuffer->GetBufferID(), mQueue);
+	}
 	// Set the frame buffer back to zero (screen's frame buffer)
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	mDevice->BindFramebuffer(0);
 	// Draw from the GBuffer
-	DrawFromGBuffer();
+	{
+		PROFILE_SCOPE("Renderer::LightingPass");
+		DrawFromGBuffer();
+	}
 	
 	// Draw all sprite components
+	PROFILE_SCOPE("Renderer::SpritePass");
 	// Disable depth buffering
-	glDisable(GL_DEPTH_TEST);
+	mDevice->SetDepthState(false, false);
 	// Enable alpha blending on the color buffer
-	glEnable(GL_BLEND);
-	glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
-	glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ZERO);
+	mDevice->SetBlendMode(RenderDevice::EBlendAlpha);
 
 	// Set shader/vao as active
 	mSpriteShader->SetActive();
@@ -201,7 +361,10 @@ void Renderer::Draw()
 	}
 
 	// Swap the buffers
-	SDL_GL_SwapWindow(mWindow);
+	if (!mHeadless)
+	{
+		SDL_GL_SwapWindow(mWindow);
+	}
 }
 
 void Renderer::AddSprite(SpriteComponent* sprite)
@@ -279,9 +442,11 @@ Texture* Renderer::GetTexture(const std::string& fileName)
 	}
 	else
 	{
-		tex = new Texture();
+		tex = new Texture(mDevice);
 		if (tex->Load(fileName))
 		{
+			// IDs start at 1, so draws without a texture sort first
+			tex->SetSortID(static_cast<unsigned>(mTextures.size()) + 1);
 			mTextures.emplace(fileName, tex);
 		}
 		else
@@ -306,6 +471,7 @@ Mesh* Renderer::GetMesh(const std::string & fileName)
 		m = new Mesh();
 		if (m->Load(fileName, this))
 		{
+			m->SetSortID(static_cast<unsigned>(mMeshes.size()));
 			mMeshes.emplace(fileName, m);
 		}
 		else
@@ -317,86 +483,245 @@ Mesh* Renderer::GetMesh(const std::string & fileName)
 	return m;
 }
 
-void Renderer::Draw3DScene(unsigned int framebuffer, const Matrix4& view, const Matrix4& proj, bool lit)
+namespace
 {
-	// Set the current frame buffer
-	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
-	// Clear color buffer/depth buffer
-	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-	glDepthMask(GL_TRUE);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	// Smallest world space box around an object space box
+	AABB TransformBox(const AABB& box, const Matrix4& transform)
+	{
+		Vector3 center = (box.mMin + box.mMax) * 0.5f;
+		Vector3 extents = (box.mMax - box.mMin) * 0.5f;
+		Vector3 worldCenter = Vector3::Transform(center, transform);
+		// Each world axis gets the most each local axis can add to it
+		const float* e = extents.GetAsFloatPtr();
+		float worldExtents[3];
+		for (int j = 0; j < 3; j++)
+		{
+			worldExtents[j] = 0.0f;
+			for (int i = 0; i < 3; i++)
+			{
+				worldExtents[j] += e[i] * Math::Abs(transform.mat[i][j]);
+			}
+		}
+		Vector3 worldExt(worldExtents[0], worldExtents[1], worldExtents[2]);
+		return AABB(worldCenter - worldExt, worldCenter + worldExt);
+	}
+}
 
-	// Draw mesh components
-	// Enable depth buffering/disable alpha blend
-	glEnable(GL_DEPTH_TEST);
-	glDisable(GL_BLEND);
-	// Set the mesh shader active
-	mMeshShader->SetActive();
-	// Update view-projection matrix
-	mMeshShader->SetMatrixUniform("uViewProj", view * proj);
-	// Update lighting uniforms
-	if (lit)
+void Renderer::ExtractScene()
+{
+	PROFILE_SCOPE("Renderer::ExtractScene");
+	// Update the bounds of everything that could be drawn
+	mCullStats.mMeshesTested = 0;
+	mMeshBounds.Resize(mMeshComps.size());
+	for (size_t i = 0; i < mMeshComps.size(); i++)
 	{
-		SetLightUniforms(mMeshShader, view);
+		MeshComponent* mc = mMeshComps[i];
+		if (mc->GetVisible() && mc->GetMesh() != nullptr)
+		{
+			mMeshBounds.Set(i, TransformBox(mc->GetMesh()->GetBox(),
+				mc->GetOwner()->GetRenderTransform()));
+			mCullStats.mMeshesTested++;
+		}
+		else
+		{
+			mMeshBounds.Clear(i);
+		}
 	}
-	for (auto mc : mMeshComps)
+
+	// Animations move the vertices around, so skinned meshes
+	// use the bind pose's radius (around the actor's position)
+	mCullStats.mSkeletalTested = 0;
+	mSkeletalBounds.Resize(mSkeletalMeshes.size());
+	for (size_t i = 0; i < mSkeletalMeshes.size(); i++)
 	{
-		if (mc->GetVisible())
+		SkeletalMeshComponent* sk = mSkeletalMeshes[i];
+		if (sk->GetVisible() && sk->GetMesh() != nullptr)
 		{
-			mc->Draw(mMeshShader);
+			Actor* owner = sk->GetOwner();
+			mSkeletalBounds.Set(i, Sphere(owner->GetRenderTransform().GetTranslation(),
+				sk->GetMesh()->GetRadius() * owner->GetWorldScale()));
+			mCullStats.mSkeletalTested++;
+		}
+		else
+		{
+			// Never in any frustum
+			mSkeletalBounds.Set(i, Sphere(Vector3::Zero, -Math::Infinity));
 		}
 	}
 
-	// Draw any skinned meshes now
-	mSkinnedShader->SetActive();
-	// Update view-projection matrix
-	mSkinnedShader->SetMatrixUniform("uViewProj", view * proj);
-	// Update lighting uniforms
-	if (lit)
+	// Point lights light everything within their outer radius
+	mPointLightBounds.Resize(mPointLights.size());
+	for (size_t i = 0; i < mPointLights.size(); i++)
 	{
-		SetLightUniforms(mSkinnedShader, view);
+		Actor* owner = mPointLights[i]->GetOwner();
+		mPointLightBounds.Set(i, Sphere(owner->GetRenderTransform().GetTranslation(),
+			mPointLights[i]->mOuterRadius * owner->GetWorldScale()));
 	}
-	for (auto sk : mSkeletalMeshes)
+	mCullStats.mPointLightsTested = mPointLights.size();
+
+	size_t maxCount = std::max(mMeshComps.size(),
+		std::max(mSkeletalMeshes.size(), mPointLights.size()));
+	if (mCullIndices.size() < maxCount)
 	{
-		if (sk->GetVisible())
+		mCullIndices.resize(maxCount);
+	}
+
+	Frustum frustum(mRenderView * mProjection);
+	CullMeshes(frustum, mVisible);
+	mCullStats.mMeshesVisible = mVisible.mMeshComps.size();
+	mCullStats.mSkeletalVisible = mVisible.mSkeletalMeshes.size();
+
+	size_t count = BoxKernels::CullSpheres(mPointLightBounds, 0, mPointLights.size(),
+		frustum, mCullIndices.data());
+	mVisiblePointLights.clear();
+	for (size_t i = 0; i < count; i++)
+	{
+		mVisiblePointLights.emplace_back(mPointLights[mCullIndices[i]]);
+	}
+	mCullStats.mPointLightsVisible = count;
+
+	// The mirror sees a different part of the scene
+	mMirrorVisible.mMeshComps.clear();
+	mMirrorVisible.mSkeletalMeshes.clear();
+	if (mMirrorTexture != nullptr)
+	{
+		CullMeshes(Frustum(mMirrorView * mProjection), mMirrorVisible);
+	}
+	mCullStats.mMirrorVisible = mMirrorVisible.mMeshComps.size() +
+		mMirrorVisible.mSkeletalMeshes.size();
+
+	// Sort what's visible into draw order
+	BuildQueue(mVisible, mRenderView, mQueue);
+	BuildQueue(mMirrorVisible, mMirrorView, mMirrorQueue);
+}
+
+void Renderer::CullMeshes(const Frustum& frustum, VisibleMeshes& outVisible)
+{
+	size_t count = BoxKernels::CullBoxes(mMeshBounds, 0, mMeshComps.size(),
+		frustum, mCullIndices.data());
+	outVisible.mMeshComps.clear();
+	for (size_t i = 0; i < count; i++)
+	{
+		outVisible.mMeshComps.emplace_back(mMeshComps[mCullIndices[i]]);
+	}
+
+	count = BoxKernels::CullSpheres(mSkeletalBounds, 0, mSkeletalMeshes.size(),
+		frustum, mCullIndices.data());
+	outVisible.mSkeletalMeshes.clear();
+	for (size_t i = 0; i < count; i++)
+	{
+		outVisible.mSkeletalMeshes.emplace_back(mSkeletalMeshes[mCullIndices[i]]);
+	}
+}
+
+void Renderer::Draw3DScene(unsigned int framebuffer, const RenderQueue& queue)
+{
+	// Set the current frame buffer
+	mDevice->BindFramebuffer(framebuffer);
+	// Draw mesh components
+	// Enable depth buffering/disable alpha blend
+	mDevice->SetDepthState(true, true);
+	mDevice->SetBlendMode(RenderDevice::EBlendNone);
+	// Clear color buffer/depth buffer
+	mDevice->Clear();
+
+	// Upload every packet's world transform (so a batch's
+	// instances start at its first packet)
+	const std::vector<RenderQueue::Packet>& packets = queue.GetPackets();
+	if (packets.empty())
+	{
+		return;
+	}
+	mInstanceTransforms.clear();
+	for (const RenderQueue::Packet& p : packets)
+	{
+		mInstanceTransforms.emplace_back(p.mMeshComp->GetOwner()->GetRenderTransform());
+	}
+	mDevice->SetBufferData(mInstanceBuffer, mInstanceTransforms.size() * sizeof(Matrix4),
+		mInstanceTransforms.data());
+
+	// The queue is sorted by shader, then texture, then mesh,
+	// so only bind each when it changes
+	Shader* shaders[] = { mMeshShader, mSkinnedShader };
+	Shader* shader = nullptr;
+	Texture* texture = nullptr;
+	VertexArray* va = nullptr;
+	for (const RenderQueue::Batch& b : queue.GetBatches())
+	{
+		const RenderQueue::Packet& p = packets[b.mFirst];
+		unsigned shaderID = RenderQueue::GetShader(p.mKey);
+		Shader* packetShader = shaders[shaderID];
+		if (packetShader != shader)
 		{
-			sk->Draw(mSkinnedShader);
+			shader = packetShader;
+			shader->SetActive();
+			mRenderStats.mProgramBinds++;
 		}
+		MeshComponent* mc = p.mMeshComp;
+		Texture* t = mc->GetTexture();
+		if (t != nullptr && t != texture)
+		{
+			texture = t;
+			texture->SetActive();
+			mRenderStats.mTextureBinds++;
+		}
+		VertexArray* packetVA = mc->GetMesh()->GetVertexArray();
+		if (packetVA != va)
+		{
+			va = packetVA;
+			va->SetActive();
+			mRenderStats.mVAOBinds++;
+		}
+		if (shaderID == MeshShaderID)
+		{
+			va->SetInstanceTransforms(mInstanceBuffer, static_cast<unsigned>(b.mFirst));
+			shader->SetFloatUniform("uSpecPower", mc->GetMesh()->GetSpecPower());
+			mDevice->DrawIndexedInstanced(va->GetNumIndices(),
+				static_cast<unsigned>(b.mCount));
+		}
+		else
+		{
+			mc->SetDrawUniforms(shader);
+			mDevice->DrawIndexed(va->GetNumIndices());
+		}
+		mRenderStats.mDraws++;
+		mRenderStats.mInstances += b.mCount;
 	}
 }
 
-bool Renderer::CreateMirrorTarget()
+void Renderer::BuildQueue(const VisibleMeshes& visible, const Matrix4& view,
+	RenderQueue& outQueue)
 {
-	// Generate a frame buffer for the mirror texture
-	glGenFramebuffers(1, &mMirrorBuffer);
-	glBindFramebuffer(GL_FRAMEBUFFER, mMirrorBuffer);
+	outQueue.Clear();
+	for (auto mc : visible.mMeshComps)
+	{
+		outQueue.Add(MakeMeshKey(mc, MeshShaderID, view), mc);
+	}
+	for (auto sk : visible.mSkeletalMeshes)
+	{
+		outQueue.Add(MakeMeshKey(sk, SkinnedShaderID, view), sk);
+	}
+	// Non-skinned meshes with the same mesh and texture are instanced
+	outQueue.Sort(1u << MeshShaderID);
+}
 
+bool Renderer::CreateMirrorTarget()
+{
 	// Create the texture we'll use for rendering
 	int width = static_cast<int>(mScreenWidth);
 	int height = static_cast<int>(mScreenHeight);
-	mMirrorTexture = new Texture();
-	mMirrorTexture->CreateForRendering(width, height, GL_RGB);
-
-	// Add a depth buffer to this target
-	GLuint depthBuffer;
-	glGenRenderbuffers(1, &depthBuffer);
-	glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, width, height);
-	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
-
-	// Attach mirror texture as the output target for the frame buffer
-	glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, mMirrorTexture->GetTextureID(), 0);
+	mMirrorTexture = new Texture(mDevice);
+	mMirrorTexture->CreateForRendering(width, height, RenderDevice::ERGB8);
 
-	// Set the list of buffers to draw to for this frame buffer
-	GLenum drawBuffers[] = { GL_COLOR_ATTACHMENT0 };
-	glDrawBuffers(1, drawBuffers);
+	// Generate a frame buffer (with a depth buffer) that
+	// draws to the mirror texture
+	unsigned textureID = mMirrorTexture->GetTextureID();
+	mMirrorBuffer = mDevice->CreateFramebuffer(width, height, &textureID, 1);
 
 	// Make sure everything worked
-	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	if (mMirrorBuffer == 0)
 	{
-		// If it didn't work, delete the framebuffer,
-		// unload/delete the texture and return false
-		glDeleteFramebuffers(1, &mMirrorBuffer);
+		// If it didn't work, unload/delete the texture and return false
 		mMirrorTexture->Unload();
 		delete mMirrorTexture;
 		mMirrorTexture = nullptr;
@@ -407,50 +732,39 @@ bool Renderer::CreateMirrorTarget()
 
 void Renderer::DrawFromGBuffer()
 {
-	// Clear the current framebuffer
-	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	
 	// Disable depth testing for the global lighting pass
-	glDisable(GL_DEPTH_TEST);
+	mDevice->SetDepthState(false, true);
+	// Clear the current framebuffer
+	mDevice->Clear();
 	// Activate global G-buffer shader
 	mGGlobalShader->SetActive();
 	// Activate sprite verts quad
 	mSpriteVerts->SetActive();
 	// Set the G-buffer textures to sample
 	mGBuffer->SetTexturesActive();
-	// Set the lighting uniforms
-	SetLightUniforms(mGGlobalShader, mView);
 	// Draw the triangles
-	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
+	mDevice->DrawIndexed(6);
 
 	// Copy depth buffer from G-buffer to default frame buffer
-	glBindFramebuffer(GL_READ_FRAMEBUFFER, mGBuffer->GetBufferID());
 	int width = static_cast<int>(mScreenWidth);
 	int height = static_cast<int>(mScreenHeight);
-	glBlitFramebuffer(0, 0, width, height,
-		0, 0, width, height,
-		GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+	mDevice->BlitDepth(mGBuffer->GetBufferID(), width, height);
 
 	// Enable depth test, but disable writes to depth buffer
-	glEnable(GL_DEPTH_TEST);
-	glDepthMask(GL_FALSE);
+	mDevice->SetDepthState(true, false);
 
 	// Set the point light shader and mesh as active
 	mGPointLightShader->SetActive();
 	mPointLightMesh->GetVertexArray()->SetActive();
-	// Set the view-projection matrix
-	mGPointLightShader->SetMatrixUniform("uViewProj",
-		mView * mProjection);
 	// Set the G-buffer textures for sampling
 	mGBuffer->SetTexturesActive();
 
 	// The point light color should add to existing color
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_ONE, GL_ONE);
+	mDevice->SetBlendMode(RenderDevice::EBlendAdd);
 
-	// Draw the point lights
-	for (PointLightComponent* p : mPointLights)
+	// Draw the point lights (only the ones that can light
+	// something on screen)
+	for (PointLightComponent* p : mVisiblePointLights)
 	{
 		p->Draw(mGPointLightShader, mPointLightMesh);
 	}
@@ -459,7 +773,7 @@ void Renderer::DrawFromGBuffer()
 bool Renderer::LoadShaders()
 {
 	// Create sprite shader
-	mSpriteShader = new Shader();
+	mSpriteShader = new Shader(mDevice);
 	if (!mSpriteShader->Load("Shaders/Sprite.vert", "Shaders/Sprite.frag"))
 	{
 		return false;
@@ -470,32 +784,26 @@ bool Renderer::LoadShaders()
 	Matrix4 spriteViewProj = Matrix4::CreateSimpleViewProj(mScreenWidth, mScreenHeight);
 	mSpriteShader->SetMatrixUniform("uViewProj", spriteViewProj);
 
-	// Create basic mesh shader
-	mMeshShader = new Shader();
-	if (!mMeshShader->Load("Shaders/Phong.vert", "Shaders/GBufferWrite.frag"))
+	// Create basic mesh shader (drawing every instance of a mesh at once)
+	mMeshShader = new Shader(mDevice);
+	if (!mMeshShader->Load("Shaders/PhongInstanced.vert", "Shaders/GBufferWrite.frag"))
 	{
 		return false;
 	}
 
-	mMeshShader->SetActive();
-	// Set the view-projection matrix
-	mView = Matrix4::CreateLookAt(Vector3::Zero, Vector3::UnitX, Vector3::UnitZ);
-	mProjection = Matrix4::CreatePerspectiveFOV(Math::ToRadians(70.0f),
-		mScreenWidth, mScreenHeight, 10.0f, 10000.0f);
-	mMeshShader->SetMatrixUniform("uViewProj", mView * mProjection);
+	mMeshShader->BindUniformBlock("FrameData", FrameDataBinding);
 
 	// Create skinned shader
-	mSkinnedShader = new Shader();
+	mSkinnedShader = new Shader(mDevice);
 	if (!mSkinnedShader->Load("Shaders/Skinned.vert", "Shaders/GBufferWrite.frag"))
 	{
 		return false;
 	}
 
-	mSkinnedShader->SetActive();
-	mSkinnedShader->SetMatrixUniform("uViewProj", mView * mProjection);
+	mSkinnedShader->BindUniformBlock("FrameData", FrameDataBinding);
 	
 	// Create shader for drawing from GBuffer (global lighting)
-	mGGlobalShader = new Shader();
+	mGGlobalShader = new Shader(mDevice);
 	if (!mGGlobalShader->Load("Shaders/GBufferGlobal.vert", "Shaders/GBufferGlobal.frag"))
 	{
 		return false;
@@ -511,9 +819,10 @@ bool Renderer::LoadShaders()
 	Matrix4 gbufferWorld = Matrix4::CreateScale(mScreenWidth, -mScreenHeight,
 												1.0f);
 	mGGlobalShader->SetMatrixUniform("uWorldTransform", gbufferWorld);
+	mGGlobalShader->BindUniformBlock("FrameData", FrameDataBinding);
 	
 	// Create a shader for point lights from GBuffer
-	mGPointLightShader = new Shader();
+	mGPointLightShader = new Shader(mDevice);
 	if (!mGPointLightShader->Load("Shaders/BasicMesh.vert",
 								  "Shaders/GBufferPointLight.frag"))
 	{
@@ -526,6 +835,8 @@ bool Renderer::LoadShaders()
 	mGPointLightShader->SetIntUniform("uGWorldPos", 2);
 	mGPointLightShader->SetVector2Uniform("uScreenDimensions",
 		Vector2(mScreenWidth, mScreenHeight));
+	mGPointLightShader->BindUniformBlock("FrameData", FrameDataBinding);
+	PointLightComponent::FindUniforms(mGPointLightShader);
 	return true;
 }
 
@@ -543,24 +854,25 @@ void Renderer::CreateSpriteVerts()
 		2, 3, 0
 	};
 
-	mSpriteVerts = new VertexArray(vertices, 4, VertexArray::PosNormTex, indices, 6);
+	mSpriteVerts = new VertexArray(mDevice, vertices, 4, VertexArray::PosNormTex, indices, 6);
 }
 
-void Renderer::SetLightUniforms(Shader* shader, const Matrix4& view)
+void Renderer::UpdateFrameUniforms(const Matrix4& view, const Matrix4& proj)
 {
+	FrameUniforms frame = {};
+	frame.mViewProj = view * proj;
 	// Camera position is from inverted view
 	Matrix4 invView = view;
 	invView.Invert();
-	shader->SetVectorUniform("uCameraPos", invView.GetTranslation());
+	frame.mCameraPos = invView.GetTranslation();
 	// Ambient light
-	shader->SetVectorUniform("uAmbientLight", mAmbientLight);
+	frame.mAmbientLight = mAmbientLight;
 	// Directional light
-	shader->SetVectorUniform("uDirLight.mDirection",
-		mDirLight.mDirection);
-	shader->SetVectorUniform("uDirLight.mDiffuseColor",
-		mDirLight.mDiffuseColor);
-	shader->SetVectorUniform("uDirLight.mSpecColor",
-		mDirLight.mSpecColor);
+	frame.mDirDirection = mDirLight.mDirection;
+	frame.mDirDiffuseColor = mDirLight.mDiffuseColor;
+	frame.mDirSpecColor = mDirLight.mSpecColor;
+
+	mDevice->UpdateBuffer(mFrameUniformBuffer, 0, sizeof(FrameUniforms), &frame);
 }
 
 Vector3 Renderer::Unproject(const Vector3& screenPoint) const
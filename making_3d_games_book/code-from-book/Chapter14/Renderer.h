@@ -12,6 +12,8 @@
 #include <unordered_map>
 #include <SDL/SDL.h>
 #include "Math.h"
+#include "BoxKernels.h"
+#include "RenderQueue.h"
 
 struct DirectionalLight
 {
@@ -23,6 +25,28 @@ struct DirectionalLight
 	Vector3 mSpecColor;
 };
 
+// Mesh components to draw in one pass
+struct VisibleMeshes
+{
+	std::vector<class MeshComponent*> mMeshComps;
+	std::vector<class SkeletalMeshComponent*> mSkeletalMeshes;
+};
+
+// How many of each renderable culling tested this frame
+// (the ones not hidden with SetVisible), and how many of
+// those were in the view frustum
+struct CullStats
+{
+	size_t mMeshesTested;
+	size_t mMeshesVisible;
+	size_t mSkeletalTested;
+	size_t mSkeletalVisible;
+	size_t mPointLightsTested;
+	size_t mPointLightsVisible;
+	// Meshes and skeletal meshes in the mirror's frustum
+	size_t mMirrorVisible;
+};
+
 class Renderer
 {
 public:
@@ -33,7 +57,9 @@ public:
 	void Shutdown();
 	void UnloadData();
 
-	void Draw();
+	// Draw the frame (alpha is the fraction of a simulation step
+	// real time is past the last step, used to interpolate the camera)
+	void Draw(float alpha = 1.0f);
 
 	void AddSprite(class SpriteComponent* sprite);
 	void RemoveSprite(class SpriteComponent* sprite);
@@ -48,6 +74,8 @@ public:
 	class Mesh* GetMesh(const std::string& fileName);
 
 	void SetViewMatrix(const Matrix4& view) { mView = view; }
+	// Save the current view as the start of this simulation step
+	void SnapshotView() { mPrevView = mView; }
 
 	const Vector3& GetAmbientLight() const { return mAmbientLight; }
 	void SetAmbientLight(const Vector3& ambient) { mAmbientLight = ambient; }
@@ -65,22 +93,51 @@ public:
 	// Gets start point and direction of screen vector
 	void GetScreenDirection(Vector3& outStart, Vector3& outDir) const;
 
+	// Headless renderers have no window or GL context, and draw
+	// to a device that only records what it's asked to do
+	bool IsHeadless() const { return mHeadless; }
+	// Device that everything is created and drawn with
+	class RenderDevice* GetDevice() { return mDevice; }
+
 	float GetScreenWidth() const { return mScreenWidth; }
 	float GetScreenHeight() const { return mScreenHeight; }
 
 	void SetMirrorView(const Matrix4& view) { mMirrorView = view; }
 	class Texture* GetMirrorTexture() { return mMirrorTexture; }
 	class GBuffer* GetGBuffer() { return mGBuffer; }
+
+	// What was culled in the last frame
+	const CullStats& GetCullStats() const { return mCullStats; }
+	// Draws and binds in the last frame's mesh passes
+	const RenderStats& GetRenderStats() const { return mRenderStats; }
+	// The mesh components and point lights in the last frame's view
+	const VisibleMeshes& GetVisibleMeshes() const { return mVisible; }
+	const std::vector<class PointLightComponent*>& GetVisiblePointLights() const
+	{
+		return mVisiblePointLights;
+	}
 private:
+	// Gather the mesh components and point lights in the
+	// view frustum (and the mirror's) for this frame
+	void ExtractScene();
+	// Cull the mesh components against the frustum
+	void CullMeshes(const Frustum& frustum, VisibleMeshes& outVisible);
 	// Chapter 14 additions
-	void Draw3DScene(unsigned int framebuffer, const Matrix4& view, const Matrix4& proj, bool lit = true);
+	// Sort the visible meshes into a queue, for drawing with this view
+	void BuildQueue(const VisibleMeshes& visible, const Matrix4& view, RenderQueue& outQueue);
+	// Draw the queue (with the view last set in the frame uniforms)
+	void Draw3DScene(unsigned int framebuffer, const RenderQueue& queue);
 	bool CreateMirrorTarget();
 	void DrawFromGBuffer();
 	//void DrawFromGBuffer();
 	// End chapter 14 additions
+	// Create the window and GL context, and a device that draws with it
+	bool CreateGLDevice();
 	bool LoadShaders();
 	void CreateSpriteVerts();
-	void SetLightUniforms(class Shader* shader, const Matrix4& view);
+	// Upload the view-projection, camera and lighting
+	// shared by the 3D shaders
+	void UpdateFrameUniforms(const Matrix4& view, const Matrix4& proj);
 
 	// Map of textures loaded
 	std::unordered_map<std::string, class Texture*> mTextures;
@@ -93,6 +150,21 @@ private:
 	// All (non-skeletal) mesh components drawn
 	std::vector<class MeshComponent*> mMeshComps;
 	std::vector<class SkeletalMeshComponent*> mSkeletalMeshes;
+	// Mesh components visible this frame (in the main view and the mirror)
+	VisibleMeshes mVisible;
+	VisibleMeshes mMirrorVisible;
+	std::vector<class PointLightComponent*> mVisiblePointLights;
+	// World bounds for culling, one per mesh component/point light
+	// (hidden ones are left at infinity, so they're never visible)
+	BoxArrays mMeshBounds;
+	SphereArrays mSkeletalBounds;
+	SphereArrays mPointLightBounds;
+	std::vector<uint32_t> mCullIndices;
+	CullStats mCullStats;
+	// Draw order for the main view and the mirror
+	RenderQueue mQueue;
+	RenderQueue mMirrorQueue;
+	RenderStats mRenderStats;
 
 	// Game
 	class Game* mGame;
@@ -102,7 +174,7 @@ private:
 	// Sprite vertex array
 	class VertexArray* mSpriteVerts;
 
-	// Mesh shader
+	// Mesh shader (instanced)
 	class Shader* mMeshShader;
 	// Skinned shader
 	class Shader* mSkinnedShader;
@@ -110,11 +182,18 @@ private:
 	// View/projection for 3D shaders
 	Matrix4 mView;
 	Matrix4 mProjection;
+	// View at the start of the simulation step, and the
+	// interpolated view actually used to draw this frame
+	Matrix4 mPrevView;
+	Matrix4 mRenderView;
 
 	// Lighting data
 	Vector3 mAmbientLight;
 	DirectionalLight mDirLight;
 
+	// Running without a window/GL context?
+	bool mHeadless;
+	class RenderDevice* mDevice;
 	// Window
 	SDL_Window* mWindow;
 	// OpenGL context
@@ -133,4 +212,9 @@ private:
 	class Shader* mGPointLightShader;
 	std::vector<class PointLightComponent*> mPointLights;
 	class Mesh* mPointLightMesh;
+	// World transforms for instanced draws, uploaded each pass
+	unsigned int mInstanceBuffer;
+	std::vector<Matrix4> mInstanceTransforms;
+	// Uniform buffer for the FrameData block
+	unsigned int mFrameUniformBuffer;
 };
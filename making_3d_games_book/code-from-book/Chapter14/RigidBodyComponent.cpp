@@ -0,0 +1,128 @@
+// ----------------------------------------------------------------
+// From Game Programming in C++ by Sanjay Madhav
+// Copyright (C) 2017 Sanjay Madhav. All rights reserved.
+// 
+// Released under the BSD License
+// See LICENSE in root directory for full details.
+// ----------------------------------------------------------------
+
+#include "RigidBodyComponent.h"
+#include "Actor.h"
+#include "Game.h"
+#include "BoxComponent.h"
+#include "DynamicsWorld.h"
+#include "LevelLoader.h"
+
+RigidBodyComponent::RigidBodyComponent(Actor* owner, int updateOrder)
+	:Component(owner, updateOrder)
+	,mMass(1.0f)
+	,mRestitution(0.0f)
+	,mFriction(0.6f)
+	,mLinearVelocity(Vector3::Zero)
+	,mAngularVelocity(Vector3::Zero)
+	,mAwake(true)
+	,mSleepTime(0.0f)
+	,mBox(nullptr)
+	,mBodyIndex(0)
+{
+	mOwner->GetGame()->GetDynamicsWorld()->AddBody(this);
+}
+
+RigidBodyComponent::~RigidBodyComponent()
+{
+	if (mBox)
+	{
+		mBox->mBody = nullptr;
+	}
+	mOwner->GetGame()->GetDynamicsWorld()->RemoveBody(this);
+}
+
+void RigidBodyComponent::SetLinearVelocity(const Vector3& velocity)
+{
+	mLinearVelocity = velocity;
+	Wake();
+}
+
+void RigidBodyComponent::SetAngularVelocity(const Vector3& velocity)
+{
+	mAngularVelocity = velocity;
+	Wake();
+}
+
+void RigidBodyComponent::ApplyImpulse(const Vector3& impulse, const Vector3& point)
+{
+	float invMass = GetInvMass();
+	if (invMass == 0.0f)
+	{
+		return;
+	}
+	mLinearVelocity += impulse * invMass;
+	// Spin from the impulse's torque, worked out in the box's local space
+	const OBB& obb = mBox->GetWorldOBB();
+	Quaternion inv = obb.mRotation;
+	inv.Conjugate();
+	Vector3 torque = Vector3::Transform(
+		Vector3::Cross(point - obb.mCenter, impulse), inv);
+	Vector3 invInertia = GetLocalInvInertia();
+	Vector3 spin(torque.x * invInertia.x, torque.y * invInertia.y,
+		torque.z * invInertia.z);
+	mAngularVelocity += Vector3::Transform(spin, obb.mRotation);
+	Wake();
+}
+
+void RigidBodyComponent::Wake()
+{
+	mAwake = true;
+	mSleepTime = 0.0f;
+}
+
+float RigidBodyComponent::GetInvMass() const
+{
+	if (mBox == nullptr || mMass <= 0.0f)
+	{
+		return 0.0f;
+	}
+	return 1.0f / mMass;
+}
+
+Vector3 RigidBodyComponent::GetLocalInvInertia() const
+{
+	float invMass = GetInvMass();
+	if (invMass == 0.0f)
+	{
+		return Vector3::Zero;
+	}
+	// Solid box: I = m/3 * (the other two half sizes squared)
+	const Vector3& half = mBox->GetWorldOBB().mExtents;
+	float xx = half.x * half.x;
+	float yy = half.y * half.y;
+	float zz = half.z * half.z;
+	return Vector3(3.0f * invMass / Math::Max(yy + zz, 0.0001f),
+		3.0f * invMass / Math::Max(xx + zz, 0.0001f),
+		3.0f * invMass / Math::Max(xx + yy, 0.0001f));
+}
+
+void RigidBodyComponent::LoadProperties(const rapidjson::Value& inObj)
+{
+	Component::LoadProperties(inObj);
+
+	JsonHelper::GetFloat(inObj, "mass", mMass);
+	JsonHelper::GetFloat(inObj, "restitution", mRestitution);
+	JsonHelper::GetFloat(inObj, "friction", mFriction);
+	JsonHelper::GetVector3(inObj, "linearVelocity", mLinearVelocity);
+	JsonHelper::GetVector3(inObj, "angularVelocity", mAngularVelocity);
+	JsonHelper::GetBool(inObj, "awake", mAwake);
+}
+
+void RigidBodyComponent::SaveProperties(rapidjson::Document::AllocatorType& alloc,
+	rapidjson::Value& inObj) const
+{
+	Component::SaveProperties(alloc, inObj);
+
+	JsonHelper::AddFloat(alloc, inObj, "mass", mMass);
+	JsonHelper::AddFloat(alloc, inObj, "restitution", mRestitution);
+	JsonHelper::AddFloat(alloc, inObj, "friction", mFriction);
+	JsonHelper::AddVector3(alloc, inObj, "linearVelocity", mLinearVelocity);
+	JsonHelper::AddVector3(alloc, inObj, "angularVelocity", mAngularVelocity);
+	JsonHelper::AddBool(alloc, inObj, "awake", mAwake);
+}
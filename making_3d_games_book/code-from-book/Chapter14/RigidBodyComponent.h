@@ -0,0 +1,73 @@
+// ----------------------------------------------------------------
+// From Game Programming in C++ by Sanjay Madhav
+// Copyright (C) 2017 Sanjay Madhav. All rights reserved.
+// 
+// Released under the BSD License
+// See LICENSE in root directory for full details.
+// ----------------------------------------------------------------
+
+#pragma once
+#include "Component.h"
+
+// Makes the owner's BoxComponent a rigid body, which the game's
+// DynamicsWorld moves: it falls, hits other boxes and comes to
+// rest on them. (Boxes without a body, and bodies with a mass of
+// 0, never move.) A body collides with its true rotated box, so
+// its box is made oriented.
+class RigidBodyComponent : public Component
+{
+public:
+	RigidBodyComponent(class Actor* owner, int updateOrder = 100);
+	~RigidBodyComponent();
+
+	TypeID GetType() const override { return TRigidBodyComponent; }
+
+	void LoadProperties(const rapidjson::Value& inObj) override;
+	void SaveProperties(rapidjson::Document::AllocatorType& alloc,
+		rapidjson::Value& inObj) const override;
+
+	void SetMass(float mass) { mMass = mass; }
+	float GetMass() const { return mMass; }
+	// A contact bounces by the larger restitution of the two
+	// bodies, and uses the geometric mean of their friction
+	void SetRestitution(float value) { mRestitution = value; }
+	float GetRestitution() const { return mRestitution; }
+	void SetFriction(float value) { mFriction = value; }
+	float GetFriction() const { return mFriction; }
+
+	// Setting a velocity wakes the body
+	void SetLinearVelocity(const Vector3& velocity);
+	const Vector3& GetLinearVelocity() const { return mLinearVelocity; }
+	void SetAngularVelocity(const Vector3& velocity);
+	const Vector3& GetAngularVelocity() const { return mAngularVelocity; }
+	// Change the velocity as if hit at this world point
+	void ApplyImpulse(const Vector3& impulse, const Vector3& point);
+
+	// A sleeping body isn't simulated until an awake body
+	// touches it (or it's woken)
+	bool IsAwake() const { return mAwake; }
+	void Wake();
+
+	// Inverse mass (0 if it never moves)
+	float GetInvMass() const;
+	// Inverse of the inertia around the box's local axes
+	Vector3 GetLocalInvInertia() const;
+
+	class BoxComponent* GetBox() const { return mBox; }
+private:
+	float mMass;
+	float mRestitution;
+	float mFriction;
+	Vector3 mLinearVelocity;
+	Vector3 mAngularVelocity;
+	bool mAwake;
+	// How long it's been nearly still
+	float mSleepTime;
+	// The box it moves (found when it first steps,
+	// since the box might be added after the body)
+	friend class DynamicsWorld;
+	friend class BoxComponent;
+	class BoxComponent* mBox;
+	// Index in the dynamics world's bodies
+	size_t mBodyIndex;
+};
@@ -0,0 +1,705 @@
+// ----------------------------------------------------------------
+// From Game Programming in C++ by Sanjay Madhav
+// Copyright (C) 2017 Sanjay Madhav. All rights reserved.
+// 
+// Released under the BSD License
+// See LICENSE in root directory for full details.
+// ----------------------------------------------------------------
+
+#include "SelfTest.h"
+#include "Game.h"
+#include "JobSystem.h"
+#include "Actor.h"
+#include "BoxComponent.h"
+#include "MoveComponent.h"
+#include "BallMove.h"
+#include "RigidBodyComponent.h"
+#include "PhysWorld.h"
+#include "TransformStore.h"
+#include "FrameAllocator.h"
+#include "HeapStats.h"
+#include "BoxKernels.h"
+#include "Renderer.h"
+#include "NullRenderDevice.h"
+#include "GBuffer.h"
+#include "MeshComponent.h"
+#include "SkeletalMeshComponent.h"
+#include "Mesh.h"
+#include <SDL/SDL_log.h>
+#include <algorithm>
+#include <functional>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace
+{
+	bool Report(const char* name, bool passed)
+	{
+		SDL_Log("%s: %s", name, passed ? "passed" : "FAILED");
+		return passed;
+	}
+
+	Actor* AddBox(Game* game, const Vector3& pos, const Vector3& halfSize,
+		bool isStatic = false)
+	{
+		Actor* actor = new Actor(game);
+		actor->SetPosition(pos);
+		BoxComponent* box = new BoxComponent(actor);
+		box->SetObjectBox(AABB(halfSize * -1.0f, halfSize));
+		box->SetStatic(isStatic);
+		return actor;
+	}
+
+	// Delete the actors a check made, and let the
+	// physics world forget their boxes
+	void RemoveActors(Game* game, std::vector<Actor*>& actors)
+	{
+		for (Actor* actor : actors)
+		{
+			delete actor;
+		}
+		actors.clear();
+		game->GetPhysWorld()->UpdateBroadphase();
+	}
+}
+
+bool SelfTest::RunAll(Game* game)
+{
+	bool success = true;
+	success = Report("jobSystem", TestJobSystem()) && success;
+	success = Report("frameAllocations", TestFrameAllocations(game)) && success;
+	success = Report("overlapEvents", TestOverlapEvents(game)) && success;
+	success = Report("culling", TestCulling()) && success;
+	success = Report("levelDraw", TestLevelDraw()) && success;
+	return success;
+}
+
+bool SelfTest::TestJobSystem()
+{
+	const size_t GrainSize = 64;
+	const int NumRounds = 200;
+	const int NumWriters = 16;
+	bool success = true;
+	for (unsigned numThreads : { 1u, 4u })
+	{
+		JobSystem jobs;
+		jobs.Initialize(numThreads);
+
+		// Counts around the grain size, where the ranges split
+		for (size_t count : { 0, 1, 63, 64, 65, 10000 })
+		{
+			std::vector<int> hits(count, 0);
+			jobs.ParallelFor(count, GrainSize, [&hits](size_t begin, size_t end) {
+				for (size_t i = begin; i < end; i++)
+				{
+					hits[i]++;
+				}
+			});
+			if (static_cast<size_t>(std::count(hits.begin(), hits.end(), 1)) != count)
+			{
+				SDL_Log("ParallelFor over %u missed or repeated an index on %u threads",
+					static_cast<unsigned>(count), numThreads);
+				success = false;
+			}
+		}
+
+		// The sum job depends on the writers, so it has to see
+		// every value they wrote
+		for (int round = 0; round < NumRounds; round++)
+		{
+			std::vector<int> values(NumWriters, 0);
+			JobCounter written;
+			JobCounter summed;
+			int sum = 0;
+			for (int i = 0; i < NumWriters; i++)
+			{
+				jobs.Run([&values, i, round] { values[i] = round + i; }, &written);
+			}
+			jobs.Run([&values, &sum] {
+				for (int value : values)
+				{
+					sum += value;
+				}
+			}, &summed, &written);
+			jobs.Wait(summed);
+			int expected = NumWriters * round + NumWriters * (NumWriters - 1) / 2;
+			if (sum != expected || !written.IsDone())
+			{
+				SDL_Log("Dependent job ran early on %u threads (sum %d, expected %d)",
+					numThreads, sum, expected);
+				success = false;
+				break;
+			}
+		}
+		jobs.Shutdown();
+	}
+	return success;
+}
+
+bool SelfTest::TestFrameAllocations(Game* game)
+{
+	const float DeltaTime = 1.0f / 60.0f;
+	// The circling boxes come back around every 240 frames, so
+	// this is long enough for every container to reach its size
+	const int WarmUpFrames = 480;
+	const int NumFrames = 480;
+	const float ArenaHalf = 1000.0f;
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> unitDist(-1.0f, 1.0f);
+	std::vector<Actor*> actors;
+
+	// A floor and four walls
+	actors.emplace_back(AddBox(game, Vector3(0.0f, 0.0f, -50.0f),
+		Vector3(ArenaHalf, ArenaHalf, 50.0f), true));
+	for (int i = 0; i < 4; i++)
+	{
+		float side = (i & 1) ? ArenaHalf : -ArenaHalf;
+		Vector3 pos = (i & 2) ? Vector3(side, 0.0f, 250.0f) : Vector3(0.0f, side, 250.0f);
+		Vector3 half = (i & 2) ? Vector3(10.0f, ArenaHalf, 250.0f) :
+			Vector3(ArenaHalf, 10.0f, 250.0f);
+		actors.emplace_back(AddBox(game, pos, half, true));
+	}
+
+	// Boxes driving in circles, through each other
+	for (int i = 0; i < 400; i++)
+	{
+		Vector3 pos(unitDist(rng) * 600.0f, unitDist(rng) * 600.0f,
+			250.0f + unitDist(rng) * 150.0f);
+		Actor* actor = AddBox(game, pos, Vector3(20.0f, 20.0f, 20.0f));
+		MoveComponent* move = new MoveComponent(actor);
+		move->SetForwardSpeed(300.0f);
+		move->SetAngularSpeed(Math::Pi * 0.5f);
+		actors.emplace_back(actor);
+	}
+
+	// Balls bouncing off the walls and each other
+	for (int i = 0; i < 64; i++)
+	{
+		Vector3 pos(unitDist(rng) * 800.0f, unitDist(rng) * 800.0f, 100.0f);
+		Actor* actor = AddBox(game, pos, Vector3(10.0f, 10.0f, 10.0f));
+		actor->SetRotation(Quaternion(Vector3::UnitZ, unitDist(rng) * Math::Pi));
+		BoxComponent* box = static_cast<BoxComponent*>(
+			actor->GetComponentOfType(Component::TBoxComponent));
+		box->SetShouldRotate(false);
+		box->SetContinuous(true);
+		box->SetLayer(BoxComponent::ProjectileLayer);
+		BallMove* move = new BallMove(actor);
+		move->SetForwardSpeed(1500.0f);
+		actors.emplace_back(actor);
+	}
+
+	// Towers of rigid bodies (that the balls knock over)
+	for (int i = 0; i < 20; i++)
+	{
+		Vector3 pos(-300.0f + 200.0f * (i / 5), 300.0f, 26.0f + 51.0f * (i % 5));
+		Actor* actor = AddBox(game, pos, Vector3(25.0f, 25.0f, 25.0f));
+		new RigidBodyComponent(actor);
+		actors.emplace_back(actor);
+	}
+
+	int allocFrames = 0;
+	Uint64 totalAllocs = 0;
+	int firstAllocFrame = -1;
+	for (int frame = 0; frame < WarmUpFrames + NumFrames; frame++)
+	{
+		Uint64 allocs = HeapStats::GetNumAllocs();
+		game->StepSimulation(DeltaTime);
+		FrameAllocator::ResetAll();
+		allocs = HeapStats::GetNumAllocs() - allocs;
+		if (frame >= WarmUpFrames && allocs > 0)
+		{
+			allocFrames++;
+			totalAllocs += allocs;
+			if (firstAllocFrame < 0)
+			{
+				firstAllocFrame = frame;
+			}
+		}
+	}
+	RemoveActors(game, actors);
+
+	if (allocFrames > 0)
+	{
+		SDL_Log("%u heap allocations over %d frames (the first in frame %d)",
+			static_cast<unsigned>(totalAllocs), allocFrames, firstAllocFrame);
+		return false;
+	}
+	return true;
+}
+
+namespace
+{
+	// Solid pairs are (lower, higher), trigger pairs are (trigger, other)
+	typedef std::set<std::pair<Actor*, Actor*>> ActorPairSet;
+
+	BoxComponent* GetBox(Actor* actor)
+	{
+		return static_cast<BoxComponent*>(actor->GetComponentOfType(Component::TBoxComponent));
+	}
+
+	// What the events since the last call should have been
+	bool CheckEvents(const char* test, int frame, const ActorPairSet& before,
+		const ActorPairSet& now, const ActorPairSet (&events)[3], bool duplicates)
+	{
+		ActorPairSet begun;
+		ActorPairSet persisted;
+		ActorPairSet ended;
+		std::set_difference(now.begin(), now.end(), before.begin(), before.end(),
+			std::inserter(begun, begun.end()));
+		std::set_intersection(now.begin(), now.end(), before.begin(), before.end(),
+			std::inserter(persisted, persisted.end()));
+		std::set_difference(before.begin(), before.end(), now.begin(), now.end(),
+			std::inserter(ended, ended.end()));
+		if (duplicates || events[PhysWorld::EBegin] != begun ||
+			events[PhysWorld::EPersist] != persisted || events[PhysWorld::EEnd] != ended)
+		{
+			SDL_Log("%s disagreed in frame %d: begin %u/%u, persist %u/%u, end %u/%u%s",
+				test, frame,
+				static_cast<unsigned>(events[PhysWorld::EBegin].size()),
+				static_cast<unsigned>(begun.size()),
+				static_cast<unsigned>(events[PhysWorld::EPersist].size()),
+				static_cast<unsigned>(persisted.size()),
+				static_cast<unsigned>(events[PhysWorld::EEnd].size()),
+				static_cast<unsigned>(ended.size()),
+				duplicates ? " (with duplicates)" : "");
+			return false;
+		}
+		return true;
+	}
+}
+
+bool SelfTest::TestOverlapEvents(Game* game)
+{
+	const int NumFrames = 300;
+	const int NumBoxes = 300;
+	const float WorldHalf = 200.0f;
+	PhysWorld* phys = game->GetPhysWorld();
+	TransformStore* transforms = game->GetTransformStore();
+	std::mt19937 rng(5678);
+	std::uniform_real_distribution<float> unitDist(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> chanceDist(0.0f, 1.0f);
+	const uint32_t Layers[] = { BoxComponent::DefaultLayer, BoxComponent::ProjectileLayer };
+	const uint32_t Masks[] = { 0xFFFFFFFF, BoxComponent::DefaultLayer,
+		BoxComponent::ProjectileLayer };
+
+	auto randomPoint = [&rng, &unitDist](float half) {
+		return Vector3(unitDist(rng) * half, unitDist(rng) * half, unitDist(rng) * half);
+	};
+	auto refilter = [&rng, &chanceDist, &Layers, &Masks](BoxComponent* box) {
+		box->SetLayer(Layers[rng() % 2]);
+		box->SetCollisionMask(Masks[rng() % 3]);
+		box->SetTrigger(chanceDist(rng) < 0.1f);
+	};
+	std::vector<Actor*> actors;
+	auto addActor = [&]() {
+		Vector3 half(15.0f + unitDist(rng) * 10.0f, 15.0f + unitDist(rng) * 10.0f,
+			15.0f + unitDist(rng) * 10.0f);
+		Actor* actor = AddBox(game, randomPoint(WorldHalf), half, chanceDist(rng) < 0.2f);
+		refilter(GetBox(actor));
+		actors.emplace_back(actor);
+	};
+	for (int i = 0; i < NumBoxes; i++)
+	{
+		addActor();
+	}
+
+	ActorPairSet overlapping;
+	ActorPairSet triggered;
+	// Drop the expected pairs with this actor that the test says go
+	// away without an end
+	auto forget = [&overlapping, &triggered](Actor* actor,
+		const std::function<bool(Actor*)>& test) {
+		for (ActorPairSet* pairs : { &overlapping, &triggered })
+		{
+			for (auto iter = pairs->begin(); iter != pairs->end(); )
+			{
+				Actor* other = iter->first == actor ? iter->second :
+					(iter->second == actor ? iter->first : nullptr);
+				iter = (other && test(other)) ? pairs->erase(iter) : std::next(iter);
+			}
+		}
+	};
+	bool success = true;
+	for (int frame = 0; frame < NumFrames && success; frame++)
+	{
+		// Move most of the boxes a little, and a few a long way
+		for (Actor* actor : actors)
+		{
+			if (GetBox(actor)->IsStatic())
+			{
+				continue;
+			}
+			float chance = chanceDist(rng);
+			if (chance < 0.02f)
+			{
+				actor->SetPosition(randomPoint(WorldHalf));
+			}
+			else if (chance < 0.5f)
+			{
+				actor->SetPosition(actor->GetPosition() + randomPoint(20.0f));
+			}
+		}
+		// Change a filter. Its pairs with solid boxes switch between
+		// solid and trigger if its trigger flag changes.
+		if (chanceDist(rng) < 0.5f)
+		{
+			Actor* actor = actors[rng() % actors.size()];
+			bool wasTrigger = GetBox(actor)->IsTrigger();
+			refilter(GetBox(actor));
+			if (GetBox(actor)->IsTrigger() != wasTrigger)
+			{
+				forget(actor, [](Actor* other) { return !GetBox(other)->IsTrigger(); });
+			}
+		}
+		// Replace some boxes (their pairs go without an end)
+		for (size_t i = 0; i < actors.size(); i++)
+		{
+			if (chanceDist(rng) < 0.02f)
+			{
+				Actor* dead = actors[i];
+				forget(dead, [](Actor*) { return true; });
+				delete dead;
+				actors[i] = actors.back();
+				actors.pop_back();
+				addActor();
+			}
+		}
+		transforms->UpdateWorldTransforms();
+
+		// Every pair, from scratch
+		ActorPairSet nowOverlapping;
+		ActorPairSet nowTriggered;
+		for (size_t i = 0; i < actors.size(); i++)
+		{
+			BoxComponent* a = GetBox(actors[i]);
+			for (size_t j = i + 1; j < actors.size(); j++)
+			{
+				BoxComponent* b = GetBox(actors[j]);
+				if ((a->IsStatic() && b->IsStatic()) || (a->IsTrigger() && b->IsTrigger()) ||
+					(a->GetLayer() & b->GetCollisionMask()) == 0 ||
+					(b->GetLayer() & a->GetCollisionMask()) == 0 ||
+					!Intersect(a->GetWorldBox(), b->GetWorldBox()))
+				{
+					continue;
+				}
+				if (a->IsTrigger() || b->IsTrigger())
+				{
+					nowTriggered.emplace(a->IsTrigger() ? actors[i] : actors[j],
+						a->IsTrigger() ? actors[j] : actors[i]);
+				}
+				else
+				{
+					nowOverlapping.emplace(std::min(actors[i], actors[j]),
+						std::max(actors[i], actors[j]));
+				}
+			}
+		}
+
+		// (TestOverlaps updates the broadphase first)
+		ActorPairSet events[3];
+		bool duplicates = false;
+		phys->TestOverlaps([&events, &duplicates](Actor* a, Actor* b,
+			PhysWorld::OverlapEvent event) {
+			duplicates |= !events[event].emplace(std::min(a, b), std::max(a, b)).second;
+		});
+		success = CheckEvents("TestOverlaps", frame, overlapping, nowOverlapping,
+			events, duplicates);
+
+		ActorPairSet triggerEvents[3];
+		duplicates = false;
+		phys->TestTriggers([&triggerEvents, &duplicates](Actor* trigger, Actor* other,
+			PhysWorld::OverlapEvent event) {
+			duplicates |= !triggerEvents[event].emplace(trigger, other).second;
+		});
+		success = CheckEvents("TestTriggers", frame, triggered, nowTriggered,
+			triggerEvents, duplicates) && success;
+
+		overlapping.swap(nowOverlapping);
+		triggered.swap(nowTriggered);
+		FrameAllocator::ResetAll();
+	}
+	RemoveActors(game, actors);
+	return success;
+}
+
+bool SelfTest::TestCulling()
+{
+	const int NumViews = 16;
+	const size_t NumPoints = 2000;
+	const size_t NumBounds = 1000;
+	// The renderer's projection
+	Matrix4 projection = Matrix4::CreatePerspectiveFOV(Math::ToRadians(70.0f),
+		1024.0f, 768.0f, 10.0f, 10000.0f);
+	std::mt19937 rng(9012);
+	std::uniform_real_distribution<float> unitDist(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> sizeDist(1.0f, 300.0f);
+	auto randomPoint = [&rng, &unitDist](const Vector3& center, float half) {
+		return center + Vector3(unitDist(rng), unitDist(rng), unitDist(rng)) * half;
+	};
+
+	BoxArrays boxArrays;
+	SphereArrays sphereArrays;
+	std::vector<uint32_t> indices(NumBounds);
+	std::vector<uint32_t> expected;
+	BoxKernels::Level oldLevel = BoxKernels::GetLevel();
+	bool success = true;
+	for (int view = 0; view < NumViews * 2 && success; view++)
+	{
+		// Where FollowCamera and MirrorCamera put the camera,
+		// around a player somewhere facing some way
+		Vector3 player = randomPoint(Vector3::Zero, 2000.0f);
+		float angle = unitDist(rng) * Math::Pi;
+		Vector3 forward(Math::Cos(angle), Math::Sin(angle), 0.0f);
+		bool mirror = (view & 1) != 0;
+		Matrix4 viewMatrix = mirror ?
+			Matrix4::CreateLookAt(player + forward * 150.0f + Vector3::UnitZ * 200.0f,
+				player - forward * 400.0f, Vector3::UnitZ) :
+			Matrix4::CreateLookAt(player - forward * 350.0f + Vector3::UnitZ * 250.0f,
+				player + forward * 100.0f, Vector3::UnitZ);
+		Matrix4 viewProj = viewMatrix * projection;
+		Frustum frustum(viewProj);
+		const char* name = mirror ? "mirror" : "follow";
+
+		for (int i = 0; i < Frustum::NumPlanes; i++)
+		{
+			if (!Math::NearZero(frustum.mNormals[i].Length() - 1.0f, 0.0001f))
+			{
+				SDL_Log("Frustum plane %d isn't normalized (%s view)", i, name);
+				success = false;
+			}
+		}
+
+		// Points are inside when -w <= x, y <= w and 0 <= z <= w in clip
+		// space (skipping ones too close to a plane to call)
+		for (size_t i = 0; i < NumPoints; i++)
+		{
+			Vector3 p = randomPoint(player, i % 2 ? 12000.0f : 2000.0f);
+			float clip[4];
+			for (int col = 0; col < 4; col++)
+			{
+				clip[col] = p.x * viewProj.mat[0][col] + p.y * viewProj.mat[1][col] +
+					p.z * viewProj.mat[2][col] + viewProj.mat[3][col];
+			}
+			float w = clip[3];
+			float margin = std::min({ w - clip[0], w + clip[0], w - clip[1],
+				w + clip[1], clip[2], w - clip[2] });
+			if (Math::Abs(margin) < 0.001f * Math::Abs(w) + 0.001f)
+			{
+				continue;
+			}
+			bool clipInside = w > 0.0f && margin > 0.0f;
+			bool planesInside = true;
+			for (int plane = 0; plane < Frustum::NumPlanes; plane++)
+			{
+				if (Vector3::Dot(p, frustum.mNormals[plane]) - frustum.mD[plane] < 0.0f)
+				{
+					planesInside = false;
+				}
+			}
+			if (clipInside != planesInside)
+			{
+				SDL_Log("Frustum planes put (%.1f, %.1f, %.1f) %s, but clip space "
+					"puts it %s (%s view)", p.x, p.y, p.z, planesInside ? "inside" : "outside",
+					clipInside ? "inside" : "outside", name);
+				success = false;
+				break;
+			}
+		}
+
+		// Bounds near the player, of all sizes
+		boxArrays.Resize(NumBounds);
+		sphereArrays.Resize(NumBounds);
+		for (size_t i = 0; i < NumBounds; i++)
+		{
+			Vector3 center = randomPoint(player, 3000.0f);
+			Vector3 half(sizeDist(rng), sizeDist(rng), sizeDist(rng));
+			boxArrays.Set(i, AABB(center - half, center + half));
+			sphereArrays.Set(i, Sphere(randomPoint(player, 3000.0f), sizeDist(rng)));
+		}
+		// All of them, and a range that doesn't start or end on a
+		// multiple of the SIMD width
+		const size_t Ranges[2][2] = { { 0, NumBounds }, { 5, NumBounds - 3 } };
+		for (int level = BoxKernels::EScalar; level <= BoxKernels::GetBestLevel(); level++)
+		{
+			BoxKernels::SetLevel(static_cast<BoxKernels::Level>(level));
+			for (const auto& range : Ranges)
+			{
+				expected.clear();
+				for (size_t i = range[0]; i < range[1]; i++)
+				{
+					if (Intersect(frustum, boxArrays.Get(i)))
+					{
+						expected.emplace_back(static_cast<uint32_t>(i));
+					}
+				}
+				size_t count = BoxKernels::CullBoxes(boxArrays, range[0], range[1],
+					frustum, indices.data());
+				std::sort(indices.begin(), indices.begin() + count);
+				if (!std::equal(expected.begin(), expected.end(), indices.begin(),
+					indices.begin() + count))
+				{
+					SDL_Log("CullBoxes kept %u boxes, Intersect kept %u (%s, %s view)",
+						static_cast<unsigned>(count), static_cast<unsigned>(expected.size()),
+						BoxKernels::GetLevelName(BoxKernels::GetLevel()), name);
+					success = false;
+				}
+
+				expected.clear();
+				for (size_t i = range[0]; i < range[1]; i++)
+				{
+					if (Intersect(frustum, sphereArrays.Get(i)))
+					{
+						expected.emplace_back(static_cast<uint32_t>(i));
+					}
+				}
+				count = BoxKernels::CullSpheres(sphereArrays, range[0], range[1],
+					frustum, indices.data());
+				std::sort(indices.begin(), indices.begin() + count);
+				if (!std::equal(expected.begin(), expected.end(), indices.begin(),
+					indices.begin() + count))
+				{
+					SDL_Log("CullSpheres kept %u spheres, Intersect kept %u (%s, %s view)",
+						static_cast<unsigned>(count), static_cast<unsigned>(expected.size()),
+						BoxKernels::GetLevelName(BoxKernels::GetLevel()), name);
+					success = false;
+				}
+			}
+		}
+	}
+	BoxKernels::SetLevel(oldLevel);
+	return success;
+}
+
+bool SelfTest::TestLevelDraw()
+{
+	Game level;
+	level.SetLevelFile("Assets/Level3.gplevel");
+	if (!level.Initialize(true))
+	{
+		level.Shutdown();
+		return false;
+	}
+	// One step places the camera, then draw where everything is now
+	level.StepSimulation(1.0f / 60.0f);
+	level.GetTransformStore()->ComputeRenderTransforms(1.0f);
+	Renderer* renderer = level.GetRenderer();
+	renderer->Draw();
+	NullRenderDevice* device = static_cast<NullRenderDevice*>(renderer->GetDevice());
+	const RenderStats& stats = renderer->GetRenderStats();
+	const CullStats& cull = renderer->GetCullStats();
+	const VisibleMeshes& visible = renderer->GetVisibleMeshes();
+
+	// What the queue should come to: one draw per mesh/texture
+	// among the plain meshes, and one per skinned mesh
+	std::set<std::pair<Mesh*, Texture*>> batches;
+	for (MeshComponent* mc : visible.mMeshComps)
+	{
+		batches.emplace(mc->GetMesh(), mc->GetTexture());
+	}
+	size_t expectedDraws = batches.size() + visible.mSkeletalMeshes.size();
+	size_t expectedInstances = cull.mMeshesVisible + cull.mSkeletalVisible;
+
+	// Replay the G-buffer pass's commands, tracking what's bound
+	unsigned gbuffer = renderer->GetGBuffer()->GetBufferID();
+	bool inPass = false;
+	unsigned program = 0;
+	unsigned vertexArray = 0;
+	std::vector<unsigned> textures;
+	size_t draws = 0;
+	size_t instances = 0;
+	size_t programBinds = 0;
+	size_t textureBinds = 0;
+	size_t vertexArrayBinds = 0;
+	size_t redundantBinds = 0;
+	for (const NullRenderDevice::Command& c : device->GetCommands())
+	{
+		if (c.mType == NullRenderDevice::EBindFramebuffer)
+		{
+			inPass = c.mArg0 == gbuffer;
+			continue;
+		}
+		if (!inPass)
+		{
+			continue;
+		}
+		switch (c.mType)
+		{
+		case NullRenderDevice::EUseProgram:
+			redundantBinds += c.mArg0 == program;
+			program = c.mArg0;
+			programBinds++;
+			break;
+		case NullRenderDevice::EBindVertexArray:
+			redundantBinds += c.mArg0 == vertexArray;
+			vertexArray = c.mArg0;
+			vertexArrayBinds++;
+			break;
+		case NullRenderDevice::EBindTexture:
+			if (c.mArg1 >= textures.size())
+			{
+				textures.resize(c.mArg1 + 1, 0);
+			}
+			redundantBinds += c.mArg0 == textures[c.mArg1];
+			textures[c.mArg1] = c.mArg0;
+			textureBinds++;
+			break;
+		case NullRenderDevice::EDraw:
+			draws++;
+			instances++;
+			break;
+		case NullRenderDevice::EDrawInstanced:
+			draws++;
+			instances += c.mArg1;
+			break;
+		default:
+			break;
+		}
+	}
+	SDL_Log("Level3 drew %u meshes in %u draws (%u program, %u texture, %u vertex array binds)",
+		static_cast<unsigned>(instances), static_cast<unsigned>(draws),
+		static_cast<unsigned>(programBinds), static_cast<unsigned>(textureBinds),
+		static_cast<unsigned>(vertexArrayBinds));
+
+	bool success = true;
+	if (expectedInstances == 0)
+	{
+		SDL_Log("Level3's first frame had no meshes in view");
+		success = false;
+	}
+	if (draws != expectedDraws || draws != stats.mDraws)
+	{
+		SDL_Log("Made %u draws (stats say %u), expected %u",
+			static_cast<unsigned>(draws), static_cast<unsigned>(stats.mDraws),
+			static_cast<unsigned>(expectedDraws));
+		success = false;
+	}
+	if (instances != expectedInstances || instances != stats.mInstances)
+	{
+		SDL_Log("Drew %u meshes (stats say %u), expected %u",
+			static_cast<unsigned>(instances), static_cast<unsigned>(stats.mInstances),
+			static_cast<unsigned>(expectedInstances));
+		success = false;
+	}
+	if (programBinds != stats.mProgramBinds || textureBinds != stats.mTextureBinds ||
+		vertexArrayBinds != stats.mVAOBinds)
+	{
+		SDL_Log("Bind counts don't match the render stats");
+		success = false;
+	}
+	if (redundantBinds > 0)
+	{
+		SDL_Log("Bound what was already bound %u times",
+			static_cast<unsigned>(redundantBinds));
+		success = false;
+	}
+	// Sorting means each state is bound at most once per batch
+	if (programBinds > draws || textureBinds > draws || vertexArrayBinds > draws)
+	{
+		SDL_Log("More binds than draws");
+		success = false;
+	}
+	level.Shutdown();
+	return success;
+}
@@ -0,0 +1,44 @@
+// ----------------------------------------------------------------
+// From Game Programming in C++ by Sanjay Madhav
+// Copyright (C) 2017 Sanjay Madhav. All rights reserved.
+// 
+// Released under the BSD License
+// See LICENSE in root directory for full details.
+// ----------------------------------------------------------------
+
+#pragma once
+
+// Checks that the engine's optimized systems agree with simple
+// reference versions of themselves. The benchmark executable runs
+// these with -selftest, and exits nonzero if any of them fail.
+class SelfTest
+{
+public:
+	// Run every check, logging what failed, and return whether
+	// they all passed (the game only needs its simulation)
+	static bool RunAll(class Game* game);
+private:
+	// ParallelFor covers every index exactly once, and a job
+	// never starts before the counter it depends on is done
+	// (on one thread and on several)
+	static bool TestJobSystem();
+	// Once warmed up, a simulation step (with moving boxes, balls
+	// bouncing around an arena, and stacked rigid bodies) makes no
+	// heap allocations
+	static bool TestFrameAllocations(class Game* game);
+	// Over 300 frames of boxes moving, coming and going, and
+	// changing layers, masks and triggers at random, TestOverlaps
+	// and TestTriggers report exactly the begins, persists and ends
+	// that testing every pair from scratch says they should
+	static bool TestOverlapEvents(class Game* game);
+	// Frustum planes match clip space, and CullBoxes/CullSpheres
+	// (at every SIMD level) keep exactly what Intersect does, for
+	// both the follow camera's view and the mirror's
+	static bool TestCulling();
+	// Drawing Level3 through the null device, the G-buffer pass
+	// makes one draw per visible mesh/texture (plus one per skinned
+	// mesh), with every instance in them, and never binds a program,
+	// texture or vertex array that's already bound. This loads its
+	// own headless game, so it needs the level's assets.
+	static bool TestLevelDraw();
+};
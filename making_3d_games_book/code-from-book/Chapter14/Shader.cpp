@@ -11,11 +11,26 @@
 #include <SDL/SDL.h>
 #include <fstream>
 #include <sstream>
+#include <vector>
 
-Shader::Shader()
-	: mShaderProgram(0)
-	, mVertexShader(0)
-	, mFragShader(0)
+namespace
+{
+	// FNV-1a hash of a uniform name
+	uint32_t HashName(const char* name)
+	{
+		uint32_t hash = 2166136261u;
+		for (const char* c = name; *c != '\0'; c++)
+		{
+			hash ^= static_cast<uint8_t>(*c);
+			hash *= 16777619u;
+		}
+		return hash;
+	}
+}
+
+Shader::Shader(RenderDevice* device)
+	: mDevice(device)
+	, mShaderProgram(0)
 {
 	
 }
@@ -27,157 +42,175 @@ Shader::~Shader()
 
 bool Shader::Load(const std::string& vertName, const std::string& fragName)
 {
-	// Compile vertex and pixel shaders
-	if (!CompileShader(vertName,
-					   GL_VERTEX_SHADER,
-					   mVertexShader) ||
-		!CompileShader(fragName,
-					   GL_FRAGMENT_SHADER,
-					   mFragShader))
+	// Read the vertex and pixel shaders
+	std::string vertSource;
+	std::string fragSource;
+	if (!ReadFile(vertName, vertSource) ||
+		!ReadFile(fragName, fragSource))
 	{
 		return false;
 	}
 	
-	// Now create a shader program that
-	// links together the vertex/frag shaders
-	mShaderProgram = glCreateProgram();
-	glAttachShader(mShaderProgram, mVertexShader);
-	glAttachShader(mShaderProgram, mFragShader);
-	glLinkProgram(mShaderProgram);
-	
-	// Verify that the program linked successfully
-	if (!IsValidProgram())
+	// Compile them and link them together into a program
+	mShaderProgram = mDevice->CreateProgram(vertSource.c_str(), fragSource.c_str());
+	if (mShaderProgram == 0)
 	{
+		SDL_Log("Failed to build shader from %s and %s",
+			vertName.c_str(), fragName.c_str());
 		return false;
 	}
-	
+
+	// Look up every uniform now, rather than on each set
+	ReflectUniforms();
 	return true;
 }
 
 void Shader::Unload()
 {
-	// Delete the program/shaders
-	glDeleteProgram(mShaderProgram);
-	glDeleteShader(mVertexShader);
-	glDeleteShader(mFragShader);
+	// Delete the program
+	if (mShaderProgram != 0)
+	{
+		mDevice->DestroyProgram(mShaderProgram);
+		mShaderProgram = 0;
+	}
+	mUniforms.clear();
 }
 
 void Shader::SetActive()
 {
 	// Set this program as the active one
-	glUseProgram(mShaderProgram);
+	mDevice->UseProgram(mShaderProgram);
 }
 
 void Shader::SetMatrixUniform(const char* name, const Matrix4& matrix)
 {
-	// Find the uniform by this name
-	GLuint loc = glGetUniformLocation(mShaderProgram, name);
-	// Send the matrix data to the uniform
-	glUniformMatrix4fv(loc, 1, GL_TRUE, matrix.GetAsFloatPtr());
+	// Find the uniform by this name, and send the matrix data
+	mDevice->SetUniform(FindUniform(name), &matrix, 1);
 }
 
 void Shader::SetMatrixUniforms(const char* name, Matrix4* matrices, unsigned count)
 {
-	GLuint loc = glGetUniformLocation(mShaderProgram, name);
-	// Send the matrix data to the uniform
-	glUniformMatrix4fv(loc, count, GL_TRUE, matrices->GetAsFloatPtr());
+	mDevice->SetUniform(FindUniform(name), matrices, count);
 }
 
 void Shader::SetVectorUniform(const char* name, const Vector3& vector)
 {
-	GLuint loc = glGetUniformLocation(mShaderProgram, name);
-	// Send the vector data
-	glUniform3fv(loc, 1, vector.GetAsFloatPtr());
+	mDevice->SetUniform(FindUniform(name), vector);
 }
 
 void Shader::SetVector2Uniform(const char* name, const Vector2& vector)
 {
-	GLuint loc = glGetUniformLocation(mShaderProgram, name);
-	// Send the vector data
-	glUniform2fv(loc, 1, vector.GetAsFloatPtr());
+	mDevice->SetUniform(FindUniform(name), vector);
 }
 
 void Shader::SetFloatUniform(const char* name, float value)
 {
-	GLuint loc = glGetUniformLocation(mShaderProgram, name);
-	// Send the float data
-	glUniform1f(loc, value);
+	mDevice->SetUniform(FindUniform(name), value);
 }
 
 void Shader::SetIntUniform(const char* name, int value)
 {
-	GLuint loc = glGetUniformLocation(mShaderProgram, name);
-	// Send the float data
-	glUniform1i(loc, value);
+	mDevice->SetUniform(FindUniform(name), value);
 }
 
-bool Shader::CompileShader(const std::string& fileName,
-				   GLenum shaderType,
-				   GLuint& outShader)
+void Shader::SetUniform(UniformHandle<Matrix4> handle, const Matrix4& matrix)
 {
-	// Open file
-	std::ifstream shaderFile(fileName);
-	if (shaderFile.is_open())
+	mDevice->SetUniform(handle.GetLocation(), &matrix, 1);
+}
+
+void Shader::SetUniform(UniformHandle<Vector3> handle, const Vector3& vector)
+{
+	mDevice->SetUniform(handle.GetLocation(), vector);
+}
+
+void Shader::SetUniform(UniformHandle<Vector2> handle, const Vector2& vector)
+{
+	mDevice->SetUniform(handle.GetLocation(), vector);
+}
+
+void Shader::SetUniform(UniformHandle<float> handle, float value)
+{
+	mDevice->SetUniform(handle.GetLocation(), value);
+}
+
+void Shader::SetUniform(UniformHandle<int> handle, int value)
+{
+	mDevice->SetUniform(handle.GetLocation(), value);
+}
+
+bool Shader::BindUniformBlock(const char* name, unsigned binding)
+{
+	if (!mDevice->BindUniformBlock(mShaderProgram, name, binding))
 	{
-		// Read all of the text into a string
-		std::stringstream sstream;
-		sstream << shaderFile.rdbuf();
-		std::string contents = sstream.str();
-		const char* contentsChar = contents.c_str();
-		
-		// Create a shader of the specified type
-		outShader = glCreateShader(shaderType);
-		// Set the source characters and try to compile
-		glShaderSource(outShader, 1, &(contentsChar), nullptr);
-		glCompileShader(outShader);
-		
-		if (!IsCompiled(outShader))
-		{
-			SDL_Log("Failed to compile shader %s", fileName.c_str());
-			return false;
-		}
+		SDL_Log("Shader has no uniform block %s", name);
+		return false;
 	}
-	else
+	return true;
+}
+
+bool Shader::ReadFile(const std::string& fileName, std::string& outContents)
+{
+	// Open file
+	std::ifstream shaderFile(fileName);
+	if (!shaderFile.is_open())
 	{
 		SDL_Log("Shader file not found: %s", fileName.c_str());
 		return false;
 	}
-	
+	// Read all of the text into a string
+	std::stringstream sstream;
+	sstream << shaderFile.rdbuf();
+	outContents = sstream.str();
 	return true;
 }
 
-bool Shader::IsCompiled(GLuint shader)
+void Shader::ReflectUniforms()
 {
-	GLint status;
-	// Query the compile status
-	glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
-	
-	if (status != GL_TRUE)
+	mUniforms.clear();
+	std::vector<RenderDevice::UniformDesc> uniforms;
+	mDevice->GetUniforms(mShaderProgram, uniforms);
+	for (const RenderDevice::UniformDesc& u : uniforms)
 	{
-		char buffer[512];
-		memset(buffer, 0, 512);
-		glGetShaderInfoLog(shader, 511, nullptr, buffer);
-		SDL_Log("GLSL Compile Failed:\n%s", buffer);
-		return false;
+		uint32_t hash = HashName(u.mName.c_str());
+		auto iter = mUniforms.find(hash);
+		if (iter != mUniforms.end())
+		{
+			SDL_Log("Uniforms %s and %s have the same hash",
+				iter->second.mName.c_str(), u.mName.c_str());
+			continue;
+		}
+		UniformInfo info;
+		info.mName = u.mName;
+		info.mLocation = u.mLocation;
+		info.mType = u.mType;
+		mUniforms.emplace(hash, info);
 	}
-	
-	return true;
 }
 
-bool Shader::IsValidProgram()
+int Shader::FindUniform(const char* name) const
 {
-	
-	GLint status;
-	// Query the link status
-	glGetProgramiv(mShaderProgram, GL_LINK_STATUS, &status);
-	if (status != GL_TRUE)
+	auto iter = mUniforms.find(HashName(name));
+	if (iter == mUniforms.end() || iter->second.mName != name)
 	{
-		char buffer[512];
-		memset(buffer, 0, 512);
-		glGetProgramInfoLog(mShaderProgram, 511, nullptr, buffer);
-		SDL_Log("GLSL Link Status:\n%s", buffer);
-		return false;
+		return -1;
 	}
-	
-	return true;
+	return iter->second.mLocation;
+}
+
+int Shader::FindUniform(const char* name, RenderDevice::UniformType type) const
+{
+	auto iter = mUniforms.find(HashName(name));
+	if (iter == mUniforms.end() || iter->second.mName != name)
+	{
+		return -1;
+	}
+	// Samplers are set with an int
+	const UniformInfo& info = iter->second;
+	if (info.mType != type &&
+		!(type == RenderDevice::EUniformInt && info.mType == RenderDevice::EUniformSampler))
+	{
+		SDL_Log("Uniform %s is set with the wrong type", name);
+		return -1;
+	}
+	return info.mLocation;
 }
@@ -7,14 +7,54 @@
 // ----------------------------------------------------------------
 
 #pragma once
-#include <GL/glew.h>
 #include <string>
+#include <unordered_map>
+#include <cstdint>
 #include "Math.h"
+#include "RenderDevice.h"
+
+// A uniform's location, found once with Shader::GetUniform so
+// setting it later needs no lookup. T is the type it's set with.
+template <typename T>
+class UniformHandle
+{
+public:
+	UniformHandle() :mLocation(-1) { }
+	explicit UniformHandle(int location) :mLocation(location) { }
+	int GetLocation() const { return mLocation; }
+	// False if the shader has no such uniform (or it's unused)
+	bool IsValid() const { return mLocation != -1; }
+private:
+	int mLocation;
+};
+
+// The type a uniform must have to be set with each handle type
+template <typename T> struct UniformType;
+template <> struct UniformType<Matrix4>
+{
+	static const RenderDevice::UniformType Value = RenderDevice::EUniformMatrix4;
+};
+template <> struct UniformType<Vector3>
+{
+	static const RenderDevice::UniformType Value = RenderDevice::EUniformVector3;
+};
+template <> struct UniformType<Vector2>
+{
+	static const RenderDevice::UniformType Value = RenderDevice::EUniformVector2;
+};
+template <> struct UniformType<float>
+{
+	static const RenderDevice::UniformType Value = RenderDevice::EUniformFloat;
+};
+template <> struct UniformType<int>
+{
+	static const RenderDevice::UniformType Value = RenderDevice::EUniformInt;
+};
 
 class Shader
 {
 public:
-	Shader();
+	Shader(class RenderDevice* device);
 	~Shader();
 	bool Load(const std::string& vertName, const std::string& fragName);
 	void Unload();
@@ -31,19 +71,43 @@ public:
 	void SetFloatUniform(const char* name, float value);
 	// Sets an integer uniform
 	void SetIntUniform(const char* name, int value);
+
+	// Find a uniform, to set through the handle (returns an
+	// invalid handle if there's no uniform of this type)
+	template <typename T>
+	UniformHandle<T> GetUniform(const char* name) const
+	{
+		return UniformHandle<T>(FindUniform(name, UniformType<T>::Value));
+	}
+	// Set a uniform through its handle (the shader must be active)
+	void SetUniform(UniformHandle<Matrix4> handle, const Matrix4& matrix);
+	void SetUniform(UniformHandle<Vector3> handle, const Vector3& vector);
+	void SetUniform(UniformHandle<Vector2> handle, const Vector2& vector);
+	void SetUniform(UniformHandle<float> handle, float value);
+	void SetUniform(UniformHandle<int> handle, int value);
+
+	// Use the buffer at this binding point for the named uniform block
+	bool BindUniformBlock(const char* name, unsigned binding);
 private:
-	// Tries to compile the specified shader
-	bool CompileShader(const std::string& fileName,
-					   GLenum shaderType,
-					   GLuint& outShader);
-	
-	// Tests whether shader compiled successfully
-	bool IsCompiled(GLuint shader);
-	// Tests whether vertex/fragment programs link
-	bool IsValidProgram();
+	// Read the whole file into outContents
+	bool ReadFile(const std::string& fileName, std::string& outContents);
+	// Cache the location of every active uniform
+	void ReflectUniforms();
+	// Location of the named uniform from the cache (-1 if there's none)
+	int FindUniform(const char* name) const;
+	// Same, but the uniform must also be of this type
+	int FindUniform(const char* name, RenderDevice::UniformType type) const;
 private:
-	// Store the shader object IDs
-	GLuint mVertexShader;
-	GLuint mFragShader;
-	GLuint mShaderProgram;
+	class RenderDevice* mDevice;
+	// Device ID of the program
+	unsigned int mShaderProgram;
+
+	struct UniformInfo
+	{
+		std::string mName;
+		int mLocation;
+		RenderDevice::UniformType mType;
+	};
+	// Active uniforms (outside of blocks), by hash of their name
+	std::unordered_map<uint32_t, UniformInfo> mUniforms;
 };
@@ -9,9 +9,33 @@
 // Request GLSL 3.3
 #version 330
 
-// Uniforms for world transform and view-proj
+// Create a struct for directional light
+struct DirectionalLight
+{
+	// Direction of light
+	vec3 mDirection;
+	// Diffuse color
+	vec3 mDiffuseColor;
+	// Specular color
+	vec3 mSpecColor;
+};
+
+// Per-frame data, shared by every 3D shader (the renderer
+// updates this buffer once a frame)
+layout(std140, row_major) uniform FrameData
+{
+	// View-projection matrix
+	mat4 mViewProj;
+	// Camera position (in world space)
+	vec3 mCameraPos;
+	// Ambient light level
+	vec3 mAmbientLight;
+	// Directional Light
+	DirectionalLight mDirLight;
+} uFrame;
+
+// Uniform for world transform
 uniform mat4 uWorldTransform;
-uniform mat4 uViewProj;
 
 // Attribute 0 is position, 1 is normal, 2 is tex coords.
 layout(location = 0) in vec3 inPosition;
@@ -26,7 +50,7 @@ void main()
 	// Convert position to homogeneous coordinates
 	vec4 pos = vec4(inPosition, 1.0);
 	// Transform to position world space, then clip space
-	gl_Position = pos * uWorldTransform * uViewProj;
+	gl_Position = pos * uWorldTransform * uFrame.mViewProj;
 
 	// Pass along the texture coordinate to frag shader
 	fragTexCoord = inTexCoord;
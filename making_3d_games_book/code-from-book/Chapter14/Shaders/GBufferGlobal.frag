@@ -32,13 +32,19 @@ struct DirectionalLight
 	vec3 mSpecColor;
 };
 
-// Uniforms for lighting
-// Camera position (in world space)
-uniform vec3 uCameraPos;
-// Ambient light level
-uniform vec3 uAmbientLight;
-// Directional Light
-uniform DirectionalLight uDirLight;
+// Per-frame data, shared by every 3D shader (the renderer
+// updates this buffer once a frame)
+layout(std140, row_major) uniform FrameData
+{
+	// View-projection matrix
+	mat4 mViewProj;
+	// Camera position (in world space)
+	vec3 mCameraPos;
+	// Ambient light level
+	vec3 mAmbientLight;
+	// Directional Light
+	DirectionalLight mDirLight;
+} uFrame;
 
 void main()
 {
@@ -48,18 +54,18 @@ void main()
 	// Surface normal
 	vec3 N = normalize(gbufferNorm);
 	// Vector from surface to light
-	vec3 L = normalize(-uDirLight.mDirection);
+	vec3 L = normalize(-uFrame.mDirLight.mDirection);
 	// Vector from surface to camera
-	vec3 V = normalize(uCameraPos - gbufferWorldPos);
+	vec3 V = normalize(uFrame.mCameraPos - gbufferWorldPos);
 	// Reflection of -L about N
 	vec3 R = normalize(reflect(-L, N));
 
 	// Compute phong reflection
-	vec3 Phong = uAmbientLight;
+	vec3 Phong = uFrame.mAmbientLight;
 	float NdotL = dot(N, L);
 	if (NdotL > 0)
 	{
-		vec3 Diffuse = uDirLight.mDiffuseColor * dot(N, L);
+		vec3 Diffuse = uFrame.mDirLight.mDiffuseColor * dot(N, L);
 	}
 	// Clamp light between 0-1 RGB values
 	Phong = clamp(Phong, 0.0, 1.0);
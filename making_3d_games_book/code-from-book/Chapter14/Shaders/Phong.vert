@@ -9,9 +9,33 @@
 // Request GLSL 3.3
 #version 330
 
-// Uniforms for world transform and view-proj
+// Create a struct for directional light
+struct DirectionalLight
+{
+	// Direction of light
+	vec3 mDirection;
+	// Diffuse color
+	vec3 mDiffuseColor;
+	// Specular color
+	vec3 mSpecColor;
+};
+
+// Per-frame data, shared by every 3D shader (the renderer
+// updates this buffer once a frame)
+layout(std140, row_major) uniform FrameData
+{
+	// View-projection matrix
+	mat4 mViewProj;
+	// Camera position (in world space)
+	vec3 mCameraPos;
+	// Ambient light level
+	vec3 mAmbientLight;
+	// Directional Light
+	DirectionalLight mDirLight;
+} uFrame;
+
+// Uniform for world transform
 uniform mat4 uWorldTransform;
-uniform mat4 uViewProj;
 
 // Attribute 0 is position, 1 is normal, 2 is tex coords.
 layout(location = 0) in vec3 inPosition;
@@ -34,7 +58,7 @@ void main()
 	// Save world position
 	fragWorldPos = pos.xyz;
 	// Transform to clip space
-	gl_Position = pos * uViewProj;
+	gl_Position = pos * uFrame.mViewProj;
 
 	// Transform normal into world space (w = 0)
 	fragNormal = (vec4(inNormal, 0.0f) * uWorldTransform).xyz;
@@ -0,0 +1,70 @@
+// ----------------------------------------------------------------
+// From Game Programming in C++ by Sanjay Madhav
+// Copyright (C) 2017 Sanjay Madhav. All rights reserved.
+// 
+// Released under the BSD License
+// See LICENSE in root directory for full details.
+// ----------------------------------------------------------------
+
+// Request GLSL 3.3
+#version 330
+
+// Create a struct for directional light
+struct DirectionalLight
+{
+	// Direction of light
+	vec3 mDirection;
+	// Diffuse color
+	vec3 mDiffuseColor;
+	// Specular color
+	vec3 mSpecColor;
+};
+
+// Per-frame data, shared by every 3D shader (the renderer
+// updates this buffer once a frame)
+layout(std140, row_major) uniform FrameData
+{
+	// View-projection matrix
+	mat4 mViewProj;
+	// Camera position (in world space)
+	vec3 mCameraPos;
+	// Ambient light level
+	vec3 mAmbientLight;
+	// Directional Light
+	DirectionalLight mDirLight;
+} uFrame;
+
+// Attribute 0 is position, 1 is normal, 2 is tex coords.
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec2 inTexCoord;
+// Attributes 3-6 are the instance's world transform, one row
+// per attribute. GLSL fills a mat4 attribute a column at a time,
+// so this is the transpose of the world transform, and it
+// multiplies on the left instead of the right.
+layout(location = 3) in mat4 inWorldTransform;
+
+// Any vertex outputs (other than position)
+out vec2 fragTexCoord;
+// Normal (in world space)
+out vec3 fragNormal;
+// Position (in world space)
+out vec3 fragWorldPos;
+
+void main()
+{
+	// Convert position to homogeneous coordinates
+	vec4 pos = vec4(inPosition, 1.0);
+	// Transform position to world space
+	pos = inWorldTransform * pos;
+	// Save world position
+	fragWorldPos = pos.xyz;
+	// Transform to clip space
+	gl_Position = pos * uFrame.mViewProj;
+
+	// Transform normal into world space (w = 0)
+	fragNormal = (inWorldTransform * vec4(inNormal, 0.0f)).xyz;
+
+	// Pass along the texture coordinate to frag shader
+	fragTexCoord = inTexCoord;
+}
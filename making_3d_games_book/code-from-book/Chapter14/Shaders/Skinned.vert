@@ -9,9 +9,33 @@
 // Request GLSL 3.3
 #version 330
 
-// Uniforms for world transform and view-proj
+// Create a struct for directional light
+struct DirectionalLight
+{
+	// Direction of light
+	vec3 mDirection;
+	// Diffuse color
+	vec3 mDiffuseColor;
+	// Specular color
+	vec3 mSpecColor;
+};
+
+// Per-frame data, shared by every 3D shader (the renderer
+// updates this buffer once a frame)
+layout(std140, row_major) uniform FrameData
+{
+	// View-projection matrix
+	mat4 mViewProj;
+	// Camera position (in world space)
+	vec3 mCameraPos;
+	// Ambient light level
+	vec3 mAmbientLight;
+	// Directional Light
+	DirectionalLight mDirLight;
+} uFrame;
+
+// Uniform for world transform
 uniform mat4 uWorldTransform;
-uniform mat4 uViewProj;
 // Uniform for matrix palette
 uniform mat4 uMatrixPalette[96];
 
@@ -47,7 +71,7 @@ void main()
 	// Save world position
 	fragWorldPos = skinnedPos.xyz;
 	// Transform to clip space
-	gl_Position = skinnedPos * uViewProj;
+	gl_Position = skinnedPos * uFrame.mViewProj;
 
 	// Skin the vertex normal
 	vec4 skinnedNormal = vec4(inNormal, 0.0f);
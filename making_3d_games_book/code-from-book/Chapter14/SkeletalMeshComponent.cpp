@@ -17,6 +17,7 @@
 #include "Animation.h"
 #include "Skeleton.h"
 #include "LevelLoader.h"
+#include "FrameAllocator.h"
 
 SkeletalMeshComponent::SkeletalMeshComponent(Actor* owner)
 	:MeshComponent(owner, true)
@@ -24,30 +25,12 @@ SkeletalMeshComponent::SkeletalMeshComponent(Actor* owner)
 {
 }
 
-void SkeletalMeshComponent::Draw(Shader* shader)
+void SkeletalMeshComponent::SetDrawUniforms(Shader* shader)
 {
-	if (mMesh)
-	{
-		// Set the world transform
-		shader->SetMatrixUniform("uWorldTransform", 
-			mOwner->GetWorldTransform());
-		// Set the matrix palette
-		shader->SetMatrixUniforms("uMatrixPalette", &mPalette.mEntry[0], 
-			MAX_SKELETON_BONES);
-		// Set specular power
-		shader->SetFloatUniform("uSpecPower", mMesh->GetSpecPower());
-		// Set the active texture
-		Texture* t = mMesh->GetTexture(mTextureIndex);
-		if (t)
-		{
-			t->SetActive();
-		}
-		// Set the mesh's vertex array as active
-		VertexArray* va = mMesh->GetVertexArray();
-		va->SetActive();
-		// Draw
-		glDrawElements(GL_TRIANGLES, va->GetNumIndices(), GL_UNSIGNED_INT, nullptr);
-	}
+	MeshComponent::SetDrawUniforms(shader);
+	// Set the matrix palette
+	shader->SetMatrixUniforms("uMatrixPalette", &mPalette.mEntry[0], 
+		MAX_SKELETON_BONES);
 }
 
 void SkeletalMeshComponent::Update(float deltaTime)
@@ -120,8 +103,9 @@ void SkeletalMeshComponent::SaveProperties(rapidjson::Document::AllocatorType& a
 void SkeletalMeshComponent::ComputeMatrixPalette()
 {
 	const std::vector<Matrix4>& globalInvBindPoses = mSkeleton->GetGlobalInvBindPoses();
-	std::vector<Matrix4> currentPoses;
-	mAnimation->GetGlobalPoseAtTime(currentPoses, mSkeleton, mAnimTime);
+	// (Only needed until the palette's built)
+	FrameVector<Matrix4> currentPoses(mAnimation->GetNumBones());
+	mAnimation->GetGlobalPoseAtTime(currentPoses.data(), mSkeleton, mAnimTime);
 
 	// Setup the palette for each bone
 	for (size_t i = 0; i < mSkeleton->GetNumBones(); i++)
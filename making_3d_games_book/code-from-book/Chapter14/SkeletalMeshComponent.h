@@ -14,8 +14,8 @@ class SkeletalMeshComponent : public MeshComponent
 {
 public:
 	SkeletalMeshComponent(class Actor* owner);
-	// Draw this mesh component
-	void Draw(class Shader* shader) override;
+	// Also sets the matrix palette
+	void SetDrawUniforms(class Shader* shader) override;
 
 	void Update(float deltaTime) override;
 
@@ -12,6 +12,7 @@
 #include "Actor.h"
 #include "Game.h"
 #include "Renderer.h"
+#include "RenderDevice.h"
 #include "LevelLoader.h"
 
 SpriteComponent::SpriteComponent(Actor* owner, int drawOrder)
@@ -50,7 +51,7 @@ void SpriteComponent::Draw(Shader* shader)
 		// Set current texture
 		mTexture->SetActive();
 		// Draw quad
-		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
+		mOwner->GetGame()->GetRenderer()->GetDevice()->DrawIndexed(6);
 	}
 }
 
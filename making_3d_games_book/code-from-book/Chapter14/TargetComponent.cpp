@@ -17,11 +17,12 @@
 
 TargetComponent::TargetComponent(Actor * owner)
 	:Component(owner)
+	,mTarget(owner->GetHandle())
 {
-	mOwner->GetGame()->GetHUD()->AddTargetComponent(this);
+	mOwner->GetGame()->GetHUD()->AddTarget(mTarget);
 }
 
 TargetComponent::~TargetComponent()
 {
-	mOwner->GetGame()->GetHUD()->RemoveTargetComponent(this);
+	mOwner->GetGame()->GetHUD()->RemoveTarget(mTarget);
 }
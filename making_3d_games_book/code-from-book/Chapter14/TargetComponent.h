@@ -8,6 +8,7 @@
 
 #pragma once
 #include "Component.h"
+#include "ActorHandle.h"
 
 class TargetComponent : public Component
 {
@@ -15,4 +16,8 @@ public:
 	TargetComponent(class Actor* owner);
 	~TargetComponent();
 	TypeID GetType() const override { return TTargetComponent; }
+private:
+	// The owner's handle (which it no longer has by the
+	// time its components are deleted)
+	ActorHandle mTarget;
 };
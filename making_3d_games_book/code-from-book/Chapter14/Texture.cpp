@@ -8,13 +8,14 @@
 
 #include "Texture.h"
 #include <SOIL/SOIL.h>
-#include <GL/glew.h>
 #include <SDL/SDL.h>
 
-Texture::Texture()
-:mTextureID(0)
+Texture::Texture(RenderDevice* device)
+:mDevice(device)
+,mTextureID(0)
 ,mWidth(0)
 ,mHeight(0)
+,mSortID(0)
 {
 	
 }
@@ -37,43 +38,28 @@ bool Texture::Load(const std::string& fileName)
 		SDL_Log("SOIL failed to load image %s: %s", fileName.c_str(), SOIL_last_result());
 		return false;
 	}
-	
-	int format = GL_RGB;
+
+	RenderDevice::TextureFormat format = RenderDevice::ERGB8;
 	if (channels == 4)
 	{
-		format = GL_RGBA;
+		format = RenderDevice::ERGBA8;
 	}
 	
-	glGenTextures(1, &mTextureID);
-	glBindTexture(GL_TEXTURE_2D, mTextureID);
-	
-	glTexImage2D(GL_TEXTURE_2D, 0, format, mWidth, mHeight, 0, format,
-				 GL_UNSIGNED_BYTE, image);
+	// Use mipmaps, for linear filtering
+	mTextureID = mDevice->CreateTexture(mWidth, mHeight, format, image,
+		RenderDevice::EMipmapped);
 	
 	SOIL_free_image_data(image);
-	
-	// Generate mipmaps for texture
-	glGenerateMipmap(GL_TEXTURE_2D);
-	// Enable linear filtering
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	// Enable anisotropic filtering, if supported
-	if (GLEW_EXT_texture_filter_anisotropic)
-	{
-		// Get the maximum anisotropy value
-		GLfloat largest;
-		glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &largest);
-		// Enable it
-		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, largest);
-	}
-	
 	return true;
 }
 
 void Texture::Unload()
 {
-	glDeleteTextures(1, &mTextureID);
+	if (mTextureID != 0)
+	{
+		mDevice->DestroyTexture(mTextureID);
+		mTextureID = 0;
+	}
 }
 
 void Texture::CreateFromSurface(SDL_Surface* surface)
@@ -81,35 +67,22 @@ void Texture::CreateFromSurface(SDL_Surface* surface)
 	mWidth = surface->w;
 	mHeight = surface->h;
 	
-	// Generate a GL texture
-	glGenTextures(1, &mTextureID);
-	glBindTexture(GL_TEXTURE_2D, mTextureID);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, mWidth, mHeight, 0, GL_BGRA,
-				 GL_UNSIGNED_BYTE, surface->pixels);
-	
-	// Use linear filtering
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	// Generate a texture (with linear filtering)
+	mTextureID = mDevice->CreateTexture(mWidth, mHeight, RenderDevice::EBGRA8,
+		surface->pixels, RenderDevice::ELinear);
 }
 
-void Texture::CreateForRendering(int width, int height, unsigned int format)
+void Texture::CreateForRendering(int width, int height, RenderDevice::TextureFormat format)
 {
 	mWidth = width;
 	mHeight = height;
-	// Create the texture id
-	glGenTextures(1, &mTextureID);
-	glBindTexture(GL_TEXTURE_2D, mTextureID);
 	// Set the image width/height with null initial data
-	glTexImage2D(GL_TEXTURE_2D, 0, format, mWidth, mHeight, 0, GL_RGB,
-		GL_FLOAT, nullptr);
-
 	// For a texture we'll render to, just use nearest neighbor
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	mTextureID = mDevice->CreateTexture(mWidth, mHeight, format, nullptr,
+		RenderDevice::ENearest);
 }
 
 void Texture::SetActive(int index)
 {
-	glActiveTexture(GL_TEXTURE0 + index);
-	glBindTexture(GL_TEXTURE_2D, mTextureID);
+	mDevice->BindTexture(mTextureID, static_cast<unsigned>(index));
 }
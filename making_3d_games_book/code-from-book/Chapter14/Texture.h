@@ -7,17 +7,18 @@
 // ----------------------------------------------------------------
 
 #include <string>
+#include "RenderDevice.h"
 
 class Texture
 {
 public:
-	Texture();
+	Texture(class RenderDevice* device);
 	~Texture();
 	
 	bool Load(const std::string& fileName);
 	void Unload();
 	void CreateFromSurface(struct SDL_Surface* surface);
-	void CreateForRendering(int width, int height, unsigned int format);
+	void CreateForRendering(int width, int height, RenderDevice::TextureFormat format);
 	
 	void SetActive(int index = 0);
 	
@@ -26,9 +27,15 @@ public:
 	unsigned int GetTextureID() const { return mTextureID; }
 
 	const std::string& GetFileName() const { return mFileName; }
+
+	// Small ID the renderer sorts draws by (0 if it didn't load this)
+	unsigned int GetSortID() const { return mSortID; }
+	void SetSortID(unsigned int id) { mSortID = id; }
 private:
 	std::string mFileName;
+	class RenderDevice* mDevice;
 	unsigned int mTextureID;
 	int mWidth;
 	int mHeight;
+	unsigned int mSortID;
 };
@@ -0,0 +1,460 @@
+// ----------------------------------------------------------------
+// From Game Programming in C++ by Sanjay Madhav
+// Copyright (C) 2017 Sanjay Madhav. All rights reserved.
+// 
+// Released under the BSD License
+// See LICENSE in root directory for full details.
+// ----------------------------------------------------------------
+
+#include "TransformStore.h"
+#include "Actor.h"
+#include "Profiler.h"
+#include <algorithm>
+
+// SSE is always there on x64 (and 32-bit builds that ask for it)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TRANSFORM_STORE_SSE
+#include <xmmintrin.h>
+#endif
+
+const uint32_t TransformStore::InvalidIndex;
+
+TransformStore::TransformStore()
+	:mNumDirtyWords(0)
+	,mChildOrderDirty(false)
+	,mCount(0)
+{
+}
+
+uint32_t TransformStore::Add(Actor* owner)
+{
+	size_t index = mCount;
+	mCount++;
+
+	// Grow every array in blocks of 4
+	if (mCount > mPosX.size())
+	{
+		size_t newSize = mPosX.size() + 4;
+		for (auto v : { &mPosX, &mPosY, &mPosZ, &mRotX, &mRotY, &mRotZ,
+			&mPrevPosX, &mPrevPosY, &mPrevPosZ, &mPrevRotX, &mPrevRotY, &mPrevRotZ })
+		{
+			v->resize(newSize, 0.0f);
+		}
+		for (auto v : { &mRotW, &mScale, &mPrevRotW, &mPrevScale })
+		{
+			v->resize(newSize, 1.0f);
+		}
+		mHasPrev.resize(newSize, 0);
+		mMoved.resize(newSize, 0);
+		mParent.resize(newSize, InvalidIndex);
+		mDepth.resize(newSize, 0);
+		mNumChildren.resize(newSize, 0);
+		mWorld.resize(newSize);
+		mRender.resize(newSize);
+		mOwners.resize(newSize, nullptr);
+
+		// Atomics can't be moved, so copy the dirty bits to a new array
+		size_t numWords = (newSize + 63) / 64;
+		if (numWords > mNumDirtyWords)
+		{
+			std::unique_ptr<std::atomic<uint64_t>[]> dirty(new std::atomic<uint64_t>[numWords]);
+			for (size_t i = 0; i < numWords; i++)
+			{
+				dirty[i].store(i < mNumDirtyWords ? mDirty[i].load() : 0);
+			}
+			mDirty = std::move(dirty);
+			mNumDirtyWords = numWords;
+		}
+	}
+
+	// Start as the identity (at the origin), with no parent
+	mOwners[index] = owner;
+	mParent[index] = InvalidIndex;
+	mDepth[index] = 0;
+	mNumChildren[index] = 0;
+	SetPosition(static_cast<uint32_t>(index), Vector3::Zero);
+	SetRotation(static_cast<uint32_t>(index), Quaternion::Identity);
+	SetScale(static_cast<uint32_t>(index), 1.0f);
+	mWorld[index] = Matrix4::Identity;
+	mRender[index] = Matrix4::Identity;
+	mHasPrev[index] = 0;
+	return static_cast<uint32_t>(index);
+}
+
+void TransformStore::Remove(uint32_t index)
+{
+	// (Owners detach from the hierarchy before this)
+	size_t last = mCount - 1;
+	if (index != last)
+	{
+		// Move the last transform into this slot
+		MoveTransform(last, index);
+		mOwners[index]->mTransformIndex = index;
+		// Its children need to know where it went
+		for (Actor* child : mOwners[index]->mChildren)
+		{
+			mParent[child->mTransformIndex] = index;
+		}
+		if (mParent[index] != InvalidIndex || mNumChildren[index] > 0)
+		{
+			mChildOrderDirty = true;
+		}
+	}
+	mOwners[last] = nullptr;
+	mDirty[last >> 6] &= ~(1ull << (last & 63));
+	mCount--;
+}
+
+void TransformStore::MoveTransform(size_t from, size_t to)
+{
+	mPosX[to] = mPosX[from];
+	mPosY[to] = mPosY[from];
+	mPosZ[to] = mPosZ[from];
+	mRotX[to] = mRotX[from];
+	mRotY[to] = mRotY[from];
+	mRotZ[to] = mRotZ[from];
+	mRotW[to] = mRotW[from];
+	mScale[to] = mScale[from];
+	mPrevPosX[to] = mPrevPosX[from];
+	mPrevPosY[to] = mPrevPosY[from];
+	mPrevPosZ[to] = mPrevPosZ[from];
+	mPrevRotX[to] = mPrevRotX[from];
+	mPrevRotY[to] = mPrevRotY[from];
+	mPrevRotZ[to] = mPrevRotZ[from];
+	mPrevRotW[to] = mPrevRotW[from];
+	mPrevScale[to] = mPrevScale[from];
+	mHasPrev[to] = mHasPrev[from];
+	mParent[to] = mParent[from];
+	mDepth[to] = mDepth[from];
+	mNumChildren[to] = mNumChildren[from];
+	mWorld[to] = mWorld[from];
+	mRender[to] = mRender[from];
+	mOwners[to] = mOwners[from];
+
+	// The dirty bit moves too
+	uint64_t fromBit = 1ull << (from & 63);
+	uint64_t toBit = 1ull << (to & 63);
+	if (mDirty[from >> 6] & fromBit)
+	{
+		mDirty[to >> 6] |= toBit;
+	}
+	else
+	{
+		mDirty[to >> 6] &= ~toBit;
+	}
+}
+
+void TransformStore::SetParent(uint32_t index, uint32_t parentIndex)
+{
+	if (mParent[index] != InvalidIndex)
+	{
+		mNumChildren[mParent[index]]--;
+	}
+	mParent[index] = parentIndex;
+	if (parentIndex != InvalidIndex)
+	{
+		mNumChildren[parentIndex]++;
+	}
+	UpdateDepths(index);
+	mChildOrderDirty = true;
+
+	// Force this (and everything under it) to recompute, even if
+	// it was already dirty
+	mDirty[index >> 6] &= ~(1ull << (index & 63));
+	MarkDirty(index);
+}
+
+void TransformStore::MarkChildrenDirty(uint32_t index)
+{
+	for (Actor* child : mOwners[index]->mChildren)
+	{
+		MarkDirty(child->mTransformIndex);
+	}
+}
+
+void TransformStore::UpdateDepths(uint32_t index)
+{
+	uint32_t parent = mParent[index];
+	mDepth[index] = (parent == InvalidIndex) ? 0 : mDepth[parent] + 1;
+	for (Actor* child : mOwners[index]->mChildren)
+	{
+		UpdateDepths(child->mTransformIndex);
+	}
+}
+
+void TransformStore::SortChildren()
+{
+	mChildOrder.clear();
+	for (size_t i = 0; i < mCount; i++)
+	{
+		if (mParent[i] != InvalidIndex)
+		{
+			mChildOrder.emplace_back(static_cast<uint32_t>(i));
+		}
+	}
+	std::sort(mChildOrder.begin(), mChildOrder.end(),
+		[this](uint32_t a, uint32_t b) {
+			return mDepth[a] < mDepth[b];
+	});
+	mChildOrderDirty = false;
+}
+
+void TransformStore::ComputeWorldTransform(uint32_t index)
+{
+	ComputeLocal(index, mWorld[index]);
+	uint32_t parent = mParent[index];
+	if (parent != InvalidIndex)
+	{
+		// Make sure the parent is up to date first
+		if (IsDirty(parent))
+		{
+			ComputeWorldTransform(parent);
+		}
+		mWorld[index] *= mWorld[parent];
+	}
+	mDirty[index >> 6] &= ~(1ull << (index & 63));
+	mOwners[index]->NotifyWorldTransform();
+}
+
+void TransformStore::UpdateWorldTransforms()
+{
+	PROFILE_SCOPE("TransformStore::UpdateWorldTransforms");
+	// Recompute the local transform of each block of 4 with
+	// anything dirty in it (roots are done after this)
+	bool anyDirty = false;
+	for (size_t word = 0; word < mNumDirtyWords; word++)
+	{
+		uint64_t bits = mDirty[word];
+		if (bits == 0)
+		{
+			continue;
+		}
+		anyDirty = true;
+		size_t base = word * 64;
+		for (size_t block = 0; block < 64; block += 4)
+		{
+			if ((bits >> block) & 0xF)
+			{
+				ComputeBlock(base + block);
+			}
+		}
+	}
+	if (!anyDirty)
+	{
+		return;
+	}
+
+	// Then put children in their parent's space, parents first
+	// (a dirty parent means all its children are dirty too). This
+	// covers every child in a recomputed block, not just dirty ones.
+	if (mChildOrderDirty)
+	{
+		SortChildren();
+	}
+	for (uint32_t index : mChildOrder)
+	{
+		uint64_t blockBits = 0xFull << (index & 60);
+		if (mDirty[index >> 6] & blockBits)
+		{
+			mWorld[index] *= mWorld[mParent[index]];
+		}
+	}
+
+	// Finally, tell the owners of everything that changed
+	for (size_t word = 0; word < mNumDirtyWords; word++)
+	{
+		uint64_t bits = mDirty[word];
+		// Clear first, so owners can dirty themselves again when told
+		mDirty[word] = 0;
+		size_t base = word * 64;
+		while (bits != 0)
+		{
+			size_t bit = 0;
+			while (((bits >> bit) & 1) == 0)
+			{
+				bit++;
+			}
+			bits &= bits - 1;
+			size_t index = base + bit;
+			if (index < mCount)
+			{
+				mOwners[index]->NotifyWorldTransform();
+			}
+		}
+	}
+}
+
+void TransformStore::ComputeBlock(size_t first)
+{
+#ifdef TRANSFORM_STORE_SSE
+	// Same as ComputeLocal, but for 4 transforms at once
+	// (each register holds one value for each of the 4)
+	__m128 x = _mm_loadu_ps(&mRotX[first]);
+	__m128 y = _mm_loadu_ps(&mRotY[first]);
+	__m128 z = _mm_loadu_ps(&mRotZ[first]);
+	__m128 w = _mm_loadu_ps(&mRotW[first]);
+	__m128 s = _mm_loadu_ps(&mScale[first]);
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 two = _mm_set1_ps(2.0f);
+
+	__m128 x2 = _mm_mul_ps(x, two);
+	__m128 y2 = _mm_mul_ps(y, two);
+	__m128 z2 = _mm_mul_ps(z, two);
+	__m128 xx = _mm_mul_ps(x, x2);
+	__m128 yy = _mm_mul_ps(y, y2);
+	__m128 zz = _mm_mul_ps(z, z2);
+	__m128 xy = _mm_mul_ps(x, y2);
+	__m128 xz = _mm_mul_ps(x, z2);
+	__m128 yz = _mm_mul_ps(y, z2);
+	__m128 wx = _mm_mul_ps(w, x2);
+	__m128 wy = _mm_mul_ps(w, y2);
+	__m128 wz = _mm_mul_ps(w, z2);
+
+	// Rotation matrix, scaled
+	__m128 r00 = _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(one, yy), zz), s);
+	__m128 r01 = _mm_mul_ps(_mm_add_ps(xy, wz), s);
+	__m128 r02 = _mm_mul_ps(_mm_sub_ps(xz, wy), s);
+	__m128 r10 = _mm_mul_ps(_mm_sub_ps(xy, wz), s);
+	__m128 r11 = _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(one, xx), zz), s);
+	__m128 r12 = _mm_mul_ps(_mm_add_ps(yz, wx), s);
+	__m128 r20 = _mm_mul_ps(_mm_add_ps(xz, wy), s);
+	__m128 r21 = _mm_mul_ps(_mm_sub_ps(yz, wx), s);
+	__m128 r22 = _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(one, xx), yy), s);
+	__m128 r03 = _mm_setzero_ps();
+	__m128 r13 = _mm_setzero_ps();
+	__m128 r23 = _mm_setzero_ps();
+	// Translation
+	__m128 r30 = _mm_loadu_ps(&mPosX[first]);
+	__m128 r31 = _mm_loadu_ps(&mPosY[first]);
+	__m128 r32 = _mm_loadu_ps(&mPosZ[first]);
+	__m128 r33 = one;
+
+	// Transpose so each register is one row of one matrix
+	_MM_TRANSPOSE4_PS(r00, r01, r02, r03);
+	_MM_TRANSPOSE4_PS(r10, r11, r12, r13);
+	_MM_TRANSPOSE4_PS(r20, r21, r22, r23);
+	_MM_TRANSPOSE4_PS(r30, r31, r32, r33);
+
+	__m128 rows[4][4] = {
+		{ r00, r10, r20, r30 },
+		{ r01, r11, r21, r31 },
+		{ r02, r12, r22, r32 },
+		{ r03, r13, r23, r33 }
+	};
+	for (int i = 0; i < 4; i++)
+	{
+		Matrix4& m = mWorld[first + i];
+		for (int row = 0; row < 4; row++)
+		{
+			_mm_storeu_ps(m.mat[row], rows[i][row]);
+		}
+	}
+#else
+	for (size_t i = first; i < first + 4; i++)
+	{
+		ComputeLocal(i, mWorld[i]);
+	}
+#endif
+}
+
+void TransformStore::ComputeLocal(size_t index, Matrix4& outMat) const
+{
+	// Scale, then rotate, then translate. This is the same as
+	// CreateScale * CreateFromQuaternion * CreateTranslation,
+	// without the two full matrix multiplies.
+	float x = mRotX[index];
+	float y = mRotY[index];
+	float z = mRotZ[index];
+	float w = mRotW[index];
+	float s = mScale[index];
+	Matrix4& m = outMat;
+
+	m.mat[0][0] = (1.0f - 2.0f * y * y - 2.0f * z * z) * s;
+	m.mat[0][1] = (2.0f * x * y + 2.0f * w * z) * s;
+	m.mat[0][2] = (2.0f * x * z - 2.0f * w * y) * s;
+	m.mat[0][3] = 0.0f;
+
+	m.mat[1][0] = (2.0f * x * y - 2.0f * w * z) * s;
+	m.mat[1][1] = (1.0f - 2.0f * x * x - 2.0f * z * z) * s;
+	m.mat[1][2] = (2.0f * y * z + 2.0f * w * x) * s;
+	m.mat[1][3] = 0.0f;
+
+	m.mat[2][0] = (2.0f * x * z + 2.0f * w * y) * s;
+	m.mat[2][1] = (2.0f * y * z - 2.0f * w * x) * s;
+	m.mat[2][2] = (1.0f - 2.0f * x * x - 2.0f * y * y) * s;
+	m.mat[2][3] = 0.0f;
+
+	m.mat[3][0] = mPosX[index];
+	m.mat[3][1] = mPosY[index];
+	m.mat[3][2] = mPosZ[index];
+	m.mat[3][3] = 1.0f;
+}
+
+void TransformStore::SnapshotTransforms()
+{
+	std::copy(mPosX.begin(), mPosX.end(), mPrevPosX.begin());
+	std::copy(mPosY.begin(), mPosY.end(), mPrevPosY.begin());
+	std::copy(mPosZ.begin(), mPosZ.end(), mPrevPosZ.begin());
+	std::copy(mRotX.begin(), mRotX.end(), mPrevRotX.begin());
+	std::copy(mRotY.begin(), mRotY.end(), mPrevRotY.begin());
+	std::copy(mRotZ.begin(), mRotZ.end(), mPrevRotZ.begin());
+	std::copy(mRotW.begin(), mRotW.end(), mPrevRotW.begin());
+	std::copy(mScale.begin(), mScale.end(), mPrevScale.begin());
+	std::fill(mHasPrev.begin(), mHasPrev.end(), 1);
+}
+
+void TransformStore::ComputeRenderTransforms(float alpha)
+{
+	PROFILE_SCOPE("TransformStore::ComputeRenderTransforms");
+	for (size_t i = 0; i < mCount; i++)
+	{
+		// Transforms that haven't been through a step yet (or that
+		// didn't move last step) just draw with their world transform
+		mMoved[i] = mHasPrev[i] &&
+			!(mPrevPosX[i] == mPosX[i] && mPrevPosY[i] == mPosY[i] &&
+			  mPrevPosZ[i] == mPosZ[i] && mPrevScale[i] == mScale[i] &&
+			  mPrevRotX[i] == mRotX[i] && mPrevRotY[i] == mRotY[i] &&
+			  mPrevRotZ[i] == mRotZ[i] && mPrevRotW[i] == mRotW[i]);
+		if (!mMoved[i])
+		{
+			mRender[i] = mWorld[i];
+			continue;
+		}
+
+		float scale = Math::Lerp(mPrevScale[i], mScale[i], alpha);
+		Quaternion rot = Quaternion::Slerp(
+			Quaternion(mPrevRotX[i], mPrevRotY[i], mPrevRotZ[i], mPrevRotW[i]),
+			Quaternion(mRotX[i], mRotY[i], mRotZ[i], mRotW[i]), alpha);
+		Vector3 pos = Vector3::Lerp(
+			Vector3(mPrevPosX[i], mPrevPosY[i], mPrevPosZ[i]),
+			Vector3(mPosX[i], mPosY[i], mPosZ[i]), alpha);
+		mRender[i] = Matrix4::CreateScale(scale);
+		mRender[i] *= Matrix4::CreateFromQuaternion(rot);
+		mRender[i] *= Matrix4::CreateTranslation(pos);
+	}
+
+	// Children that moved (or whose parent moved) are so far only
+	// in their parent's space, so put them in the parent's render
+	// transform (parents first)
+	if (mChildOrderDirty)
+	{
+		SortChildren();
+	}
+	for (uint32_t index : mChildOrder)
+	{
+		uint32_t parent = mParent[index];
+		if (mMoved[parent])
+		{
+			if (!mMoved[index])
+			{
+				ComputeLocal(index, mRender[index]);
+				mMoved[index] = 1;
+			}
+			mRender[index] *= mRender[parent];
+		}
+		else if (mMoved[index])
+		{
+			mRender[index] *= mRender[parent];
+		}
+	}
+}
@@ -0,0 +1,154 @@
+// ----------------------------------------------------------------
+// From Game Programming in C++ by Sanjay Madhav
+// Copyright (C) 2017 Sanjay Madhav. All rights reserved.
+// 
+// Released under the BSD License
+// See LICENSE in root directory for full details.
+// ----------------------------------------------------------------
+
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include "Math.h"
+
+// Stores every actor's position/rotation/scale in contiguous
+// arrays (one array per float), so world transforms can be
+// recomputed in batches rather than one actor at a time.
+// A transform can have a parent, in which case its position/
+// rotation/scale are relative to the parent's world transform.
+class TransformStore
+{
+public:
+	TransformStore();
+
+	static const uint32_t InvalidIndex = 0xFFFFFFFF;
+
+	// Add a transform for this actor (returns its index)
+	uint32_t Add(class Actor* owner);
+	// Remove the transform at this index. The last transform moves
+	// into its place, and its owner is told the new index.
+	void Remove(uint32_t index);
+
+	Vector3 GetPosition(uint32_t index) const
+	{
+		return Vector3(mPosX[index], mPosY[index], mPosZ[index]);
+	}
+	void SetPosition(uint32_t index, const Vector3& pos)
+	{
+		mPosX[index] = pos.x;
+		mPosY[index] = pos.y;
+		mPosZ[index] = pos.z;
+		MarkDirty(index);
+	}
+	Quaternion GetRotation(uint32_t index) const
+	{
+		return Quaternion(mRotX[index], mRotY[index], mRotZ[index], mRotW[index]);
+	}
+	void SetRotation(uint32_t index, const Quaternion& rot)
+	{
+		mRotX[index] = rot.x;
+		mRotY[index] = rot.y;
+		mRotZ[index] = rot.z;
+		mRotW[index] = rot.w;
+		MarkDirty(index);
+	}
+	float GetScale(uint32_t index) const { return mScale[index]; }
+	void SetScale(uint32_t index, float scale)
+	{
+		mScale[index] = scale;
+		MarkDirty(index);
+	}
+
+	// Make the transform relative to the parent
+	// (or a root, if parentIndex is InvalidIndex)
+	void SetParent(uint32_t index, uint32_t parentIndex);
+	uint32_t GetParent(uint32_t index) const { return mParent[index]; }
+
+	const Matrix4& GetWorldTransform(uint32_t index) const { return mWorld[index]; }
+	const Matrix4& GetRenderTransform(uint32_t index) const { return mRender[index]; }
+
+	// Recompute one world transform right now (and tell its owner)
+	void ComputeWorldTransform(uint32_t index);
+	// Recompute every world transform that changed (and tell their owners)
+	void UpdateWorldTransforms();
+
+	// Save every transform as the start of this simulation step
+	void SnapshotTransforms();
+	// Blend between the previous and current step's transforms
+	// (alpha is the fraction of a step since the current one)
+	void ComputeRenderTransforms(float alpha);
+
+	size_t GetNumTransforms() const { return mCount; }
+private:
+	bool IsDirty(size_t index) const
+	{
+		return (mDirty[index >> 6] & (1ull << (index & 63))) != 0;
+	}
+	void MarkDirty(uint32_t index)
+	{
+		// Actors on different job threads can share a word, so set
+		// the bit atomically. If this was already dirty, so is
+		// everything under it.
+		uint64_t bit = 1ull << (index & 63);
+		uint64_t old = mDirty[index >> 6].fetch_or(bit, std::memory_order_relaxed);
+		if ((old & bit) == 0 && mNumChildren[index] > 0)
+		{
+			MarkChildrenDirty(index);
+		}
+	}
+	void MarkChildrenDirty(uint32_t index);
+	// Recompute depths for this transform and everything under it
+	void UpdateDepths(uint32_t index);
+	// Sort every transform with a parent by depth (parents first)
+	void SortChildren();
+	// Compute the local transforms for 4 transforms starting at first
+	void ComputeBlock(size_t first);
+	void ComputeLocal(size_t index, Matrix4& outMat) const;
+	// Copy every array's element from one index to another
+	void MoveTransform(size_t from, size_t to);
+
+	// Local transform
+	std::vector<float> mPosX;
+	std::vector<float> mPosY;
+	std::vector<float> mPosZ;
+	std::vector<float> mRotX;
+	std::vector<float> mRotY;
+	std::vector<float> mRotZ;
+	std::vector<float> mRotW;
+	std::vector<float> mScale;
+	// Transform at the start of the current simulation step
+	std::vector<float> mPrevPosX;
+	std::vector<float> mPrevPosY;
+	std::vector<float> mPrevPosZ;
+	std::vector<float> mPrevRotX;
+	std::vector<float> mPrevRotY;
+	std::vector<float> mPrevRotZ;
+	std::vector<float> mPrevRotW;
+	std::vector<float> mPrevScale;
+	// Whether there's a previous transform (new ones don't have one)
+	std::vector<uint8_t> mHasPrev;
+
+	std::vector<Matrix4> mWorld;
+	std::vector<Matrix4> mRender;
+	std::vector<class Actor*> mOwners;
+	// One bit per transform that changed since it was last computed
+	// (marking a transform also marks everything under it)
+	std::unique_ptr<std::atomic<uint64_t>[]> mDirty;
+	size_t mNumDirtyWords;
+
+	// Hierarchy
+	std::vector<uint32_t> mParent;
+	std::vector<uint32_t> mDepth;
+	std::vector<uint32_t> mNumChildren;
+	// Every transform with a parent, sorted by depth
+	std::vector<uint32_t> mChildOrder;
+	bool mChildOrderDirty;
+	// Whether each transform moved since the last step (for rendering)
+	std::vector<uint8_t> mMoved;
+
+	// Number of transforms in use (the arrays are padded
+	// to a multiple of 4 so batches never run off the end)
+	size_t mCount;
+};
@@ -11,6 +11,7 @@
 #include "Shader.h"
 #include "Game.h"
 #include "Renderer.h"
+#include "RenderDevice.h"
 #include "Font.h"
 
 UIScreen::UIScreen(Game* game)
@@ -157,6 +158,12 @@ void UIScreen::AddButton(const std::string& name, std::function<void()> onClick)
 void UIScreen::DrawTexture(class Shader* shader, class Texture* texture,
 				 const Vector2& offset, float scale, bool flipY)
 {
+	// Text isn't rendered when headless, so it has no texture
+	if (texture == nullptr)
+	{
+		return;
+	}
+
 	// Scale the quad by the width/height of texture
 	// and flip the y if we need to
 	float yScale = static_cast<float>(texture->GetHeight()) * scale;
@@ -177,7 +184,7 @@ void UIScreen::DrawTexture(class Shader* shader, class Texture* texture,
 	// Set current texture
 	texture->SetActive();
 	// Draw quad
-	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
+	mGame->GetRenderer()->GetDevice()->DrawIndexed(6);
 }
 
 void UIScreen::SetRelativeMouseMode(bool relative)
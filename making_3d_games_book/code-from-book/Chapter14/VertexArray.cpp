@@ -7,78 +7,74 @@
 // ----------------------------------------------------------------
 
 #include "VertexArray.h"
-#include <GL/glew.h>
+#include "RenderDevice.h"
 
-VertexArray::VertexArray(const void* verts, unsigned int numVerts, Layout layout,
-	const unsigned int* indices, unsigned int numIndices)
-	:mNumVerts(numVerts)
+VertexArray::VertexArray(RenderDevice* device, const void* verts, unsigned int numVerts,
+	Layout layout, const unsigned int* indices, unsigned int numIndices)
+	:mDevice(device)
+	,mNumVerts(numVerts)
 	,mNumIndices(numIndices)
 {
-	// Create vertex array
-	glGenVertexArrays(1, &mVertexArray);
-	glBindVertexArray(mVertexArray);
-
 	unsigned vertexSize = GetVertexSize(layout);
 
 	// Create vertex buffer
-	glGenBuffers(1, &mVertexBuffer);
-	glBindBuffer(GL_ARRAY_BUFFER, mVertexBuffer);
-	glBufferData(GL_ARRAY_BUFFER, numVerts * vertexSize, verts, GL_STATIC_DRAW);
+	mVertexBuffer = mDevice->CreateBuffer(RenderDevice::EVertexBuffer,
+		numVerts * vertexSize, verts, false);
 
 	// Create index buffer
-	glGenBuffers(1, &mIndexBuffer);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIndexBuffer);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, numIndices * sizeof(unsigned int), indices, GL_STATIC_DRAW);
+	mIndexBuffer = mDevice->CreateBuffer(RenderDevice::EIndexBuffer,
+		numIndices * sizeof(unsigned int), indices, false);
 
 	// Specify the vertex attributes
 	if (layout == PosNormTex)
 	{
-		// Position is 3 floats
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, vertexSize, 0);
-		// Normal is 3 floats
-		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, vertexSize,
-			reinterpret_cast<void*>(sizeof(float) * 3));
-		// Texture coordinates is 2 floats
-		glEnableVertexAttribArray(2);
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, vertexSize,
-			reinterpret_cast<void*>(sizeof(float) * 6));
+		RenderDevice::VertexAttrib attribs[] = {
+			// Position is 3 floats
+			{ 0, 3, RenderDevice::EAttribFloat, 0 },
+			// Normal is 3 floats
+			{ 1, 3, RenderDevice::EAttribFloat, sizeof(float) * 3 },
+			// Texture coordinates is 2 floats
+			{ 2, 2, RenderDevice::EAttribFloat, sizeof(float) * 6 }
+		};
+		mVertexArray = mDevice->CreateVertexArray(mVertexBuffer, mIndexBuffer,
+			vertexSize, attribs, 3);
 	}
-	else if (layout == PosNormSkinTex)
+	else
 	{
-		// Position is 3 floats
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, vertexSize, 0);
-		// Normal is 3 floats
-		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, vertexSize,
-			reinterpret_cast<void*>(sizeof(float) * 3));
-		// Skinning indices (keep as ints)
-		glEnableVertexAttribArray(2);
-		glVertexAttribIPointer(2, 4, GL_UNSIGNED_BYTE, vertexSize,
-			reinterpret_cast<void*>(sizeof(float) * 6));
-		// Skinning weights (convert to floats)
-		glEnableVertexAttribArray(3);
-		glVertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, GL_TRUE, vertexSize,
-			reinterpret_cast<void*>(sizeof(float) * 6 + sizeof(char) * 4));
-		// Texture coordinates
-		glEnableVertexAttribArray(4);
-		glVertexAttribPointer(4, 2, GL_FLOAT, GL_FALSE, vertexSize,
-			reinterpret_cast<void*>(sizeof(float) * 6 + sizeof(char) * 8));
+		RenderDevice::VertexAttrib attribs[] = {
+			// Position is 3 floats
+			{ 0, 3, RenderDevice::EAttribFloat, 0 },
+			// Normal is 3 floats
+			{ 1, 3, RenderDevice::EAttribFloat, sizeof(float) * 3 },
+			// Skinning indices (keep as ints)
+			{ 2, 4, RenderDevice::EAttribUInt8, sizeof(float) * 6 },
+			// Skinning weights (convert to floats)
+			{ 3, 4, RenderDevice::EAttribUNorm8, sizeof(float) * 6 + sizeof(char) * 4 },
+			// Texture coordinates
+			{ 4, 2, RenderDevice::EAttribFloat, sizeof(float) * 6 + sizeof(char) * 8 }
+		};
+		mVertexArray = mDevice->CreateVertexArray(mVertexBuffer, mIndexBuffer,
+			vertexSize, attribs, 5);
 	}
 }
 
 VertexArray::~VertexArray()
 {
-	glDeleteBuffers(1, &mVertexBuffer);
-	glDeleteBuffers(1, &mIndexBuffer);
-	glDeleteVertexArrays(1, &mVertexArray);
+	mDevice->DestroyBuffer(mVertexBuffer);
+	mDevice->DestroyBuffer(mIndexBuffer);
+	mDevice->DestroyVertexArray(mVertexArray);
 }
 
 void VertexArray::SetActive()
 {
-	glBindVertexArray(mVertexArray);
+	mDevice->BindVertexArray(mVertexArray);
+}
+
+void VertexArray::SetInstanceTransforms(unsigned int buffer, unsigned int firstInstance)
+{
+	// Attributes 3-6, with each Matrix4 after the one before
+	size_t offset = sizeof(float) * 16 * static_cast<size_t>(firstInstance);
+	mDevice->SetInstanceTransforms(buffer, 3, offset);
 }
 
 unsigned int VertexArray::GetVertexSize(VertexArray::Layout layout)
@@ -17,24 +17,29 @@ public:
 		PosNormSkinTex
 	};
 
-	VertexArray(const void* verts, unsigned int numVerts, Layout layout,
-		const unsigned int* indices, unsigned int numIndices);
+	VertexArray(class RenderDevice* device, const void* verts, unsigned int numVerts,
+		Layout layout, const unsigned int* indices, unsigned int numIndices);
 	~VertexArray();
 
 	void SetActive();
+	// Read a world transform per instance (as attributes 3-6) from
+	// this buffer of Matrix4s, starting at firstInstance. Call this
+	// with the vertex array active.
+	void SetInstanceTransforms(unsigned int buffer, unsigned int firstInstance);
 	unsigned int GetNumIndices() const { return mNumIndices; }
 	unsigned int GetNumVerts() const { return mNumVerts; }
 
 	static unsigned int GetVertexSize(VertexArray::Layout layout);
 private:
+	class RenderDevice* mDevice;
 	// How many vertices in the vertex buffer?
 	unsigned int mNumVerts;
 	// How many indices in the index buffer
 	unsigned int mNumIndices;
-	// OpenGL ID of the vertex buffer
+	// Device ID of the vertex buffer
 	unsigned int mVertexBuffer;
-	// OpenGL ID of the index buffer
+	// Device ID of the index buffer
 	unsigned int mIndexBuffer;
-	// OpenGL ID of the vertex array object
+	// Device ID of the vertex array object
 	unsigned int mVertexArray;
 };
\ No newline at end of file